@@ -331,6 +331,7 @@ Socket_t xSocket;
 static const TickType_t xReceiveTimeOut = portMAX_DELAY;
 const BaseType_t xBacklog = 20;
 BaseType_t xReuseSocket = pdTRUE;
+BaseType_t xQuickAck = pdTRUE;
 
 	/* Attempt to open the socket. */
 	xSocket = FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
@@ -349,6 +350,10 @@ BaseType_t xReuseSocket = pdTRUE;
 	SimpleTCPEchoServer.c for an example of a higher throughput TCP server that
 	uses are larger RX and TX buffer. */
 
+	/* The characters typed are echoed one by one, so don't let the client
+	wait for delayed ACK's. */
+	FreeRTOS_setsockopt( xSocket, 0, FREERTOS_SO_TCP_QUICKACK, &xQuickAck, sizeof( xQuickAck ) );
+
 	/* Bind the socket to the port that the client task will send to, then
 	listen for incoming connections. */
 	xBindAddress.sin_port = usPort;
@@ -284,6 +284,11 @@ uint8_t ucMinAgeFound = 0U;
 					optimisation. */
 					xARPCache[ x ].ucAge = ( uint8_t ) ipconfigMAX_ARP_AGE;
 					xARPCache[ x ].ucValid = ( uint8_t ) pdTRUE;
+					#if( ipconfigNETWORK_INTERFACES > 1 )
+					{
+						xARPCache[ x ].ucInterface = ( uint8_t ) xIPGetRxInterface();
+					}
+					#endif
 					return;
 				}
 
@@ -356,6 +361,11 @@ uint8_t ucMinAgeFound = 0U;
 			/* And this entry does not need immediate attention */
 			xARPCache[ xUseEntry ].ucAge = ( uint8_t ) ipconfigMAX_ARP_AGE;
 			xARPCache[ xUseEntry ].ucValid = ( uint8_t ) pdTRUE;
+			#if( ipconfigNETWORK_INTERFACES > 1 )
+			{
+				xARPCache[ xUseEntry ].ucInterface = ( uint8_t ) xIPGetRxInterface();
+			}
+			#endif
 		}
 		else if( xIpEntry < 0 )
 		{
@@ -391,6 +401,29 @@ uint8_t ucMinAgeFound = 0U;
 
 /*-----------------------------------------------------------*/
 
+#if( ipconfigNETWORK_INTERFACES > 1 )
+
+	BaseType_t xARPGetCacheInterface( const MACAddress_t * const pxMACAddress )
+	{
+	BaseType_t x;
+	BaseType_t xReturn = -1;
+
+		for( x = 0; x < ipconfigARP_CACHE_ENTRIES; x++ )
+		{
+			if( ( xARPCache[ x ].ucValid != ( uint8_t ) pdFALSE ) &&
+				( memcmp( pxMACAddress->ucBytes, xARPCache[ x ].xMACAddress.ucBytes, sizeof( MACAddress_t ) ) == 0 ) )
+			{
+				xReturn = ( BaseType_t ) xARPCache[ x ].ucInterface;
+				break;
+			}
+		}
+
+		return xReturn;
+	}
+
+#endif /* ipconfigNETWORK_INTERFACES */
+/*-----------------------------------------------------------*/
+
 eARPLookupResult_t eARPGetCacheEntry( uint32_t *pulIPAddress, MACAddress_t * const pxMACAddress )
 {
 eARPLookupResult_t eReturn;
@@ -598,7 +631,7 @@ NetworkBufferDescriptor_t *pxNetworkBuffer;
 		}
 		#endif
 
-		xNetworkInterfaceOutput( pxNetworkBuffer, pdTRUE );
+		xIPOutputBatchFrame( pxNetworkBuffer, pdTRUE );
 	}
 }
 
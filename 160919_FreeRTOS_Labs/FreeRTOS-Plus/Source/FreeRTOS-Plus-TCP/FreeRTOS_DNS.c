@@ -84,12 +84,14 @@
 	#define dnsOUTGOING_FLAGS				0x0001 /* Standard query. */
 	#define dnsRX_FLAGS_MASK				0x0f80 /* The bits of interest in the flags field of incoming DNS messages. */
 	#define dnsEXPECTED_RX_FLAGS			0x0080 /* Should be a response, without any errors. */
+	#define dnsNXDOMAIN_RX_FLAGS			0x0380 /* A response with RCODE 3: the name does not exist. */
 #else
 	#define dnsDNS_PORT						0x0035
 	#define dnsONE_QUESTION					0x0001
 	#define dnsOUTGOING_FLAGS				0x0100 /* Standard query. */
 	#define dnsRX_FLAGS_MASK				0x800f /* The bits of interest in the flags field of incoming DNS messages. */
 	#define dnsEXPECTED_RX_FLAGS			0x8000 /* Should be a response, without any errors. */
+	#define dnsNXDOMAIN_RX_FLAGS			0x8003 /* A response with RCODE 3: the name does not exist. */
 
 #endif /* ipconfigBYTE_ORDER */
 
@@ -128,11 +130,18 @@ name field is an offset to the string, rather than the string itself. */
 the query will be responded to with these flags: */
 #define dnsNBNS_QUERY_RESPONSE_FLAGS	( 0x8500 )
 
-/*
- * Create a socket and bind it to the standard DNS port number.  Return the
- * the created socket - or NULL if the socket could not be created or bound.
- */
-static Socket_t prvCreateDNSSocket( void );
+#if( ipconfigDNS_USE_CALLBACKS == 0 )
+	/*
+	 * Create a socket and bind it to the standard DNS port number.  Return the
+	 * the created socket - or NULL if the socket could not be created or bound.
+	 */
+	static Socket_t prvCreateDNSSocket( void );
+
+	/*
+	 * Prepare and send a message to a DNS server and wait for the reply.
+	 */
+	static uint32_t prvGetHostByName( const char *pcHostName, TickType_t xIdentifier, TickType_t xReadTimeOut_ms );
+#endif
 
 /*
  * Create the DNS message in the zero copy buffer passed in the first parameter.
@@ -145,15 +154,26 @@ static size_t prvCreateDNSMessage( uint8_t *pucUDPPayloadBuffer, const char *pcH
 static uint8_t *prvSkipNameField( uint8_t *pucByte );
 
 /*
- * Process a response packet from a DNS server.
- */
-static uint32_t prvParseDNSReply( uint8_t *pucUDPPayloadBuffer, TickType_t xIdentifier );
-
-/*
- * Prepare and send a message to a DNS server.  'xReadTimeOut_ms' will be passed as
- * zero, in case the user has supplied a call-back function.
+ * Process a response packet from a DNS server.  xExpected is pdTRUE when the
+ * packet was received on the socket of the request with ID xIdentifier.
+ * Otherwise the answer is only used if prvIsExpectedDNSReply() recognises it.
  */
-static uint32_t prvGetHostByName( const char *pcHostName, TickType_t xIdentifier, TickType_t xReadTimeOut_ms );
+static uint32_t prvParseDNSReply( uint8_t *pucUDPPayloadBuffer, TickType_t xIdentifier, BaseType_t xExpected );
+
+#if( ( ipconfigDNS_USE_CALLBACKS != 0 ) || ( ( ipconfigUSE_DNS_CACHE == 1 ) && ( ipconfigDNS_CACHE_PREFETCH_TIME != 0 ) ) )
+	/*
+	 * Returns pdTRUE if a reply with the given ID and name answers a request
+	 * that is still outstanding.  Replies that were not asked for, e.g.
+	 * forged ones, must not end up in the cache.
+	 */
+	static BaseType_t prvIsExpectedDNSReply( TickType_t xIdentifier, const char *pcName );
+
+	/*
+	 * Create a DNS request and pass it to the IP-task, without waiting for a
+	 * reply.  The reply will be handled by ulDNSHandlePacket().
+	 */
+	static BaseType_t prvSendDNSRequest( const char *pcHostName, TickType_t xIdentifier, uint32_t ulIPAddress, uint16_t usPort, uint16_t usLocalPort, TickType_t xBlockTimeTicks );
+#endif
 
 /*
  * The NBNS and the LLMNR protocol share this reply function.
@@ -162,21 +182,64 @@ static uint32_t prvGetHostByName( const char *pcHostName, TickType_t xIdentifier
 	static void prvReplyDNSMessage( NetworkBufferDescriptor_t *pxNetworkBuffer, BaseType_t lNetLength );
 #endif
 
+#if( ( ipconfigUSE_DNS_CACHE == 1 ) || ( ipconfigDNS_USE_CALLBACKS != 0 ) )
+	/* The size of the buffer in which prvParseDNSReply() stores the name of
+	the first question. */
+	#define dnsPARSED_NAME_LENGTH			128
+
+	/*
+	 * Copy the NAME field of a resource record as a dotted string.
+	 */
+	static uint8_t *prvReadNameField( uint8_t *pucByte, char *pcName, BaseType_t xLen );
+#endif
+
 #if( ipconfigUSE_NBNS == 1 )
 	static portINLINE void prvTreatNBNS( uint8_t *pucUDPPayloadBuffer, uint32_t ulIPAddress );
 #endif /* ipconfigUSE_NBNS */
 
 #if( ipconfigUSE_DNS_CACHE == 1 )
-	static uint8_t *prvReadNameField( uint8_t *pucByte, char *pcName, BaseType_t xLen );
-	static void prvProcessDNSCache( const char *pcName, uint32_t *pulIP, BaseType_t xLookUp );
+	/* Values returned by prvProcessDNSCache() when it is called for a look-up. */
+	#define dnsCACHE_NOT_FOUND				( ( BaseType_t ) 0 )
+	#define dnsCACHE_FOUND					( ( BaseType_t ) 1 )
+	#define dnsCACHE_FOUND_PREFETCH			( ( BaseType_t ) 2 )	/* Found, but the entry is about to expire. */
+
+	/* An entry must have been looked up at least this many times before it is
+	considered worth refreshing before it expires. */
+	#define dnsCACHE_PREFETCH_MIN_HITS		( ( uint8_t ) 2 )
+
+	static BaseType_t prvProcessDNSCache( const char *pcName, uint32_t *pulIP, uint32_t ulTTL, BaseType_t xLookUp );
+	static uint16_t prvDNSCacheHash( const char *pcName );
+	static uint32_t prvDNSCacheTimeInSeconds( void );
+
+	#if( ipconfigDNS_CACHE_PREFETCH_TIME != 0 )
+		/*
+		 * Send a DNS request without waiting for the reply.  The reply will be
+		 * handled by ulDNSHandlePacket(), which refreshes the cache entry.
+		 */
+		static void prvPrefetchDNSCacheEntry( const char *pcHostName );
+
+		/* The ID and the name hash of the last prefetch request.  Only its
+		reply is accepted by ulDNSHandlePacket(). */
+		static uint16_t usPrefetchIdentifier = 0u;
+		static uint16_t usPrefetchHash = 0u;
+		static BaseType_t xPrefetchPending = pdFALSE;
+	#endif
 
 	typedef struct xDNS_CACHE_TABLE_ROW
 	{
-		uint32_t ulIPAddress;		/* The IP address of an ARP cache entry. */
-		char pcName[ipconfigDNS_CACHE_NAME_LENGTH];  /* The name of the host */
-		uint8_t ucAge;				/* A value that is periodically decremented but can also be refreshed by active communication.  The ARP cache entry is removed if the value reaches zero. */
+		uint32_t ulIPAddress;		/* The IP address of the host, or zero when the name could not be resolved. */
+		char pcName[ipconfigDNS_CACHE_NAME_LENGTH];  /* The name of the host, possibly truncated. */
+		uint32_t ulTTL;				/* Time-to-Live (in seconds) from the DNS server, or ipconfigDNS_CACHE_NEGATIVE_TTL for a negative entry. */
+		uint32_t ulTimeWhenAddedInSeconds;
+		uint16_t usHash;			/* Hash of the complete name, also used to distinguish truncated names. */
+		uint8_t ucHits;				/* The number of look-ups since the entry was last refreshed. */
+		uint8_t ucPrefetchSent;		/* Non-zero when a prefetch request has been sent for this entry. */
 	} DNSCacheRow_t;
 
+	/* The cache is an open-addressed hash table: an entry is stored in the
+	first free row at or after the row selected by its hash.  Rows are never
+	emptied once used, expired rows are recycled instead, so a look-up can stop
+	as soon as it finds a row that has never been used. */
 	static DNSCacheRow_t xDNSCache[ ipconfigDNS_CACHE_ENTRIES ];
 #endif /* ipconfigUSE_DNS_CACHE == 1 */
 
@@ -268,10 +331,35 @@ typedef struct xDNSTail DNSTail_t;
 /*-----------------------------------------------------------*/
 
 #if( ipconfigUSE_DNS_CACHE == 1 )
+	/* Look up pcHostName in the cache.  Returns pdTRUE if an entry was found,
+	in which case *pulIPAddress is set to the cached address, or to zero if
+	the name is known to be unresolvable. */
+	static BaseType_t prvLookupDNSCache( const char *pcHostName, uint32_t *pulIPAddress );
+	static BaseType_t prvLookupDNSCache( const char *pcHostName, uint32_t *pulIPAddress )
+	{
+	BaseType_t xResult;
+
+		xResult = prvProcessDNSCache( pcHostName, pulIPAddress, 0UL, pdTRUE );
+
+		#if( ipconfigDNS_CACHE_PREFETCH_TIME != 0 )
+		{
+			if( xResult == dnsCACHE_FOUND_PREFETCH )
+			{
+				/* The entry is popular and about to expire: ask the DNS server
+				again now, so it will be refreshed before it times out. */
+				prvPrefetchDNSCacheEntry( pcHostName );
+			}
+		}
+		#endif /* ipconfigDNS_CACHE_PREFETCH_TIME */
+
+		return ( xResult != dnsCACHE_NOT_FOUND ) ? pdTRUE : pdFALSE;
+	}
+	/*-----------------------------------------------------------*/
+
 	uint32_t FreeRTOS_dnslookup( const char *pcHostName )
 	{
 	uint32_t ulIPAddress = 0UL;
-		prvProcessDNSCache( pcHostName, &ulIPAddress, pdTRUE );
+		prvLookupDNSCache( pcHostName, &ulIPAddress );
 		return ulIPAddress;
 	}
 #endif /* ipconfigUSE_DNS_CACHE == 1 */
@@ -279,17 +367,50 @@ typedef struct xDNSTail DNSTail_t;
 
 #if( ipconfigDNS_USE_CALLBACKS != 0 )
 
+	/* The time between two attempts to get an answer to a request. */
+	#define dnsRETRY_PERIOD_MS				( 1200u )
+
+	/* The period of the DNS timer as long as requests are outstanding. */
+	#define dnsRESOLVER_TIMER_PERIOD_MS		( 100u )
+
+	/* An outstanding request.  Requests are kept in xCallbackList, the item
+	value is the DNS transaction ID.  All requests share the socket
+	xResolverSocket, replies are matched on the transaction ID and the name. */
 	typedef struct xDNS_Callback {
-		TickType_t xRemaningTime;		/* Timeout in ms */
+		TickType_t xRemaningTime;		/* Timeout in ticks */
 		FOnDNSEvent pCallbackFunction;	/* Function to be called when the address has been found or when a timeout has beeen reached */
 		TimeOut_t xTimeoutState;
 		void *pvSearchID;
+		SemaphoreHandle_t xDoneSemaphore;	/* Given when the result is known to the task blocked in FreeRTOS_gethostbyname(), or NULL when a call-back is used. */
+		TickType_t xStartTime;			/* The time the request was made, to measure the latency. */
+		TickType_t xLastSendTime;		/* The time of the last transmission. */
+		uint32_t ulIPAddress;			/* The result, valid when xDone is set. */
+		BaseType_t xAttempts;			/* The number of times the request has been sent. */
+		volatile BaseType_t xDone;		/* Set when a waiting task may collect the result. */
 		struct xLIST_ITEM xListItem;
 		char pcName[ 1 ];
 	} DNSCallback_t;
 
 	static List_t xCallbackList;
 
+	/* The socket shared by all outstanding requests.  It is only used to
+	reserve a port number: the replies are passed to ulDNSHandlePacket() by
+	the IP-task and never queued. */
+	static FreeRTOS_Socket_t *xResolverSocket = NULL;
+
+	#if( ipconfigDNS_EXTRA_SERVERS > 0 )
+		/* DNS servers that are asked in addition to the server of the network
+		configuration. */
+		static uint32_t ulExtraDNSServers[ ipconfigDNS_EXTRA_SERVERS ];
+	#endif
+
+	static DNSCallback_t *prvCreateDNSQuery( const char *pcHostName, void *pvSearchID, FOnDNSEvent pCallbackFunction, TickType_t xTimeout );
+	static DNSCallback_t *prvFindDNSQuery( TickType_t xIdentifier );
+	static void prvCompleteDNSQuery( DNSCallback_t *pxQuery, uint32_t ulIPAddress, List_t *pxCompletedList );
+	static void prvCallCompletedDNSQueries( List_t *pxCompletedList );
+	static BaseType_t prvSendDNSQuery( const char *pcHostName, TickType_t xIdentifier, TickType_t xBlockTimeTicks );
+	static TickType_t prvNextDNSRetry( char *pcName, size_t uxLength );
+
 	/* Define FreeRTOS_gethostbyname() as a normal blocking call. */
 	uint32_t FreeRTOS_gethostbyname( const char *pcHostName )
 	{
@@ -297,16 +418,136 @@ typedef struct xDNSTail DNSTail_t;
 	}
 	/*-----------------------------------------------------------*/
 
-	/* Initialise the list of call-back structures. */
+	BaseType_t xIsDNSSocket( Socket_t xSocket )
+	{
+	BaseType_t xReturn;
+
+		if( ( xResolverSocket != NULL ) && ( ( FreeRTOS_Socket_t * ) xSocket == xResolverSocket ) )
+		{
+			xReturn = pdTRUE;
+		}
+		else
+		{
+			xReturn = pdFALSE;
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	#if( ipconfigDNS_EXTRA_SERVERS > 0 )
+
+		BaseType_t FreeRTOS_SetDNSServer( BaseType_t xIndex, uint32_t ulIPAddress )
+		{
+		BaseType_t xReturn;
+
+			if( ( xIndex >= 0 ) && ( xIndex < ( BaseType_t ) ipconfigDNS_EXTRA_SERVERS ) )
+			{
+				ulExtraDNSServers[ xIndex ] = ulIPAddress;
+				xReturn = pdPASS;
+			}
+			else
+			{
+				xReturn = pdFAIL;
+			}
+
+			return xReturn;
+		}
+
+	#endif /* ipconfigDNS_EXTRA_SERVERS */
+	/*-----------------------------------------------------------*/
+
+	/* Initialise the list of call-back structures and create the socket that
+	is shared by all requests.  Called from the IP-task each time the network
+	goes up. */
 	void vDNSInitialise( void );
 	void vDNSInitialise( void )
 	{
-		vListInitialise( &xCallbackList );
+	static BaseType_t xListInitialised = pdFALSE;
+	struct freertos_sockaddr xAddress;
+
+		if( xListInitialised == pdFALSE )
+		{
+			vListInitialise( &xCallbackList );
+			xListInitialised = pdTRUE;
+		}
+
+		if( xResolverSocket == NULL )
+		{
+			xResolverSocket = ( FreeRTOS_Socket_t * ) FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP );
+			if( xResolverSocket == FREERTOS_INVALID_SOCKET )
+			{
+				xResolverSocket = NULL;
+			}
+			else
+			{
+				/* This runs in the IP-task, so bind directly to a private port
+				number, like the DHCP socket does. */
+				xAddress.sin_port = 0u;
+				if( vSocketBind( xResolverSocket, &xAddress, sizeof( xAddress ), pdFALSE ) != 0 )
+				{
+					vSocketClose( xResolverSocket );
+					xResolverSocket = NULL;
+				}
+			}
+		}
+
 	}
 	/*-----------------------------------------------------------*/
 
-	/* Iterate through the list of call-back structures and remove
-	old entries which have reached a timeout.
+	/* Send a request for pcHostName to the LLMNR group address if the name
+	has no dot, or else to all configured DNS servers at once.  Returns the
+	number of messages sent. */
+	static BaseType_t prvSendDNSQuery( const char *pcHostName, TickType_t xIdentifier, TickType_t xBlockTimeTicks )
+	{
+	BaseType_t xCount = 0;
+	uint32_t ulDNSServerAddress;
+	uint16_t usLocalPort;
+	FreeRTOS_Socket_t *pxSocket = xResolverSocket;
+
+		if( pxSocket != NULL )
+		{
+			usLocalPort = FreeRTOS_htons( pxSocket->usLocalPort );
+
+			#if( ipconfigUSE_LLMNR == 1 )
+			if( strchr( pcHostName, '.' ) == NULL )
+			{
+				xCount += prvSendDNSRequest( pcHostName, xIdentifier, ipLLMNR_IP_ADDR, FreeRTOS_htons( ipLLMNR_PORT ), usLocalPort, xBlockTimeTicks );
+			}
+			else
+			#endif /* ipconfigUSE_LLMNR */
+			{
+				FreeRTOS_GetAddressConfiguration( NULL, NULL, NULL, &ulDNSServerAddress );
+
+				if( ulDNSServerAddress != 0UL )
+				{
+					xCount += prvSendDNSRequest( pcHostName, xIdentifier, ulDNSServerAddress, dnsDNS_PORT, usLocalPort, xBlockTimeTicks );
+				}
+
+				#if( ipconfigDNS_EXTRA_SERVERS > 0 )
+				{
+				BaseType_t xIndex;
+
+					for( xIndex = 0; xIndex < ( BaseType_t ) ipconfigDNS_EXTRA_SERVERS; xIndex++ )
+					{
+						if( ( ulExtraDNSServers[ xIndex ] != 0UL ) && ( ulExtraDNSServers[ xIndex ] != ulDNSServerAddress ) )
+						{
+							xCount += prvSendDNSRequest( pcHostName, xIdentifier, ulExtraDNSServers[ xIndex ], dnsDNS_PORT, usLocalPort, xBlockTimeTicks );
+						}
+					}
+				}
+				#endif /* ipconfigDNS_EXTRA_SERVERS */
+			}
+		}
+
+		return xCount;
+	}
+	/*-----------------------------------------------------------*/
+
+	/* Iterate through the list of outstanding requests.  When called from
+	the DNS timer, pvSearchID is NULL: requests that have reached their
+	timeout are completed with a zero address, the others are sent again if
+	there was no answer for dnsRETRY_PERIOD_MS.
 	As soon as the list hase become empty, the DNS timer will be stopped
 	In case pvSearchID is supplied, the user wants to cancel a DNS request
 	*/
@@ -315,6 +556,11 @@ typedef struct xDNSTail DNSTail_t;
 	{
 	const ListItem_t *pxIterator;
 	const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xCallbackList );
+	List_t xCompletedList;
+	TickType_t xIdentifier;
+	char pcName[ dnsPARSED_NAME_LENGTH ];
+
+		vListInitialise( &xCompletedList );
 
 		vTaskSuspendAll();
 		{
@@ -325,21 +571,54 @@ typedef struct xDNSTail DNSTail_t;
 				DNSCallback_t *pxCallback = ( DNSCallback_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
 				/* Move to the next item because we might remove this item */
 				pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator );
-				if( ( pvSearchID != NULL ) && ( pvSearchID == pxCallback->pvSearchID ) )
+				if( pvSearchID != NULL )
+				{
+					if( pvSearchID == pxCallback->pvSearchID )
+					{
+						uxListRemove( &pxCallback->xListItem );
+						vPortFree( pxCallback );
+					}
+				}
+				else if( pxCallback->xDone != pdFALSE )
 				{
-					uxListRemove( &pxCallback->xListItem );
-					vPortFree( pxCallback );
+					/* Waiting for the blocked task to collect the result. */
 				}
 				else if( xTaskCheckForTimeOut( &pxCallback->xTimeoutState, &pxCallback->xRemaningTime ) != pdFALSE )
 				{
-					pxCallback->pCallbackFunction( pxCallback->pcName, pxCallback->pvSearchID, 0 );
-					uxListRemove( &pxCallback->xListItem );
-					vPortFree( ( void * ) pxCallback );
+					#if( ipconfigUSE_DNS_CACHE == 1 )
+					{
+					uint32_t ulIPAddress = 0UL;
+
+						/* No reply: remember that for a while. */
+						prvProcessDNSCache( pxCallback->pcName, &ulIPAddress, ipconfigDNS_CACHE_NEGATIVE_TTL, pdFALSE );
+					}
+					#endif /* ipconfigUSE_DNS_CACHE */
+					prvCompleteDNSQuery( pxCallback, 0UL, &xCompletedList );
 				}
 			}
 		}
 		xTaskResumeAll();
 
+		prvCallCompletedDNSQueries( &xCompletedList );
+
+		if( pvSearchID == NULL )
+		{
+			/* Repeat the requests that were not answered.  Sending a request
+			may block, so it is done with the scheduler running.  This runs
+			in the IP-task, which may not wait for a network buffer. */
+			for( ;; )
+			{
+				xIdentifier = prvNextDNSRetry( pcName, sizeof( pcName ) );
+
+				if( xIdentifier == 0u )
+				{
+					break;
+				}
+
+				prvSendDNSQuery( pcName, xIdentifier, 0u );
+			}
+		}
+
 		if( listLIST_IS_EMPTY( &xCallbackList ) )
 		{
 			vIPSetDnsTimerEnableState( pdFALSE );
@@ -354,36 +633,178 @@ typedef struct xDNSTail DNSTail_t;
 	}
 	/*-----------------------------------------------------------*/
 
-	/* FreeRTOS_gethostbyname_a() was called along with callback parameters.
-	Store them in a list for later reference. */
-	static void vDNSSetCallBack( const char *pcHostName, void *pvSearchID, FOnDNSEvent pCallbackFunction, TickType_t xTimeout, TickType_t xIdentifier );
-	static void vDNSSetCallBack( const char *pcHostName, void *pvSearchID, FOnDNSEvent pCallbackFunction, TickType_t xTimeout, TickType_t xIdentifier )
+	/* Find a request that must be sent again, copy its name to pcName and
+	return its transaction ID, or zero if there is none.  The request is
+	counted as sent, so the next call will return another one.  The name is
+	copied because the request may be freed as soon as the scheduler runs. */
+	static TickType_t prvNextDNSRetry( char *pcName, size_t uxLength )
 	{
-		size_t lLength = strlen( pcHostName );
-		DNSCallback_t *pxCallback = ( DNSCallback_t * )pvPortMalloc( sizeof( *pxCallback ) + lLength );
+	const ListItem_t *pxIterator;
+	const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xCallbackList );
+	DNSCallback_t *pxCallback;
+	TickType_t xIdentifier = 0u;
+	TickType_t xNow;
 
-		/* Translate from ms to number of clock ticks. */
-		xTimeout /= portTICK_PERIOD_MS;
-		if( pxCallback != NULL )
+		vTaskSuspendAll();
 		{
-			if( listLIST_IS_EMPTY( &xCallbackList ) )
+			xNow = xTaskGetTickCount();
+
+			for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
+				 pxIterator != ( const ListItem_t * ) xEnd;
+				 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
 			{
-				/* This is the first one, start the DNS timer to check for timeouts */
-				vIPReloadDNSTimer( FreeRTOS_min_uint32( 1000U, xTimeout ) );
+				pxCallback = ( DNSCallback_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+
+				if( ( pxCallback->xDone == pdFALSE ) &&
+					( pxCallback->xAttempts < ( BaseType_t ) ipconfigDNS_REQUEST_ATTEMPTS ) &&
+					( ( pxCallback->xAttempts == 0 ) || ( ( xNow - pxCallback->xLastSendTime ) >= pdMS_TO_TICKS( dnsRETRY_PERIOD_MS ) ) ) )
+				{
+					strncpy( pcName, pxCallback->pcName, uxLength - 1 );
+					pcName[ uxLength - 1 ] = '\0';
+					xIdentifier = listGET_LIST_ITEM_VALUE( pxIterator );
+					pxCallback->xAttempts++;
+					pxCallback->xLastSendTime = xNow;
+					break;
+				}
 			}
+		}
+		xTaskResumeAll();
+
+		return xIdentifier;
+	}
+	/*-----------------------------------------------------------*/
+
+	/* Find the outstanding request with the given transaction ID.  Called
+	with the scheduler suspended. */
+	static DNSCallback_t *prvFindDNSQuery( TickType_t xIdentifier )
+	{
+	const ListItem_t *pxIterator;
+	const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xCallbackList );
+	DNSCallback_t *pxResult = NULL;
+
+		for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
+			 pxIterator != ( const ListItem_t * ) xEnd;
+			 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+		{
+			if( listGET_LIST_ITEM_VALUE( pxIterator ) == xIdentifier )
+			{
+				pxResult = ( DNSCallback_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+				break;
+			}
+		}
+
+		return pxResult;
+	}
+	/*-----------------------------------------------------------*/
+
+	/* FreeRTOS_gethostbyname_a() was called for a name that is not in the
+	cache.  Store the request in the list, with a transaction ID that is not
+	in use by any other outstanding request. */
+	static DNSCallback_t *prvCreateDNSQuery( const char *pcHostName, void *pvSearchID, FOnDNSEvent pCallbackFunction, TickType_t xTimeout )
+	{
+	size_t lLength = strlen( pcHostName );
+	DNSCallback_t *pxCallback = ( DNSCallback_t * )pvPortMalloc( sizeof( *pxCallback ) + lLength );
+	TickType_t xIdentifier;
+
+		if( ( pxCallback != NULL ) && ( pCallbackFunction == NULL ) )
+		{
+			/* A blocking request: the calling task will wait on its own
+			semaphore, so its task notifications are left alone. */
+			pxCallback->xDoneSemaphore = xSemaphoreCreateBinary();
+
+			if( pxCallback->xDoneSemaphore == NULL )
+			{
+				vPortFree( pxCallback );
+				pxCallback = NULL;
+			}
+		}
+
+		if( pxCallback != NULL )
+		{
 			strcpy( pxCallback->pcName, pcHostName );
 			pxCallback->pCallbackFunction = pCallbackFunction;
 			pxCallback->pvSearchID = pvSearchID;
+			if( pCallbackFunction != NULL )
+			{
+				pxCallback->xDoneSemaphore = NULL;
+			}
 			pxCallback->xRemaningTime = xTimeout;
+			pxCallback->ulIPAddress = 0UL;
+			pxCallback->xAttempts = 1;	/* The first request is sent by the caller. */
+			pxCallback->xDone = pdFALSE;
 			vTaskSetTimeOutState( &pxCallback->xTimeoutState );
 			listSET_LIST_ITEM_OWNER( &( pxCallback->xListItem ), ( void* ) pxCallback );
-			listSET_LIST_ITEM_VALUE( &( pxCallback->xListItem ), xIdentifier );
+
 			vTaskSuspendAll();
 			{
+				/* A random identifier makes it harder to spoof an answer. */
+				do
+				{
+					xIdentifier = ( TickType_t ) ( ipconfigRAND32() & 0xffffUL );
+				} while( ( xIdentifier == 0u ) || ( prvFindDNSQuery( xIdentifier ) != NULL ) );
+
+				listSET_LIST_ITEM_VALUE( &( pxCallback->xListItem ), xIdentifier );
+				pxCallback->xStartTime = xTaskGetTickCount();
+				pxCallback->xLastSendTime = pxCallback->xStartTime;
+
+				if( listLIST_IS_EMPTY( &xCallbackList ) )
+				{
+					/* This is the first one, start the DNS timer to check for
+					timeouts and to repeat the requests. */
+					vIPReloadDNSTimer( pdMS_TO_TICKS( dnsRESOLVER_TIMER_PERIOD_MS ) );
+				}
+
 				vListInsertEnd( &xCallbackList, &pxCallback->xListItem );
 			}
 			xTaskResumeAll();
 		}
+
+		return pxCallback;
+	}
+	/*-----------------------------------------------------------*/
+
+	/* A request has been answered or has reached its timeout.  Called with
+	the scheduler suspended.  A blocked task is woken up to collect the
+	result, a request with a call-back is moved to pxCompletedList. */
+	static void prvCompleteDNSQuery( DNSCallback_t *pxQuery, uint32_t ulIPAddress, List_t *pxCompletedList )
+	{
+	TickType_t xLatency = xTaskGetTickCount() - pxQuery->xStartTime;
+
+		iptraceDNS_REQUEST_COMPLETE( pxQuery->pcName, ulIPAddress, xLatency );
+		( void ) xLatency;
+
+		pxQuery->ulIPAddress = ulIPAddress;
+
+		if( pxQuery->xDoneSemaphore != NULL )
+		{
+			pxQuery->xDone = pdTRUE;
+			xSemaphoreGive( pxQuery->xDoneSemaphore );
+		}
+		else
+		{
+			uxListRemove( &( pxQuery->xListItem ) );
+			vListInsertEnd( pxCompletedList, &( pxQuery->xListItem ) );
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	/* Call the handlers of the completed requests, with the scheduler
+	running. */
+	static void prvCallCompletedDNSQueries( List_t *pxCompletedList )
+	{
+	DNSCallback_t *pxCallback;
+
+		while( listLIST_IS_EMPTY( pxCompletedList ) == pdFALSE )
+		{
+			pxCallback = ( DNSCallback_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCompletedList );
+			uxListRemove( &( pxCallback->xListItem ) );
+
+			FreeRTOS_debug_printf( ( "DNS: '%s' %lxip after %lu ms (%ld attempts)\n", pxCallback->pcName, FreeRTOS_ntohl( pxCallback->ulIPAddress ),
+				( xTaskGetTickCount() - pxCallback->xStartTime ) * portTICK_PERIOD_MS, pxCallback->xAttempts ) );
+
+			pxCallback->pCallbackFunction( pxCallback->pcName, pxCallback->pvSearchID, pxCallback->ulIPAddress );
+			vPortFree( pxCallback );
+		}
 	}
 	/*-----------------------------------------------------------*/
 
@@ -392,44 +813,148 @@ typedef struct xDNSTail DNSTail_t;
 	static void vDNSDoCallback( TickType_t xIdentifier, const char *pcName, uint32_t ulIPAddress );
 	static void vDNSDoCallback( TickType_t xIdentifier, const char *pcName, uint32_t ulIPAddress )
 	{
-		const ListItem_t *pxIterator;
-		const MiniListItem_t* xEnd = ( const MiniListItem_t* )listGET_END_MARKER( &xCallbackList );
+	DNSCallback_t *pxCallback;
+	List_t xCompletedList;
+
+		vListInitialise( &xCompletedList );
 
 		vTaskSuspendAll();
 		{
-			for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( xEnd );
-				 pxIterator != ( const ListItem_t * ) xEnd;
-				 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
+			pxCallback = prvFindDNSQuery( xIdentifier );
+
+			/* The first answer wins, the answers from the other servers are
+			ignored.  Also check the name, the reply might belong to an old
+			request that used the same ID. */
+			if( ( pxCallback != NULL ) &&
+				( pxCallback->xDone == pdFALSE ) &&
+				( strncmp( pxCallback->pcName, pcName, dnsPARSED_NAME_LENGTH - 1 ) == 0 ) )
+			{
+				prvCompleteDNSQuery( pxCallback, ulIPAddress, &xCompletedList );
+			}
+		}
+		xTaskResumeAll();
+
+		prvCallCompletedDNSQueries( &xCompletedList );
+
+		if( listLIST_IS_EMPTY( &xCallbackList ) )
+		{
+			vIPSetDnsTimerEnableState( pdFALSE );
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	uint32_t FreeRTOS_gethostbyname_a( const char *pcHostName, FOnDNSEvent pCallback, void *pvSearchID, TickType_t xTimeout )
+	{
+	uint32_t ulIPAddress = 0UL;
+	BaseType_t xFoundInCache = pdFALSE;
+	DNSCallback_t *pxQuery;
+	TickType_t xIdentifier, xWaitTime;
+	TimeOut_t xWaitTimeOut;
+
+		/* If a DNS cache is used then check the cache before issuing another
+		DNS request. */
+		#if( ipconfigUSE_DNS_CACHE == 1 )
+		{
+			xFoundInCache = prvLookupDNSCache( pcHostName, &ulIPAddress );
+			if( ulIPAddress != 0 )
+			{
+				FreeRTOS_debug_printf( ( "FreeRTOS_gethostbyname: found '%s' in cache: %lxip\n", pcHostName, ulIPAddress ) );
+			}
+			else if( xFoundInCache != pdFALSE )
+			{
+				/* A recent look-up of this name failed, don't ask again until
+				the negative entry has expired. */
+				FreeRTOS_debug_printf( ( "FreeRTOS_gethostbyname: '%s' is cached as unresolvable\n", pcHostName ) );
+			}
+		}
+		#endif /* ipconfigUSE_DNS_CACHE == 1 */
+
+		if( ( xFoundInCache != pdFALSE ) || ( xResolverSocket == NULL ) )
+		{
+			/* Either the result is known, or the network has never been up
+			and no request can be made yet. */
+			if( pCallback != NULL )
+			{
+				pCallback( pcHostName, pvSearchID, ulIPAddress );
+			}
+		}
+		else
+		{
+			/* Translate from ms to number of clock ticks.  Without a timeout
+			the request will be sent at most ipconfigDNS_REQUEST_ATTEMPTS
+			times. */
+			if( xTimeout == 0u )
 			{
-				if( listGET_LIST_ITEM_VALUE( pxIterator ) == xIdentifier )
+				xTimeout = ( TickType_t ) ipconfigDNS_REQUEST_ATTEMPTS * dnsRETRY_PERIOD_MS;
+			}
+			xTimeout = pdMS_TO_TICKS( xTimeout );
+
+			pxQuery = prvCreateDNSQuery( pcHostName, pvSearchID, pCallback, xTimeout );
+
+			if( pxQuery != NULL )
+			{
+				xIdentifier = listGET_LIST_ITEM_VALUE( &( pxQuery->xListItem ) );
+
+				/* Send the first request from this task.  A request with a
+				call-back might already have been completed and freed by the
+				IP-task when this returns, so pxQuery is only used again if
+				the caller is blocking. */
+				if( ( prvSendDNSQuery( pcHostName, xIdentifier, pdMS_TO_TICKS( 100u ) ) == 0 ) && ( pCallback == NULL ) )
 				{
-					DNSCallback_t *pxCallback = ( DNSCallback_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
-					pxCallback->pCallbackFunction( pcName, pxCallback->pvSearchID, ulIPAddress );
-					uxListRemove( &pxCallback->xListItem );
-					vPortFree( pxCallback );
-					if( listLIST_IS_EMPTY( &xCallbackList ) )
+					/* Let the DNS timer try again straight away. */
+					vTaskSuspendAll();
 					{
-						vIPSetDnsTimerEnableState( pdFALSE );
+						pxQuery->xAttempts = 0;
 					}
-					break;
+					xTaskResumeAll();
+				}
+
+				if( pCallback == NULL )
+				{
+					/* Wait for the IP-task to report the result, which it does
+					at the latest when the timeout has been reached. */
+					xWaitTime = xTimeout + pdMS_TO_TICKS( dnsRETRY_PERIOD_MS );
+					vTaskSetTimeOutState( &xWaitTimeOut );
+
+					while( pxQuery->xDone == pdFALSE )
+					{
+						xSemaphoreTake( pxQuery->xDoneSemaphore, xWaitTime );
+
+						if( xTaskCheckForTimeOut( &xWaitTimeOut, &xWaitTime ) != pdFALSE )
+						{
+							break;
+						}
+					}
+
+					vTaskSuspendAll();
+					{
+						uxListRemove( &( pxQuery->xListItem ) );
+						ulIPAddress = pxQuery->ulIPAddress;
+					}
+					xTaskResumeAll();
+
+					FreeRTOS_debug_printf( ( "DNS: '%s' %lxip after %lu ms (%ld attempts)\n", pcHostName, FreeRTOS_ntohl( ulIPAddress ),
+						( xTaskGetTickCount() - pxQuery->xStartTime ) * portTICK_PERIOD_MS, pxQuery->xAttempts ) );
+
+					vSemaphoreDelete( pxQuery->xDoneSemaphore );
+					vPortFree( pxQuery );
 				}
 			}
 		}
-		xTaskResumeAll();
+
+		return ulIPAddress;
 	}
 
 #endif	/* ipconfigDNS_USE_CALLBACKS != 0 */
 /*-----------------------------------------------------------*/
 
 #if( ipconfigDNS_USE_CALLBACKS == 0 )
+
 uint32_t FreeRTOS_gethostbyname( const char *pcHostName )
-#else
-uint32_t FreeRTOS_gethostbyname_a( const char *pcHostName, FOnDNSEvent pCallback, void *pvSearchID, TickType_t xTimeout )
-#endif
 {
 uint32_t ulIPAddress = 0UL;
 static uint16_t usIdentifier = 0u;
-TickType_t xReadTimeOut_ms = 1200U;
+BaseType_t xFoundInCache = pdFALSE;
 /* Generate a unique identifier for this query. Keep it in a local variable
  as gethostbyname() may be called from different threads */
 TickType_t xIdentifier = ( TickType_t )usIdentifier++;
@@ -438,11 +963,17 @@ TickType_t xIdentifier = ( TickType_t )usIdentifier++;
 	request. */
 	#if( ipconfigUSE_DNS_CACHE == 1 )
 	{
-		ulIPAddress = FreeRTOS_dnslookup( pcHostName );
+		xFoundInCache = prvLookupDNSCache( pcHostName, &ulIPAddress );
 		if( ulIPAddress != 0 )
 		{
 			FreeRTOS_debug_printf( ( "FreeRTOS_gethostbyname: found '%s' in cache: %lxip\n", pcHostName, ulIPAddress ) );
 		}
+		else if( xFoundInCache != pdFALSE )
+		{
+			/* A recent look-up of this name failed, don't ask again until
+			the negative entry has expired. */
+			FreeRTOS_debug_printf( ( "FreeRTOS_gethostbyname: '%s' is cached as unresolvable\n", pcHostName ) );
+		}
 		else
 		{
 			/* prvGetHostByName will be called to start a DNS lookup */
@@ -450,28 +981,9 @@ TickType_t xIdentifier = ( TickType_t )usIdentifier++;
 	}
 	#endif /* ipconfigUSE_DNS_CACHE == 1 */
 
-	#if( ipconfigDNS_USE_CALLBACKS != 0 )
+	if( xFoundInCache == pdFALSE )
 	{
-		if( pCallback != NULL )
-		{
-			if( ulIPAddress == 0UL )
-			{
-				/* The user has provided a callback function, so do not block on recvfrom() */
-				xReadTimeOut_ms  = 0;
-				vDNSSetCallBack( pcHostName, pvSearchID, pCallback, xTimeout, ( TickType_t ) xIdentifier );
-			}
-			else
-			{
-				/* The IP address is known, do the call-back now. */
-				pCallback( pcHostName, pvSearchID, ulIPAddress );
-			}
-		}
-	}
-	#endif
-
-	if( ulIPAddress == 0UL)
-	{
-		ulIPAddress = prvGetHostByName( pcHostName, xIdentifier, xReadTimeOut_ms );
+		ulIPAddress = prvGetHostByName( pcHostName, xIdentifier, 1200U );
 	}
 
 	return ulIPAddress;
@@ -489,6 +1001,7 @@ BaseType_t xAttempt;
 int32_t lBytes;
 size_t xPayloadLength, xExpectedPayloadLength;
 TickType_t xWriteTimeOut_ms = 100U;
+BaseType_t xRequestSent = pdFALSE, xNameError = pdFALSE;
 
 #if( ipconfigUSE_LLMNR == 1 )
 	BaseType_t bHasDot = pdFALSE;
@@ -559,20 +1072,33 @@ TickType_t xWriteTimeOut_ms = 100U;
 
 				if( FreeRTOS_sendto( xDNSSocket, pucUDPPayloadBuffer, xPayloadLength, FREERTOS_ZERO_COPY, &xAddress, sizeof( xAddress ) ) != 0 )
 				{
+					xRequestSent = pdTRUE;
+
 					/* Wait for the reply. */
 					lBytes = FreeRTOS_recvfrom( xDNSSocket, &pucUDPPayloadBuffer, 0, FREERTOS_ZERO_COPY, &xAddress, &ulAddressLength );
 
 					if( lBytes > 0 )
 					{
+					DNSMessage_t *pxDNSMessageHeader = ( DNSMessage_t * ) pucUDPPayloadBuffer;
+
+						/* A definite "no such name" answer makes retrying
+						useless.  prvParseDNSReply() has already stored the
+						negative result in the cache. */
+						if( ( pxDNSMessageHeader->usIdentifier == ( uint16_t ) xIdentifier ) &&
+							( ( pxDNSMessageHeader->usFlags & dnsRX_FLAGS_MASK ) == dnsNXDOMAIN_RX_FLAGS ) )
+						{
+							xNameError = pdTRUE;
+						}
+
 						/* The reply was received.  Process it. */
-						ulIPAddress = prvParseDNSReply( pucUDPPayloadBuffer, xIdentifier );
+						ulIPAddress = prvParseDNSReply( pucUDPPayloadBuffer, xIdentifier, pdTRUE );
 
 						/* Finished with the buffer.  The zero copy interface
 						is being used, so the buffer must be freed by the
 						task. */
 						FreeRTOS_ReleaseUDPPayloadBuffer( ( void * ) pucUDPPayloadBuffer );
 
-						if( ulIPAddress != 0UL )
+						if( ( ulIPAddress != 0UL ) || ( xNameError != pdFALSE ) )
 						{
 							/* All done. */
 							break;
@@ -590,10 +1116,29 @@ TickType_t xWriteTimeOut_ms = 100U;
 
 		/* Finished with the socket. */
 		FreeRTOS_closesocket( xDNSSocket );
+
+		#if( ipconfigUSE_DNS_CACHE == 1 )
+		{
+			/* When the caller was blocking and none of the requests got an
+			answer, cache the failure so that the next call for the same name
+			doesn't block again straight away.  With a call-back the reply
+			(or the time-out) will come later. */
+			if( ( ulIPAddress == 0UL ) && ( xRequestSent != pdFALSE ) && ( xNameError == pdFALSE ) && ( xReadTimeOut_ms != 0U ) )
+			{
+				prvProcessDNSCache( pcHostName, &ulIPAddress, ipconfigDNS_CACHE_NEGATIVE_TTL, pdFALSE );
+			}
+		}
+		#else
+		{
+			( void ) xRequestSent;
+		}
+		#endif /* ipconfigUSE_DNS_CACHE */
 	}
 
 	return ulIPAddress;
 }
+
+#endif /* ipconfigDNS_USE_CALLBACKS == 0 */
 /*-----------------------------------------------------------*/
 
 static size_t prvCreateDNSMessage( uint8_t *pucUDPPayloadBuffer, const char *pcHostName, TickType_t xIdentifier )
@@ -668,7 +1213,63 @@ static const DNSMessage_t xDefaultPartDNSHeader =
 }
 /*-----------------------------------------------------------*/
 
-#if( ipconfigUSE_DNS_CACHE == 1 )
+#if( ( ipconfigDNS_USE_CALLBACKS != 0 ) || ( ( ipconfigUSE_DNS_CACHE == 1 ) && ( ipconfigDNS_CACHE_PREFETCH_TIME != 0 ) ) )
+
+	static BaseType_t prvSendDNSRequest( const char *pcHostName, TickType_t xIdentifier, uint32_t ulIPAddress, uint16_t usPort, uint16_t usLocalPort, TickType_t xBlockTimeTicks )
+	{
+	NetworkBufferDescriptor_t *pxNetworkBuffer;
+	IPStackEvent_t xStackTxEvent = { eStackTxEvent, NULL };
+	uint8_t *pucUDPPayloadBuffer;
+	size_t xExpectedPayloadLength;
+	BaseType_t xReturn = pdFAIL;
+
+		/* Two is added at the end for the count of characters in the first
+		subdomain part and the string end byte. */
+		xExpectedPayloadLength = sizeof( DNSMessage_t ) + strlen( pcHostName ) + sizeof( uint16_t ) + sizeof( uint16_t ) + 2u;
+
+		pucUDPPayloadBuffer = ( uint8_t * ) FreeRTOS_GetUDPPayloadBuffer( xExpectedPayloadLength, xBlockTimeTicks );
+		pxNetworkBuffer = pxUDPPayloadBuffer_to_NetworkBuffer( pucUDPPayloadBuffer );
+
+		if( pxNetworkBuffer != NULL )
+		{
+			iptraceSENDING_DNS_REQUEST();
+
+			pxNetworkBuffer->xDataLength = prvCreateDNSMessage( pucUDPPayloadBuffer, pcHostName, xIdentifier );
+
+			#if( ipconfigUSE_LLMNR == 1 )
+			{
+				if( ulIPAddress == ipLLMNR_IP_ADDR )
+				{
+					( ( DNSMessage_t * ) pucUDPPayloadBuffer) -> usFlags = 0;
+				}
+			}
+			#endif
+
+			pxNetworkBuffer->ulIPAddress = ulIPAddress;
+			pxNetworkBuffer->usPort = usPort;
+			pxNetworkBuffer->usBoundPort = usLocalPort;
+			pxNetworkBuffer->pucEthernetBuffer[ ipSOCKET_OPTIONS_OFFSET ] = ( uint8_t ) FREERTOS_SO_UDPCKSUM_OUT;
+
+			xStackTxEvent.pvData = pxNetworkBuffer;
+
+			if( xSendEventStructToIPTask( &xStackTxEvent, xBlockTimeTicks ) == pdPASS )
+			{
+				xReturn = pdPASS;
+			}
+			else
+			{
+				vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+				iptraceSTACK_TX_EVENT_LOST( ipSTACK_TX_EVENT );
+			}
+		}
+
+		return xReturn;
+	}
+
+#endif /* ipconfigDNS_USE_CALLBACKS || ipconfigDNS_CACHE_PREFETCH_TIME */
+/*-----------------------------------------------------------*/
+
+#if( ( ipconfigUSE_DNS_CACHE == 1 ) || ( ipconfigDNS_USE_CALLBACKS != 0 ) )
 
 	static uint8_t *prvReadNameField( uint8_t *pucByte, char *pcName, BaseType_t xLen )
 	{
@@ -701,7 +1302,7 @@ static const DNSMessage_t xDefaultPartDNSHeader =
 
 		return pucByte;
 	}
-#endif	/* ipconfigUSE_DNS_CACHE == 1 */
+#endif	/* ipconfigUSE_DNS_CACHE || ipconfigDNS_USE_CALLBACKS */
 /*-----------------------------------------------------------*/
 
 static uint8_t *prvSkipNameField( uint8_t *pucByte )
@@ -736,13 +1337,60 @@ uint32_t ulDNSHandlePacket( NetworkBufferDescriptor_t *pxNetworkBuffer )
 uint8_t *pucUDPPayloadBuffer = pxNetworkBuffer->pucEthernetBuffer + sizeof( UDPPacket_t );
 DNSMessage_t *pxDNSMessageHeader = ( DNSMessage_t * ) pucUDPPayloadBuffer;
 
-	prvParseDNSReply( pucUDPPayloadBuffer, ( uint32_t ) pxDNSMessageHeader->usIdentifier );
+	/* This may be an LLMNR request, or a reply that is only used if it
+	answers an outstanding request. */
+	prvParseDNSReply( pucUDPPayloadBuffer, ( TickType_t ) pxDNSMessageHeader->usIdentifier, pdFALSE );
 
 	/* The packet was not consumed. */
 	return pdFAIL;
 }
 /*-----------------------------------------------------------*/
 
+#if( ( ipconfigDNS_USE_CALLBACKS != 0 ) || ( ( ipconfigUSE_DNS_CACHE == 1 ) && ( ipconfigDNS_CACHE_PREFETCH_TIME != 0 ) ) )
+
+	static BaseType_t prvIsExpectedDNSReply( TickType_t xIdentifier, const char *pcName )
+	{
+	BaseType_t xReturn = pdFALSE;
+
+		#if( ipconfigDNS_USE_CALLBACKS != 0 )
+		{
+		DNSCallback_t *pxCallback;
+
+			vTaskSuspendAll();
+			{
+				pxCallback = prvFindDNSQuery( xIdentifier );
+
+				if( ( pxCallback != NULL ) &&
+					( pxCallback->xDone == pdFALSE ) &&
+					( strncmp( pxCallback->pcName, pcName, dnsPARSED_NAME_LENGTH - 1 ) == 0 ) )
+				{
+					xReturn = pdTRUE;
+				}
+			}
+			xTaskResumeAll();
+		}
+		#endif /* ipconfigDNS_USE_CALLBACKS */
+
+		#if( ( ipconfigUSE_DNS_CACHE == 1 ) && ( ipconfigDNS_CACHE_PREFETCH_TIME != 0 ) )
+		{
+			if( ( xReturn == pdFALSE ) &&
+				( xPrefetchPending != pdFALSE ) &&
+				( ( uint16_t ) xIdentifier == usPrefetchIdentifier ) &&
+				( prvDNSCacheHash( pcName ) == usPrefetchHash ) )
+			{
+				/* Only the first answer is used. */
+				xPrefetchPending = pdFALSE;
+				xReturn = pdTRUE;
+			}
+		}
+		#endif /* ipconfigUSE_DNS_CACHE && ipconfigDNS_CACHE_PREFETCH_TIME */
+
+		return xReturn;
+	}
+
+#endif /* ipconfigDNS_USE_CALLBACKS || ipconfigDNS_CACHE_PREFETCH_TIME */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_NBNS == 1 )
 
 	uint32_t ulNBNSHandlePacket (NetworkBufferDescriptor_t *pxNetworkBuffer )
@@ -759,7 +1407,7 @@ DNSMessage_t *pxDNSMessageHeader = ( DNSMessage_t * ) pucUDPPayloadBuffer;
 #endif /* ipconfigUSE_NBNS */
 /*-----------------------------------------------------------*/
 
-static uint32_t prvParseDNSReply( uint8_t *pucUDPPayloadBuffer, TickType_t xIdentifier )
+static uint32_t prvParseDNSReply( uint8_t *pucUDPPayloadBuffer, TickType_t xIdentifier, BaseType_t xExpected )
 {
 DNSMessage_t *pxDNSMessageHeader;
 uint32_t ulIPAddress = 0UL;
@@ -771,8 +1419,11 @@ uint16_t x, usDataLength, usQuestions;
 #if( ipconfigUSE_LLMNR == 1 )
 	uint16_t usType = 0, usClass = 0;
 #endif
+#if( ( ipconfigUSE_DNS_CACHE == 1 ) || ( ipconfigDNS_USE_CALLBACKS != 0 ) )
+	char pcName[dnsPARSED_NAME_LENGTH] = ""; /*_RB_ What is the significance of 128?  Probably too big to go on the stack for a small MCU but don't know how else it could be made re-entrant.  Might be necessary. */
+#endif
 #if( ipconfigUSE_DNS_CACHE == 1 )
-	char pcName[128] = ""; /*_RB_ What is the significance of 128?  Probably too big to go on the stack for a small MCU but don't know how else it could be made re-entrant.  Might be necessary. */
+	uint32_t ulTTL = 0UL;
 #endif
 
 	pxDNSMessageHeader = ( DNSMessage_t * ) pucUDPPayloadBuffer;
@@ -795,13 +1446,13 @@ uint16_t x, usDataLength, usQuestions;
 			}
 			#endif
 
-#if( ipconfigUSE_DNS_CACHE == 1 )
+#if( ( ipconfigUSE_DNS_CACHE == 1 ) || ( ipconfigDNS_USE_CALLBACKS != 0 ) )
 			if( x == 0 )
 			{
 				pucByte = prvReadNameField( pucByte, pcName, sizeof( pcName ) );
 			}
 			else
-#endif /* ipconfigUSE_DNS_CACHE */
+#endif /* ipconfigUSE_DNS_CACHE || ipconfigDNS_USE_CALLBACKS */
 			{
 				/* Skip the variable length pcName field. */
 				pucByte = prvSkipNameField( pucByte );
@@ -831,6 +1482,15 @@ uint16_t x, usDataLength, usQuestions;
 				/* Is the type field that of an A record? */
 				if( usChar2u16( pucByte ) == dnsTYPE_A_HOST )
 				{
+					#if( ipconfigUSE_DNS_CACHE == 1 )
+					{
+						/* The time to live field follows the type and class
+						fields. */
+						memcpy( ( void * ) &ulTTL, ( void * ) ( pucByte + sizeof( uint32_t ) ), sizeof( uint32_t ) );
+						ulTTL = FreeRTOS_ntohl( ulTTL );
+					}
+					#endif /* ipconfigUSE_DNS_CACHE */
+
 					/* This is the required record.  Skip the type, class, and
 					time to live fields, plus the first byte of the data
 					length. */
@@ -845,17 +1505,34 @@ uint16_t x, usDataLength, usQuestions;
 						/* Copy the IP address out of the record. */
 						memcpy( ( void * ) &ulIPAddress, ( void * ) pucByte, sizeof( uint32_t ) );
 
-						#if( ipconfigUSE_DNS_CACHE == 1 )
+						#if( ( ipconfigDNS_USE_CALLBACKS != 0 ) || ( ( ipconfigUSE_DNS_CACHE == 1 ) && ( ipconfigDNS_CACHE_PREFETCH_TIME != 0 ) ) )
 						{
-							prvProcessDNSCache( pcName, &ulIPAddress, pdFALSE );
+							if( xExpected == pdFALSE )
+							{
+								xExpected = prvIsExpectedDNSReply( ( TickType_t ) pxDNSMessageHeader->usIdentifier, pcName );
+							}
 						}
-						#endif /* ipconfigUSE_DNS_CACHE */
-						#if( ipconfigDNS_USE_CALLBACKS != 0 )
+						#endif
+
+						if( xExpected != pdFALSE )
+						{
+							#if( ipconfigUSE_DNS_CACHE == 1 )
+							{
+								prvProcessDNSCache( pcName, &ulIPAddress, ulTTL, pdFALSE );
+							}
+							#endif /* ipconfigUSE_DNS_CACHE */
+							#if( ipconfigDNS_USE_CALLBACKS != 0 )
+							{
+								/* See if any asynchronous call was made to FreeRTOS_gethostbyname_a() */
+								vDNSDoCallback( ( TickType_t ) pxDNSMessageHeader->usIdentifier, pcName, ulIPAddress );
+							}
+							#endif	/* ipconfigDNS_USE_CALLBACKS != 0 */
+						}
+						else
 						{
-							/* See if any asynchronous call was made to FreeRTOS_gethostbyname_a() */
-							vDNSDoCallback( ( TickType_t ) pxDNSMessageHeader->usIdentifier, pcName, ulIPAddress );
+							/* Nobody asked for this address. */
+							ulIPAddress = 0UL;
 						}
-						#endif	/* ipconfigDNS_USE_CALLBACKS != 0 */
 					}
 
 					break;
@@ -874,6 +1551,36 @@ uint16_t x, usDataLength, usQuestions;
 				}
 			}
 		}
+		else if( ( pxDNSMessageHeader->usFlags & dnsRX_FLAGS_MASK ) == dnsNXDOMAIN_RX_FLAGS )
+		{
+			/* The server says that the name does not exist.  Remember that
+			for a while, and tell a waiting call-back straight away rather
+			than letting it time out.  A negative answer is only stored when it
+			belongs to an outstanding request, otherwise a forged reply could
+			block a name for ipconfigDNS_CACHE_NEGATIVE_TTL seconds. */
+			#if( ( ipconfigDNS_USE_CALLBACKS != 0 ) || ( ( ipconfigUSE_DNS_CACHE == 1 ) && ( ipconfigDNS_CACHE_PREFETCH_TIME != 0 ) ) )
+			{
+				if( xExpected == pdFALSE )
+				{
+					xExpected = prvIsExpectedDNSReply( ( TickType_t ) pxDNSMessageHeader->usIdentifier, pcName );
+				}
+			}
+			#endif
+
+			if( xExpected != pdFALSE )
+			{
+				#if( ipconfigUSE_DNS_CACHE == 1 )
+				{
+					prvProcessDNSCache( pcName, &ulIPAddress, ipconfigDNS_CACHE_NEGATIVE_TTL, pdFALSE );
+				}
+				#endif /* ipconfigUSE_DNS_CACHE */
+				#if( ipconfigDNS_USE_CALLBACKS != 0 )
+				{
+					vDNSDoCallback( ( TickType_t ) pxDNSMessageHeader->usIdentifier, pcName, 0UL );
+				}
+				#endif	/* ipconfigDNS_USE_CALLBACKS != 0 */
+			}
+		}
 #if( ipconfigUSE_LLMNR == 1 )
 		else if( usQuestions && ( usType == dnsTYPE_A_HOST ) && ( usClass == dnsCLASS_IN ) )
 		{
@@ -1007,7 +1714,7 @@ uint16_t x, usDataLength, usQuestions;
 				{
 					/* If this is a response from another device,
 					add the name to the DNS cache */
-					prvProcessDNSCache( ( char * ) ucNBNSName, &ulIPAddress, pdFALSE );
+					prvProcessDNSCache( ( char * ) ucNBNSName, &ulIPAddress, dnsNBNS_TTL_VALUE, pdFALSE );
 				}
 			}
 			#else
@@ -1086,6 +1793,8 @@ uint16_t x, usDataLength, usQuestions;
 #endif	/* ipconfigUSE_NBNS */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigDNS_USE_CALLBACKS == 0 )
+
 static Socket_t prvCreateDNSSocket( void )
 {
 static Socket_t xSocket = NULL;
@@ -1116,6 +1825,8 @@ TickType_t xTimeoutTime = pdMS_TO_TICKS( 200 );
 
 	return xSocket;
 }
+
+#endif /* ipconfigDNS_USE_CALLBACKS == 0 */
 /*-----------------------------------------------------------*/
 
 #if( ( ipconfigUSE_NBNS == 1 ) || ( ipconfigUSE_LLMNR == 1 ) )
@@ -1164,62 +1875,207 @@ TickType_t xTimeoutTime = pdMS_TO_TICKS( 200 );
 
 #if( ipconfigUSE_DNS_CACHE == 1 )
 
-	static void prvProcessDNSCache( const char *pcName, uint32_t *pulIP, BaseType_t xLookUp )
+	static uint16_t prvDNSCacheHash( const char *pcName )
+	{
+	uint32_t ulHash = 2166136261UL;
+	uint8_t ucChar;
+
+		/* FNV-1a over the complete name, folded to 16 bits.  Host names are
+		not case sensitive, so neither is the hash. */
+		while( *pcName != '\0' )
+		{
+			ucChar = ( uint8_t ) *( pcName++ );
+
+			if( ( ucChar >= ( uint8_t ) 'A' ) && ( ucChar <= ( uint8_t ) 'Z' ) )
+			{
+				ucChar += ( uint8_t ) ( 'a' - 'A' );
+			}
+
+			ulHash = ( ulHash ^ ucChar ) * 16777619UL;
+		}
+
+		return ( uint16_t ) ( ( ulHash >> 16 ) ^ ( ulHash & 0xffffUL ) );
+	}
+	/*-----------------------------------------------------------*/
+
+	static uint32_t prvDNSCacheTimeInSeconds( void )
 	{
-	BaseType_t x;
+		return ( uint32_t ) ( xTaskGetTickCount() / configTICK_RATE_HZ );
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvProcessDNSCache( const char *pcName, uint32_t *pulIP, uint32_t ulTTL, BaseType_t xLookUp )
+	{
+	BaseType_t x, xIndex;
 	BaseType_t xFound = pdFALSE;
-	static BaseType_t xFreeEntry = 0;
+	BaseType_t xReturn = dnsCACHE_NOT_FOUND;
+	DNSCacheRow_t *pxRow, *pxVictim = NULL;
+	uint32_t ulAge, ulRemaining, ulVictimRemaining = 0UL;
+	uint32_t ulCurrentTimeSeconds = prvDNSCacheTimeInSeconds();
+	uint16_t usHash = prvDNSCacheHash( pcName );
 
-		/* For each entry in the DNS cache table. */
-		for( x = 0; x < ipconfigDNS_CACHE_ENTRIES; x++ )
+		if( xLookUp == pdFALSE )
 		{
-			if( xDNSCache[ x ].pcName[ 0 ] == 0 )
+			/* A TTL of zero means: use the answer but don't cache it. */
+			if( ulTTL == 0UL )
 			{
-				break;
+				return dnsCACHE_NOT_FOUND;
+			}
+
+			if( ulTTL > ( uint32_t ) ipconfigDNS_CACHE_MAX_TTL )
+			{
+				ulTTL = ( uint32_t ) ipconfigDNS_CACHE_MAX_TTL;
 			}
+		}
 
-			if( strncmp( xDNSCache[ x ].pcName, pcName, sizeof( xDNSCache[ x ].pcName ) ) == 0 )
+		vTaskSuspendAll();
+		{
+			/* Probe the rows, starting at the row selected by the hash. */
+			xIndex = ( BaseType_t ) ( usHash % ( uint16_t ) ipconfigDNS_CACHE_ENTRIES );
+
+			for( x = 0; x < ipconfigDNS_CACHE_ENTRIES; x++ )
 			{
-				/* Is this function called for a lookup or to add/update an IP address? */
-				if( xLookUp != pdFALSE )
+				pxRow = &( xDNSCache[ xIndex ] );
+
+				if( pxRow->pcName[ 0 ] == 0 )
 				{
-					*pulIP = xDNSCache[ x ].ulIPAddress;
+					/* A row that has never been used: the name can not be
+					stored any further.  A new entry may be stored here. */
+					pxVictim = pxRow;
+					break;
 				}
-				else
+
+				ulAge = ulCurrentTimeSeconds - pxRow->ulTimeWhenAddedInSeconds;
+				ulRemaining = ( ulAge < pxRow->ulTTL ) ? ( pxRow->ulTTL - ulAge ) : 0UL;
+
+				/* A long name is stored truncated, compare as many characters
+				as were stored.  The hash covers the complete name. */
+				if( ( pxRow->usHash == usHash ) && ( strncmp( pxRow->pcName, pcName, sizeof( pxRow->pcName ) - 1 ) == 0 ) )
 				{
-					xDNSCache[ x ].ulIPAddress = *pulIP;
+					xFound = pdTRUE;
+					break;
 				}
 
-				xFound = pdTRUE;
-				break;
+				/* Remember the row that expires first, it will be recycled if
+				the name has to be added and no free row is found. */
+				if( ( pxVictim == NULL ) || ( ulRemaining < ulVictimRemaining ) )
+				{
+					pxVictim = pxRow;
+					ulVictimRemaining = ulRemaining;
+				}
+
+				xIndex++;
+				if( xIndex == ipconfigDNS_CACHE_ENTRIES )
+				{
+					xIndex = 0;
+				}
 			}
-		}
 
-		if( xFound == pdFALSE )
-		{
 			if( xLookUp != pdFALSE )
 			{
-				*pulIP = 0;
+				*pulIP = 0UL;
+
+				if( ( xFound != pdFALSE ) && ( ulRemaining != 0UL ) )
+				{
+					*pulIP = pxRow->ulIPAddress;
+					xReturn = dnsCACHE_FOUND;
+
+					if( pxRow->ucHits < ( uint8_t ) 0xffu )
+					{
+						pxRow->ucHits++;
+					}
+
+					#if( ipconfigDNS_CACHE_PREFETCH_TIME != 0 )
+					{
+						if( ( pxRow->ulIPAddress != 0UL ) &&
+							( ulRemaining <= ( uint32_t ) ipconfigDNS_CACHE_PREFETCH_TIME ) &&
+							( pxRow->ucHits >= dnsCACHE_PREFETCH_MIN_HITS ) &&
+							( pxRow->ucPrefetchSent == 0u ) )
+						{
+							pxRow->ucPrefetchSent = 1u;
+							xReturn = dnsCACHE_FOUND_PREFETCH;
+						}
+					}
+					#endif /* ipconfigDNS_CACHE_PREFETCH_TIME */
+				}
 			}
 			else
 			{
-				/* Called to add or update an item */
-				strncpy( xDNSCache[ xFreeEntry ].pcName, pcName, sizeof( xDNSCache[ xFreeEntry ].pcName ) );
-				xDNSCache[ xFreeEntry ].ulIPAddress = *pulIP;
+				if( xFound != pdFALSE )
+				{
+					/* Refresh the existing entry, but don't let a late
+					negative answer (e.g. a time-out) overwrite a valid
+					address. */
+					if( ( *pulIP != 0UL ) || ( pxRow->ulIPAddress == 0UL ) || ( ulRemaining == 0UL ) )
+					{
+						pxVictim = pxRow;
+					}
+					else
+					{
+						pxVictim = NULL;
+					}
+				}
+				else if( pxVictim != NULL )
+				{
+					/* Called to add a new item. */
+					strncpy( pxVictim->pcName, pcName, sizeof( pxVictim->pcName ) - 1 );
+					pxVictim->pcName[ sizeof( pxVictim->pcName ) - 1 ] = '\0';
+					pxVictim->usHash = usHash;
+				}
 
-				xFreeEntry++;
-				if( xFreeEntry == ipconfigDNS_CACHE_ENTRIES )
+				if( pxVictim != NULL )
 				{
-					xFreeEntry = 0;
+					pxVictim->ulIPAddress = *pulIP;
+					pxVictim->ulTTL = ulTTL;
+					pxVictim->ulTimeWhenAddedInSeconds = ulCurrentTimeSeconds;
+					pxVictim->ucHits = 0u;
+					pxVictim->ucPrefetchSent = 0u;
 				}
 			}
 		}
+		xTaskResumeAll();
 
 		if( ( xLookUp == 0 ) || ( *pulIP != 0 ) )
 		{
-			FreeRTOS_debug_printf( ( "prvProcessDNSCache: %s: '%s' @ %lxip\n", xLookUp ? "look-up" : "add", pcName, FreeRTOS_ntohl( *pulIP ) ) );
+			FreeRTOS_debug_printf( ( "prvProcessDNSCache: %s: '%s' @ %lxip TTL %lu\n", xLookUp ? "look-up" : "add", pcName, FreeRTOS_ntohl( *pulIP ), ulTTL ) );
 		}
+
+		return xReturn;
 	}
+	/*-----------------------------------------------------------*/
+
+	#if( ipconfigDNS_CACHE_PREFETCH_TIME != 0 )
+
+		static void prvPrefetchDNSCacheEntry( const char *pcHostName )
+		{
+		uint32_t ulDNSServerAddress;
+
+			/* LLMNR names (without a dot) are not refreshed, they are cheap
+			to look up on the local network. */
+			if( strchr( pcHostName, '.' ) == NULL )
+			{
+				return;
+			}
+
+			FreeRTOS_GetAddressConfiguration( NULL, NULL, NULL, &ulDNSServerAddress );
+
+			/* A random identifier makes it harder to spoof an answer.  A
+			newer prefetch replaces an older one that was not answered. */
+			do
+			{
+				usPrefetchIdentifier = ( uint16_t ) ( ipconfigRAND32() & 0xffffUL );
+			} while( usPrefetchIdentifier == 0u );
+			usPrefetchHash = prvDNSCacheHash( pcHostName );
+			xPrefetchPending = pdTRUE;
+
+			/* Don't block: the caller already has its answer from the cache.
+			No socket is bound to the source port, so the reply will be passed
+			to ulDNSHandlePacket(), which updates the cache. */
+			prvSendDNSRequest( pcHostName, ( TickType_t ) usPrefetchIdentifier, ulDNSServerAddress, dnsDNS_PORT,
+				FreeRTOS_htons( ipconfigDNS_CACHE_PREFETCH_PORT ), 0u );
+		}
+
+	#endif /* ipconfigDNS_CACHE_PREFETCH_TIME */
 
 #endif /* ipconfigUSE_DNS_CACHE */
 
@@ -144,6 +144,11 @@ character expected to fill ICMP echo replies. */
 	#define ipFRAGMENT_OFFSET_BIT_MASK				( ( uint16_t ) 0x0fff )
 #endif /* ipconfigBYTE_ORDER */
 
+/* Of the TCP flags URG, ACK, PSH, RST, SYN and FIN, a received segment that is
+merged with others must have ACK set, it may have PSH set. */
+#define ipTCP_COALESCE_FLAGS_MASK					( 0x37u )
+#define ipTCP_COALESCE_FLAGS						( 0x10u )
+
 /* The maximum time the IP task is allowed to remain in the Blocked state if no
 events are posted to the network event queue. */
 #ifndef	ipconfigMAX_IP_TASK_SLEEP_TIME
@@ -163,10 +168,6 @@ per ms: */
 handled.  The value is chosen simply to be easy to spot when debugging. */
 #define ipUNHANDLED_PROTOCOL		0x4321u
 
-/* Returned to indicate a valid checksum when the checksum does not need to be
-calculated. */
-#define ipCORRECT_CRC				0xffffu
-
 /* Returned as the (invalid) checksum when the length of the data being checked
 had an invalid length. */
 #define ipINVALID_LENGTH			0x1234u
@@ -264,6 +265,70 @@ static TickType_t prvCalculateSleepTime( void );
  */
 static void prvHandleEthernetPacket( NetworkBufferDescriptor_t *pxBuffer );
 
+#if( ipconfigUSE_NETWORK_OUTPUT_BATCH != 0 )
+	/*
+	 * Pass the frames collected by xIPOutputBatchFrame() to the driver.
+	 */
+	static void prvOutputBatchFlush( void );
+#endif
+
+#if( ipconfigUSE_UDP_BATCH != 0 )
+	/*
+	 * FreeRTOS_sendmmsg() has passed a chain of UDP packets, linked through
+	 * pxNextBuffer.  Send them in order, as a single batch.
+	 */
+	static void prvProcessGeneratedUDPBatch( NetworkBufferDescriptor_t *pxBuffer );
+#endif
+
+#if( ipconfigUDP_DIRECT_SEND != 0 )
+	/*
+	 * Called by the IP-task before it waits for an event: from now on, a task
+	 * may take the driver lock.
+	 */
+	static void prvDriverLockRelease( void );
+
+	/*
+	 * Called by the IP-task when it has woken up.  It only blocks when a task
+	 * is still sending directly.
+	 */
+	static void prvDriverLockAcquire( void );
+#endif
+
+#if( ipconfigUSE_IP_EVENT_RING != 0 )
+	/*
+	 * Store an event in xEventRing, unless it has no parameter and the same
+	 * event is still waiting in the ring.  Must be called with interrupts
+	 * masked.
+	 */
+	static BaseType_t prvEventRingAdd( const IPStackEvent_t *pxEvent );
+
+	/*
+	 * Called by the IP-task to get the oldest event.  It will only block when
+	 * there are no events.
+	 */
+	static BaseType_t prvEventRingReceive( IPStackEvent_t *pxEvent, TickType_t xTicksToWait );
+#endif
+
+/*
+ * Returns the number of events waiting to be handled by the IP-task.
+ */
+static UBaseType_t prvEventsWaiting( void );
+
+#if( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_LINKED_RX_MESSAGES != 0 ) && ( ipconfigTCP_RX_COALESCE != 0 )
+	/*
+	 * Let the TCP data segments that directly follow pxBuffer in a chain, and
+	 * which continue the same connection, be handled along with it.  Returns
+	 * the first buffer of the chain that was not merged.
+	 */
+	static NetworkBufferDescriptor_t *prvCoalesceTCPSegments( NetworkBufferDescriptor_t *pxBuffer, NetworkBufferDescriptor_t *pxNextBuffer );
+
+	/*
+	 * Returns the length of the payload of a plain TCP data segment that may
+	 * be merged, or zero.
+	 */
+	static size_t prvCoalescePayloadLength( const NetworkBufferDescriptor_t *pxBuffer );
+#endif
+
 /*
  * Utility functions for the light weight IP timers.
  */
@@ -333,6 +398,14 @@ static IPTimer_t xARPTimer;
 	static IPTimer_t xDNSTimer;
 #endif
 
+#if( ipconfigNETWORK_INTERFACES > 1 )
+	/* The output functions of the extra ports, and the port of the frame that
+	is being handled by the IP-task.  Port 0 is the driver's own
+	xNetworkInterfaceOutput(), entry 0 is not used. */
+	static NetworkInterfaceOutputFunction_t pxInterfaceOutput[ ipconfigNETWORK_INTERFACES ];
+	static BaseType_t xRxInterface = 0;
+#endif
+
 /* Set to pdTRUE when the IP task is ready to start processing packets. */
 static BaseType_t xIPTaskInitialised = pdFALSE;
 
@@ -341,12 +414,71 @@ static BaseType_t xIPTaskInitialised = pdFALSE;
 	static UBaseType_t uxQueueMinimumSpace = ipconfigEVENT_QUEUE_LENGTH;
 #endif
 
+#if( ipconfigUSE_IP_EVENT_RING != 0 )
+	/* The number of slots in the ring: one slot stays unused in order to tell
+	a full ring from an empty one. */
+	#define ipEVENT_RING_SIZE		( ( UBaseType_t ) ipconfigEVENT_QUEUE_LENGTH + 1u )
+
+	/* The events without a parameter that will not be stored twice, and the
+	highest of these event types plus one. */
+	#define ipEVENT_RING_COALESCE	( ( 1ul << eARPTimerEvent ) | ( 1ul << eDHCPEvent ) | ( 1ul << eTCPTimerEvent ) )
+	#define ipEVENT_RING_TYPES		( ( UBaseType_t ) eTCPTimerEvent + 1u )
+
+	/* Events are added at uxEventRingHead by any task or interrupt, and taken
+	at uxEventRingTail by the IP-task only. */
+	static IPStackEvent_t xEventRing[ ipEVENT_RING_SIZE ];
+	static volatile UBaseType_t uxEventRingHead = 0u;
+	static volatile UBaseType_t uxEventRingTail = 0u;
+
+	/* Non-zero while an event of the type ipEVENT_RING_COALESCE is waiting in
+	the ring.  A byte per event type, so that the IP-task can clear it without
+	masking interrupts. */
+	static volatile uint8_t ucEventRingPending[ ipEVENT_RING_TYPES ];
+
+	/* Tasks that find the ring full wait for xEventRingSpace.  The IP-task
+	only gives it when uxEventRingWaiters is non-zero. */
+	static SemaphoreHandle_t xEventRingSpace = NULL;
+	static volatile UBaseType_t uxEventRingWaiters = 0u;
+
+	/* Counters, see vGetIPEventRingCounters(). */
+	static uint32_t ulEventRingCoalesced = 0ul;
+	static uint32_t ulEventRingOverflows = 0ul;
+#endif
+
+#if( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_LINKED_RX_MESSAGES != 0 ) && ( ipconfigTCP_RX_COALESCE != 0 )
+	/* The number of TCP data segments received in a chain, and the number of
+	those that were merged with an earlier segment. */
+	static uint32_t ulCoalesceSegments = 0ul;
+	static uint32_t ulCoalesceMerged = 0ul;
+#endif
+
+#if( ipconfigUSE_NETWORK_OUTPUT_BATCH != 0 )
+	/* The frames that are waiting to be passed to xNetworkInterfaceOutputBatch(),
+	and the nesting level of vIPOutputBatchBegin(). */
+	static NetworkBufferDescriptor_t *pxOutputBatch[ ipconfigNETWORK_OUTPUT_BATCH_SIZE ];
+	static BaseType_t xOutputBatchCount = 0;
+	static BaseType_t xOutputBatchLevel = 0;
+#endif
+
+#if( ipconfigUDP_DIRECT_SEND != 0 )
+	/* Serialise the access to the driver and the ARP cache between the
+	IP-task and the tasks that call xUDPDirectSend().  A task may only use the
+	driver while the IP-task is waiting for an event, and only one task at a
+	time.  That task holds xDriverLock.  The IP-task only takes the mutex when
+	it wakes up while a task is still sending: the sender then inherits the
+	priority of the IP-task until it is ready. */
+	static volatile BaseType_t xIPTaskIdle = pdFALSE;
+	static volatile BaseType_t xDirectSendActive = pdFALSE;
+	static SemaphoreHandle_t xDriverLock = NULL;
+#endif
+
 /*-----------------------------------------------------------*/
 
 static void prvIPTask( void *pvParameters )
 {
 IPStackEvent_t xReceivedEvent;
 TickType_t xNextIPSleep;
+BaseType_t xHaveEvent = pdFALSE;
 FreeRTOS_Socket_t *pxSocket;
 struct freertos_sockaddr xAddress;
 
@@ -383,14 +515,49 @@ struct freertos_sockaddr xAddress;
 		or timeout processing to perform. */
 		prvCheckNetworkTimers();
 
-		/* Calculate the acceptable maximum sleep time. */
-		xNextIPSleep = prvCalculateSleepTime();
-
-		/* Wait until there is something to do.  The event is initialised to "no
-		event" in case the following call exits due to a time out rather than a
-		message being received. */
+		/* The event is initialised to "no event" in case the following calls
+		exit due to a time out rather than a message being received. */
 		xReceivedEvent.eEventType = eNoEvent;
-		xQueueReceive( xNetworkEventQueue, ( void * ) &xReceivedEvent, xNextIPSleep );
+
+		#if( ipconfigUSE_IP_EVENT_RING != 0 )
+		{
+			/* All events in the ring are handled before the IP-task waits
+			again. */
+			xHaveEvent = prvEventRingReceive( &xReceivedEvent, ( TickType_t ) 0u );
+		}
+		#endif
+
+		if( xHaveEvent == pdFALSE )
+		{
+			/* Calculate the acceptable maximum sleep time. */
+			xNextIPSleep = prvCalculateSleepTime();
+
+			/* Wait until there is something to do. */
+			#if( ipconfigUDP_DIRECT_SEND != 0 )
+			{
+				/* The driver lock is only released while waiting for an
+				event. */
+				prvDriverLockRelease();
+			}
+			#endif
+
+			#if( ipconfigUSE_IP_EVENT_RING != 0 )
+			{
+				prvEventRingReceive( &xReceivedEvent, xNextIPSleep );
+			}
+			#else
+			{
+				xQueueReceive( xNetworkEventQueue, ( void * ) &xReceivedEvent, xNextIPSleep );
+			}
+			#endif
+
+			#if( ipconfigUDP_DIRECT_SEND != 0 )
+			{
+				/* Wait until a task that is sending directly has finished. */
+				prvDriverLockAcquire();
+			}
+			#endif
+		}
 
 		#if( ipconfigCHECK_IP_QUEUE_SPACE != 0 )
 		{
@@ -398,7 +565,7 @@ struct freertos_sockaddr xAddress;
 			{
 			UBaseType_t uxCount;
 
-				uxCount = uxQueueSpacesAvailable( xNetworkEventQueue );
+				uxCount = ( UBaseType_t ) ipconfigEVENT_QUEUE_LENGTH - prvEventsWaiting();
 				if( uxQueueMinimumSpace > uxCount )
 				{
 					uxQueueMinimumSpace = uxCount;
@@ -463,6 +630,15 @@ struct freertos_sockaddr xAddress;
 				vProcessGeneratedUDPPacket( ( NetworkBufferDescriptor_t * ) ( xReceivedEvent.pvData ) );
 				break;
 
+			case eStackTxBatchEvent :
+				/* FreeRTOS_sendmmsg() has generated a chain of packets. */
+				#if( ipconfigUSE_UDP_BATCH != 0 )
+				{
+					prvProcessGeneratedUDPBatch( ( NetworkBufferDescriptor_t * ) ( xReceivedEvent.pvData ) );
+				}
+				#endif /* ipconfigUSE_UDP_BATCH */
+				break;
+
 			case eDHCPEvent:
 				/* The DHCP state machine needs processing. */
 				#if( ipconfigUSE_DHCP == 1 )
@@ -574,13 +750,18 @@ static void prvHandleEthernetPacket( NetworkBufferDescriptor_t *pxBuffer )
 	#else /* ipconfigUSE_LINKED_RX_MESSAGES */
 	{
 	NetworkBufferDescriptor_t *pxNextBuffer;
+	#if( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_RX_COALESCE != 0 )
+		NetworkBufferDescriptor_t *pxMerged;
+	#endif
 
 		/* An optimisation that is useful when there is high network traffic.
 		Instead of passing received packets into the IP task one at a time the
 		network interface can chain received packets together and pass them into
 		the IP task in one go.  The packets are chained using the pxNextBuffer
 		member.  The loop below walks through the chain processing each packet
-		in the chain in turn. */
+		in the chain in turn.  The replies are sent to the driver in batches. */
+		vIPOutputBatchBegin();
+
 		do
 		{
 			/* Store a pointer to the buffer after pxBuffer for use later on. */
@@ -589,16 +770,171 @@ static void prvHandleEthernetPacket( NetworkBufferDescriptor_t *pxBuffer )
 			/* Make it NULL to avoid using it later on. */
 			pxBuffer->pxNextBuffer = NULL;
 
+			#if( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_RX_COALESCE != 0 )
+			{
+				/* TCP segments that continue pxBuffer will be linked to it, and
+				xProcessReceivedTCPPacket() will handle them as one segment. */
+				pxNextBuffer = prvCoalesceTCPSegments( pxBuffer, pxNextBuffer );
+				pxMerged = pxBuffer->pxNextBuffer;
+			}
+			#endif
+
 			prvProcessEthernetPacket( pxBuffer );
+
+			#if( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_RX_COALESCE != 0 )
+			{
+				/* The merged segments have been processed along with pxBuffer,
+				or dropped along with it. */
+				while( pxMerged != NULL )
+				{
+				NetworkBufferDescriptor_t *pxRelease = pxMerged;
+
+					pxMerged = pxMerged->pxNextBuffer;
+					vReleaseNetworkBufferAndDescriptor( pxRelease );
+				}
+			}
+			#endif
+
 			pxBuffer = pxNextBuffer;
 
 		/* While there is another packet in the chain. */
 		} while( pxBuffer != NULL );
+
+		vIPOutputBatchEnd();
 	}
 	#endif /* ipconfigUSE_LINKED_RX_MESSAGES */
 }
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_LINKED_RX_MESSAGES != 0 ) && ( ipconfigTCP_RX_COALESCE != 0 )
+
+	static size_t prvCoalescePayloadLength( const NetworkBufferDescriptor_t *pxBuffer )
+	{
+	const TCPPacket_t *pxTCPPacket = ( const TCPPacket_t * ) ( pxBuffer->pucEthernetBuffer );
+	size_t uxLength, uxHeaderLength, uxResult = 0u;
+
+		/* Only IPv4 packets without IP options and without fragmentation,
+		carrying TCP data without any of the flags SYN, FIN, RST or URG. */
+		if( ( pxBuffer->xDataLength >= ( size_t ) ( ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER ) ) &&
+			( pxTCPPacket->xEthernetHeader.usFrameType == ipIPv4_FRAME_TYPE ) &&
+			( pxTCPPacket->xIPHeader.ucVersionHeaderLength == 0x45u ) &&
+			( pxTCPPacket->xIPHeader.ucProtocol == ( uint8_t ) ipPROTOCOL_TCP ) &&
+			( ( pxTCPPacket->xIPHeader.usFragmentOffset & ipFRAGMENT_OFFSET_BIT_MASK ) == 0u ) &&
+			( ( pxTCPPacket->xTCPHeader.ucTCPFlags & ipTCP_COALESCE_FLAGS_MASK ) == ipTCP_COALESCE_FLAGS ) )
+		{
+			uxLength = ( size_t ) FreeRTOS_ntohs( pxTCPPacket->xIPHeader.usLength );
+			/* The high nibble of ucTCPOffset holds the TCP header length in
+			32-bit words. */
+			uxHeaderLength = ( size_t ) ( ipSIZE_OF_IPv4_HEADER + ( ( pxTCPPacket->xTCPHeader.ucTCPOffset & 0xF0u ) >> 2 ) );
+
+			if( ( uxHeaderLength >= ( size_t ) ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER ) ) &&
+				( uxLength > uxHeaderLength ) &&
+				( ( uxLength + ipSIZE_OF_ETH_HEADER ) <= pxBuffer->xDataLength ) )
+			{
+				uxResult = uxLength - uxHeaderLength;
+			}
+		}
+
+		#if( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 )
+		{
+			if( ( uxResult != 0u ) &&
+				( usGenerateChecksum( 0UL, ( const uint8_t * ) &( pxTCPPacket->xIPHeader.ucVersionHeaderLength ), ipSIZE_OF_IPv4_HEADER ) != ipCORRECT_CRC ) )
+			{
+				uxResult = 0u;
+			}
+		}
+		#endif
+
+		return uxResult;
+	}
+	/*-----------------------------------------------------------*/
+
+	static NetworkBufferDescriptor_t *prvCoalesceTCPSegments( NetworkBufferDescriptor_t *pxBuffer, NetworkBufferDescriptor_t *pxNextBuffer )
+	{
+	const TCPPacket_t *pxFirst = ( const TCPPacket_t * ) ( pxBuffer->pucEthernetBuffer );
+	const TCPPacket_t *pxTCPPacket;
+	NetworkBufferDescriptor_t *pxLast = pxBuffer;
+	size_t uxLength, uxTotal, uxOptionsLength;
+	uint32_t ulNextSequenceNumber;
+	UBaseType_t uxCount = 1u;
+
+		uxTotal = prvCoalescePayloadLength( pxBuffer );
+
+		if( uxTotal != 0u )
+		{
+			ulNextSequenceNumber = FreeRTOS_ntohl( pxFirst->xTCPHeader.ulSequenceNumber ) + ( uint32_t ) uxTotal;
+			uxOptionsLength = ( size_t ) ( ( ( pxFirst->xTCPHeader.ucTCPOffset & 0xF0u ) >> 2 ) - ipSIZE_OF_TCP_HEADER );
+
+			while( ( pxNextBuffer != NULL ) && ( uxCount < ( UBaseType_t ) ipconfigTCP_RX_COALESCE_MAX_SEGMENTS ) )
+			{
+				pxTCPPacket = ( const TCPPacket_t * ) ( pxNextBuffer->pucEthernetBuffer );
+				uxLength = prvCoalescePayloadLength( pxNextBuffer );
+
+				/* The segment must directly follow the previous one, with the
+				same addresses, ports, ACK number, window and options.  The
+				sum of the lengths is limited to what fits in an IP packet. */
+				if( ( uxLength == 0u ) ||
+					( ( uxTotal + uxLength ) > ( size_t ) ( 0xffffu - ipSIZE_OF_IPv4_HEADER - ipSIZE_OF_TCP_HEADER - uxOptionsLength ) ) ||
+					( FreeRTOS_ntohl( pxTCPPacket->xTCPHeader.ulSequenceNumber ) != ulNextSequenceNumber ) ||
+					( memcmp( &( pxTCPPacket->xEthernetHeader ), &( pxFirst->xEthernetHeader ), sizeof( pxFirst->xEthernetHeader ) ) != 0 ) ||
+					( pxTCPPacket->xIPHeader.ulSourceIPAddress != pxFirst->xIPHeader.ulSourceIPAddress ) ||
+					( pxTCPPacket->xIPHeader.ulDestinationIPAddress != pxFirst->xIPHeader.ulDestinationIPAddress ) ||
+					( pxTCPPacket->xTCPHeader.usSourcePort != pxFirst->xTCPHeader.usSourcePort ) ||
+					( pxTCPPacket->xTCPHeader.usDestinationPort != pxFirst->xTCPHeader.usDestinationPort ) ||
+					( pxTCPPacket->xTCPHeader.ulAckNr != pxFirst->xTCPHeader.ulAckNr ) ||
+					( pxTCPPacket->xTCPHeader.usWindow != pxFirst->xTCPHeader.usWindow ) ||
+					( pxTCPPacket->xTCPHeader.ucTCPOffset != pxFirst->xTCPHeader.ucTCPOffset ) ||
+					( memcmp( pxNextBuffer->pucEthernetBuffer + ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER,
+						pxBuffer->pucEthernetBuffer + ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER, uxOptionsLength ) != 0 ) )
+				{
+					break;
+				}
+
+				#if( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 ) && ( ipconfigTCP_FUSED_CHECKSUM == 0 )
+				{
+					/* The segment won't pass prvAllowIPPacket(), check it here.
+					With ipconfigTCP_FUSED_CHECKSUM, xProcessReceivedTCPPacket()
+					checks all merged segments while copying them. */
+					if( usGenerateProtocolChecksum( pxNextBuffer->pucEthernetBuffer, pdFALSE ) != ipCORRECT_CRC )
+					{
+						break;
+					}
+				}
+				#endif
+
+				/* Move it from the chain to the list of merged segments. */
+				pxLast->pxNextBuffer = pxNextBuffer;
+				pxLast = pxNextBuffer;
+				pxNextBuffer = pxNextBuffer->pxNextBuffer;
+				pxLast->pxNextBuffer = NULL;
+
+				ulNextSequenceNumber += ( uint32_t ) uxLength;
+				uxTotal += uxLength;
+				uxCount++;
+			}
+
+			ulCoalesceSegments += ( uint32_t ) uxCount;
+			ulCoalesceMerged += ( uint32_t ) ( uxCount - 1u );
+
+			if( uxCount > 1u )
+			{
+				iptraceTCP_RX_SEGMENTS_MERGED( uxCount, uxTotal );
+			}
+		}
+
+		return pxNextBuffer;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vGetTCPCoalesceCounters( uint32_t *pulSegments, uint32_t *pulMerged )
+	{
+		*pulSegments = ulCoalesceSegments;
+		*pulMerged = ulCoalesceMerged;
+	}
+
+#endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_LINKED_RX_MESSAGES != 0 ) && ( ipconfigTCP_RX_COALESCE != 0 ) */
+/*-----------------------------------------------------------*/
+
 static TickType_t prvCalculateSleepTime( void )
 {
 TickType_t xMaximumSleepTime;
@@ -694,7 +1030,7 @@ static void prvCheckNetworkTimers( void )
 	BaseType_t xCheckTCPSockets;
 	extern uint32_t ulNextInitialSequenceNumber;
 
-		if( uxQueueMessagesWaiting( xNetworkEventQueue ) == 0u )
+		if( prvEventsWaiting() == 0u )
 		{
 			xWillSleep = pdTRUE;
 		}
@@ -820,7 +1156,7 @@ static const IPStackEvent_t xNetworkDownEvent = { eNetworkDownEvent, NULL };
 BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
 	/* Simply send the network task the appropriate event. */
-	if( xQueueSendToBackFromISR( xNetworkEventQueue, &xNetworkDownEvent, &xHigherPriorityTaskWoken ) != pdPASS )
+	if( xSendEventStructToIPTaskFromISR( &xNetworkDownEvent, &xHigherPriorityTaskWoken ) != pdPASS )
 	{
 		xNetworkDownEventPending = pdTRUE;
 	}
@@ -887,6 +1223,324 @@ NetworkBufferDescriptor_t * pxNewBuffer;
 }
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+
+	size_t uxNetworkBufferChainLength( const NetworkBufferDescriptor_t *pxNetworkBuffer )
+	{
+	size_t uxLength = 0u;
+
+		while( pxNetworkBuffer != NULL )
+		{
+			uxLength += pxNetworkBuffer->xDataLength;
+			pxNetworkBuffer = pxNetworkBuffer->pxNextFragment;
+		}
+
+		return uxLength;
+	}
+	/*-----------------------------------------------------------*/
+
+	NetworkBufferDescriptor_t *pxLinearizeNetworkBuffer( const NetworkBufferDescriptor_t *pxNetworkBuffer )
+	{
+	NetworkBufferDescriptor_t * pxNewBuffer;
+	const NetworkBufferDescriptor_t *pxFragment;
+	uint8_t *pucTarget;
+
+		pxNewBuffer = pxGetNetworkBufferWithDescriptor( uxNetworkBufferChainLength( pxNetworkBuffer ), ( TickType_t ) 0 );
+
+		if( pxNewBuffer != NULL )
+		{
+			pxNewBuffer->ulIPAddress = pxNetworkBuffer->ulIPAddress;
+			pxNewBuffer->usPort = pxNetworkBuffer->usPort;
+			pxNewBuffer->usBoundPort = pxNetworkBuffer->usBoundPort;
+
+			/* Append the header and all fragments. */
+			pucTarget = pxNewBuffer->pucEthernetBuffer;
+			for( pxFragment = pxNetworkBuffer; pxFragment != NULL; pxFragment = pxFragment->pxNextFragment )
+			{
+				memcpy( pucTarget, pxFragment->pucEthernetBuffer, pxFragment->xDataLength );
+				pucTarget += pxFragment->xDataLength;
+			}
+		}
+
+		return pxNewBuffer;
+	}
+	/*-----------------------------------------------------------*/
+
+	BaseType_t xNetworkInterfaceOutputChain( NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t xReleaseAfterSend )
+	{
+	NetworkBufferDescriptor_t *pxLinearBuffer;
+	BaseType_t xReturn = pdFAIL;
+
+		if( ( pxNetworkBuffer->pxNextFragment == NULL ) ||
+			( ( ipconfigGATHER_TX_DRIVER != 0 ) && ( ipconfigZERO_COPY_TX_DRIVER == 0 ) ) )
+		{
+			/* The driver will gather the fragments before it returns. */
+			xReturn = xIPOutputBatchFrame( pxNetworkBuffer, xReleaseAfterSend );
+		}
+		else
+		{
+			pxLinearBuffer = pxLinearizeNetworkBuffer( pxNetworkBuffer );
+
+			if( pxLinearBuffer == NULL )
+			{
+				FreeRTOS_debug_printf( ( "xNetworkInterfaceOutputChain: no buffer to linearise %lu bytes\n",
+					uxNetworkBufferChainLength( pxNetworkBuffer ) ) );
+			}
+
+			if( xReleaseAfterSend != pdFALSE )
+			{
+				vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+			}
+
+			if( pxLinearBuffer != NULL )
+			{
+				/* The copy belongs to the driver now. */
+				xReturn = xIPOutputBatchFrame( pxLinearBuffer, pdTRUE );
+			}
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* ipconfigUSE_CHAINED_BUFFERS */
+
+#if( ipconfigUSE_UDP_BATCH != 0 )
+
+	static void prvProcessGeneratedUDPBatch( NetworkBufferDescriptor_t *pxBuffer )
+	{
+	NetworkBufferDescriptor_t *pxNextBuffer;
+
+		vIPOutputBatchBegin();
+
+		while( pxBuffer != NULL )
+		{
+			pxNextBuffer = pxBuffer->pxNextBuffer;
+			pxBuffer->pxNextBuffer = NULL;
+
+			vProcessGeneratedUDPPacket( pxBuffer );
+
+			pxBuffer = pxNextBuffer;
+		}
+
+		vIPOutputBatchEnd();
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* ipconfigUSE_UDP_BATCH */
+
+#if( ipconfigUSE_NETWORK_OUTPUT_BATCH != 0 )
+
+	void vIPOutputBatchBegin( void )
+	{
+		xOutputBatchLevel++;
+	}
+	/*-----------------------------------------------------------*/
+
+	BaseType_t xIPOutputBatchFrame( NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t xReleaseAfterSend )
+	{
+	BaseType_t xReturn;
+
+		if( ( xOutputBatchLevel == 0 ) || ( xReleaseAfterSend == pdFALSE ) )
+		{
+			/* The caller needs the buffer back, or no batch is being collected.
+			Keep the frames in order. */
+			prvOutputBatchFlush();
+			xReturn = xNetworkInterfaceOutput( pxNetworkBuffer, xReleaseAfterSend );
+		}
+		else
+		{
+			if( xOutputBatchCount >= ( BaseType_t ) ipconfigNETWORK_OUTPUT_BATCH_SIZE )
+			{
+				prvOutputBatchFlush();
+			}
+
+			pxOutputBatch[ xOutputBatchCount ] = pxNetworkBuffer;
+			xOutputBatchCount++;
+			xReturn = pdPASS;
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vIPOutputBatchEnd( void )
+	{
+		configASSERT( xOutputBatchLevel > 0 );
+
+		xOutputBatchLevel--;
+		if( xOutputBatchLevel == 0 )
+		{
+			prvOutputBatchFlush();
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvOutputBatchFlush( void )
+	{
+		if( xOutputBatchCount == 1 )
+		{
+			/* Not worth a batch. */
+			xNetworkInterfaceOutput( pxOutputBatch[ 0 ], pdTRUE );
+		}
+		else if( xOutputBatchCount > 1 )
+		{
+			iptraceNETWORK_INTERFACE_OUTPUT_BATCH( xOutputBatchCount );
+			xNetworkInterfaceOutputBatch( pxOutputBatch, xOutputBatchCount );
+		}
+		else
+		{
+			/* Nothing was collected. */
+		}
+
+		xOutputBatchCount = 0;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* ipconfigUSE_NETWORK_OUTPUT_BATCH */
+
+#if( ipconfigUDP_DIRECT_SEND != 0 )
+
+	BaseType_t xIPDriverLockTake( void )
+	{
+	BaseType_t xReturn = pdFALSE;
+
+		/* The mutex is taken first, so that it is owned by the time the
+		IP-task can see xDirectSendActive. */
+		if( ( xDriverLock != NULL ) && ( xSemaphoreTake( xDriverLock, ( TickType_t ) 0u ) != pdFALSE ) )
+		{
+			taskENTER_CRITICAL();
+			{
+				if( xIPTaskIdle != pdFALSE )
+				{
+					xDirectSendActive = pdTRUE;
+					xReturn = pdTRUE;
+				}
+			}
+			taskEXIT_CRITICAL();
+
+			if( xReturn == pdFALSE )
+			{
+				/* The IP-task is busy, it will send the packet itself. */
+				xSemaphoreGive( xDriverLock );
+			}
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vIPDriverLockGive( void )
+	{
+		taskENTER_CRITICAL();
+		{
+			xDirectSendActive = pdFALSE;
+		}
+		taskEXIT_CRITICAL();
+
+		/* A waiting IP-task will get the mutex now. */
+		xSemaphoreGive( xDriverLock );
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvDriverLockRelease( void )
+	{
+		taskENTER_CRITICAL();
+		{
+			xIPTaskIdle = pdTRUE;
+		}
+		taskEXIT_CRITICAL();
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvDriverLockAcquire( void )
+	{
+	BaseType_t xMustWait;
+
+		taskENTER_CRITICAL();
+		{
+			/* No new senders will be admitted. */
+			xIPTaskIdle = pdFALSE;
+			xMustWait = xDirectSendActive;
+		}
+		taskEXIT_CRITICAL();
+
+		if( xMustWait != pdFALSE )
+		{
+			/* Wait for the sender, which inherits the priority of the
+			IP-task in the meantime. */
+			xSemaphoreTake( xDriverLock, portMAX_DELAY );
+			xSemaphoreGive( xDriverLock );
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* ipconfigUDP_DIRECT_SEND */
+
+#if( ipconfigNETWORK_INTERFACES > 1 )
+
+	void vIPRegisterPortOutput( BaseType_t xInterface, NetworkInterfaceOutputFunction_t pxOutput )
+	{
+		configASSERT( ( xInterface > 0 ) && ( xInterface < ( BaseType_t ) ipconfigNETWORK_INTERFACES ) );
+		pxInterfaceOutput[ xInterface ] = pxOutput;
+	}
+	/*-----------------------------------------------------------*/
+
+	BaseType_t xIPGetRxInterface( void )
+	{
+		return xRxInterface;
+	}
+	/*-----------------------------------------------------------*/
+
+	BaseType_t xIPPortOutput( NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t xReleaseAfterSend )
+	{
+	const EthernetHeader_t *pxEthernetHeader = ( const EthernetHeader_t * ) pxNetworkBuffer->pucEthernetBuffer;
+	NetworkBufferDescriptor_t *pxCopy;
+	BaseType_t xInterface, xReturn;
+
+		if( ( pxEthernetHeader->xDestinationAddress.ucBytes[ 0 ] & 0x01u ) != 0u )
+		{
+			/* Broadcast and multicast frames are sent on every port, the
+			original goes out on port 0. */
+			for( xInterface = 1; xInterface < ( BaseType_t ) ipconfigNETWORK_INTERFACES; xInterface++ )
+			{
+				if( pxInterfaceOutput[ xInterface ] != NULL )
+				{
+					pxCopy = pxDuplicateNetworkBufferWithDescriptor( pxNetworkBuffer, pxNetworkBuffer->xDataLength );
+					if( pxCopy != NULL )
+					{
+						pxInterfaceOutput[ xInterface ]( pxCopy, pdTRUE );
+					}
+				}
+			}
+			xInterface = 0;
+		}
+		else
+		{
+			/* Send it on the port where the destination was last heard. */
+			xInterface = xARPGetCacheInterface( &( pxEthernetHeader->xDestinationAddress ) );
+
+			if( ( xInterface <= 0 ) || ( pxInterfaceOutput[ xInterface ] == NULL ) )
+			{
+				xInterface = 0;
+			}
+		}
+
+		if( xInterface == 0 )
+		{
+			xReturn = xNetworkInterfaceOutput( pxNetworkBuffer, xReleaseAfterSend );
+		}
+		else
+		{
+			xReturn = pxInterfaceOutput[ xInterface ]( pxNetworkBuffer, xReleaseAfterSend );
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* ipconfigNETWORK_INTERFACES */
+
 #if( ipconfigZERO_COPY_TX_DRIVER != 0 ) || ( ipconfigZERO_COPY_RX_DRIVER != 0 )
 
 	NetworkBufferDescriptor_t *pxPacketBuffer_to_NetworkBuffer( void *pvBuffer )
@@ -976,6 +1630,7 @@ void FreeRTOS_ReleaseUDPPayloadBuffer( void *pvBuffer )
 BaseType_t FreeRTOS_IPInit( const uint8_t ucIPAddress[ ipIP_ADDRESS_LENGTH_BYTES ], const uint8_t ucNetMask[ ipIP_ADDRESS_LENGTH_BYTES ], const uint8_t ucGatewayAddress[ ipIP_ADDRESS_LENGTH_BYTES ], const uint8_t ucDNSServerAddress[ ipIP_ADDRESS_LENGTH_BYTES ], const uint8_t ucMACAddress[ ipMAC_ADDRESS_LENGTH_BYTES ] )
 {
 BaseType_t xReturn = pdFALSE;
+BaseType_t xEventsReady = pdFALSE;
 
 	/* This function should only be called once. */
 	configASSERT( xIPIsNetworkTaskReady() == pdFALSE );
@@ -989,13 +1644,34 @@ BaseType_t xReturn = pdFALSE;
 	configASSERT( sizeof( ICMPHeader_t ) == ipEXPECTED_ICMPHeader_t_SIZE );
 	configASSERT( sizeof( UDPHeader_t ) == ipEXPECTED_UDPHeader_t_SIZE );
 
-	/* Attempt to create the queue used to communicate with the IP task. */
-	xNetworkEventQueue = xQueueCreate( ( UBaseType_t ) ipconfigEVENT_QUEUE_LENGTH, ( UBaseType_t ) sizeof( IPStackEvent_t ) );
-	configASSERT( xNetworkEventQueue );
+	#if( ipconfigUSE_IP_EVENT_RING != 0 )
+	{
+		/* The events are passed through xEventRing, which is static.  Only
+		the semaphore for the tasks that find the ring full is created. */
+		xEventRingSpace = xSemaphoreCreateBinary();
+		configASSERT( xEventRingSpace );
+
+		if( xEventRingSpace != NULL )
+		{
+			xEventsReady = pdTRUE;
+		}
+	}
+	#else
+	{
+		/* Attempt to create the queue used to communicate with the IP task. */
+		xNetworkEventQueue = xQueueCreate( ( UBaseType_t ) ipconfigEVENT_QUEUE_LENGTH, ( UBaseType_t ) sizeof( IPStackEvent_t ) );
+		configASSERT( xNetworkEventQueue );
+
+		if( xNetworkEventQueue != NULL )
+		{
+			xEventsReady = pdTRUE;
+		}
+	}
+	#endif /* ipconfigUSE_IP_EVENT_RING */
 
-	if( xNetworkEventQueue != NULL )
+	if( xEventsReady != pdFALSE )
 	{
-		#if ( configQUEUE_REGISTRY_SIZE > 0 )
+		#if ( configQUEUE_REGISTRY_SIZE > 0 ) && ( ipconfigUSE_IP_EVENT_RING == 0 )
 		{
 			/* A queue registry is normally used to assist a kernel aware
 			debugger.  If one is in use then it will be helpful for the debugger
@@ -1038,6 +1714,14 @@ BaseType_t xReturn = pdFALSE;
 			/* Prepare the sockets interface. */
 			vNetworkSocketsInit();
 
+			#if( ipconfigUDP_DIRECT_SEND != 0 )
+			{
+				/* Without the lock, all packets will be sent by the IP-task. */
+				xDriverLock = xSemaphoreCreateMutex();
+				configASSERT( xDriverLock );
+			}
+			#endif
+
 			/* Create the task that processes Ethernet and stack events. */
 			xReturn = xTaskCreate( prvIPTask, "IP-task", ( uint16_t ) ipconfigIP_TASK_STACK_SIZE_WORDS, NULL, ( UBaseType_t ) ipconfigIP_TASK_PRIORITY, &xIPTaskHandle );
 		}
@@ -1046,8 +1730,12 @@ BaseType_t xReturn = pdFALSE;
 			FreeRTOS_debug_printf( ( "FreeRTOS_IPInit: xNetworkBuffersInitialise() failed\n") );
 
 			/* Clean up. */
-			vQueueDelete( xNetworkEventQueue );
-			xNetworkEventQueue = NULL;
+			#if( ipconfigUSE_IP_EVENT_RING == 0 )
+			{
+				vQueueDelete( xNetworkEventQueue );
+				xNetworkEventQueue = NULL;
+			}
+			#endif
 		}
 	}
 	else
@@ -1212,7 +1900,7 @@ BaseType_t xReturn, xSendMessage;
 				IP task is already awake processing other message. */
 				xTCPTimer.bExpired = pdTRUE_UNSIGNED;
 
-				if( uxQueueMessagesWaiting( xNetworkEventQueue ) != 0u )
+				if( prvEventsWaiting() != 0u )
 				{
 					/* Not actually going to send the message but this is not a
 					failure as the message didn't need to be sent. */
@@ -1231,7 +1919,66 @@ BaseType_t xReturn, xSendMessage;
 				xTimeout = ( TickType_t ) 0;
 			}
 
-			xReturn = xQueueSendToBack( xNetworkEventQueue, pxEvent, xTimeout );
+			#if( ipconfigUSE_IP_EVENT_RING != 0 )
+			{
+			TimeOut_t xTimeOut;
+			BaseType_t xTimedOut;
+
+				vTaskSetTimeOutState( &xTimeOut );
+				xTimedOut = ( xTimeout == ( TickType_t ) 0 ) ? pdTRUE : pdFALSE;
+
+				for( ;; )
+				{
+					taskENTER_CRITICAL();
+					{
+						xReturn = prvEventRingAdd( pxEvent );
+
+						if( ( xReturn == pdFAIL ) && ( xTimedOut == pdFALSE ) )
+						{
+							/* Counted while the ring is still full, so the
+							IP-task can not miss this task. */
+							uxEventRingWaiters++;
+						}
+					}
+					taskEXIT_CRITICAL();
+
+					if( ( xReturn != pdFAIL ) || ( xTimedOut != pdFALSE ) )
+					{
+						break;
+					}
+
+					/* The ring is full, wait until the IP-task has taken an
+					event. */
+					( void ) xSemaphoreTake( xEventRingSpace, xTimeout );
+					xTimedOut = xTaskCheckForTimeOut( &xTimeOut, &xTimeout );
+
+					taskENTER_CRITICAL();
+					{
+						uxEventRingWaiters--;
+					}
+					taskEXIT_CRITICAL();
+				}
+
+				if( xReturn != pdFAIL )
+				{
+					if( uxEventRingWaiters != 0u )
+					{
+						/* Only one waiting task is woken up at a time, pass
+						it on in case there is more space. */
+						xSemaphoreGive( xEventRingSpace );
+					}
+
+					if( xIPTaskHandle != NULL )
+					{
+						xTaskNotifyGive( xIPTaskHandle );
+					}
+				}
+			}
+			#else
+			{
+				xReturn = xQueueSendToBack( xNetworkEventQueue, pxEvent, xTimeout );
+			}
+			#endif /* ipconfigUSE_IP_EVENT_RING */
 
 			if( xReturn == pdFAIL )
 			{
@@ -1252,6 +1999,174 @@ BaseType_t xReturn, xSendMessage;
 }
 /*-----------------------------------------------------------*/
 
+BaseType_t xSendEventStructToIPTaskFromISR( const IPStackEvent_t *pxEvent, BaseType_t *pxHigherPriorityTaskWoken )
+{
+BaseType_t xReturn;
+
+	#if( ipconfigUSE_IP_EVENT_RING != 0 )
+	{
+	UBaseType_t uxSavedInterruptStatus;
+
+		uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+		{
+			xReturn = prvEventRingAdd( pxEvent );
+		}
+		portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+
+		if( ( xReturn != pdFAIL ) && ( xIPTaskHandle != NULL ) )
+		{
+			vTaskNotifyGiveFromISR( xIPTaskHandle, pxHigherPriorityTaskWoken );
+		}
+	}
+	#else
+	{
+		xReturn = xQueueSendToBackFromISR( xNetworkEventQueue, pxEvent, pxHigherPriorityTaskWoken );
+	}
+	#endif /* ipconfigUSE_IP_EVENT_RING */
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvEventsWaiting( void )
+{
+UBaseType_t uxCount;
+
+	#if( ipconfigUSE_IP_EVENT_RING != 0 )
+	{
+	UBaseType_t uxHead = uxEventRingHead;
+	UBaseType_t uxTail = uxEventRingTail;
+
+		if( uxHead >= uxTail )
+		{
+			uxCount = uxHead - uxTail;
+		}
+		else
+		{
+			uxCount = ( ipEVENT_RING_SIZE + uxHead ) - uxTail;
+		}
+	}
+	#else
+	{
+		uxCount = uxQueueMessagesWaiting( xNetworkEventQueue );
+	}
+	#endif /* ipconfigUSE_IP_EVENT_RING */
+
+	return uxCount;
+}
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_IP_EVENT_RING != 0 )
+
+	static BaseType_t prvEventRingAdd( const IPStackEvent_t *pxEvent )
+	{
+	BaseType_t xReturn = pdPASS;
+	BaseType_t xCoalesce = pdFALSE;
+	UBaseType_t uxNext;
+
+		if( ( pxEvent->pvData == NULL ) &&
+			( pxEvent->eEventType > eNoEvent ) &&
+			( ( ( 1ul << ( uint32_t ) pxEvent->eEventType ) & ipEVENT_RING_COALESCE ) != 0ul ) )
+		{
+			xCoalesce = pdTRUE;
+		}
+
+		if( ( xCoalesce != pdFALSE ) && ( ucEventRingPending[ pxEvent->eEventType ] != 0u ) )
+		{
+			/* The same event is still waiting in the ring, it is enough to
+			handle it once. */
+			ulEventRingCoalesced++;
+		}
+		else
+		{
+			uxNext = uxEventRingHead + 1u;
+			if( uxNext >= ipEVENT_RING_SIZE )
+			{
+				uxNext = 0u;
+			}
+
+			if( uxNext == uxEventRingTail )
+			{
+				ulEventRingOverflows++;
+				xReturn = pdFAIL;
+			}
+			else
+			{
+				/* The event is complete before the IP-task can see it. */
+				xEventRing[ uxEventRingHead ] = *pxEvent;
+				uxEventRingHead = uxNext;
+
+				if( xCoalesce != pdFALSE )
+				{
+					ucEventRingPending[ pxEvent->eEventType ] = 1u;
+				}
+			}
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvEventRingReceive( IPStackEvent_t *pxEvent, TickType_t xTicksToWait )
+	{
+	BaseType_t xReturn = pdFALSE;
+	UBaseType_t uxTail;
+
+		if( ( uxEventRingHead == uxEventRingTail ) && ( xTicksToWait != ( TickType_t ) 0u ) )
+		{
+			/* A task notification is given for every event that is added. */
+			( void ) ulTaskNotifyTake( pdTRUE, xTicksToWait );
+		}
+
+		if( uxEventRingHead != uxEventRingTail )
+		{
+			/* Only the IP-task changes the tail, no locking is needed to take
+			an event.  The events are taken in the order in which they were
+			added. */
+			uxTail = uxEventRingTail;
+			*pxEvent = xEventRing[ uxTail ];
+
+			if( ( pxEvent->pvData == NULL ) &&
+				( pxEvent->eEventType > eNoEvent ) &&
+				( ( ( 1ul << ( uint32_t ) pxEvent->eEventType ) & ipEVENT_RING_COALESCE ) != 0ul ) )
+			{
+				/* Cleared before the event is handled: a new event of this
+				type must be stored again. */
+				ucEventRingPending[ pxEvent->eEventType ] = 0u;
+			}
+
+			uxTail++;
+			if( uxTail >= ipEVENT_RING_SIZE )
+			{
+				uxTail = 0u;
+			}
+			uxEventRingTail = uxTail;
+			xReturn = pdTRUE;
+
+			if( uxEventRingWaiters != 0u )
+			{
+				/* A task is waiting for space in the ring. */
+				xSemaphoreGive( xEventRingSpace );
+			}
+		}
+		else
+		{
+			/* Timed out. */
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vGetIPEventRingCounters( uint32_t *pulCoalesced, uint32_t *pulOverflows )
+	{
+		*pulCoalesced = ulEventRingCoalesced;
+		*pulOverflows = ulEventRingOverflows;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* ipconfigUSE_IP_EVENT_RING */
+
 eFrameProcessingResult_t eConsiderFrameForProcessing( const uint8_t * const pucEthernetBuffer )
 {
 eFrameProcessingResult_t eReturn;
@@ -1387,10 +2302,43 @@ volatile eFrameProcessingResult_t eReturned; /* Volatile to prevent complier war
 
 	configASSERT( pxNetworkBuffer );
 
+	#if( ipconfigNETWORK_INTERFACES > 1 )
+	{
+		/* The ARP cache will remember the port of the sender. */
+		if( ( pxNetworkBuffer->xInterface >= 0 ) && ( pxNetworkBuffer->xInterface < ( BaseType_t ) ipconfigNETWORK_INTERFACES ) )
+		{
+			xRxInterface = pxNetworkBuffer->xInterface;
+		}
+		else
+		{
+			xRxInterface = 0;
+		}
+	}
+	#endif /* ipconfigNETWORK_INTERFACES */
+
 	/* Interpret the Ethernet frame. */
 	eReturned = ipCONSIDER_FRAME_FOR_PROCESSING( pxNetworkBuffer->pucEthernetBuffer );
 	pxEthernetHeader = ( EthernetHeader_t * ) ( pxNetworkBuffer->pucEthernetBuffer );
 
+	#if( ipconfigNETWORK_INTERFACES > 1 )
+	{
+		/* All ports use the MAC-address of the stack, so they must be
+		connected to separate segments.  A port that receives a frame that was
+		sent by this stack shares a segment with another port.  It is not used
+		for output any more, its neighbours are reached through port 0. */
+		if( ( xRxInterface != 0 ) &&
+			( memcmp( ( void * ) ipLOCAL_MAC_ADDRESS, ( void * ) &( pxEthernetHeader->xSourceAddress ), sizeof( MACAddress_t ) ) == 0 ) )
+		{
+			if( pxInterfaceOutput[ xRxInterface ] != NULL )
+			{
+				FreeRTOS_printf( ( "Port %ld is on the same segment as another port, it is disabled\n", xRxInterface ) );
+				pxInterfaceOutput[ xRxInterface ] = NULL;
+			}
+			eReturned = eReleaseBuffer;
+		}
+	}
+	#endif /* ipconfigNETWORK_INTERFACES */
+
 	if( eReturned == eProcessBuffer )
 	{
 		/* Interpret the received Ethernet packet. */
@@ -1507,6 +2455,13 @@ eFrameProcessingResult_t eReturn = eProcessBuffer;
 				/* Check sum in IP-header not correct. */
 				eReturn = eReleaseBuffer;
 			}
+		#if( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_FUSED_CHECKSUM != 0 )
+			else if( ( pxIPHeader->ucProtocol == ( uint8_t ) ipPROTOCOL_TCP ) && ( uxHeaderLength == ipSIZE_OF_IPv4_HEADER ) )
+			{
+				/* The TCP checksum will be checked by xProcessReceivedTCPPacket(),
+				while copying the payload to the socket. */
+			}
+		#endif
 			/* Is the upper-layer checksum (TCP/UDP/ICMP) correct? */
 			else if( usGenerateProtocolChecksum( ( uint8_t * )( pxNetworkBuffer->pucEthernetBuffer ), pdFALSE ) != ipCORRECT_CRC )
 			{
@@ -1689,7 +2644,6 @@ uint8_t ucProtocol;
 	{
 	ICMPHeader_t *pxICMPHeader;
 	IPHeader_t *pxIPHeader;
-	uint16_t usRequest;
 
 		pxICMPHeader = &( pxICMPPacket->xICMPHeader );
 		pxIPHeader = &( pxICMPPacket->xIPHeader );
@@ -1707,24 +2661,12 @@ uint8_t ucProtocol;
 
 		/* Update the checksum because the ucTypeOfMessage member in the header
 		has been changed to ipICMP_ECHO_REPLY.  This is faster than calling
-		usGenerateChecksum(). */
-
-		/* due to compiler warning "integer operation result is out of range" */
-
-		usRequest = ( uint16_t ) ( ( uint16_t )ipICMP_ECHO_REQUEST << 8 );
+		usGenerateChecksum().  The type is the high byte of the first 16-bit
+		word of the header. */
+		pxICMPHeader->usChecksum = usUpdateChecksum16( pxICMPHeader->usChecksum,
+			FreeRTOS_htons( ( uint16_t ) ( ( uint16_t ) ipICMP_ECHO_REQUEST << 8 ) ),
+			FreeRTOS_htons( ( uint16_t ) ( ( uint16_t ) ipICMP_ECHO_REPLY << 8 ) ) );
 
-		if( pxICMPHeader->usChecksum >= FreeRTOS_htons( 0xFFFFu - usRequest ) )
-		{
-			pxICMPHeader->usChecksum = ( uint16_t )
-				( ( ( uint32_t ) pxICMPHeader->usChecksum ) +
-					FreeRTOS_htons( usRequest + 1UL ) );
-		}
-		else
-		{
-			pxICMPHeader->usChecksum = ( uint16_t )
-				( ( ( uint32_t ) pxICMPHeader->usChecksum ) +
-					FreeRTOS_htons( usRequest ) );
-		}
 		return eReturnEthernetFrame;
 	}
 
@@ -1768,7 +2710,15 @@ uint8_t ucProtocol;
 
 uint16_t usGenerateProtocolChecksum( const uint8_t * const pucEthernetBuffer, BaseType_t xOutgoingPacket )
 {
-uint32_t ulLength;
+	/* Sum all protocol data. */
+	return usGenerateProtocolChecksumPartial( pucEthernetBuffer, xOutgoingPacket, 0u, 0u );
+}
+/*-----------------------------------------------------------*/
+
+uint16_t usGenerateProtocolChecksumPartial( const uint8_t * const pucEthernetBuffer, BaseType_t xOutgoingPacket,
+	size_t uxSummedLength, uint16_t usSummedData )
+{
+uint32_t ulLength, ulSum;
 uint16_t usChecksum, *pusChecksum;
 const IPPacket_t * pxIPPacket;
 UBaseType_t uxIPHeaderLength;
@@ -1855,18 +2805,30 @@ uint8_t ucProtocol;
 		format/length */
 		return ipINVALID_LENGTH;
 	}
+
+	if( ( uxSummedLength > ( size_t ) ulLength ) || ( ( ( ulLength - uxSummedLength ) & 1u ) != 0u ) )
+	{
+		/* The part that was summed already must start at an even offset. */
+		return ipINVALID_LENGTH;
+	}
+
+	/* Only the headers and the data that was not summed yet will be read. */
+	ulLength -= ( uint32_t ) uxSummedLength;
+
 	if( ucProtocol <= ( uint8_t ) ipPROTOCOL_IGMP )
 	{
 		/* ICMP/IGMP do not have a pseudo header for CRC-calculation. */
 		usChecksum = ( uint16_t )
-			( ~usGenerateChecksum( 0UL,
+			( ~usGenerateChecksum( ( uint32_t ) usSummedData,
 				( uint8_t * ) &( pxProtPack->xTCPPacket.xTCPHeader ), ( size_t ) ulLength ) );
 	}
 	else
 	{
 		/* For UDP and TCP, sum the pseudo header, i.e. IP protocol + length
-		fields */
-		usChecksum = ( uint16_t ) ( ulLength + ( ( uint16_t ) ucProtocol ) );
+		fields, plus the sum of the data that has been summed already. */
+		ulSum = ulLength + ( uint32_t ) uxSummedLength + ( ( uint32_t ) ucProtocol ) + ( uint32_t ) usSummedData;
+		ulSum = ( ulSum & 0xffffUL ) + ( ulSum >> 16 );
+		usChecksum = ( uint16_t ) ( ( ulSum & 0xffffUL ) + ( ulSum >> 16 ) );
 
 		/* And then continue at the IPv4 source and destination addresses. */
 		usChecksum = ( uint16_t )
@@ -1916,14 +2878,19 @@ uint8_t ucProtocol;
 
 uint16_t usGenerateChecksum( uint32_t ulSum, const uint8_t * pucNextData, size_t uxDataLengthBytes )
 {
-xUnion32 xSum2, xSum, xTerm;
+xUnion32 xSum, xTerm;
 xUnionPtr xSource;		/* Points to first byte */
 xUnionPtr xLastSource;	/* Points to last byte plus one */
-uint32_t ulAlignBits, ulCarry = 0ul;
+uint32_t ulAlignBits;
+uint64_t ullSum, ullSum2 = 0ull;
 
-	/* Small MCUs often spend up to 30% of the time doing checksum calculations
-	This function is optimised for 32-bit CPUs; Each time it will try to fetch
-	32-bits, sums it with an accumulator and counts the number of carries. */
+	/* Small MCUs often spend up to 30% of the time doing checksum calculations.
+	The 32-bit words are added to 64-bit accumulators, which can not overflow
+	for any realistic length, so there is no need to test for carries in the
+	loop: they are all folded back once at the end.  Compilers translate a
+	64-bit addition into an add-with-carry pair on 32-bit CPUs.  The two
+	independent accumulators allow 64-bit and superscalar CPUs, such as the
+	Cortex-A9 or x86, to do the additions in parallel, or to vectorise them. */
 
 	/* Swap the input (little endian platform only). */
 	xSum.u32 = FreeRTOS_ntohs( ulSum );
@@ -1950,59 +2917,43 @@ uint32_t ulAlignBits, ulCarry = 0ul;
 		/* Now xSource is word (32-bit) aligned. */
 	}
 
-	/* Word (32-bit) aligned, do the most part. */
-	xLastSource.u32ptr = ( xSource.u32ptr + ( uxDataLengthBytes / 4u ) ) - 3u;
+	ullSum = ( uint64_t ) xSum.u32;
+
+	/* Word (32-bit) aligned, do the most part.  In this loop, eight 32-bit
+	additions will be done, in total 32 bytes.  Indexing with constants gives
+	faster code than using post-increments. */
+	xLastSource.u32ptr = xSource.u32ptr + ( ( uxDataLengthBytes / 32u ) * 8u );
 
-	/* In this loop, four 32-bit additions will be done, in total 16 bytes.
-	Indexing with constants (0,1,2,3) gives faster code than using
-	post-increments. */
 	while( xSource.u32ptr < xLastSource.u32ptr )
 	{
-		/* Use a secondary Sum2, just to see if the addition produced an
-		overflow. */
-		xSum2.u32 = xSum.u32 + xSource.u32ptr[ 0 ];
-		if( xSum2.u32 < xSum.u32 )
-		{
-			ulCarry++;
-		}
-
-		/* Now add the secondary sum to the major sum, and remember if there was
-		a carry. */
-		xSum.u32 = xSum2.u32 + xSource.u32ptr[ 1 ];
-		if( xSum2.u32 > xSum.u32 )
-		{
-			ulCarry++;
-		}
-
-		/* And do the same trick once again for indexes 2 and 3 */
-		xSum2.u32 = xSum.u32 + xSource.u32ptr[ 2 ];
-		if( xSum2.u32 < xSum.u32 )
-		{
-			ulCarry++;
-		}
+		ullSum  += xSource.u32ptr[ 0 ];
+		ullSum2 += xSource.u32ptr[ 1 ];
+		ullSum  += xSource.u32ptr[ 2 ];
+		ullSum2 += xSource.u32ptr[ 3 ];
+		ullSum  += xSource.u32ptr[ 4 ];
+		ullSum2 += xSource.u32ptr[ 5 ];
+		ullSum  += xSource.u32ptr[ 6 ];
+		ullSum2 += xSource.u32ptr[ 7 ];
 
-		xSum.u32 = xSum2.u32 + xSource.u32ptr[ 3 ];
-
-		if( xSum2.u32 > xSum.u32 )
-		{
-			ulCarry++;
-		}
-
-		/* And finally advance the pointer 4 * 4 = 16 bytes. */
-		xSource.u32ptr += 4;
+		/* And finally advance the pointer 8 * 4 = 32 bytes. */
+		xSource.u32ptr += 8;
 	}
 
-	/* Now add all carries. */
-	xSum.u32 = ( uint32_t )xSum.u16[ 0 ] + xSum.u16[ 1 ] + ulCarry;
+	/* The remaining words. */
+	uxDataLengthBytes %= 32u;
+	xLastSource.u32ptr = xSource.u32ptr + ( uxDataLengthBytes / 4u );
 
-	uxDataLengthBytes %= 16u;
-	xLastSource.u8ptr = ( uint8_t * ) ( xSource.u8ptr + ( uxDataLengthBytes & ~( ( size_t ) 1 ) ) );
+	while( xSource.u32ptr < xLastSource.u32ptr )
+	{
+		ullSum += xSource.u32ptr[ 0 ];
+		xSource.u32ptr++;
+	}
 
-	/* Half-word aligned. */
-	while( xSource.u16ptr < xLastSource.u16ptr )
+	/* Half-word aligned, at most one short left. */
+	uxDataLengthBytes %= 4u;
+	if( uxDataLengthBytes >= 2u )
 	{
-		/* At least one more short. */
-		xSum.u32 += xSource.u16ptr[ 0 ];
+		ullSum += xSource.u16ptr[ 0 ];
 		xSource.u16ptr++;
 	}
 
@@ -2010,12 +2961,16 @@ uint32_t ulAlignBits, ulCarry = 0ul;
 	{
 		xTerm.u8[ 0 ] = xSource.u8ptr[ 0 ];
 	}
-	xSum.u32 += xTerm.u32;
+	ullSum += ullSum2 + xTerm.u32;
 
-	/* Now add all carries again. */
-	xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
+	/* Now fold all carries: from 64 to 32 bits, the second time can not
+	give a carry any more. */
+	ullSum = ( ullSum & 0xffffffffull ) + ( ullSum >> 32 );
+	ullSum = ( ullSum & 0xffffffffull ) + ( ullSum >> 32 );
+	xSum.u32 = ( uint32_t ) ullSum;
 
-	/* The previous summation might have given a 16-bit carry. */
+	/* And from 32 to 16 bits, the first summation might give a 16-bit carry. */
+	xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
 	xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
 
 	if( ( ulAlignBits & 1u ) != 0u )
@@ -2030,6 +2985,157 @@ uint32_t ulAlignBits, ulCarry = 0ul;
 }
 /*-----------------------------------------------------------*/
 
+uint16_t usGenerateChecksumCopy( uint32_t ulSum, uint8_t * pucTarget, const uint8_t * pucSource, size_t uxDataLengthBytes )
+{
+xUnion32 xSum, xTerm;
+xUnionPtr xSource;		/* Points to first byte */
+xUnionPtr xTarget;
+xUnionPtr xLastSource;	/* Points to last byte plus one */
+uint32_t ulWord0, ulWord1, ulWord2, ulWord3;
+uint64_t ullSum, ullSum2 = 0ull;
+
+	if( ( ( ( ( ( size_t ) pucSource ) ^ ( ( size_t ) pucTarget ) ) & 0x03u ) != 0u ) ||
+		( ( ( ( size_t ) pucSource ) & 0x01u ) != 0u ) )
+	{
+		/* The source and the target have a different alignment, or the data
+		starts at an odd address.  Copy first and then sum the copy, which is
+		still in the cache. */
+		memcpy( pucTarget, pucSource, uxDataLengthBytes );
+		xSum.u32 = ( uint32_t ) usGenerateChecksum( 0UL, pucTarget, uxDataLengthBytes ) + ( ulSum & 0xffffUL );
+		xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
+
+		return ( uint16_t ) ( ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ] );
+	}
+
+	/* The same algorithm as in usGenerateChecksum(), except that every word
+	that is added is also stored at the target. */
+	xSum.u32 = FreeRTOS_ntohs( ulSum );
+	xTerm.u32 = 0ul;
+
+	xSource.u8ptr = ( uint8_t * ) pucSource;
+	xTarget.u8ptr = pucTarget;
+
+	/* If half-word (16-bit) aligned... */
+	if( ( ( ( ( size_t ) pucSource ) & 0x02u ) != 0u ) && ( uxDataLengthBytes >= 2u ) )
+	{
+		*( xTarget.u16ptr ) = *( xSource.u16ptr );
+		xSum.u32 += *( xSource.u16ptr );
+		( xSource.u16ptr )++;
+		( xTarget.u16ptr )++;
+		uxDataLengthBytes -= 2u;
+		/* Now both are word (32-bit) aligned. */
+	}
+
+	ullSum = ( uint64_t ) xSum.u32;
+
+	/* Word (32-bit) aligned, 16 bytes per loop.  The words are loaded into
+	locals first, so the stores can not force the compiler to load them again
+	from the source. */
+	xLastSource.u32ptr = xSource.u32ptr + ( ( uxDataLengthBytes / 16u ) * 4u );
+
+	while( xSource.u32ptr < xLastSource.u32ptr )
+	{
+		ulWord0 = xSource.u32ptr[ 0 ];
+		ulWord1 = xSource.u32ptr[ 1 ];
+		ulWord2 = xSource.u32ptr[ 2 ];
+		ulWord3 = xSource.u32ptr[ 3 ];
+		xTarget.u32ptr[ 0 ] = ulWord0;
+		xTarget.u32ptr[ 1 ] = ulWord1;
+		xTarget.u32ptr[ 2 ] = ulWord2;
+		xTarget.u32ptr[ 3 ] = ulWord3;
+		ullSum  += ulWord0;
+		ullSum2 += ulWord1;
+		ullSum  += ulWord2;
+		ullSum2 += ulWord3;
+
+		xSource.u32ptr += 4;
+		xTarget.u32ptr += 4;
+	}
+
+	/* The remaining words. */
+	uxDataLengthBytes %= 16u;
+	xLastSource.u32ptr = xSource.u32ptr + ( uxDataLengthBytes / 4u );
+
+	while( xSource.u32ptr < xLastSource.u32ptr )
+	{
+		ulWord0 = xSource.u32ptr[ 0 ];
+		xTarget.u32ptr[ 0 ] = ulWord0;
+		ullSum += ulWord0;
+		xSource.u32ptr++;
+		xTarget.u32ptr++;
+	}
+
+	/* Half-word aligned, at most one short left. */
+	uxDataLengthBytes %= 4u;
+	if( uxDataLengthBytes >= 2u )
+	{
+		xTarget.u16ptr[ 0 ] = xSource.u16ptr[ 0 ];
+		ullSum += xSource.u16ptr[ 0 ];
+		xSource.u16ptr++;
+		xTarget.u16ptr++;
+	}
+
+	if( ( uxDataLengthBytes & ( size_t ) 1 ) != 0u )	/* Maybe one more ? */
+	{
+		xTarget.u8ptr[ 0 ] = xSource.u8ptr[ 0 ];
+		xTerm.u8[ 0 ] = xSource.u8ptr[ 0 ];
+	}
+	ullSum += ullSum2 + xTerm.u32;
+
+	/* Fold all carries, as in usGenerateChecksum(). */
+	ullSum = ( ullSum & 0xffffffffull ) + ( ullSum >> 32 );
+	ullSum = ( ullSum & 0xffffffffull ) + ( ullSum >> 32 );
+	xSum.u32 = ( uint32_t ) ullSum;
+
+	xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
+	xSum.u32 = ( uint32_t ) xSum.u16[ 0 ] + xSum.u16[ 1 ];
+
+	/* swap the output (little endian platform only). */
+	return FreeRTOS_htons( ( (uint16_t) xSum.u32 ) );
+}
+/*-----------------------------------------------------------*/
+
+uint16_t usAddPartialChecksum( uint16_t usChecksum, uint16_t usPartial, size_t uxPartialOffset )
+{
+uint32_t ulSum;
+
+	if( ( uxPartialOffset & 1u ) != 0u )
+	{
+		/* The part starts at an odd offset, its bytes belong to the other
+		halves of the 16-bit words. */
+		usPartial = ( uint16_t ) ( ( ( usPartial & 0xffu ) << 8 ) | ( ( usPartial & 0xff00u ) >> 8 ) );
+	}
+
+	ulSum = ( uint32_t ) usChecksum + ( uint32_t ) usPartial;
+	ulSum = ( ulSum & 0xffffUL ) + ( ulSum >> 16 );
+
+	return ( uint16_t ) ulSum;
+}
+/*-----------------------------------------------------------*/
+
+uint16_t usUpdateChecksum16( uint16_t usChecksum, uint16_t usOldValue, uint16_t usNewValue )
+{
+uint32_t ulSum;
+
+	/* RFC 1624, eqn. 3: HC' = ~( ~HC + ~m + m' ).  The one's complement sum
+	does not depend on the byte order, as long as all three values have the
+	same order. */
+	ulSum = ( uint32_t ) ( uint16_t ) ~usChecksum + ( uint32_t ) ( uint16_t ) ~usOldValue + ( uint32_t ) usNewValue;
+	ulSum = ( ulSum & 0xffffUL ) + ( ulSum >> 16 );
+	ulSum = ( ulSum & 0xffffUL ) + ( ulSum >> 16 );
+
+	return ( uint16_t ) ~ulSum;
+}
+/*-----------------------------------------------------------*/
+
+uint16_t usUpdateChecksum32( uint16_t usChecksum, uint32_t ulOldValue, uint32_t ulNewValue )
+{
+	/* A 32-bit field, e.g. an IP address, is two 16-bit words in the sum. */
+	usChecksum = usUpdateChecksum16( usChecksum, ( uint16_t ) ( ulOldValue >> 16 ), ( uint16_t ) ( ulNewValue >> 16 ) );
+	return usUpdateChecksum16( usChecksum, ( uint16_t ) ( ulOldValue & 0xffffUL ), ( uint16_t ) ( ulNewValue & 0xffffUL ) );
+}
+/*-----------------------------------------------------------*/
+
 void vReturnEthernetFrame( NetworkBufferDescriptor_t * pxNetworkBuffer, BaseType_t xReleaseAfterSend )
 {
 EthernetHeader_t *pxEthernetHeader;
@@ -2073,7 +3179,7 @@ EthernetHeader_t *pxEthernetHeader;
 		memcpy( ( void * ) &( pxEthernetHeader->xSourceAddress) , ( void * ) ipLOCAL_MAC_ADDRESS, ( size_t ) ipMAC_ADDRESS_LENGTH_BYTES );
 
 		/* Send! */
-		xNetworkInterfaceOutput( pxNetworkBuffer, xReleaseAfterSend );
+		xIPOutputBatchFrame( pxNetworkBuffer, xReleaseAfterSend );
 	}
 }
 /*-----------------------------------------------------------*/
@@ -73,6 +73,11 @@
 #include "FreeRTOS_DNS.h"
 #include "NetworkBufferManagement.h"
 
+#if( ipconfigUSE_SENDFILE != 0 ) || ( ipconfigUSE_RECV_TO_FILE != 0 )
+	/* FreeRTOS+FAT includes. */
+	#include "ff_stdio.h"
+#endif
+
 /* The ItemValue of the sockets xBoundSocketListItem member holds the socket's
 port number. */
 #define socketSET_SOCKET_PORT( pxSocket, usPort ) listSET_LIST_ITEM_VALUE( ( &( ( pxSocket )->xBoundSocketListItem ) ), ( usPort ) )
@@ -123,6 +128,33 @@ respectively. */
 #define socketNEXT_UDP_PORT_NUMBER_INDEX	0
 #define socketNEXT_TCP_PORT_NUMBER_INDEX	1
 
+#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+	/* The space allocated for a UDP and for a TCP socket, see also
+	prvDetermineSocketSize(). */
+	#define socketUDP_SOCKET_SIZE	( ( sizeof( FreeRTOS_Socket_t ) - sizeof( ( ( FreeRTOS_Socket_t * ) NULL )->u ) ) + sizeof( ( ( FreeRTOS_Socket_t * ) NULL )->u.xUDP ) )
+	#define socketTCP_SOCKET_SIZE	( ( sizeof( FreeRTOS_Socket_t ) - sizeof( ( ( FreeRTOS_Socket_t * ) NULL )->u ) ) + sizeof( ( ( FreeRTOS_Socket_t * ) NULL )->u.xTCP ) )
+
+	/* The space allocated for a stream buffer that can hold 'uxLength' bytes,
+	as calculated by prvTCPCreateStream(). */
+	#define socketSTREAM_BUFFER_SIZE( uxLength ) \
+		( ( sizeof( StreamBuffer_t ) - sizeof( ( ( StreamBuffer_t * ) NULL )->ucArray ) ) + \
+		( ( ( size_t ) ( uxLength ) + sizeof( size_t ) ) & ~( sizeof( size_t ) - 1u ) ) )
+
+	/* A slab keeps released objects of one size, linked through their first
+	word, so that the next allocation of that size does not need the heap. */
+	typedef struct xSOCKET_SLAB
+	{
+		void *pvFirstFree;
+		SocketSlabStats_t xStats;
+	} SocketSlab_t;
+#endif /* ipconfigSOCKET_SLAB_DEPTH */
+
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+	/* The bits in the event group of a poll set: a socket has been queued in
+	the ready list, or a socket in the set has been signalled. */
+	#define socketPOLL_EVENT	( ( EventBits_t ) 0x01 )
+	#define socketPOLL_INTR		( ( EventBits_t ) 0x02 )
+#endif /* ipconfigSUPPORT_POLL_SET */
 
 /*-----------------------------------------------------------*/
 
@@ -151,6 +183,17 @@ static BaseType_t prvValidSocket( FreeRTOS_Socket_t *pxSocket, BaseType_t xProto
  */
 static BaseType_t prvDetermineSocketSize( BaseType_t xDomain, BaseType_t xType, BaseType_t xProtocol, size_t *pxSocketSize );
 
+/*
+ * Take the oldest packet from the list of waiting UDP packets, which may not
+ * be empty, and copy it or pass it as a zero-copy buffer.
+ */
+static int32_t prvUDPTakePacket( FreeRTOS_Socket_t *pxSocket, void *pvBuffer, size_t xBufferLength, BaseType_t xFlags, struct freertos_sockaddr *pxSourceAddress );
+
+/*
+ * Fill in the fields that the IP-task needs to send a UDP packet.
+ */
+static void prvUDPPrepareSend( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer, size_t xDataLength, const struct freertos_sockaddr *pxDestinationAddress );
+
 #if( ipconfigUSE_TCP == 1 )
 	/*
 	 * Create a txStream or a rxStream, depending on the parameter 'xIsInputStream'
@@ -173,6 +216,15 @@ static BaseType_t prvDetermineSocketSize( BaseType_t xDomain, BaseType_t xType,
 	static void prvTCPSetSocketCount( FreeRTOS_Socket_t *pxSocketToDelete );
 #endif  /* ipconfigUSE_TCP == 1 */
 
+#if( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_ACCEPT_POOL_SIZE > 0 )
+	/*
+	 * Allocate child sockets for a listening socket in advance, and release
+	 * them when the listening socket is closed.
+	 */
+	static void prvTCPAcceptPoolFill( FreeRTOS_Socket_t *pxSocket );
+	static void prvTCPAcceptPoolFree( FreeRTOS_Socket_t *pxSocket );
+#endif /* ipconfigTCP_ACCEPT_POOL_SIZE */
+
 #if( ipconfigUSE_TCP == 1 )
 	/*
 	 * Called from FreeRTOS_connect(): make some checks and if allowed, send a
@@ -181,12 +233,36 @@ static BaseType_t prvDetermineSocketSize( BaseType_t xDomain, BaseType_t xType,
 	static BaseType_t prvTCPConnectStart( FreeRTOS_Socket_t *pxSocket, struct freertos_sockaddr *pxAddress );
 #endif /* ipconfigUSE_TCP */
 
+#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+	/*
+	 * Sockets and stream buffers are allocated from and released to the
+	 * slabs.  Objects whose size does not belong to any slab use the heap.
+	 */
+	static size_t prvSocketSlabObjectSize( BaseType_t xIndex );
+	static BaseType_t prvSocketSlabIndex( size_t uxSize, BaseType_t xIsStream );
+	static void *prvSocketSlabTake( size_t uxSize, BaseType_t xIsStream );
+	static void prvSocketSlabGive( void *pvObject, size_t uxSize, BaseType_t xIsStream );
+#endif /* ipconfigSOCKET_SLAB_DEPTH */
+
 #if( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
 
 	/* Executed by the IP-task, it will check all sockets belonging to a set */
 	static FreeRTOS_Socket_t *prvFindSelectedSocket( SocketSelect_t *pxSocketSet );
 
+	/* Return those bits of 'xInterest' that are true for the socket right now.
+	It only reads the socket, so it may also be called by a user task while
+	the scheduler is suspended. */
+	static EventBits_t prvSocketReadyBits( FreeRTOS_Socket_t *pxSocket, EventBits_t xInterest );
+
 #endif /* ipconfigSUPPORT_SELECT_FUNCTION == 1 */
+
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+
+	/* Check the sockets that are queued in the ready list of a poll set, and
+	store at most 'xMaxEvents' events. */
+	static BaseType_t prvPollCollect( SocketPoll_t *pxPollSet, PollEvent_t *pxEvents, BaseType_t xMaxEvents );
+
+#endif /* ipconfigSUPPORT_POLL_SET */
 /*-----------------------------------------------------------*/
 
 /* The list that contains mappings between sockets and port numbers.  Accesses
@@ -206,6 +282,13 @@ when the IP stack is initialised.  Note ipconfigRAND32() is used, which must be
 seeded prior to the IP task being started. */
 static uint16_t usNextPortToUse[ socketPROTOCOL_COUNT ] = { 0 };
 
+#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+	/* The slabs for UDP sockets, TCP sockets, and stream buffers of the default
+	RX and TX sizes.  Sockets are created by user tasks and released by the
+	IP-task, so the slabs are accessed while the scheduler is suspended. */
+	static SocketSlab_t xSocketSlabs[ FREERTOS_SLAB_COUNT ];
+#endif /* ipconfigSOCKET_SLAB_DEPTH */
+
 /*-----------------------------------------------------------*/
 
 static BaseType_t prvValidSocket( FreeRTOS_Socket_t *pxSocket, BaseType_t xProtocol, BaseType_t xIsBound )
@@ -337,7 +420,15 @@ Socket_t xReturn;
 		size depends on the type of socket: UDP sockets need less space.  A
 		define 'pvPortMallocSocket' will used to allocate the necessary space.
 		By default it points to the FreeRTOS function 'pvPortMalloc()'. */
-		pxSocket = ( FreeRTOS_Socket_t * ) pvPortMallocSocket( uxSocketSize );
+		#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+		{
+			pxSocket = ( FreeRTOS_Socket_t * ) prvSocketSlabTake( uxSocketSize, pdFALSE );
+		}
+		#else
+		{
+			pxSocket = ( FreeRTOS_Socket_t * ) pvPortMallocSocket( uxSocketSize );
+		}
+		#endif
 
 		if( pxSocket == NULL )
 		{
@@ -346,7 +437,15 @@ Socket_t xReturn;
 		}
 		else if( ( xEventGroup = xEventGroupCreate() ) == NULL )
 		{
-			vPortFreeSocket( pxSocket );
+			#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+			{
+				prvSocketSlabGive( pxSocket, uxSocketSize, pdFALSE );
+			}
+			#else
+			{
+				vPortFreeSocket( pxSocket );
+			}
+			#endif
 			pxSocket = ( FreeRTOS_Socket_t * ) FREERTOS_INVALID_SOCKET;
 			iptraceFAILED_TO_CREATE_EVENT_GROUP();
 		}
@@ -400,6 +499,11 @@ Socket_t xReturn;
 						pxSocket->u.xTCP.uxTxWinSize  = 1u;
 					}
 					#endif
+					#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+					{
+						pxSocket->u.xTCP.xTCPWindow.ucCongestionAlgorithm = ( uint8_t ) ipconfigTCP_CONGESTION_CONTROL;
+					}
+					#endif
 					/* The above values are just defaults, and can be overridden by
 					calling FreeRTOS_setsockopt().  No buffers will be allocated until a
 					socket is connected and data is exchanged. */
@@ -642,6 +746,256 @@ Socket_t xReturn;
 #endif /* ipconfigSUPPORT_SELECT_FUNCTION == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+
+	PollSet_t FreeRTOS_CreatePollSet( void )
+	{
+	SocketPoll_t *pxPollSet;
+
+		pxPollSet = ( SocketPoll_t * ) pvPortMalloc( sizeof( *pxPollSet ) );
+
+		if( pxPollSet != NULL )
+		{
+			memset( pxPollSet, '\0', sizeof( *pxPollSet ) );
+			vListInitialise( &( pxPollSet->xReadyList ) );
+			pxPollSet->xPollGroup = xEventGroupCreate();
+
+			if( pxPollSet->xPollGroup == NULL )
+			{
+				vPortFree( ( void * ) pxPollSet );
+				pxPollSet = NULL;
+			}
+		}
+
+		return ( PollSet_t ) pxPollSet;
+	}
+
+#endif /* ipconfigSUPPORT_POLL_SET */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+
+	void FreeRTOS_DeletePollSet( PollSet_t xPollSet )
+	{
+	SocketPoll_t *pxPollSet = ( SocketPoll_t * ) xPollSet;
+
+		/* The sockets must have been removed with ePOLL_CTL_DEL or closed.
+		A registered socket that is idle is not in the ready list, but the
+		IP-task would still find the poll set through its pxPollSet. */
+		configASSERT( pxPollSet->uxSocketCount == 0u );
+		configASSERT( listLIST_IS_EMPTY( &( pxPollSet->xReadyList ) ) != pdFALSE );
+
+		vEventGroupDelete( pxPollSet->xPollGroup );
+		vPortFree( ( void * ) pxPollSet );
+	}
+
+#endif /* ipconfigSUPPORT_POLL_SET */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+
+	/* Register, modify or remove the events that a poll set is interested in.
+	The socket fields are also accessed by the IP-task, which is kept out by
+	suspending the scheduler. */
+	BaseType_t FreeRTOS_PollCtl( PollSet_t xPollSet, Socket_t xSocket, BaseType_t xOperation, EventBits_t xEvents, void *pvData )
+	{
+	FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
+	SocketPoll_t *pxPollSet = ( SocketPoll_t * ) xPollSet;
+	BaseType_t xReturn = 0;
+
+		configASSERT( pxSocket != NULL );
+		configASSERT( pxPollSet != NULL );
+
+		vTaskSuspendAll();
+		{
+			switch( xOperation )
+			{
+			case ePOLL_CTL_ADD:
+				if( pxSocket->pxPollSet != NULL )
+				{
+					/* A socket can only be registered in one poll set. */
+					xReturn = -pdFREERTOS_ERRNO_EEXIST;
+				}
+				else
+				{
+					vListInitialiseItem( &( pxSocket->xPollListItem ) );
+					listSET_LIST_ITEM_OWNER( &( pxSocket->xPollListItem ), ( void * ) pxSocket );
+					pxSocket->pxPollSet = pxPollSet;
+					pxPollSet->uxSocketCount++;
+				}
+				break;
+
+			case ePOLL_CTL_MOD:
+			case ePOLL_CTL_DEL:
+				if( pxSocket->pxPollSet != pxPollSet )
+				{
+					xReturn = -pdFREERTOS_ERRNO_ENOENT;
+				}
+				else if( xOperation == ePOLL_CTL_DEL )
+				{
+					if( listIS_CONTAINED_WITHIN( &( pxPollSet->xReadyList ), &( pxSocket->xPollListItem ) ) != pdFALSE )
+					{
+						uxListRemove( &( pxSocket->xPollListItem ) );
+					}
+					pxSocket->pxPollSet = NULL;
+					pxPollSet->uxSocketCount--;
+				}
+				break;
+
+			default:
+				xReturn = -pdFREERTOS_ERRNO_EINVAL;
+				break;
+			}
+
+			if( ( xReturn == 0 ) && ( xOperation != ePOLL_CTL_DEL ) )
+			{
+				pxSocket->xPollBits = xEvents & ( eSELECT_READ | eSELECT_WRITE | eSELECT_EXCEPT );
+				pxSocket->pvPollData = pvData;
+
+				/* The socket might be ready already: queue it so that the next
+				FreeRTOS_PollWait() will check it. */
+				if( listIS_CONTAINED_WITHIN( &( pxPollSet->xReadyList ), &( pxSocket->xPollListItem ) ) == pdFALSE )
+				{
+					vListInsertEnd( &( pxPollSet->xReadyList ), &( pxSocket->xPollListItem ) );
+				}
+				xEventGroupSetBits( pxPollSet->xPollGroup, socketPOLL_EVENT );
+			}
+		}
+		xTaskResumeAll();
+
+		return xReturn;
+	}
+
+#endif /* ipconfigSUPPORT_POLL_SET */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+
+	/* Wait until at least one of the registered sockets has an event, or until
+	the time-out expires.  Only the sockets which had an event since they were
+	last found idle are checked, so the cost does not grow with the number of
+	sockets in the set. */
+	BaseType_t FreeRTOS_PollWait( PollSet_t xPollSet, PollEvent_t *pxEvents, BaseType_t xMaxEvents, TickType_t xBlockTimeTicks )
+	{
+	SocketPoll_t *pxPollSet = ( SocketPoll_t * ) xPollSet;
+	TimeOut_t xTimeOut;
+	TickType_t xRemainingTime;
+	EventBits_t xGroupBits;
+	BaseType_t xReturn;
+
+		configASSERT( pxPollSet != NULL );
+		configASSERT( pxEvents != NULL );
+
+		xRemainingTime = xBlockTimeTicks;
+		vTaskSetTimeOutState( &xTimeOut );
+
+		for( ;; )
+		{
+			xReturn = prvPollCollect( pxPollSet, pxEvents, xMaxEvents );
+
+			if( xReturn != 0 )
+			{
+				break;
+			}
+
+			/* Has the timeout been reached? */
+			if( xTaskCheckForTimeOut( &xTimeOut, &xRemainingTime ) != pdFALSE )
+			{
+				break;
+			}
+
+			/* The IP-task sets socketPOLL_EVENT after queuing a socket, so an
+			event that occurs after prvPollCollect() will not be missed. */
+			xGroupBits = xEventGroupWaitBits( pxPollSet->xPollGroup, socketPOLL_EVENT | socketPOLL_INTR, pdTRUE, pdFALSE, xRemainingTime );
+
+			if( ( xGroupBits & socketPOLL_INTR ) != 0u )
+			{
+				FreeRTOS_debug_printf( ( "FreeRTOS_PollWait: interrupted\n" ) );
+				xReturn = -pdFREERTOS_ERRNO_EINTR;
+				break;
+			}
+		}
+
+		return xReturn;
+	}
+
+#endif /* ipconfigSUPPORT_POLL_SET */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+
+	static BaseType_t prvPollCollect( SocketPoll_t *pxPollSet, PollEvent_t *pxEvents, BaseType_t xMaxEvents )
+	{
+	UBaseType_t uxQueued;
+	FreeRTOS_Socket_t *pxSocket;
+	EventBits_t xReadyBits;
+	BaseType_t xCount = 0;
+
+		vTaskSuspendAll();
+		{
+			/* Visit each queued socket once.  A socket that is ready is
+			returned and moves to the end of the list: the events are level-
+			triggered and the other sockets get their turn first in the next
+			call.  A socket that is not ready leaves the list until the IP-task
+			reports a new event for it. */
+			uxQueued = listCURRENT_LIST_LENGTH( &( pxPollSet->xReadyList ) );
+
+			while( ( uxQueued > 0u ) && ( xCount < xMaxEvents ) )
+			{
+				uxQueued--;
+				pxSocket = ( FreeRTOS_Socket_t * ) listGET_OWNER_OF_HEAD_ENTRY( &( pxPollSet->xReadyList ) );
+				uxListRemove( &( pxSocket->xPollListItem ) );
+
+				xReadyBits = prvSocketReadyBits( pxSocket, pxSocket->xPollBits );
+
+				if( xReadyBits != 0u )
+				{
+					pxEvents[ xCount ].xSocket = ( Socket_t ) pxSocket;
+					pxEvents[ xCount ].xEvents = xReadyBits;
+					pxEvents[ xCount ].pvData = pxSocket->pvPollData;
+					xCount++;
+					vListInsertEnd( &( pxPollSet->xReadyList ), &( pxSocket->xPollListItem ) );
+				}
+			}
+		}
+		xTaskResumeAll();
+
+		return xCount;
+	}
+
+#endif /* ipconfigSUPPORT_POLL_SET */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+
+	void vSocketPollEvent( FreeRTOS_Socket_t *pxSocket, EventBits_t xEvents )
+	{
+	SocketPoll_t *pxPollSet;
+
+		if( ( pxSocket->pxPollSet != NULL ) && ( ( pxSocket->xPollBits & xEvents ) != 0u ) )
+		{
+			/* FreeRTOS_PollCtl() and prvPollCollect() change the ready list
+			while the scheduler is suspended. */
+			vTaskSuspendAll();
+			{
+				pxPollSet = pxSocket->pxPollSet;
+
+				if( pxPollSet != NULL )
+				{
+					if( listIS_CONTAINED_WITHIN( &( pxPollSet->xReadyList ), &( pxSocket->xPollListItem ) ) == pdFALSE )
+					{
+						vListInsertEnd( &( pxPollSet->xReadyList ), &( pxSocket->xPollListItem ) );
+					}
+					xEventGroupSetBits( pxPollSet->xPollGroup, socketPOLL_EVENT );
+				}
+			}
+			xTaskResumeAll();
+		}
+	}
+
+#endif /* ipconfigSUPPORT_POLL_SET */
+/*-----------------------------------------------------------*/
+
 /*
  * FreeRTOS_recvfrom: receive data from a bound socket
  * In this library, the function can only be used with connectionsless sockets
@@ -650,7 +1004,6 @@ Socket_t xReturn;
 int32_t FreeRTOS_recvfrom( Socket_t xSocket, void *pvBuffer, size_t xBufferLength, BaseType_t xFlags, struct freertos_sockaddr *pxSourceAddress, socklen_t *pxSourceAddressLength )
 {
 BaseType_t lPacketCount = 0;
-NetworkBufferDescriptor_t *pxNetworkBuffer;
 FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
 TickType_t xRemainingTime = ( TickType_t ) 0; /* Obsolete assignment, but some compilers output a warning if its not done. */
 BaseType_t xTimed = pdFALSE;
@@ -741,70 +1094,80 @@ EventBits_t xEventBits = ( EventBits_t ) 0;
 
 	if( lPacketCount != 0 )
 	{
-		taskENTER_CRITICAL();
-		{
-			/* The owner of the list item is the network buffer. */
-			pxNetworkBuffer = ( NetworkBufferDescriptor_t * ) listGET_OWNER_OF_HEAD_ENTRY( &( pxSocket->u.xUDP.xWaitingPacketsList ) );
+		lReturn = prvUDPTakePacket( pxSocket, pvBuffer, xBufferLength, xFlags, pxSourceAddress );
+	}
+#if( ipconfigSUPPORT_SIGNALS != 0 )
+	else if( ( xEventBits & eSOCKET_INTR ) != 0 )
+	{
+		lReturn = -pdFREERTOS_ERRNO_EINTR;
+		iptraceRECVFROM_INTERRUPTED();
+	}
+#endif /* ipconfigSUPPORT_SIGNALS */
+	else
+	{
+		lReturn = -pdFREERTOS_ERRNO_EWOULDBLOCK;
+		iptraceRECVFROM_TIMEOUT();
+	}
 
-			if( ( xFlags & FREERTOS_MSG_PEEK ) == 0 )
-			{
-				/* Remove the network buffer from the list of buffers waiting to
-				be processed by the socket. */
-				uxListRemove( &( pxNetworkBuffer->xBufferListItem ) );
-			}
-		}
-		taskEXIT_CRITICAL();
+	return lReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int32_t prvUDPTakePacket( FreeRTOS_Socket_t *pxSocket, void *pvBuffer, size_t xBufferLength, BaseType_t xFlags, struct freertos_sockaddr *pxSourceAddress )
+{
+NetworkBufferDescriptor_t *pxNetworkBuffer;
+int32_t lReturn;
 
-		/* The returned value is the data length, which may have been capped to
-		the receive buffer size. */
-		lReturn = ( int32_t ) pxNetworkBuffer->xDataLength;
+	taskENTER_CRITICAL();
+	{
+		/* The owner of the list item is the network buffer. */
+		pxNetworkBuffer = ( NetworkBufferDescriptor_t * ) listGET_OWNER_OF_HEAD_ENTRY( &( pxSocket->u.xUDP.xWaitingPacketsList ) );
 
-		if( pxSourceAddress != NULL )
+		if( ( xFlags & FREERTOS_MSG_PEEK ) == 0 )
 		{
-			pxSourceAddress->sin_port = pxNetworkBuffer->usPort;
-			pxSourceAddress->sin_addr = pxNetworkBuffer->ulIPAddress;
+			/* Remove the network buffer from the list of buffers waiting to
+			be processed by the socket. */
+			uxListRemove( &( pxNetworkBuffer->xBufferListItem ) );
 		}
+	}
+	taskEXIT_CRITICAL();
 
-		if( ( xFlags & FREERTOS_ZERO_COPY ) == 0 )
-		{
-			/* The zero copy flag is not set.  Truncate the length if it won't
-			fit in the provided buffer. */
-			if( lReturn > ( int32_t ) xBufferLength )
-			{
-				iptraceRECVFROM_DISCARDING_BYTES( ( xBufferLength - lReturn ) );
-				lReturn = ( int32_t )xBufferLength;
-			}
+	/* The returned value is the data length, which may have been capped to
+	the receive buffer size. */
+	lReturn = ( int32_t ) pxNetworkBuffer->xDataLength;
 
-			/* Copy the received data into the provided buffer, then release the
-			network buffer. */
-			memcpy( pvBuffer, ( void * ) &( pxNetworkBuffer->pucEthernetBuffer[ ipUDP_PAYLOAD_OFFSET_IPv4 ] ), ( size_t )lReturn );
+	if( pxSourceAddress != NULL )
+	{
+		pxSourceAddress->sin_port = pxNetworkBuffer->usPort;
+		pxSourceAddress->sin_addr = pxNetworkBuffer->ulIPAddress;
+	}
 
-			if( ( xFlags & FREERTOS_MSG_PEEK ) == 0 )
-			{
-				vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
-			}
-		}
-		else
+	if( ( xFlags & FREERTOS_ZERO_COPY ) == 0 )
+	{
+		/* The zero copy flag is not set.  Truncate the length if it won't
+		fit in the provided buffer. */
+		if( lReturn > ( int32_t ) xBufferLength )
 		{
-			/* The zero copy flag was set.  pvBuffer is not a buffer into which
-			the received data can be copied, but a pointer that must be set to
-			point to the buffer in which the received data has already been
-			placed. */
-			*( ( void** ) pvBuffer ) = ( void * ) ( &( pxNetworkBuffer->pucEthernetBuffer[ ipUDP_PAYLOAD_OFFSET_IPv4 ] ) );
+			iptraceRECVFROM_DISCARDING_BYTES( ( xBufferLength - lReturn ) );
+			lReturn = ( int32_t )xBufferLength;
 		}
 
+		/* Copy the received data into the provided buffer, then release the
+		network buffer. */
+		memcpy( pvBuffer, ( void * ) &( pxNetworkBuffer->pucEthernetBuffer[ ipUDP_PAYLOAD_OFFSET_IPv4 ] ), ( size_t )lReturn );
+
+		if( ( xFlags & FREERTOS_MSG_PEEK ) == 0 )
+		{
+			vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+		}
 	}
-#if( ipconfigSUPPORT_SIGNALS != 0 )
-	else if( ( xEventBits & eSOCKET_INTR ) != 0 )
-	{
-		lReturn = -pdFREERTOS_ERRNO_EINTR;
-		iptraceRECVFROM_INTERRUPTED();
-	}
-#endif /* ipconfigSUPPORT_SIGNALS */
 	else
 	{
-		lReturn = -pdFREERTOS_ERRNO_EWOULDBLOCK;
-		iptraceRECVFROM_TIMEOUT();
+		/* The zero copy flag was set.  pvBuffer is not a buffer into which
+		the received data can be copied, but a pointer that must be set to
+		point to the buffer in which the received data has already been
+		placed. */
+		*( ( void** ) pvBuffer ) = ( void * ) ( &( pxNetworkBuffer->pucEthernetBuffer[ ipUDP_PAYLOAD_OFFSET_IPv4 ] ) );
 	}
 
 	return lReturn;
@@ -819,6 +1182,7 @@ TimeOut_t xTimeOut;
 TickType_t xTicksToWait;
 int32_t lReturn = 0;
 FreeRTOS_Socket_t *pxSocket;
+BaseType_t xSent;
 
 	pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
 
@@ -886,20 +1250,27 @@ FreeRTOS_Socket_t *pxSocket;
 
 			if( pxNetworkBuffer != NULL )
 			{
-				pxNetworkBuffer->xDataLength = xTotalDataLength;
-				pxNetworkBuffer->usPort = pxDestinationAddress->sin_port;
-				pxNetworkBuffer->usBoundPort = ( uint16_t ) socketGET_SOCKET_PORT( pxSocket );
-				pxNetworkBuffer->ulIPAddress = pxDestinationAddress->sin_addr;
+				prvUDPPrepareSend( pxSocket, pxNetworkBuffer, xTotalDataLength, pxDestinationAddress );
 
-				/* The socket options are passed to the IP layer in the
-				space that will eventually get used by the Ethernet header. */
-				pxNetworkBuffer->pucEthernetBuffer[ ipSOCKET_OPTIONS_OFFSET ] = pxSocket->ucSocketOptions;
+				#if( ipconfigUDP_DIRECT_SEND != 0 )
+				/* Try to pass the packet to the driver right now.  The IP-task
+				sends its own packets in the usual way, it never takes the
+				direct path. */
+				if( ( xIsCallingFromIPTask() == pdFALSE ) && ( xUDPDirectSend( pxNetworkBuffer ) != pdFALSE ) )
+				{
+					xSent = pdPASS;
+				}
+				else
+				#endif /* ipconfigUDP_DIRECT_SEND */
+				{
+					/* Tell the networking task that the packet needs sending. */
+					xStackTxEvent.pvData = pxNetworkBuffer;
 
-				/* Tell the networking task that the packet needs sending. */
-				xStackTxEvent.pvData = pxNetworkBuffer;
+					/* Ask the IP-task to send this packet */
+					xSent = xSendEventStructToIPTask( &xStackTxEvent, xTicksToWait );
+				}
 
-				/* Ask the IP-task to send this packet */
-				if( xSendEventStructToIPTask( &xStackTxEvent, xTicksToWait ) == pdPASS )
+				if( xSent == pdPASS )
 				{
 					/* The packet was successfully sent to the IP task. */
 					lReturn = ( int32_t ) xTotalDataLength;
@@ -947,40 +1318,263 @@ FreeRTOS_Socket_t *pxSocket;
 } /* Tested */
 /*-----------------------------------------------------------*/
 
-/*
- * FreeRTOS_bind() : binds a sockt to a local port number.  If port 0 is
- * provided, a system provided port number will be assigned.  This function can
- * be used for both UDP and TCP sockets.  The actual binding will be performed
- * by the IP-task to avoid mutual access to the bound-socket-lists
- * (xBoundUDPSocketsList or xBoundTCPSocketsList).
- */
-BaseType_t FreeRTOS_bind( Socket_t xSocket, struct freertos_sockaddr * pxAddress, socklen_t xAddressLength )
+static void prvUDPPrepareSend( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer, size_t xDataLength, const struct freertos_sockaddr *pxDestinationAddress )
 {
-IPStackEvent_t xBindEvent;
-FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
-BaseType_t xReturn = 0;
+	pxNetworkBuffer->xDataLength = xDataLength;
+	pxNetworkBuffer->usPort = pxDestinationAddress->sin_port;
+	pxNetworkBuffer->usBoundPort = ( uint16_t ) socketGET_SOCKET_PORT( pxSocket );
+	pxNetworkBuffer->ulIPAddress = pxDestinationAddress->sin_addr;
+
+	/* The socket options are passed to the IP layer in the
+	space that will eventually get used by the Ethernet header. */
+	pxNetworkBuffer->pucEthernetBuffer[ ipSOCKET_OPTIONS_OFFSET ] = pxSocket->ucSocketOptions;
+}
+/*-----------------------------------------------------------*/
 
-	( void ) xAddressLength;
+#if( ipconfigUSE_UDP_BATCH != 0 )
 
-	if( ( pxSocket == NULL ) || ( pxSocket == FREERTOS_INVALID_SOCKET ) )
-	{
-		xReturn = -pdFREERTOS_ERRNO_EINVAL;
-	}
-	/* Once a socket is bound to a port, it can not be bound to a different
-	port number */
-	else if( socketSOCKET_IS_BOUND( pxSocket) != pdFALSE )
-	{
-		/* The socket is already bound. */
-		FreeRTOS_debug_printf( ( "vSocketBind: Socket already bound to %d\n", pxSocket->usLocalPort ) );
-		xReturn = -pdFREERTOS_ERRNO_EINVAL;
-	}
-	else
+	/* Receive up to 'uxCount' messages.  The call blocks for the first message
+	only, just like FreeRTOS_recvfrom().  The other messages are only taken
+	when they are already waiting in the socket. */
+	int32_t FreeRTOS_recvmmsg( Socket_t xSocket, UDPMessage_t *pxMessages, size_t uxCount, BaseType_t xFlags )
 	{
-		/* Prepare a messages to the IP-task in order to perform the binding.
-		The desired port number will be passed in usLocalPort. */
-		xBindEvent.eEventType = eSocketBindEvent;
-		xBindEvent.pvData = ( void * ) xSocket;
-		if( pxAddress != NULL )
+	FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
+	void *pvBuffer;
+	size_t uxIndex;
+	int32_t lReturn = 0;
+
+		configASSERT( pxMessages != NULL );
+
+		if( ( uxCount == 0u ) || ( ( xFlags & FREERTOS_MSG_PEEK ) != 0 ) )
+		{
+			/* Peeking at a batch of messages is not supported. */
+			lReturn = -pdFREERTOS_ERRNO_EINVAL;
+		}
+		else
+		{
+			for( uxIndex = 0u; uxIndex < uxCount; uxIndex++ )
+			{
+				if( ( xFlags & FREERTOS_ZERO_COPY ) == 0 )
+				{
+					pvBuffer = pxMessages[ uxIndex ].pvBuffer;
+				}
+				else
+				{
+					/* 'pvBuffer' will be set to point to the payload of the
+					network buffer, as FreeRTOS_recvfrom() would do. */
+					pvBuffer = ( void * ) &( pxMessages[ uxIndex ].pvBuffer );
+				}
+
+				if( uxIndex == 0u )
+				{
+					lReturn = FreeRTOS_recvfrom( xSocket, pvBuffer, pxMessages[ uxIndex ].uxLength, xFlags, &( pxMessages[ uxIndex ].xAddress ), NULL );
+
+					if( lReturn < 0 )
+					{
+						break;
+					}
+				}
+				else if( listCURRENT_LIST_LENGTH( &( pxSocket->u.xUDP.xWaitingPacketsList ) ) > 0U )
+				{
+					lReturn = prvUDPTakePacket( pxSocket, pvBuffer, pxMessages[ uxIndex ].uxLength, xFlags, &( pxMessages[ uxIndex ].xAddress ) );
+				}
+				else
+				{
+					break;
+				}
+
+				pxMessages[ uxIndex ].uxLength = ( size_t ) lReturn;
+			}
+
+			if( uxIndex > 0u )
+			{
+				/* Return the number of messages received. */
+				lReturn = ( int32_t ) uxIndex;
+			}
+		}
+
+		return lReturn;
+	}
+
+#endif /* ipconfigUSE_UDP_BATCH */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_UDP_BATCH != 0 )
+
+	/* Send up to 'uxCount' messages.  The messages are passed to the IP-task
+	as a chain, with a single event.  The IP-task will pass the resulting
+	frames to the driver in one go when ipconfigUSE_NETWORK_OUTPUT_BATCH is
+	defined. */
+	int32_t FreeRTOS_sendmmsg( Socket_t xSocket, UDPMessage_t *pxMessages, size_t uxCount, BaseType_t xFlags )
+	{
+	FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
+	IPStackEvent_t xStackTxEvent = { eStackTxBatchEvent, NULL };
+	NetworkBufferDescriptor_t *pxNetworkBuffer;
+	NetworkBufferDescriptor_t *pxFirst = NULL, *pxLast = NULL;
+	TimeOut_t xTimeOut;
+	TickType_t xTicksToWait;
+	size_t uxIndex, uxQueued = 0u;
+	int32_t lReturn = 0;
+
+		configASSERT( pxMessages != NULL );
+
+		if( prvValidSocket( pxSocket, FREERTOS_IPPROTO_UDP, pdFALSE ) == pdFALSE )
+		{
+			lReturn = -pdFREERTOS_ERRNO_EINVAL;
+		}
+		else if( ( socketSOCKET_IS_BOUND( pxSocket ) == pdFALSE ) && ( FreeRTOS_bind( xSocket, NULL, 0u ) != 0 ) )
+		{
+			iptraceSENDTO_SOCKET_NOT_BOUND();
+		}
+		else
+		{
+			xTicksToWait = pxSocket->xSendBlockTime;
+
+			#if( ipconfigUSE_CALLBACKS != 0 )
+			{
+				if( xIsCallingFromIPTask() != pdFALSE )
+				{
+					/* Do not let the IP-task wait for itself. */
+					xTicksToWait = ( TickType_t ) 0;
+				}
+			}
+			#endif /* ipconfigUSE_CALLBACKS */
+
+			if( ( xFlags & FREERTOS_MSG_DONTWAIT ) != 0 )
+			{
+				xTicksToWait = ( TickType_t ) 0;
+			}
+
+			vTaskSetTimeOutState( &xTimeOut );
+
+			for( uxIndex = 0u; uxIndex < uxCount; uxIndex++ )
+			{
+				if( pxMessages[ uxIndex ].uxLength > ( size_t ) ipMAX_UDP_PAYLOAD_LENGTH )
+				{
+					iptraceSENDTO_DATA_TOO_LONG();
+					break;
+				}
+
+				if( ( xFlags & FREERTOS_ZERO_COPY ) == 0 )
+				{
+					/* The block time is shared by all messages. */
+					pxNetworkBuffer = pxGetNetworkBufferWithDescriptor( pxMessages[ uxIndex ].uxLength + sizeof( UDPPacket_t ), xTicksToWait );
+
+					if( pxNetworkBuffer == NULL )
+					{
+						iptraceNO_BUFFER_FOR_SENDTO();
+						break;
+					}
+
+					memcpy( ( void * ) &( pxNetworkBuffer->pucEthernetBuffer[ ipUDP_PAYLOAD_OFFSET_IPv4 ] ), pxMessages[ uxIndex ].pvBuffer, pxMessages[ uxIndex ].uxLength );
+
+					if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdTRUE )
+					{
+						xTicksToWait = ( TickType_t ) 0;
+					}
+				}
+				else
+				{
+					pxNetworkBuffer = pxUDPPayloadBuffer_to_NetworkBuffer( pxMessages[ uxIndex ].pvBuffer );
+				}
+
+				prvUDPPrepareSend( pxSocket, pxNetworkBuffer, pxMessages[ uxIndex ].uxLength, &( pxMessages[ uxIndex ].xAddress ) );
+
+				/* The IP-task will send the packets in this order. */
+				pxNetworkBuffer->pxNextBuffer = NULL;
+
+				if( pxFirst == NULL )
+				{
+					pxFirst = pxNetworkBuffer;
+				}
+				else
+				{
+					pxLast->pxNextBuffer = pxNetworkBuffer;
+				}
+
+				pxLast = pxNetworkBuffer;
+				uxQueued++;
+			}
+
+			if( pxFirst != NULL )
+			{
+				xStackTxEvent.pvData = pxFirst;
+
+				if( xSendEventStructToIPTask( &xStackTxEvent, xTicksToWait ) == pdPASS )
+				{
+					/* Return the number of messages that will be sent. */
+					lReturn = ( int32_t ) uxQueued;
+
+					#if( ipconfigUSE_CALLBACKS == 1 )
+					{
+						if( ipconfigIS_VALID_PROG_ADDRESS( pxSocket->u.xUDP.pxHandleSent ) )
+						{
+							for( uxIndex = 0u; uxIndex < uxQueued; uxIndex++ )
+							{
+								pxSocket->u.xUDP.pxHandleSent( (Socket_t *)pxSocket, pxMessages[ uxIndex ].uxLength );
+							}
+						}
+					}
+					#endif /* ipconfigUSE_CALLBACKS */
+				}
+				else
+				{
+					/* Release the buffers that were allocated here.  Zero-copy
+					buffers still belong to the caller. */
+					if( ( xFlags & FREERTOS_ZERO_COPY ) == 0 )
+					{
+						while( pxFirst != NULL )
+						{
+							pxNetworkBuffer = pxFirst;
+							pxFirst = pxFirst->pxNextBuffer;
+							vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+						}
+					}
+					iptraceSTACK_TX_EVENT_LOST( ipSTACK_TX_EVENT );
+				}
+			}
+		}
+
+		return lReturn;
+	}
+
+#endif /* ipconfigUSE_UDP_BATCH */
+/*-----------------------------------------------------------*/
+
+/*
+ * FreeRTOS_bind() : binds a sockt to a local port number.  If port 0 is
+ * provided, a system provided port number will be assigned.  This function can
+ * be used for both UDP and TCP sockets.  The actual binding will be performed
+ * by the IP-task to avoid mutual access to the bound-socket-lists
+ * (xBoundUDPSocketsList or xBoundTCPSocketsList).
+ */
+BaseType_t FreeRTOS_bind( Socket_t xSocket, struct freertos_sockaddr * pxAddress, socklen_t xAddressLength )
+{
+IPStackEvent_t xBindEvent;
+FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
+BaseType_t xReturn = 0;
+
+	( void ) xAddressLength;
+
+	if( ( pxSocket == NULL ) || ( pxSocket == FREERTOS_INVALID_SOCKET ) )
+	{
+		xReturn = -pdFREERTOS_ERRNO_EINVAL;
+	}
+	/* Once a socket is bound to a port, it can not be bound to a different
+	port number */
+	else if( socketSOCKET_IS_BOUND( pxSocket) != pdFALSE )
+	{
+		/* The socket is already bound. */
+		FreeRTOS_debug_printf( ( "vSocketBind: Socket already bound to %d\n", pxSocket->usLocalPort ) );
+		xReturn = -pdFREERTOS_ERRNO_EINVAL;
+	}
+	else
+	{
+		/* Prepare a messages to the IP-task in order to perform the binding.
+		The desired port number will be passed in usLocalPort. */
+		xBindEvent.eEventType = eSocketBindEvent;
+		xBindEvent.pvData = ( void * ) xSocket;
+		if( pxAddress != NULL )
 		{
 			pxSocket->usLocalPort = FreeRTOS_ntohs( pxAddress->sin_port );
 		}
@@ -1211,23 +1805,66 @@ NetworkBufferDescriptor_t *pxNetworkBuffer;
 			#endif /* ipconfigUSE_TCP_WIN */
 
 			/* Free the input and output streams */
-			if( pxSocket->u.xTCP.rxStream != NULL )
+			#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
 			{
-				vPortFreeLarge( pxSocket->u.xTCP.rxStream );
-			}
+				if( pxSocket->u.xTCP.rxStream != NULL )
+				{
+					prvSocketSlabGive( pxSocket->u.xTCP.rxStream, socketSTREAM_BUFFER_SIZE( pxSocket->u.xTCP.rxStream->LENGTH - sizeof( size_t ) ), pdTRUE );
+				}
 
-			if( pxSocket->u.xTCP.txStream != NULL )
+				if( pxSocket->u.xTCP.txStream != NULL )
+				{
+					prvSocketSlabGive( pxSocket->u.xTCP.txStream, socketSTREAM_BUFFER_SIZE( pxSocket->u.xTCP.txStream->LENGTH - sizeof( size_t ) ), pdTRUE );
+				}
+			}
+			#else
 			{
-				vPortFreeLarge( pxSocket->u.xTCP.txStream );
+				if( pxSocket->u.xTCP.rxStream != NULL )
+				{
+					vPortFreeLarge( pxSocket->u.xTCP.rxStream );
+				}
+
+				if( pxSocket->u.xTCP.txStream != NULL )
+				{
+					vPortFreeLarge( pxSocket->u.xTCP.txStream );
+				}
 			}
+			#endif /* ipconfigSOCKET_SLAB_DEPTH */
 
 			/* In case this is a child socket, make sure the child-count of the
 			parent socket is decreased. */
 			prvTCPSetSocketCount( pxSocket );
+
+			#if( ipconfigTCP_ACCEPT_POOL_SIZE > 0 )
+			{
+				/* A listening socket releases the children it never used. */
+				prvTCPAcceptPoolFree( pxSocket );
+			}
+			#endif
 		}
 	}
 	#endif  /* ipconfigUSE_TCP == 1 */
 
+	#if( ipconfigSUPPORT_POLL_SET != 0 )
+	{
+		/* The socket may be closed while it is still registered in a poll
+		set.  Make sure it is not queued in its ready list. */
+		if( pxSocket->pxPollSet != NULL )
+		{
+			vTaskSuspendAll();
+			{
+				if( listIS_CONTAINED_WITHIN( &( pxSocket->pxPollSet->xReadyList ), &( pxSocket->xPollListItem ) ) != pdFALSE )
+				{
+					uxListRemove( &( pxSocket->xPollListItem ) );
+				}
+				pxSocket->pxPollSet->uxSocketCount--;
+				pxSocket->pxPollSet = NULL;
+			}
+			xTaskResumeAll();
+		}
+	}
+	#endif /* ipconfigSUPPORT_POLL_SET */
+
 	/* Socket must be unbound first, to ensure no more packets are queued on
 	it. */
 	if( socketSOCKET_IS_BOUND( pxSocket ) != pdFALSE )
@@ -1282,13 +1919,263 @@ NetworkBufferDescriptor_t *pxNetworkBuffer;
 	#endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigHAS_DEBUG_PRINTF != 0 ) */
 
 	/* Anf finally, after all resources have been freed, free the socket space */
-	vPortFreeSocket( pxSocket );
+	#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+	{
+		#if( ipconfigUSE_TCP == 1 )
+		if( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP )
+		{
+			prvSocketSlabGive( pxSocket, socketTCP_SOCKET_SIZE, pdFALSE );
+		}
+		else
+		#endif /* ipconfigUSE_TCP */
+		{
+			prvSocketSlabGive( pxSocket, socketUDP_SOCKET_SIZE, pdFALSE );
+		}
+	}
+	#else
+	{
+		vPortFreeSocket( pxSocket );
+	}
+	#endif
 
 	return 0;
 } /* Tested */
 
 /*-----------------------------------------------------------*/
 
+#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+
+	static size_t prvSocketSlabObjectSize( BaseType_t xIndex )
+	{
+	size_t uxReturn;
+
+		switch( xIndex )
+		{
+		case FREERTOS_SLAB_UDP_SOCKET:
+			uxReturn = socketUDP_SOCKET_SIZE;
+			break;
+	#if( ipconfigUSE_TCP == 1 )
+		case FREERTOS_SLAB_TCP_SOCKET:
+			uxReturn = socketTCP_SOCKET_SIZE;
+			break;
+		case FREERTOS_SLAB_RX_STREAM:
+			uxReturn = socketSTREAM_BUFFER_SIZE( ipconfigTCP_RX_BUFFER_LENGTH );
+			break;
+		case FREERTOS_SLAB_TX_STREAM:
+			uxReturn = socketSTREAM_BUFFER_SIZE( FreeRTOS_round_up( ipconfigTCP_TX_BUFFER_LENGTH, ipconfigTCP_MSS ) );
+			break;
+	#endif /* ipconfigUSE_TCP */
+		default:
+			/* Not in use. */
+			uxReturn = 0u;
+			break;
+		}
+
+		return uxReturn;
+	}
+
+#endif /* ipconfigSOCKET_SLAB_DEPTH */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+
+	static BaseType_t prvSocketSlabIndex( size_t uxSize, BaseType_t xIsStream )
+	{
+	BaseType_t xIndex, xLast;
+	BaseType_t xReturn = -1;
+
+		/* Sockets and streams are allocated with different functions, so they
+		can not share a slab, even if their sizes happen to be equal.  When the
+		default RX and TX streams have the same size, the RX slab is used for
+		both. */
+		if( xIsStream == pdFALSE )
+		{
+			xIndex = FREERTOS_SLAB_UDP_SOCKET;
+			xLast = FREERTOS_SLAB_TCP_SOCKET;
+		}
+		else
+		{
+			xIndex = FREERTOS_SLAB_RX_STREAM;
+			xLast = FREERTOS_SLAB_TX_STREAM;
+		}
+
+		for( ; xIndex <= xLast; xIndex++ )
+		{
+			if( uxSize == prvSocketSlabObjectSize( xIndex ) )
+			{
+				xReturn = xIndex;
+				break;
+			}
+		}
+
+		return xReturn;
+	}
+
+#endif /* ipconfigSOCKET_SLAB_DEPTH */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+
+	static void *prvSocketSlabTake( size_t uxSize, BaseType_t xIsStream )
+	{
+	BaseType_t xIndex = prvSocketSlabIndex( uxSize, xIsStream );
+	SocketSlab_t *pxSlab;
+	void *pvReturn = NULL;
+
+		if( xIndex >= 0 )
+		{
+			pxSlab = &( xSocketSlabs[ xIndex ] );
+
+			vTaskSuspendAll();
+			{
+				pvReturn = pxSlab->pvFirstFree;
+
+				if( pvReturn != NULL )
+				{
+					pxSlab->pvFirstFree = *( ( void ** ) pvReturn );
+					pxSlab->xStats.uxCached--;
+					pxSlab->xStats.uxHits++;
+				}
+				else
+				{
+					pxSlab->xStats.uxMisses++;
+				}
+			}
+			xTaskResumeAll();
+		}
+
+		if( pvReturn == NULL )
+		{
+			if( xIsStream != pdFALSE )
+			{
+				pvReturn = pvPortMallocLarge( uxSize );
+			}
+			else
+			{
+				pvReturn = pvPortMallocSocket( uxSize );
+			}
+		}
+
+		return pvReturn;
+	}
+
+#endif /* ipconfigSOCKET_SLAB_DEPTH */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+
+	static void prvSocketSlabGive( void *pvObject, size_t uxSize, BaseType_t xIsStream )
+	{
+	BaseType_t xIndex = prvSocketSlabIndex( uxSize, xIsStream );
+	BaseType_t xCached = pdFALSE;
+	SocketSlab_t *pxSlab;
+
+		if( xIndex >= 0 )
+		{
+			pxSlab = &( xSocketSlabs[ xIndex ] );
+
+			vTaskSuspendAll();
+			{
+				if( pxSlab->xStats.uxCached < ( UBaseType_t ) ipconfigSOCKET_SLAB_DEPTH )
+				{
+					*( ( void ** ) pvObject ) = pxSlab->pvFirstFree;
+					pxSlab->pvFirstFree = pvObject;
+					pxSlab->xStats.uxCached++;
+					pxSlab->xStats.uxReleased++;
+					xCached = pdTRUE;
+				}
+				else
+				{
+					pxSlab->xStats.uxOverflow++;
+				}
+			}
+			xTaskResumeAll();
+		}
+
+		if( xCached == pdFALSE )
+		{
+			if( xIsStream != pdFALSE )
+			{
+				vPortFreeLarge( pvObject );
+			}
+			else
+			{
+				vPortFreeSocket( pvObject );
+			}
+		}
+	}
+
+#endif /* ipconfigSOCKET_SLAB_DEPTH */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+
+	BaseType_t FreeRTOS_GetSocketSlabStats( BaseType_t xIndex, SocketSlabStats_t *pxStats )
+	{
+	BaseType_t xReturn;
+
+		if( ( xIndex < 0 ) || ( xIndex >= FREERTOS_SLAB_COUNT ) || ( pxStats == NULL ) )
+		{
+			xReturn = pdFAIL;
+		}
+		else
+		{
+			vTaskSuspendAll();
+			{
+				*pxStats = xSocketSlabs[ xIndex ].xStats;
+			}
+			xTaskResumeAll();
+
+			pxStats->uxObjectSize = prvSocketSlabObjectSize( xIndex );
+			xReturn = pdPASS;
+		}
+
+		return xReturn;
+	}
+
+#endif /* ipconfigSOCKET_SLAB_DEPTH */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+
+	void FreeRTOS_SocketSlabFlush( void )
+	{
+	BaseType_t xIndex;
+	void *pvObject, *pvNext;
+
+		for( xIndex = 0; xIndex < FREERTOS_SLAB_COUNT; xIndex++ )
+		{
+			/* Detach the whole list, and free the objects while the scheduler
+			is running. */
+			vTaskSuspendAll();
+			{
+				pvObject = xSocketSlabs[ xIndex ].pvFirstFree;
+				xSocketSlabs[ xIndex ].pvFirstFree = NULL;
+				xSocketSlabs[ xIndex ].xStats.uxCached = 0u;
+			}
+			xTaskResumeAll();
+
+			while( pvObject != NULL )
+			{
+				pvNext = *( ( void ** ) pvObject );
+
+				if( xIndex >= FREERTOS_SLAB_RX_STREAM )
+				{
+					vPortFreeLarge( pvObject );
+				}
+				else
+				{
+					vPortFreeSocket( pvObject );
+				}
+
+				pvObject = pvNext;
+			}
+		}
+	}
+
+#endif /* ipconfigSOCKET_SLAB_DEPTH */
+/*-----------------------------------------------------------*/
+
 #if ipconfigUSE_TCP == 1
 
 	/*
@@ -1324,6 +2211,90 @@ NetworkBufferDescriptor_t *pxNetworkBuffer;
 	}
 
 #endif /* ipconfigUSE_TCP == 1 */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_ACCEPT_POOL_SIZE > 0 )
+
+	static void prvTCPAcceptPoolFill( FreeRTOS_Socket_t *pxSocket )
+	{
+	FreeRTOS_Socket_t *pxChild;
+	uint16_t usWanted;
+
+		/* Called by the owner of a listening socket.  The sockets are created
+		here, so that the IP-task doesn't need to allocate memory when a SYN
+		comes in. */
+		usWanted = ( uint16_t ) FreeRTOS_min_uint32( ( uint32_t ) ipconfigTCP_ACCEPT_POOL_SIZE, ( uint32_t ) pxSocket->u.xTCP.usBacklog );
+
+		while( ( pxSocket->u.xTCP.bits.bReuseSocket == pdFALSE_UNSIGNED ) && ( pxSocket->u.xTCP.usAcceptPoolCount < usWanted ) )
+		{
+			pxChild = ( FreeRTOS_Socket_t * ) FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+
+			if( ( pxChild == NULL ) || ( pxChild == FREERTOS_INVALID_SOCKET ) )
+			{
+				break;
+			}
+
+			/* The IP-task takes sockets from the pool. */
+			vTaskSuspendAll();
+			{
+				pxChild->u.xTCP.pxPeerSocket = pxSocket->u.xTCP.pxAcceptPool;
+				pxSocket->u.xTCP.pxAcceptPool = pxChild;
+				pxSocket->u.xTCP.usAcceptPoolCount++;
+			}
+			xTaskResumeAll();
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	FreeRTOS_Socket_t *pxTCPAcceptPoolTake( FreeRTOS_Socket_t *pxSocket )
+	{
+	FreeRTOS_Socket_t *pxChild;
+
+		vTaskSuspendAll();
+		{
+			pxChild = pxSocket->u.xTCP.pxAcceptPool;
+
+			if( pxChild != NULL )
+			{
+				pxSocket->u.xTCP.pxAcceptPool = pxChild->u.xTCP.pxPeerSocket;
+				pxSocket->u.xTCP.usAcceptPoolCount--;
+				pxChild->u.xTCP.pxPeerSocket = NULL;
+			}
+		}
+		xTaskResumeAll();
+
+		if( pxChild == NULL )
+		{
+			iptraceTCP_ACCEPT_POOL_EMPTY( pxSocket );
+		}
+
+		return pxChild;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvTCPAcceptPoolFree( FreeRTOS_Socket_t *pxSocket )
+	{
+	FreeRTOS_Socket_t *pxChild, *pxNext;
+
+		vTaskSuspendAll();
+		{
+			pxChild = pxSocket->u.xTCP.pxAcceptPool;
+			pxSocket->u.xTCP.pxAcceptPool = NULL;
+			pxSocket->u.xTCP.usAcceptPoolCount = 0u;
+		}
+		xTaskResumeAll();
+
+		while( pxChild != NULL )
+		{
+			pxNext = pxChild->u.xTCP.pxPeerSocket;
+
+			/* The socket was never bound nor connected. */
+			vSocketClose( pxChild );
+			pxChild = pxNext;
+		}
+	}
+
+#endif /* ( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_ACCEPT_POOL_SIZE > 0 ) */
 
 /*-----------------------------------------------------------*/
 
@@ -1588,6 +2559,7 @@ FreeRTOS_Socket_t *pxSocket;
 				break;
 
 			case FREERTOS_SO_SET_FULL_SIZE:		/* Refuse to send packets smaller than MSS  */
+			case FREERTOS_SO_TCP_CORK:
 				{
 					if( pxSocket->ucProtocol != ( uint8_t ) FREERTOS_IPPROTO_TCP )
 					{
@@ -1603,51 +2575,180 @@ FreeRTOS_Socket_t *pxSocket;
 						pxSocket->u.xTCP.xTCPWindow.u.bits.bSendFullSize = pdFALSE_UNSIGNED;
 					}
 
-					if( ( pxSocket->u.xTCP.xTCPWindow.u.bits.bSendFullSize == pdFALSE_UNSIGNED ) &&
-						( pxSocket->u.xTCP.ucTCPState >= eESTABLISHED ) &&
-						( FreeRTOS_outstanding( pxSocket ) != 0 ) )
-					{
-						pxSocket->u.xTCP.usTimeout = 1u; /* to set/clear bSendFullSize */
-						xSendEventToIPTask( eTCPTimerEvent );
-					}
-				}
+					if( ( pxSocket->u.xTCP.xTCPWindow.u.bits.bSendFullSize == pdFALSE_UNSIGNED ) &&
+						( pxSocket->u.xTCP.ucTCPState >= eESTABLISHED ) &&
+						( FreeRTOS_outstanding( pxSocket ) != 0 ) )
+					{
+						pxSocket->u.xTCP.usTimeout = 1u; /* to set/clear bSendFullSize */
+						xSendEventToIPTask( eTCPTimerEvent );
+					}
+				}
+				xReturn = 0;
+				break;
+
+			case FREERTOS_SO_TCP_NODELAY:	/* Send small segments without waiting for outstanding ACK's */
+				{
+					if( pxSocket->ucProtocol != ( uint8_t ) FREERTOS_IPPROTO_TCP )
+					{
+						break;	/* will return -pdFREERTOS_ERRNO_EINVAL */
+					}
+
+					if( *( ( BaseType_t * ) pvOptionValue ) != 0 )
+					{
+						pxSocket->u.xTCP.xTCPWindow.u.bits.bNagle = pdFALSE_UNSIGNED;
+					}
+					else
+					{
+						pxSocket->u.xTCP.xTCPWindow.u.bits.bNagle = pdTRUE_UNSIGNED;
+					}
+
+					if( ( pxSocket->u.xTCP.xTCPWindow.u.bits.bNagle == pdFALSE_UNSIGNED ) &&
+						( pxSocket->u.xTCP.ucTCPState >= eESTABLISHED ) &&
+						( FreeRTOS_outstanding( pxSocket ) != 0 ) )
+					{
+						pxSocket->u.xTCP.usTimeout = 1u; /* to send a segment that was held */
+						xSendEventToIPTask( eTCPTimerEvent );
+					}
+				}
+				xReturn = 0;
+				break;
+
+			case FREERTOS_SO_TCP_QUICKACK:	/* Do not delay ACK's */
+				{
+					if( pxSocket->ucProtocol != ( uint8_t ) FREERTOS_IPPROTO_TCP )
+					{
+						break;	/* will return -pdFREERTOS_ERRNO_EINVAL */
+					}
+
+					if( *( ( BaseType_t * ) pvOptionValue ) != 0 )
+					{
+						pxSocket->u.xTCP.bits.bQuickAck = pdTRUE_UNSIGNED;
+
+						if( pxSocket->u.xTCP.ucTCPState >= eESTABLISHED )
+						{
+							pxSocket->u.xTCP.usTimeout = 1u; /* to send a delayed ACK now */
+							xSendEventToIPTask( eTCPTimerEvent );
+						}
+					}
+					else
+					{
+						pxSocket->u.xTCP.bits.bQuickAck = pdFALSE_UNSIGNED;
+					}
+				}
+				xReturn = 0;
+				break;
+
+			case FREERTOS_SO_STOP_RX:		/* Refuse to receive more packts */
+				{
+					if( pxSocket->ucProtocol != ( uint8_t ) FREERTOS_IPPROTO_TCP )
+					{
+						break;	/* will return -pdFREERTOS_ERRNO_EINVAL */
+					}
+
+					if( *( ( BaseType_t * ) pvOptionValue ) != 0 )
+					{
+						pxSocket->u.xTCP.bits.bRxStopped = pdTRUE_UNSIGNED;
+					}
+					else
+					{
+						pxSocket->u.xTCP.bits.bRxStopped = pdFALSE_UNSIGNED;
+					}
+
+					pxSocket->u.xTCP.bits.bWinChange = pdTRUE_UNSIGNED;
+					pxSocket->u.xTCP.usTimeout = 1u; /* to set/clear bRxStopped */
+					xSendEventToIPTask( eTCPTimerEvent );
+				}
+				xReturn = 0;
+				break;
+
+			#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+				case FREERTOS_SO_TCP_CONGESTION:	/* Choose the congestion control algorithm */
+					{
+						if( pxSocket->ucProtocol != ( uint8_t ) FREERTOS_IPPROTO_TCP )
+						{
+							break;	/* will return -pdFREERTOS_ERRNO_EINVAL */
+						}
+
+						lOptionValue = *( ( BaseType_t * ) pvOptionValue );
+
+						if( ( lOptionValue != FREERTOS_TCP_CC_NEWRENO ) && ( lOptionValue != FREERTOS_TCP_CC_CUBIC ) )
+						{
+							break;	/* will return -pdFREERTOS_ERRNO_EINVAL */
+						}
+
+						/* May be changed at any moment.  The congestion window
+						is kept, CUBIC will start a new epoch. */
+						pxSocket->u.xTCP.xTCPWindow.ucCongestionAlgorithm = ( uint8_t ) lOptionValue;
+						pxSocket->u.xTCP.xTCPWindow.u.bits.bCubicEpoch = pdFALSE_UNSIGNED;
+					}
+					xReturn = 0;
+					break;
+			#endif /* ipconfigTCP_CONGESTION_CONTROL */
+
+		#endif  /* ipconfigUSE_TCP == 1 */
+
+		default :
+			/* No other options are handled. */
+			xReturn = -pdFREERTOS_ERRNO_ENOPROTOOPT;
+			break;
+	}
+
+	return xReturn;
+} /* Tested */
+
+/*-----------------------------------------------------------*/
+
+BaseType_t FreeRTOS_getsockopt( Socket_t xSocket, int32_t lLevel, int32_t lOptionName, void *pvOptionValue, size_t *pxOptionLength )
+{
+/* The standard Berkeley function returns 0 for success. */
+BaseType_t xReturn = -pdFREERTOS_ERRNO_EINVAL;
+FreeRTOS_Socket_t *pxSocket;
+
+	pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
+
+	( void ) lLevel;
+
+	configASSERT( xSocket );
+
+	switch( lOptionName )
+	{
+		case FREERTOS_SO_RCVTIMEO	:
+			if( *pxOptionLength >= sizeof( TickType_t ) )
+			{
+				*( ( TickType_t * ) pvOptionValue ) = pxSocket->xReceiveBlockTime;
+				*pxOptionLength = sizeof( TickType_t );
 				xReturn = 0;
-				break;
-
-			case FREERTOS_SO_STOP_RX:		/* Refuse to receive more packts */
-				{
-					if( pxSocket->ucProtocol != ( uint8_t ) FREERTOS_IPPROTO_TCP )
-					{
-						break;	/* will return -pdFREERTOS_ERRNO_EINVAL */
-					}
+			}
+			break;
 
-					if( *( ( BaseType_t * ) pvOptionValue ) != 0 )
-					{
-						pxSocket->u.xTCP.bits.bRxStopped = pdTRUE_UNSIGNED;
-					}
-					else
-					{
-						pxSocket->u.xTCP.bits.bRxStopped = pdFALSE_UNSIGNED;
-					}
+		case FREERTOS_SO_SNDTIMEO	:
+			if( *pxOptionLength >= sizeof( TickType_t ) )
+			{
+				*( ( TickType_t * ) pvOptionValue ) = pxSocket->xSendBlockTime;
+				*pxOptionLength = sizeof( TickType_t );
+				xReturn = 0;
+			}
+			break;
 
-					pxSocket->u.xTCP.bits.bWinChange = pdTRUE_UNSIGNED;
-					pxSocket->u.xTCP.usTimeout = 1u; /* to set/clear bRxStopped */
-					xSendEventToIPTask( eTCPTimerEvent );
+		#if( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_CONGESTION_CONTROL != 0 )
+			case FREERTOS_SO_TCP_CONGESTION:
+				if( ( pxSocket->ucProtocol == ( uint8_t ) FREERTOS_IPPROTO_TCP ) && ( *pxOptionLength >= sizeof( BaseType_t ) ) )
+				{
+					*( ( BaseType_t * ) pvOptionValue ) = ( BaseType_t ) pxSocket->u.xTCP.xTCPWindow.ucCongestionAlgorithm;
+					*pxOptionLength = sizeof( BaseType_t );
+					xReturn = 0;
 				}
-				xReturn = 0;
 				break;
-
-		#endif  /* ipconfigUSE_TCP == 1 */
+		#endif /* ipconfigTCP_CONGESTION_CONTROL */
 
 		default :
-			/* No other options are handled. */
+			/* No other options can be read. */
 			xReturn = -pdFREERTOS_ERRNO_ENOPROTOOPT;
 			break;
 	}
 
 	return xReturn;
-} /* Tested */
-
+}
 /*-----------------------------------------------------------*/
 
 /* Get a free private ('anonymous') port number */
@@ -1884,6 +2985,33 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 	}
 	#endif /* ipconfigSUPPORT_SELECT_FUNCTION */
 
+	#if( ipconfigSUPPORT_POLL_SET != 0 )
+	{
+		if( pxSocket->pxPollSet != NULL )
+		{
+		EventBits_t xPollEvents = 0u;
+
+			/* Translate the socket events into the events of a poll set. */
+			if( ( pxSocket->xEventBits & ( eSOCKET_RECEIVE | eSOCKET_ACCEPT ) ) != 0u )
+			{
+				xPollEvents |= eSELECT_READ;
+			}
+			if( ( pxSocket->xEventBits & ( eSOCKET_SEND | eSOCKET_CONNECT ) ) != 0u )
+			{
+				xPollEvents |= eSELECT_WRITE;
+			}
+			if( ( pxSocket->xEventBits & eSOCKET_CLOSED ) != 0u )
+			{
+				xPollEvents |= eSELECT_EXCEPT;
+			}
+			if( xPollEvents != 0u )
+			{
+				vSocketPollEvent( pxSocket, xPollEvents );
+			}
+		}
+	}
+	#endif /* ipconfigSUPPORT_POLL_SET */
+
 	if( ( pxSocket->xEventGroup != NULL ) && ( pxSocket->xEventBits != 0u ) )
 	{
 		xEventGroupSetBits( pxSocket->xEventGroup, pxSocket->xEventBits );
@@ -2169,6 +3297,12 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 
 				if( pxClientSocket != NULL )
 				{
+					#if( ipconfigTCP_ACCEPT_POOL_SIZE > 0 )
+					{
+						/* Replace the child socket that has been handed out. */
+						prvTCPAcceptPoolFill( pxSocket );
+					}
+					#endif
 					break;
 				}
 
@@ -2446,6 +3580,189 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 #endif /* ipconfigUSE_TCP */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_SENDFILE != 0 )
+
+	/* Read a file directly into the circular transmit buffer.  FreeRTOS+FAT
+	reads whole sectors straight into the buffer that it is given, so the
+	data is copied only once, from the disk to txStream. */
+	BaseType_t FreeRTOS_sendfile( Socket_t xSocket, struct _FF_FILE *pxFile, size_t uxOffset, size_t uxLength )
+	{
+	FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
+	StreamBuffer_t *pxBuffer;
+	BaseType_t xResult;
+	size_t uxCount, uxEnd, uxHead, uxChunk, uxDone, uxRead;
+
+		xResult = ( BaseType_t ) prvTCPSendCheck( pxSocket, uxLength );
+
+		if( ( xResult > 0 ) && ( ( size_t ) ff_ftell( pxFile ) != uxOffset ) )
+		{
+			if( ff_fseek( pxFile, ( long ) uxOffset, FF_SEEK_SET ) != 0 )
+			{
+				xResult = -pdFREERTOS_ERRNO_EINVAL;
+			}
+		}
+
+		if( xResult > 0 )
+		{
+			pxBuffer = pxSocket->u.xTCP.txStream;
+			uxCount = FreeRTOS_min_uint32( uxLength, uxStreamBufferGetSpace( pxBuffer ) );
+
+			if( uxCount < uxLength )
+			{
+				/* Not all data fits.  Let this part end at a sector boundary,
+				so the next call will start with a complete sector. */
+				uxEnd = ( uxOffset + uxCount ) & ~( ( size_t ) 511u );
+
+				if( uxEnd > uxOffset )
+				{
+					uxCount = uxEnd - uxOffset;
+				}
+			}
+
+			/* The space may wrap around the end of the buffer, in which case
+			the data is read in two parts. */
+			uxHead = pxBuffer->uxHead;
+			uxDone = 0u;
+
+			while( uxDone < uxCount )
+			{
+				uxChunk = FreeRTOS_min_uint32( uxCount - uxDone, pxBuffer->LENGTH - uxHead );
+				uxRead = ff_fread( pxBuffer->ucArray + uxHead, 1, uxChunk, pxFile );
+				uxDone += uxRead;
+
+				if( uxRead != uxChunk )
+				{
+					break;
+				}
+
+				uxHead += uxChunk;
+
+				if( uxHead >= pxBuffer->LENGTH )
+				{
+					uxHead = 0u;
+				}
+			}
+
+			if( uxDone != uxCount )
+			{
+				/* A short read: nothing is queued, so a FIN that was
+				requested with FREERTOS_SO_CLOSE_AFTER_SEND will not follow
+				an incomplete file. */
+				xResult = -pdFREERTOS_ERRNO_EIO;
+			}
+			else if( uxDone != 0u )
+			{
+				/* The data is in place already, FreeRTOS_send() only has to
+				advance the head.  It is done in a single call, so that a
+				FIN, requested with FREERTOS_SO_CLOSE_AFTER_SEND, will be added
+				to the last part only. */
+				xResult = FreeRTOS_send( xSocket, NULL, uxDone, FREERTOS_MSG_DONTWAIT );
+			}
+			else
+			{
+				xResult = 0;
+			}
+		}
+
+		return xResult;
+	}
+
+#endif /* ipconfigUSE_SENDFILE */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_RECV_TO_FILE != 0 )
+
+	/* Write received data from the circular receive buffer to a file.
+	FreeRTOS+FAT writes whole sectors directly from the buffer that it is
+	given, only the partial sectors at the start and the end of a write go
+	through its sector cache. */
+	BaseType_t FreeRTOS_recv_to_file( Socket_t xSocket, struct _FF_FILE *pxFile, size_t uxLength )
+	{
+	FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
+	StreamBuffer_t *pxBuffer;
+	BaseType_t xResult = 0;
+	size_t uxCount = 0u, uxPosition, uxEnd, uxChunk, uxWritten;
+
+		if( prvValidSocket( pxSocket, FREERTOS_IPPROTO_TCP, pdTRUE ) == pdFALSE )
+		{
+			xResult = -pdFREERTOS_ERRNO_EINVAL;
+		}
+		else
+		{
+			pxBuffer = pxSocket->u.xTCP.rxStream;
+
+			if( pxBuffer != NULL )
+			{
+				uxCount = FreeRTOS_min_uint32( uxLength, uxStreamBufferGetSize( pxBuffer ) );
+			}
+
+			if( uxCount == 0u )
+			{
+				/* Same as FreeRTOS_recv(): the error is only returned after
+				the last byte has been read. */
+				if( ( pxSocket->u.xTCP.ucTCPState == eCLOSED ) ||
+					( pxSocket->u.xTCP.ucTCPState == eCLOSE_WAIT ) ||
+					( pxSocket->u.xTCP.ucTCPState == eCLOSING ) )
+				{
+					if( pxSocket->u.xTCP.bits.bMallocError != pdFALSE_UNSIGNED )
+					{
+						xResult = -pdFREERTOS_ERRNO_ENOMEM;
+					}
+					else
+					{
+						xResult = -pdFREERTOS_ERRNO_ENOTCONN;
+					}
+				}
+			}
+			else
+			{
+				if( ( uxCount < uxLength ) && ( pxSocket->u.xTCP.ucTCPState == eESTABLISHED ) )
+				{
+					/* More data is expected.  Stop at a sector boundary of
+					the file, so the next write starts with a complete sector.
+					A partial sector is held back as long as the stream has
+					space to receive the rest of it. */
+					uxPosition = ( size_t ) ff_ftell( pxFile );
+					uxEnd = ( uxPosition + uxCount ) & ~( ( size_t ) 511u );
+
+					if( uxEnd > uxPosition )
+					{
+						uxCount = uxEnd - uxPosition;
+					}
+					else if( uxStreamBufferGetSpace( pxBuffer ) >= 512u )
+					{
+						uxCount = 0u;
+					}
+				}
+
+				/* The data may wrap around the end of the buffer, in which
+				case it is written in two parts. */
+				while( ( size_t ) xResult < uxCount )
+				{
+					uxChunk = FreeRTOS_min_uint32( uxCount - ( size_t ) xResult, pxBuffer->LENGTH - pxBuffer->uxTail );
+					uxWritten = ff_fwrite( pxBuffer->ucArray + pxBuffer->uxTail, 1, uxChunk, pxFile );
+
+					/* Let FreeRTOS_recv() release the space, it will also
+					advertise the new window when necessary. */
+					FreeRTOS_recv( xSocket, NULL, uxWritten, FREERTOS_MSG_DONTWAIT );
+
+					if( uxWritten != uxChunk )
+					{
+						xResult = -pdFREERTOS_ERRNO_EIO;
+						break;
+					}
+
+					xResult += ( BaseType_t ) uxWritten;
+				}
+			}
+		}
+
+		return xResult;
+	}
+
+#endif /* ipconfigUSE_RECV_TO_FILE */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP == 1 )
 	/*
 	 * Send data using a TCP socket.  It is not necessary to have the socket
@@ -2674,7 +3991,23 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 				}
 
 				memset( pxSocket->u.xTCP.xPacket.u.ucLastPacket, '\0', sizeof( pxSocket->u.xTCP.xPacket.u.ucLastPacket ) );
-				memset( &pxSocket->u.xTCP.xTCPWindow, '\0', sizeof( pxSocket->u.xTCP.xTCPWindow ) );
+
+				/* Return the segments and the reservation of the previous
+				connection to the pool before the window is cleared. */
+				vTCPWindowDestroy( &pxSocket->u.xTCP.xTCPWindow );
+
+				#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+				{
+				uint8_t ucCongestionAlgorithm = pxSocket->u.xTCP.xTCPWindow.ucCongestionAlgorithm;
+
+					memset( &pxSocket->u.xTCP.xTCPWindow, '\0', sizeof( pxSocket->u.xTCP.xTCPWindow ) );
+					pxSocket->u.xTCP.xTCPWindow.ucCongestionAlgorithm = ucCongestionAlgorithm;
+				}
+				#else
+				{
+					memset( &pxSocket->u.xTCP.xTCPWindow, '\0', sizeof( pxSocket->u.xTCP.xTCPWindow ) );
+				}
+				#endif /* ipconfigTCP_CONGESTION_CONTROL */
 				memset( &pxSocket->u.xTCP.bits, '\0', sizeof( pxSocket->u.xTCP.bits ) );
 
 				/* Now set the bReuseSocket flag again, because the bits have
@@ -2682,6 +4015,12 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 				pxSocket->u.xTCP.bits.bReuseSocket = pdTRUE_UNSIGNED;
 			}
 
+			#if( ipconfigTCP_ACCEPT_POOL_SIZE > 0 )
+			{
+				prvTCPAcceptPoolFill( pxSocket );
+			}
+			#endif
+
 			vTCPStateChange( pxSocket, eTCP_LISTEN );
 		}
 
@@ -2916,7 +4255,15 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 
 		uxSize = sizeof( *pxBuffer ) - sizeof( pxBuffer->ucArray ) + uxLength;
 
-		pxBuffer = ( StreamBuffer_t * )pvPortMallocLarge( uxSize );
+		#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+		{
+			pxBuffer = ( StreamBuffer_t * ) prvSocketSlabTake( uxSize, pdTRUE );
+		}
+		#else
+		{
+			pxBuffer = ( StreamBuffer_t * )pvPortMallocLarge( uxSize );
+		}
+		#endif
 
 		if( pxBuffer == NULL )
 		{
@@ -3409,6 +4756,79 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 #endif /* ( ( ipconfigHAS_PRINTF != 0 ) && ( ipconfigUSE_TCP == 1 ) ) */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
+
+	static EventBits_t prvSocketReadyBits( FreeRTOS_Socket_t *pxSocket, EventBits_t xInterest )
+	{
+	EventBits_t xSocketBits = 0;
+
+		#if( ipconfigUSE_TCP == 1 )
+			if( pxSocket->ucProtocol == FREERTOS_IPPROTO_TCP )
+			{
+				/* Check if the socket has already been accepted by the
+				owner.  If not, it is useless to return it from a
+				select(). */
+				BaseType_t bAccepted = pdFALSE;
+
+				if( pxSocket->u.xTCP.bits.bPassQueued == pdFALSE_UNSIGNED )
+				{
+					if( pxSocket->u.xTCP.bits.bPassAccept == pdFALSE_UNSIGNED )
+					{
+						bAccepted = pdTRUE;
+					}
+				}
+
+				/* Is the set owner interested in READ events? */
+				if( ( xInterest & eSELECT_READ ) != 0 )
+				{
+					if( pxSocket->u.xTCP.ucTCPState == eTCP_LISTEN )
+					{
+						if( ( pxSocket->u.xTCP.pxPeerSocket != NULL ) && ( pxSocket->u.xTCP.pxPeerSocket->u.xTCP.bits.bPassAccept != 0 ) )
+						{
+							xSocketBits |= eSELECT_READ;
+						}
+					}
+					else if( ( bAccepted != 0 ) && ( FreeRTOS_recvcount( pxSocket ) > 0 ) )
+					{
+						xSocketBits |= eSELECT_READ;
+					}
+				}
+				/* Is the set owner interested in EXCEPTION events? */
+				if( ( xInterest & eSELECT_EXCEPT ) != 0 )
+				{
+					if( ( pxSocket->u.xTCP.ucTCPState == eCLOSE_WAIT ) || ( pxSocket->u.xTCP.ucTCPState == eCLOSED ) )
+					{
+						xSocketBits |= eSELECT_EXCEPT;
+					}
+				}
+
+				/* Is the set owner interested in WRITE events? */
+				if( ( xInterest & eSELECT_WRITE ) != 0 )
+				{
+					if( ( bAccepted != 0 ) && ( FreeRTOS_tx_space( pxSocket ) > 0 ) )
+					{
+						xSocketBits |= eSELECT_WRITE;
+					}
+				}
+			}
+			else
+		#endif /* ipconfigUSE_TCP == 1 */
+		{
+			/* Select events for UDP are simpler. */
+			if( ( ( xInterest & eSELECT_READ ) != 0 ) &&
+				( listCURRENT_LIST_LENGTH( &( pxSocket->u.xUDP.xWaitingPacketsList ) ) > 0U ) )
+			{
+				xSocketBits |= eSELECT_READ;
+			}
+			/* The WRITE and EXCEPT bits are not used for UDP */
+		}	/* if( pxSocket->ucProtocol == FREERTOS_IPPROTO_TCP ) */
+
+		return xSocketBits;
+	}
+
+#endif /* ipconfigSUPPORT_SELECT_FUNCTION == 1 */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigSUPPORT_SELECT_FUNCTION == 1 )
 
 	void vSocketSelect( SocketSelect_t *pxSocketSet )
@@ -3449,89 +4869,24 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 					/* Socket does not belong to this select group. */
 					continue;
 				}
-				xSocketBits = 0;
+				xSocketBits = prvSocketReadyBits( pxSocket, pxSocket->xSelectBits );
 
 				#if( ipconfigUSE_TCP == 1 )
-					if( pxSocket->ucProtocol == FREERTOS_IPPROTO_TCP )
+					if( ( pxSocket->ucProtocol == FREERTOS_IPPROTO_TCP ) &&
+						( ( pxSocket->xSelectBits & eSELECT_WRITE ) != 0 ) &&
+						( ( xSocketBits & eSELECT_WRITE ) == 0 ) )
 					{
-						/* Check if the socket has already been accepted by the
-						owner.  If not, it is useless to return it from a
-						select(). */
-						BaseType_t bAccepted = pdFALSE;
-
-						if( pxSocket->u.xTCP.bits.bPassQueued == pdFALSE_UNSIGNED )
-						{
-							if( pxSocket->u.xTCP.bits.bPassAccept == pdFALSE_UNSIGNED )
-							{
-								bAccepted = pdTRUE;
-							}
-						}
-
-						/* Is the set owner interested in READ events? */
-						if( ( pxSocket->xSelectBits & eSELECT_READ ) != 0 )
-						{
-							if( pxSocket->u.xTCP.ucTCPState == eTCP_LISTEN )
-							{
-								if( ( pxSocket->u.xTCP.pxPeerSocket != NULL ) && ( pxSocket->u.xTCP.pxPeerSocket->u.xTCP.bits.bPassAccept != 0 ) )
-								{
-									xSocketBits |= eSELECT_READ;
-								}
-							}
-							else if( ( bAccepted != 0 ) && ( FreeRTOS_recvcount( pxSocket ) > 0 ) )
-							{
-								xSocketBits |= eSELECT_READ;
-							}
-						}
-						/* Is the set owner interested in EXCEPTION events? */
-						if( ( pxSocket->xSelectBits & eSELECT_EXCEPT ) != 0 )
-						{
-							if( ( pxSocket->u.xTCP.ucTCPState == eCLOSE_WAIT ) || ( pxSocket->u.xTCP.ucTCPState == eCLOSED ) )
-							{
-								xSocketBits |= eSELECT_EXCEPT;
-							}
-						}
-
-						/* Is the set owner interested in WRITE events? */
-						if( ( pxSocket->xSelectBits & eSELECT_WRITE ) != 0 )
+						/* A connecting socket is returned once as writable as
+						soon as it has been connected. */
+						if( ( pxSocket->u.xTCP.bits.bConnPrepared != pdFALSE_UNSIGNED ) &&
+							( pxSocket->u.xTCP.ucTCPState >= eESTABLISHED ) &&
+							( pxSocket->u.xTCP.bits.bConnPassed == pdFALSE_UNSIGNED ) )
 						{
-							BaseType_t bMatch = pdFALSE;
-
-							if( bAccepted != 0 )
-							{
-								if( FreeRTOS_tx_space( pxSocket ) > 0 )
-								{
-									bMatch = pdTRUE;
-								}
-							}
-
-							if( bMatch == pdFALSE )
-							{
-								if( ( pxSocket->u.xTCP.bits.bConnPrepared != pdFALSE_UNSIGNED ) &&
-									( pxSocket->u.xTCP.ucTCPState >= eESTABLISHED ) &&
-									( pxSocket->u.xTCP.bits.bConnPassed == pdFALSE_UNSIGNED ) )
-								{
-									pxSocket->u.xTCP.bits.bConnPassed = pdTRUE_UNSIGNED;
-									bMatch = pdTRUE;
-								}
-							}
-
-							if( bMatch != pdFALSE )
-							{
-								xSocketBits |= eSELECT_WRITE;
-							}
+							pxSocket->u.xTCP.bits.bConnPassed = pdTRUE_UNSIGNED;
+							xSocketBits |= eSELECT_WRITE;
 						}
 					}
-					else
 				#endif /* ipconfigUSE_TCP == 1 */
-				{
-					/* Select events for UDP are simpler. */
-					if( ( ( pxSocket->xSelectBits & eSELECT_READ ) != 0 ) &&
-						( listCURRENT_LIST_LENGTH( &( pxSocket->u.xUDP.xWaitingPacketsList ) ) > 0U ) )
-					{
-						xSocketBits |= eSELECT_READ;
-					}
-					/* The WRITE and EXCEPT bits are not used for UDP */
-				}	/* if( pxSocket->ucProtocol == FREERTOS_IPPROTO_TCP ) */
 
 				/* Each socket keeps its own event flags, which are looked-up
 				by FreeRTOS_FD_ISSSET() */
@@ -3591,6 +4946,14 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 		}
 		else
 	#endif /* ipconfigSUPPORT_SELECT_FUNCTION */
+	#if( ipconfigSUPPORT_POLL_SET != 0 )
+		if( pxSocket->pxPollSet != NULL )
+		{
+			xEventGroupSetBits( pxSocket->pxPollSet->xPollGroup, socketPOLL_INTR );
+			xReturn = 0;
+		}
+		else
+	#endif /* ipconfigSUPPORT_POLL_SET */
 		if( pxSocket->xEventGroup != NULL )
 		{
 			xEventGroupSetBits( pxSocket->xEventGroup, eSOCKET_INTR );
@@ -3615,7 +4978,6 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 	FreeRTOS_Socket_t *pxSocket = ( FreeRTOS_Socket_t * ) xSocket;
 	BaseType_t xReturn;
 	IPStackEvent_t xEvent;
-	extern QueueHandle_t xNetworkEventQueue;
 
 		configASSERT( pxSocket != NULL );
 		configASSERT( pxSocket->ucProtocol == FREERTOS_IPPROTO_TCP );
@@ -3625,7 +4987,7 @@ void vSocketWakeUpUser( FreeRTOS_Socket_t *pxSocket )
 		xEvent.pvData = ( void * )pxSocket;
 
 		/* The IP-task will call FreeRTOS_SignalSocket for this socket. */
-		xReturn = xQueueSendToBackFromISR( xNetworkEventQueue, &xEvent, pxHigherPriorityTaskWoken );
+		xReturn = xSendEventStructToIPTaskFromISR( &xEvent, pxHigherPriorityTaskWoken );
 
 		return xReturn;
 	}
@@ -228,4 +228,136 @@ size_t uxSize, uxCount, uxFirst, uxNextTail;
 
 	return uxCount;
 }
+/*-----------------------------------------------------------*/
+
+/*
+ * uxStreamBufferPlaceChecksum( )
+ * Copies data into the free space at 'uxHead' + 'uxOffset', while calculating
+ * its checksum.  None of the markers will be moved: a later call to
+ * uxStreamBufferAdd() with 'pucData' equal to NULL will make the data
+ * available.  Until then, the data may be overwritten or dropped.
+ */
+size_t uxStreamBufferPlaceChecksum( StreamBuffer_t *pxBuffer, size_t uxOffset, const uint8_t *pucData, size_t uxCount, uint16_t *pusChecksum )
+{
+size_t uxSpace, uxNextHead, uxFirst;
+uint16_t usChecksum = 0u;
+
+	uxSpace = uxStreamBufferGetSpace( pxBuffer );
+
+	if( uxSpace > uxOffset )
+	{
+		uxSpace -= uxOffset;
+	}
+	else
+	{
+		uxSpace = 0u;
+	}
+
+	uxCount = FreeRTOS_min_uint32( uxSpace, uxCount );
+
+	if( uxCount != 0u )
+	{
+		uxNextHead = pxBuffer->uxHead + uxOffset;
+		if( uxNextHead >= pxBuffer->LENGTH )
+		{
+			uxNextHead -= pxBuffer->LENGTH;
+		}
+
+		uxFirst = FreeRTOS_min_uint32( pxBuffer->LENGTH - uxNextHead, uxCount );
+		usChecksum = usGenerateChecksumCopy( 0UL, pxBuffer->ucArray + uxNextHead, pucData, uxFirst );
+
+		if( uxCount > uxFirst )
+		{
+			usChecksum = usAddPartialChecksum( usChecksum,
+				usGenerateChecksumCopy( 0UL, pxBuffer->ucArray, pucData + uxFirst, uxCount - uxFirst ), uxFirst );
+		}
+	}
+
+	*pusChecksum = usChecksum;
+
+	return uxCount;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * uxStreamBufferPeekChecksum( )
+ * The same as uxStreamBufferGet() in 'peek' mode, but the checksum of the
+ * data is calculated while it is being copied.
+ */
+size_t uxStreamBufferPeekChecksum( StreamBuffer_t *pxBuffer, size_t uxOffset, uint8_t *pucData, size_t uxMaxCount, uint16_t *pusChecksum )
+{
+size_t uxSize, uxCount, uxFirst, uxNextTail;
+uint16_t usChecksum = 0u;
+
+	uxSize = uxStreamBufferGetSize( pxBuffer );
+
+	if( uxSize > uxOffset )
+	{
+		uxSize -= uxOffset;
+	}
+	else
+	{
+		uxSize = 0u;
+	}
+
+	uxCount = FreeRTOS_min_uint32( uxSize, uxMaxCount );
+
+	if( uxCount > 0u )
+	{
+		uxNextTail = pxBuffer->uxTail + uxOffset;
+		if( uxNextTail >= pxBuffer->LENGTH )
+		{
+			uxNextTail -= pxBuffer->LENGTH;
+		}
+
+		uxFirst = FreeRTOS_min_uint32( pxBuffer->LENGTH - uxNextTail, uxCount );
+		usChecksum = usGenerateChecksumCopy( 0UL, pucData, pxBuffer->ucArray + uxNextTail, uxFirst );
+
+		if( uxCount > uxFirst )
+		{
+			usChecksum = usAddPartialChecksum( usChecksum,
+				usGenerateChecksumCopy( 0UL, pucData + uxFirst, pxBuffer->ucArray, uxCount - uxFirst ), uxFirst );
+		}
+	}
+
+	*pusChecksum = usChecksum;
+
+	return uxCount;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * uxStreamBufferPeekFragments( )
+ * Finds the data at 'uxOffset' from 'uxTail' without copying it.  The data
+ * may wrap around: the first '*puxFirst' bytes are found at '*ppucFirst', the
+ * remaining bytes at the start of 'ucArray'.  The markers are not moved.
+ */
+size_t uxStreamBufferPeekFragments( StreamBuffer_t *pxBuffer, size_t uxOffset, size_t uxMaxCount, uint8_t **ppucFirst, size_t *puxFirst )
+{
+size_t uxSize, uxCount, uxNextTail;
+
+	uxSize = uxStreamBufferGetSize( pxBuffer );
+
+	if( uxSize > uxOffset )
+	{
+		uxSize -= uxOffset;
+	}
+	else
+	{
+		uxSize = 0u;
+	}
+
+	uxCount = FreeRTOS_min_uint32( uxSize, uxMaxCount );
+
+	uxNextTail = pxBuffer->uxTail + uxOffset;
+	if( uxNextTail >= pxBuffer->LENGTH )
+	{
+		uxNextTail -= pxBuffer->LENGTH;
+	}
+
+	*ppucFirst = pxBuffer->ucArray + uxNextTail;
+	*puxFirst = FreeRTOS_min_uint32( pxBuffer->LENGTH - uxNextTail, uxCount );
+
+	return uxCount;
+}
 
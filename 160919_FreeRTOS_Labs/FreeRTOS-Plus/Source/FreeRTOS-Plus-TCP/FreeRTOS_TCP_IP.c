@@ -156,11 +156,11 @@ the defined MTU size can contain at ;east a complete TCP packet. */
 
 /*
  * Acknowledgements to TCP data packets may be delayed as long as more is being expected.
- * A normal delay would be 200ms.  Here a much shorter delay of 20 ms is being used to
- * gain performance.
+ * A normal delay would be 200ms.  Here a much shorter delay of 20 ms (by default) is
+ * being used to gain performance.
  */
 #define DELAYED_ACK_SHORT_DELAY_MS			( 2 )
-#define DELAYED_ACK_LONGER_DELAY_MS			( 20 )
+#define DELAYED_ACK_LONGER_DELAY_MS			( ipconfigTCP_DELAYED_ACK_MS )
 
 /*
  * The MSS (Maximum Segment Size) will be taken as large as possible. However, packets with
@@ -192,6 +192,81 @@ the defined MTU size can contain at ;east a complete TCP packet. */
 	#define SEND_REPEATED_COUNT		( 8 )
 #endif /* !defined( SEND_REPEATED_COUNT ) */
 
+/*
+ * With chained network buffers, the payload of a TCP packet can be sent
+ * straight from the txStream, as long as the driver has gathered it before
+ * xNetworkInterfaceOutput() returns.  The payload checksum must then be known
+ * before the packet is sent, unless the driver calculates it.  Short payloads
+ * are still copied, which is cheaper than a gather.
+ */
+#if( ipconfigUSE_CHAINED_BUFFERS != 0 ) && ( ipconfigGATHER_TX_DRIVER != 0 ) && ( ipconfigZERO_COPY_TX_DRIVER == 0 ) && \
+	( ( ipconfigTCP_FUSED_CHECKSUM != 0 ) || ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM != 0 ) )
+	#define tcpCHAINED_TX					1
+#else
+	#define tcpCHAINED_TX					0
+#endif
+#define tcpCHAINED_TX_MINIMUM_LENGTH	( 128 )
+
+/*
+ * With large send, the new segments that are ready to be sent are fetched from
+ * the sliding window in one go and sent back-to-back, using a header that is
+ * only prepared once.
+ */
+#if( ipconfigTCP_LARGE_SEND != 0 ) && ( ipconfigUSE_TCP_WIN == 1 )
+	#define tcpLARGE_SEND					1
+#else
+	#define tcpLARGE_SEND					0
+#endif
+
+/*
+ * Once the time-stamps option has been negotiated, it is sent in every
+ * segment, always as the last 12 bytes of the TCP options.
+ */
+#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+	#define tcpHAS_TIMESTAMPS( pxSocket )	( ( pxSocket )->u.xTCP.xTCPWindow.u.bits.bTimeStamps != pdFALSE_UNSIGNED )
+#else
+	#define tcpHAS_TIMESTAMPS( pxSocket )	( pdFALSE )
+#endif
+#define tcpTIMESTAMP_LENGTH( pxSocket )		( tcpHAS_TIMESTAMPS( pxSocket ) ? ( UBaseType_t ) winTIMESTAMP_OPTION_LENGTH : 0u )
+
+/*
+ * Header prediction: of these flags, only ACK may be set in a segment that
+ * takes the fast path.  PSH is ignored.
+ */
+#define tcpPREDICTION_FLAGS_MASK	( ipTCP_FLAG_FIN | ipTCP_FLAG_SYN | ipTCP_FLAG_RST | ipTCP_FLAG_ACK | ipTCP_FLAG_URG )
+
+/*
+ * A SYN cookie is the initial sequence number of a SYN+ACK sent by a listening
+ * socket.  It holds 3 bits of a counter that increments every 64 seconds, 2 bits
+ * to select the MSS, and 27 bits of a hash of the connection.  A cookie is
+ * accepted during 2 periods.  Once half of the backlog is in use, SYN's are
+ * answered with a cookie, so that the other half remains available for peers
+ * that have proven to exist.
+ */
+#if( ipconfigTCP_SYN_COOKIES != 0 )
+	#define tcpSYN_COOKIE_PERIOD_TICKS			( ( TickType_t ) 64u * ( TickType_t ) configTICK_RATE_HZ )
+	#define tcpSYN_COOKIE_COUNTER_SHIFT			( 29u )
+	#define tcpSYN_COOKIE_COUNTER_MASK			( 0x07UL )
+	#define tcpSYN_COOKIE_MSS_SHIFT				( 27u )
+	#define tcpSYN_COOKIE_MSS_MASK				( 0x03UL )
+	#define tcpSYN_COOKIE_HASH_MASK				( 0x07FFFFFFUL )
+	#define tcpSYN_COOKIE_MAX_AGE				( 1UL )
+	#define tcpSYN_COOKIE_THRESHOLD( pxSocket )	( ( uint16_t ) ( ( ( pxSocket )->u.xTCP.usBacklog + 1u ) / 2u ) )
+
+	/* Used by prvSipRound(). */
+	#define tcpROTL64( ullX, uxBits )			( ( ( ullX ) << ( uxBits ) ) | ( ( ullX ) >> ( 64u - ( uxBits ) ) ) )
+#endif
+
+/*
+ * The IP-task may pass a received segment along with a number of segments that
+ * directly follow it, see ipconfigTCP_RX_COALESCE.
+ */
+#if( ipconfigUSE_LINKED_RX_MESSAGES != 0 ) && ( ipconfigTCP_RX_COALESCE != 0 )
+	#define tcpRX_COALESCE					1
+#else
+	#define tcpRX_COALESCE					0
+#endif
+
 /*
  * The names of the different TCP states may be useful in logging.
  */
@@ -229,6 +304,26 @@ static int32_t prvTCPSendPacket( FreeRTOS_Socket_t *pxSocket );
  */
 static int32_t prvTCPSendRepeated( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t **ppxNetworkBuffer );
 
+/*
+ * Fill in the headers of an outgoing packet.
+ */
+static void prvTCPSetHeaders( FreeRTOS_Socket_t *pxSocket, TCPPacket_t *pxTCPPacket, uint32_t ulLen );
+
+#if( tcpRX_COALESCE != 0 )
+	/*
+	 * Store the payload of a received segment and of the segments that were
+	 * merged with it.
+	 */
+	static int32_t prvTCPAddMergedRxdata( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer, uint32_t ulOffset );
+#endif
+
+#if( tcpLARGE_SEND != 0 )
+	/*
+	 * Send a series of new segments in one go.
+	 */
+	static int32_t prvTCPSendLarge( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t **ppxNetworkBuffer );
+#endif
+
 /*
  * Return or send a packet to the other party.
  */
@@ -277,6 +372,24 @@ static void prvTCPTouchSocket( FreeRTOS_Socket_t *pxSocket );
  */
 static int32_t prvTCPPrepareSend( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t **ppxNetworkBuffer, UBaseType_t uxOptionsLength );
 
+#if( tcpCHAINED_TX != 0 )
+	/*
+	 * Attach the payload to an outgoing packet as fragments which point into
+	 * the txStream, in stead of copying it.
+	 */
+	static BaseType_t prvTCPChainPayload( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer,
+		size_t uxOffset, int32_t lDataLen );
+#endif
+
+#if( ipconfigTCP_FUSED_CHECKSUM != 0 ) && ( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 )
+	/*
+	 * Check the protocol checksum of an incoming TCP packet.  The payload of an
+	 * in-order segment is copied to the free space of rxStream while it is
+	 * being summed, so prvStoreRxData() doesn't need to read it again.
+	 */
+	static BaseType_t prvTCPCheckRxChecksum( FreeRTOS_Socket_t *pxSocket, const NetworkBufferDescriptor_t *pxNetworkBuffer );
+#endif
+
 /*
  * Calculate when this socket needs to be checked to do (re-)transmissions.
  */
@@ -322,6 +435,12 @@ static UBaseType_t prvSetOptions( FreeRTOS_Socket_t *pxSocket, NetworkBufferDesc
 static BaseType_t prvHandleSynReceived( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t **ppxNetworkBuffer,
 	uint32_t ulReceiveLength, UBaseType_t uxOptionsLength );
 
+/*
+ * Process the acknowledgement number of a received segment: free the ACK'd
+ * data from the txStream and wake up the socket owner.
+ */
+static void prvTCPAckTxData( FreeRTOS_Socket_t *pxSocket, uint32_t ulAckNumber );
+
 /*
  * Called from prvTCPHandleState() as long as the TCP status is eESTABLISHED.
  */
@@ -342,6 +461,15 @@ static BaseType_t prvSendData( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescrip
  */
 static BaseType_t prvTCPHandleState( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t **ppxNetworkBuffer );
 
+#if( ipconfigTCP_HEADER_PREDICTION != 0 )
+	/*
+	 * The fast path for the most common segments of an established connection.
+	 * Returns pdFALSE, without having changed anything, if the segment must be
+	 * handled by prvTCPHandleState().
+	 */
+	static BaseType_t prvTCPHeaderPrediction( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t **ppxNetworkBuffer );
+#endif
+
 /*
  * Reply to a peer with the RST flag on, in case a packet can not be handled.
  */
@@ -364,6 +492,42 @@ static FreeRTOS_Socket_t *prvHandleListen( FreeRTOS_Socket_t *pxSocket, NetworkB
  */
 static BaseType_t prvTCPSocketCopy( FreeRTOS_Socket_t *pxNewSocket, FreeRTOS_Socket_t *pxSocket );
 
+/*
+ * Get a new child socket for a listening socket, either from its pool or
+ * freshly allocated, with the properties of the parent.
+ */
+static FreeRTOS_Socket_t *prvTCPNewChild( FreeRTOS_Socket_t *pxSocket );
+
+#if( ipconfigTCP_SYN_COOKIES != 0 )
+	/*
+	 * Answer a SYN with a SYN+ACK that carries a cookie, without creating a
+	 * socket.
+	 */
+	static void prvTCPSendSynCookie( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer );
+
+	/*
+	 * A listening socket received an ACK.  If it acknowledges a SYN cookie,
+	 * create the connection and return the new socket.
+	 */
+	static FreeRTOS_Socket_t *prvHandleSynCookie( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer );
+
+	/*
+	 * The keyed hash of a connection, stored in its SYN cookies.
+	 */
+	static uint32_t prvSynCookieHash( const TCPPacket_t *pxTCPPacket, uint32_t ulPeerSequence, uint32_t ulCounter );
+
+	/*
+	 * SipHash-2-4 of 'uxCount' 32-bit words, as if they were stored in
+	 * little-endian order, with the 128-bit key pulKey[ 0..3 ].
+	 */
+	static uint64_t prvSipHash24( const uint32_t *pulKey, const uint32_t *pulWords, size_t uxCount );
+
+	/*
+	 * One SipRound on the state pullV[ 0..3 ].
+	 */
+	static portINLINE void prvSipRound( uint64_t *pullV );
+#endif /* ipconfigTCP_SYN_COOKIES */
+
 /*
  * prvTCPStatusAgeCheck() will see if the socket has been in a non-connected
  * state for too long.  If so, the socket will be closed, and -1 will be
@@ -391,6 +555,41 @@ used when a new connection is opened.  The value should be randomized to prevent
 attacks from outside (spoofing). */
 uint32_t ulNextInitialSequenceNumber = 0ul;
 
+#if( ipconfigTCP_SYN_COOKIES != 0 )
+	/* The keys of the SYN cookie hash.  A new key is chosen for every period
+	of tcpSYN_COOKIE_PERIOD_TICKS in which cookies are used.  Cookies of the
+	current and of the previous period are accepted, so two keys are kept,
+	indexed by the lowest bit of the period counter. */
+	static uint32_t ulSynCookieKeys[ 2 ][ 4 ];
+	static uint32_t ulSynCookieKeyCounter[ 2 ];
+	static BaseType_t xSynCookieKeyValid[ 2 ] = { pdFALSE, pdFALSE };
+
+	/* The MSS values that can be stored in a SYN cookie. */
+	static const uint16_t usSynCookieMSS[ 4 ] = { 536u, 1200u, 1400u, 1460u };
+#endif
+
+#if( tcpCHAINED_TX != 0 )
+	/* The fragments describing the payload of the packet being sent, which may
+	wrap around in the txStream.  They are only used by the IP-task, from
+	prvTCPPrepareSend() until xNetworkInterfaceOutput() has returned. */
+	static NetworkBufferDescriptor_t xPayloadFragments[ 2 ];
+#endif
+
+#if( ipconfigTCP_HEADER_PREDICTION != 0 )
+	/* The number of segments of established connections that were handled by
+	prvTCPHeaderPrediction(), and the number that were not. */
+	static uint32_t ulPredictedAcks = 0ul;
+	static uint32_t ulPredictedData = 0ul;
+	static uint32_t ulPredictionMissed = 0ul;
+#endif
+
+#if( tcpRX_COALESCE != 0 )
+	/* The segments that were merged with the packet being handled by
+	xProcessReceivedTCPPacket(), linked through pxNextBuffer.  They are owned
+	by the IP-task, which releases them after the call. */
+	static NetworkBufferDescriptor_t *pxRxMerged = NULL;
+#endif
+
 /*-----------------------------------------------------------*/
 
 /* prvTCPSocketIsActive() returns true if the socket must be checked.
@@ -559,6 +758,8 @@ BaseType_t xReady = pdFALSE;
 				vReleaseNetworkBufferAndDescriptor( pxSocket->u.xTCP.pxAckMessage );
 				pxSocket->u.xTCP.pxAckMessage = NULL;
 			}
+
+			pxSocket->u.xTCP.ucDelayedAcks = 0u;
 		}
 	}
 	#endif /* ipconfigUSE_TCP_WIN */
@@ -635,13 +836,9 @@ NetworkBufferDescriptor_t *pxNetworkBuffer;
 
 			#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
 			{
-				/* When TCP time stamps are enabled, but they will only be applied
-				if the peer is outside the netmask, usually on the internet.
-				Packages sent on a LAN are usually too big to carry time stamps. */
-				if( ( ( pxSocket->u.xTCP.ulRemoteIP ^ FreeRTOS_ntohl( *ipLOCAL_IP_ADDRESS_POINTER ) ) & xNetworkAddressing.ulNetMask ) != 0ul )
-				{
-					pxSocket->u.xTCP.xTCPWindow.u.bits.bTimeStamps = pdTRUE_UNSIGNED;
-				}
+				/* Offer the time-stamps option.  It will only be used if the
+				SYN+ACK of the peer carries it as well. */
+				pxSocket->u.xTCP.xTCPWindow.u.bits.bTimeStamps = pdTRUE_UNSIGNED;
 			}
 			#endif
 
@@ -686,269 +883,559 @@ int32_t lResult = 0;
 UBaseType_t uxOptionsLength = 0u;
 int32_t xSendLength;
 
-	for( uxIndex = 0u; uxIndex < ( UBaseType_t ) SEND_REPEATED_COUNT; uxIndex++ )
+	/* The segments are passed to the driver in one go, when it supports that. */
+	vIPOutputBatchBegin();
+
+	#if( tcpLARGE_SEND != 0 )
+	{
+		/* See if new data can be sent in one go.  If not, e.g. because a
+		segment must be retransmitted, send the packets one by one. */
+		lResult = prvTCPSendLarge( pxSocket, ppxNetworkBuffer );
+	}
+	#endif /* tcpLARGE_SEND */
+
+	if( lResult == 0 )
 	{
-		/* prvTCPPrepareSend() might allocate a network buffer if there is data
-		to be sent. */
-		xSendLength = prvTCPPrepareSend( pxSocket, ppxNetworkBuffer, uxOptionsLength );
-		if( xSendLength <= 0 )
+		for( uxIndex = 0u; uxIndex < ( UBaseType_t ) SEND_REPEATED_COUNT; uxIndex++ )
 		{
-			break;
-		}
+			/* prvTCPPrepareSend() might allocate a network buffer if there is data
+			to be sent. */
+			xSendLength = prvTCPPrepareSend( pxSocket, ppxNetworkBuffer, uxOptionsLength );
+			if( xSendLength <= 0 )
+			{
+				break;
+			}
 
-		/* And return the packet to the peer. */
-		prvTCPReturnPacket( pxSocket, *ppxNetworkBuffer, ( uint32_t ) xSendLength, ipconfigZERO_COPY_TX_DRIVER );
+			/* And return the packet to the peer. */
+			prvTCPReturnPacket( pxSocket, *ppxNetworkBuffer, ( uint32_t ) xSendLength, ipconfigZERO_COPY_TX_DRIVER );
 
-		#if( ipconfigZERO_COPY_TX_DRIVER != 0 )
-		{
-			*ppxNetworkBuffer = NULL;
-		}
-		#endif /* ipconfigZERO_COPY_TX_DRIVER */
+			#if( ipconfigZERO_COPY_TX_DRIVER != 0 )
+			{
+				*ppxNetworkBuffer = NULL;
+			}
+			#endif /* ipconfigZERO_COPY_TX_DRIVER */
 
-		lResult += xSendLength;
+			lResult += xSendLength;
+		}
 	}
 
+	vIPOutputBatchEnd();
+
 	/* Return the total number of bytes sent. */
 	return lResult;
 }
 /*-----------------------------------------------------------*/
 
-/*
- * Return (or send) a packet the the peer.  The data is stored in pxBuffer,
- * which may either point to a real network buffer or to a TCP socket field
- * called 'xTCP.xPacket'.   A temporary xNetworkBuffer will be used to pass
- * the data to the NIC.
- */
-static void prvTCPReturnPacket( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer, uint32_t ulLen, BaseType_t xReleaseAfterSend )
-{
-TCPPacket_t * pxTCPPacket;
-IPHeader_t *pxIPHeader;
-EthernetHeader_t *pxEthernetHeader;
-uint32_t ulFrontSpace, ulSpace, ulSourceAddress, ulWinSize;
-TCPWindow_t *pxTCPWindow;
-NetworkBufferDescriptor_t xTempBuffer;
-/* For sending, a pseudo network buffer will be used, as explained above. */
-
-	if( pxNetworkBuffer == NULL )
-	{
-		pxNetworkBuffer = &xTempBuffer;
-
-		#if( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
-		{
-			xTempBuffer.pxNextBuffer = NULL;
-		}
-		#endif
-		xTempBuffer.pucEthernetBuffer = pxSocket->u.xTCP.xPacket.u.ucLastPacket;
-		xTempBuffer.xDataLength = sizeof( pxSocket->u.xTCP.xPacket.u.ucLastPacket );
-		xReleaseAfterSend = pdFALSE;
-	}
-
-	#if( ipconfigZERO_COPY_TX_DRIVER != 0 )
-	{
-		if( xReleaseAfterSend == pdFALSE )
-		{
-			pxNetworkBuffer = pxDuplicateNetworkBufferWithDescriptor( pxNetworkBuffer, ( BaseType_t ) pxNetworkBuffer->xDataLength );
-			if( pxNetworkBuffer == NULL )
-			{
-				FreeRTOS_debug_printf( ( "prvTCPReturnPacket: duplicate failed\n" ) );
-			}
-			xReleaseAfterSend = pdTRUE;
-		}
-	}
-	#endif /* ipconfigZERO_COPY_TX_DRIVER */
+#if( tcpLARGE_SEND != 0 )
 
-	if( pxNetworkBuffer != NULL )
+	static int32_t prvTCPSendLarge( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t **ppxNetworkBuffer )
 	{
-		pxTCPPacket = ( TCPPacket_t * ) ( pxNetworkBuffer->pucEthernetBuffer );
-		pxIPHeader = &pxTCPPacket->xIPHeader;
-		pxEthernetHeader = &pxTCPPacket->xEthernetHeader;
-
-		/* Fill the packet, using hton translations. */
-		if( pxSocket != NULL )
+	TCPWindow_t *pxTCPWindow = &( pxSocket->u.xTCP.xTCPWindow );
+	StreamBuffer_t *pxStream = pxSocket->u.xTCP.txStream;
+	NetworkBufferDescriptor_t *pxNetworkBuffer = NULL;
+	TCPPacket_t xTemplate, *pxTCPPacket;
+	uint8_t *pucEthernetBuffer;
+	uint32_t ulTotal = 0ul, ulSent, ulDataLen, ulSequenceNumber;
+	size_t uxOffset;
+	int32_t lStreamPos = 0;
+	int32_t lResult = 0;
+	const size_t uxHeaderLength = ipSIZE_OF_ETH_HEADER + ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER;
+	const uint16_t usMSS = pxTCPWindow->usMSS;
+
+		/* Only plain data packets are sent here.  Closing connections, keep-alive
+		messages and retransmissions are handled by prvTCPPrepareSend(). */
+		if( ( pxSocket->u.xTCP.ucTCPState == eESTABLISHED ) &&
+			( pxStream != NULL ) &&
+			( pxSocket->u.xTCP.usCurMSS > 1u ) &&
+			( pxSocket->u.xTCP.bits.bCloseRequested == pdFALSE_UNSIGNED ) &&
+			( pxSocket->u.xTCP.bits.bUserShutdown == pdFALSE_UNSIGNED ) &&
+			( pxSocket->u.xTCP.bits.bFinSent == pdFALSE_UNSIGNED ) &&
+			( pxSocket->u.xTCP.bits.bSendKeepAlive == pdFALSE_UNSIGNED ) &&
+			( tcpHAS_TIMESTAMPS( pxSocket ) == pdFALSE ) &&
+			( listLIST_IS_EMPTY( &( pxTCPWindow->xPriorityQueue ) ) != pdFALSE ) &&
+			( listLIST_IS_EMPTY( &( pxTCPWindow->xTxQueue ) ) == pdFALSE ) )
 		{
-			/* Calculate the space in the RX buffer in order to advertise the
-			size of this socket's reception window. */
-			pxTCPWindow = &( pxSocket->u.xTCP.xTCPWindow );
-
-			if( pxSocket->u.xTCP.rxStream != NULL )
+			/* The template is made from the same header as prvTCPPrepareSend()
+			would use. */
+			if( *ppxNetworkBuffer != NULL )
 			{
-				/* An RX stream was created already, see how much space is
-				available. */
-				ulFrontSpace = ( uint32_t ) uxStreamBufferFrontSpace( pxSocket->u.xTCP.rxStream );
+				memcpy( &xTemplate, ( *ppxNetworkBuffer )->pucEthernetBuffer, uxHeaderLength );
 			}
 			else
 			{
-				/* No RX stream has been created, the full stream size is
-				available. */
-				ulFrontSpace = ( uint32_t ) pxSocket->u.xTCP.uxRxStreamSize;
+				memcpy( &xTemplate, pxSocket->u.xTCP.xPacket.u.ucLastPacket, uxHeaderLength );
 			}
 
-			/* Take the minimum of the RX buffer space and the RX window size. */
-			ulSpace = FreeRTOS_min_uint32( pxSocket->u.xTCP.ulRxCurWinSize, pxTCPWindow->xSize.ulRxWindowLength );
-
-			if( ( pxSocket->u.xTCP.bits.bLowWater != pdFALSE_UNSIGNED ) || ( pxSocket->u.xTCP.bits.bRxStopped != pdFALSE_UNSIGNED ) )
+			#if( ipconfigZERO_COPY_TX_DRIVER == 0 )
 			{
-				/* The low-water mark was reached, meaning there was little
-				space left.  The socket will wait until the application has read
-				or flushed the incoming data, and 'zero-window' will be
-				advertised. */
-				ulSpace = 0u;
+				/* One network buffer will be used for all packets.  Get it before
+				fetching segments from the window. */
+				pxNetworkBuffer = prvTCPBufferResize( pxSocket, *ppxNetworkBuffer, ( int32_t ) usMSS, 0u );
+				if( pxNetworkBuffer != NULL )
+				{
+					*ppxNetworkBuffer = pxNetworkBuffer;
+					ulTotal = ulTCPWindowTxGetBurst( pxTCPWindow, pxSocket->u.xTCP.ulWindowSize, &lStreamPos, ( uint32_t ) SEND_REPEATED_COUNT * usMSS );
+				}
 			}
-
-			/* If possible, advertise an RX window size of at least 1 MSS, otherwise
-			the peer might start 'zero window probing', i.e. sending small packets
-			(1, 2, 4, 8... bytes). */
-			if( ( ulSpace < pxSocket->u.xTCP.usCurMSS ) && ( ulFrontSpace >= pxSocket->u.xTCP.usCurMSS ) )
+			#else
 			{
-				ulSpace = pxSocket->u.xTCP.usCurMSS;
+				ulTotal = ulTCPWindowTxGetBurst( pxTCPWindow, pxSocket->u.xTCP.ulWindowSize, &lStreamPos, ( uint32_t ) SEND_REPEATED_COUNT * usMSS );
 			}
+			#endif /* ipconfigZERO_COPY_TX_DRIVER */
+		}
 
-			/* Avoid overflow of the 16-bit win field. */
-			ulWinSize = ( ulSpace >> pxSocket->u.xTCP.ucMyWinScaleFactor );
-			if( ulWinSize > 0xfffcUL )
+		if( ulTotal != 0ul )
+		{
+			/* Prepare the header template: all fields that are equal for every
+			segment. */
+			xTemplate.xTCPHeader.ucTCPFlags = ( uint8_t ) ( ipTCP_FLAG_ACK | ipTCP_FLAG_PSH );
+			xTemplate.xTCPHeader.ucTCPOffset = TCP_OFFSET_STANDARD_LENGTH;
+			xTemplate.xTCPHeader.usChecksum = 0u;
+			xTemplate.xIPHeader.usHeaderChecksum = 0u;
+			prvTCPSetHeaders( pxSocket, &xTemplate, ( uint32_t ) ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER ) + ulTotal );
+			xTemplate.xIPHeader.ucTimeToLive = ( uint8_t ) ipconfigTCP_TIME_TO_LIVE;
+
+			/* prvTCPSetHeaders() has taken an identification number, but every
+			segment will get its own. */
+			usPacketIdentifier--;
+
+			ulSequenceNumber = pxTCPWindow->ulOurSequenceNumber;
+			uxOffset = uxStreamBufferDistance( pxStream, pxStream->uxTail, ( size_t ) lStreamPos );
+			ulSent = 0ul;
+
+			#if( ipconfigTCP_LARGE_SEND_OFFLOAD != 0 )
 			{
-				ulWinSize = 0xfffcUL;
-			}
+			NetworkBufferDescriptor_t *pxLargeBuffer = NULL;
 
-			pxTCPPacket->xTCPHeader.usWindow = FreeRTOS_htons( ( uint16_t ) ulWinSize );
+				/* Let the hardware cut the data into segments.  That requires a
+				network buffer that can hold all of it. */
+				if( ( ulTotal > ( uint32_t ) usMSS ) && ( xBufferAllocFixedSize == pdFALSE ) )
+				{
+					pxLargeBuffer = pxGetNetworkBufferWithDescriptor( uxHeaderLength + ( size_t ) ulTotal, 0u );
+				}
 
-			#if( ipconfigHAS_DEBUG_PRINTF != 0 )
-			{
-				if( ipconfigTCP_MAY_LOG_PORT( pxSocket->usLocalPort ) != pdFALSE )
+				if( pxLargeBuffer != NULL )
 				{
-					if( ( xTCPWindowLoggingLevel != 0 ) && ( pxSocket->u.xTCP.bits.bWinChange != pdFALSE_UNSIGNED ) )
-					{
-					size_t uxFrontSpace;
+					memcpy( pxLargeBuffer->pucEthernetBuffer, &xTemplate, uxHeaderLength );
+					( void ) uxStreamBufferGet( pxStream, uxOffset, pxLargeBuffer->pucEthernetBuffer + uxHeaderLength, ( size_t ) ulTotal, pdTRUE );
+					pxLargeBuffer->xDataLength = uxHeaderLength + ( size_t ) ulTotal;
 
-						if(pxSocket->u.xTCP.rxStream != NULL)
-						{
-							uxFrontSpace =  uxStreamBufferFrontSpace( pxSocket->u.xTCP.rxStream ) ;
-						}
-						else
-						{
-							uxFrontSpace = 0u;
-						}
+					/* The hardware will give each segment the next identification
+					number. */
+					usPacketIdentifier += ( uint16_t ) ( ( ulTotal + usMSS - 1ul ) / usMSS );
 
-						FreeRTOS_debug_printf( ( "%s: %lxip:%u: [%lu < %lu] winSize %ld\n",
-						pxSocket->u.xTCP.bits.bLowWater ? "STOP" : "GO ",
-							pxSocket->u.xTCP.ulRemoteIP,
-							pxSocket->u.xTCP.usRemotePort,
-							pxSocket->u.xTCP.bits.bLowWater ? pxSocket->u.xTCP.uxLittleSpace : uxFrontSpace, pxSocket->u.xTCP.uxEnoughSpace,
-							(int32_t) ( pxTCPWindow->rx.ulHighestSequenceNumber - pxTCPWindow->rx.ulCurrentSequenceNumber ) ) );
-					}
+					xNetworkInterfaceOutputLarge( pxLargeBuffer, usMSS, pdTRUE );
+					ulSent = ulTotal;
+					lResult = ( int32_t ) ( ( ( ulTotal + usMSS - 1ul ) / usMSS ) * ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER ) + ulTotal );
 				}
 			}
-			#endif /* ipconfigHAS_DEBUG_PRINTF != 0 */
-
-			/* The new window size has been advertised, switch off the flag. */
-			pxSocket->u.xTCP.bits.bWinChange = pdFALSE_UNSIGNED;
+			#endif /* ipconfigTCP_LARGE_SEND_OFFLOAD */
 
-			/* Later on, when deciding to delay an ACK, a precise estimate is needed
-			of the free RX space.  At this moment, 'ulHighestRxAllowed' would be the
-			highest sequence number minus 1 that the socket will accept. */
-			pxSocket->u.xTCP.ulHighestRxAllowed = pxTCPWindow->rx.ulCurrentSequenceNumber + ulSpace;
+			while( ulSent < ulTotal )
+			{
+				ulDataLen = FreeRTOS_min_uint32( ulTotal - ulSent, ( uint32_t ) usMSS );
 
-			#if( ipconfigTCP_KEEP_ALIVE == 1 )
-				if( pxSocket->u.xTCP.bits.bSendKeepAlive != pdFALSE_UNSIGNED )
+				#if( ipconfigZERO_COPY_TX_DRIVER != 0 )
+				{
+					pxNetworkBuffer = pxGetNetworkBufferWithDescriptor( uxHeaderLength + ( size_t ) ulDataLen, 0u );
+					if( pxNetworkBuffer == NULL )
+					{
+						/* The remaining segments will be sent again when their
+						transmit timers expire. */
+						break;
+					}
+				}
+				#endif /* ipconfigZERO_COPY_TX_DRIVER */
+
+				/* Only the sequence number, the lengths, the identification and
+				the checksums differ from the template. */
+				pucEthernetBuffer = pxNetworkBuffer->pucEthernetBuffer;
+				memcpy( pucEthernetBuffer, &xTemplate, uxHeaderLength );
+				pxTCPPacket = ( TCPPacket_t * ) pucEthernetBuffer;
+				pxTCPPacket->xTCPHeader.ulSequenceNumber = FreeRTOS_htonl( ulSequenceNumber + ulSent );
+				pxTCPPacket->xIPHeader.usLength = FreeRTOS_htons( ( uint16_t ) ( ( uint32_t ) ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER ) + ulDataLen ) );
+				pxTCPPacket->xIPHeader.usIdentification = FreeRTOS_htons( usPacketIdentifier );
+				usPacketIdentifier++;
+				pxNetworkBuffer->xDataLength = uxHeaderLength + ( size_t ) ulDataLen;
+
+				#if( tcpCHAINED_TX != 0 )
+				if( ( ulDataLen >= tcpCHAINED_TX_MINIMUM_LENGTH ) &&
+					( prvTCPChainPayload( pxSocket, pxNetworkBuffer, uxOffset + ( size_t ) ulSent, ( int32_t ) ulDataLen ) != pdFALSE ) )
 				{
-					/* Sending a keep-alive packet, send the current sequence number
-					minus 1, which will	be recognised as a keep-alive packet an
-					responded to by acknowledging the last byte. */
-					pxSocket->u.xTCP.bits.bSendKeepAlive = pdFALSE_UNSIGNED;
-					pxSocket->u.xTCP.bits.bWaitKeepAlive = pdTRUE_UNSIGNED;
-
-					pxTCPPacket->xTCPHeader.ulSequenceNumber = pxSocket->u.xTCP.xTCPWindow.ulOurSequenceNumber - 1UL;
-					pxTCPPacket->xTCPHeader.ulSequenceNumber = FreeRTOS_htonl( pxTCPPacket->xTCPHeader.ulSequenceNumber );
+					/* The payload will be gathered from the txStream. */
 				}
 				else
-			#endif
-			{
-				pxTCPPacket->xTCPHeader.ulSequenceNumber = FreeRTOS_htonl( pxSocket->u.xTCP.xTCPWindow.ulOurSequenceNumber );
+				#endif /* tcpCHAINED_TX */
+				#if( ipconfigTCP_FUSED_CHECKSUM != 0 ) && ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+				{
+					( void ) uxStreamBufferPeekChecksum( pxStream, uxOffset + ( size_t ) ulSent, pucEthernetBuffer + uxHeaderLength, ( size_t ) ulDataLen,
+						&( pxSocket->u.xTCP.usTxSummedData ) );
+				}
+				#else
+				{
+					( void ) uxStreamBufferGet( pxStream, uxOffset + ( size_t ) ulSent, pucEthernetBuffer + uxHeaderLength, ( size_t ) ulDataLen, pdTRUE );
+				}
+				#endif
+
+				#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+				{
+					pxTCPPacket->xIPHeader.usHeaderChecksum = usGenerateChecksum( 0UL, ( uint8_t * ) &( pxTCPPacket->xIPHeader.ucVersionHeaderLength ), ipSIZE_OF_IPv4_HEADER );
+					pxTCPPacket->xIPHeader.usHeaderChecksum = ~FreeRTOS_htons( pxTCPPacket->xIPHeader.usHeaderChecksum );
+
+					#if( ipconfigTCP_FUSED_CHECKSUM != 0 )
+					{
+						/* The payload has been summed while copying or chaining
+						it, only the headers need to be summed. */
+						usGenerateProtocolChecksumPartial( pucEthernetBuffer, pdTRUE, ( size_t ) ulDataLen, pxSocket->u.xTCP.usTxSummedData );
+					}
+					#else
+					{
+						usGenerateProtocolChecksum( pucEthernetBuffer, pdTRUE );
+					}
+					#endif
+
+					if( pxTCPPacket->xTCPHeader.usChecksum == 0x00u )
+					{
+						pxTCPPacket->xTCPHeader.usChecksum = 0xffffU;
+					}
+				}
+				#endif /* ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM */
+
+				#if defined( ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+				{
+					if( pxNetworkBuffer->xDataLength < ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+					{
+						memset( pucEthernetBuffer + pxNetworkBuffer->xDataLength, '\0', ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES - pxNetworkBuffer->xDataLength );
+						pxNetworkBuffer->xDataLength = ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES;
+					}
+				}
+				#endif
 
-				if( ( pxTCPPacket->xTCPHeader.ucTCPFlags & ( uint8_t ) ipTCP_FLAG_FIN ) != 0u )
+				#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
 				{
-					/* Suppress FIN in case this packet carries earlier data to be
-					retransmitted. */
-					uint32_t ulDataLen = ( uint32_t ) ( ulLen - ( ipSIZE_OF_TCP_HEADER + ipSIZE_OF_IPv4_HEADER ) );
-					if( ( pxTCPWindow->ulOurSequenceNumber + ulDataLen ) != pxTCPWindow->tx.ulFINSequenceNumber )
+					/* The payload fragments are not stored in this buffer. */
+					pxNetworkBuffer->xDataLength -= uxNetworkBufferChainLength( pxNetworkBuffer->pxNextFragment );
+					xNetworkInterfaceOutputChain( pxNetworkBuffer, ipconfigZERO_COPY_TX_DRIVER );
+
+					#if( ipconfigZERO_COPY_TX_DRIVER == 0 )
 					{
-						pxTCPPacket->xTCPHeader.ucTCPFlags &= ( ( uint8_t ) ~ipTCP_FLAG_FIN );
-						FreeRTOS_debug_printf( ( "Suppress FIN for %lu + %lu < %lu\n",
-							pxTCPWindow->ulOurSequenceNumber - pxTCPWindow->tx.ulFirstSequenceNumber,
-							ulDataLen,
-							pxTCPWindow->tx.ulFINSequenceNumber - pxTCPWindow->tx.ulFirstSequenceNumber ) );
+						pxNetworkBuffer->pxNextFragment = NULL;
 					}
+					#endif
+				}
+				#else
+				{
+					xIPOutputBatchFrame( pxNetworkBuffer, ipconfigZERO_COPY_TX_DRIVER );
 				}
+				#endif /* ipconfigUSE_CHAINED_BUFFERS */
+
+				/* Like after sending a packet with prvTCPPrepareSend(). */
+				pxTCPWindow->ulOurSequenceNumber = ulSequenceNumber + ulSent;
+
+				lResult += ( int32_t ) ( ( uint32_t ) ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER ) + ulDataLen );
+				ulSent += ulDataLen;
+			}
+
+			#if( ipconfigTCP_FUSED_CHECKSUM != 0 )
+			{
+				pxSocket->u.xTCP.usTxSummedLength = 0u;
 			}
+			#endif
+		}
+
+		return lResult;
+	}
+
+#endif /* tcpLARGE_SEND */
+/*-----------------------------------------------------------*/
+
+/*
+ * Fill in the headers of a packet that will be sent to the peer: the window
+ * size, the sequence and acknowledge numbers, the addresses and the ports.
+ * 'ulLen' is the length of the IP packet.
+ */
+static void prvTCPSetHeaders( FreeRTOS_Socket_t *pxSocket, TCPPacket_t *pxTCPPacket, uint32_t ulLen )
+{
+IPHeader_t *pxIPHeader = &( pxTCPPacket->xIPHeader );
+EthernetHeader_t *pxEthernetHeader = &( pxTCPPacket->xEthernetHeader );
+uint32_t ulFrontSpace, ulSpace, ulSourceAddress, ulWinSize;
+TCPWindow_t *pxTCPWindow;
+
+	/* Fill the packet, using hton translations. */
+	if( pxSocket != NULL )
+	{
+		/* Calculate the space in the RX buffer in order to advertise the
+		size of this socket's reception window. */
+		pxTCPWindow = &( pxSocket->u.xTCP.xTCPWindow );
 
-			/* Tell which sequence number is expected next time */
-			pxTCPPacket->xTCPHeader.ulAckNr = FreeRTOS_htonl( pxTCPWindow->rx.ulCurrentSequenceNumber );
+		if( pxSocket->u.xTCP.rxStream != NULL )
+		{
+			/* An RX stream was created already, see how much space is
+			available. */
+			ulFrontSpace = ( uint32_t ) uxStreamBufferFrontSpace( pxSocket->u.xTCP.rxStream );
 		}
 		else
 		{
-			/* Sending data without a socket, probably replying with a RST flag
-			Just swap the two sequence numbers. */
-			vFlip_32( pxTCPPacket->xTCPHeader.ulSequenceNumber, pxTCPPacket->xTCPHeader.ulAckNr );
+			/* No RX stream has been created, the full stream size is
+			available. */
+			ulFrontSpace = ( uint32_t ) pxSocket->u.xTCP.uxRxStreamSize;
 		}
 
-		pxIPHeader->ucTimeToLive           = ( uint8_t ) ipconfigTCP_TIME_TO_LIVE;
-		pxIPHeader->usLength               = FreeRTOS_htons( ulLen );
-		if( ( pxSocket == NULL ) || ( *ipLOCAL_IP_ADDRESS_POINTER == 0ul ) )
+		/* Take the minimum of the RX buffer space and the RX window size. */
+		ulSpace = FreeRTOS_min_uint32( pxSocket->u.xTCP.ulRxCurWinSize, pxTCPWindow->xSize.ulRxWindowLength );
+
+		if( ( pxSocket->u.xTCP.bits.bLowWater != pdFALSE_UNSIGNED ) || ( pxSocket->u.xTCP.bits.bRxStopped != pdFALSE_UNSIGNED ) )
 		{
-			/* When pxSocket is NULL, this function is called by prvTCPSendReset()
-			and the IP-addresses must be swapped.
-			Also swap the IP-addresses in case the IP-tack doesn't have an
-			IP-address yet, i.e. when ( *ipLOCAL_IP_ADDRESS_POINTER == 0ul ). */
-			ulSourceAddress = pxIPHeader->ulDestinationIPAddress;
+			/* The low-water mark was reached, meaning there was little
+			space left.  The socket will wait until the application has read
+			or flushed the incoming data, and 'zero-window' will be
+			advertised. */
+			ulSpace = 0u;
 		}
-		else
+
+		/* If possible, advertise an RX window size of at least 1 MSS, otherwise
+		the peer might start 'zero window probing', i.e. sending small packets
+		(1, 2, 4, 8... bytes). */
+		if( ( ulSpace < pxSocket->u.xTCP.usCurMSS ) && ( ulFrontSpace >= pxSocket->u.xTCP.usCurMSS ) )
 		{
-			ulSourceAddress = *ipLOCAL_IP_ADDRESS_POINTER;
+			ulSpace = pxSocket->u.xTCP.usCurMSS;
 		}
-		pxIPHeader->ulDestinationIPAddress = pxIPHeader->ulSourceIPAddress;
-		pxIPHeader->ulSourceIPAddress = ulSourceAddress;
-		vFlip_16( pxTCPPacket->xTCPHeader.usSourcePort, pxTCPPacket->xTCPHeader.usDestinationPort );
-
-		/* Just an increasing number. */
-		pxIPHeader->usIdentification = FreeRTOS_htons( usPacketIdentifier );
-		usPacketIdentifier++;
-		pxIPHeader->usFragmentOffset = 0u;
 
-		#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+		/* Avoid overflow of the 16-bit win field. */
+		ulWinSize = ( ulSpace >> pxSocket->u.xTCP.ucMyWinScaleFactor );
+		if( ulWinSize > 0xfffcUL )
 		{
-			/* calculate the IP header checksum, in case the driver won't do that. */
-			pxIPHeader->usHeaderChecksum = 0x00u;
-			pxIPHeader->usHeaderChecksum = usGenerateChecksum( 0UL, ( uint8_t * ) &( pxIPHeader->ucVersionHeaderLength ), ipSIZE_OF_IPv4_HEADER );
-			pxIPHeader->usHeaderChecksum = ~FreeRTOS_htons( pxIPHeader->usHeaderChecksum );
+			ulWinSize = 0xfffcUL;
+		}
 
-			/* calculate the TCP checksum for an outgoing packet. */
-			usGenerateProtocolChecksum( (uint8_t*)pxTCPPacket, pdTRUE );
+		pxTCPPacket->xTCPHeader.usWindow = FreeRTOS_htons( ( uint16_t ) ulWinSize );
 
-			/* A calculated checksum of 0 must be inverted as 0 means the checksum
-			is disabled. */
-			if( pxTCPPacket->xTCPHeader.usChecksum == 0x00u )
+		#if( ipconfigHAS_DEBUG_PRINTF != 0 )
+		{
+			if( ipconfigTCP_MAY_LOG_PORT( pxSocket->usLocalPort ) != pdFALSE )
 			{
-				pxTCPPacket->xTCPHeader.usChecksum = 0xffffU;
-			}
-		}
-		#endif
+				if( ( xTCPWindowLoggingLevel != 0 ) && ( pxSocket->u.xTCP.bits.bWinChange != pdFALSE_UNSIGNED ) )
+				{
+				size_t uxFrontSpace;
 
-	#if( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
-		pxNetworkBuffer->pxNextBuffer = NULL;
-	#endif
+					if(pxSocket->u.xTCP.rxStream != NULL)
+					{
+						uxFrontSpace =  uxStreamBufferFrontSpace( pxSocket->u.xTCP.rxStream ) ;
+					}
+					else
+					{
+						uxFrontSpace = 0u;
+					}
 
-		/* Important: tell NIC driver how many bytes must be sent. */
-		pxNetworkBuffer->xDataLength = ulLen + ipSIZE_OF_ETH_HEADER;
+					FreeRTOS_debug_printf( ( "%s: %lxip:%u: [%lu < %lu] winSize %ld\n",
+					pxSocket->u.xTCP.bits.bLowWater ? "STOP" : "GO ",
+						pxSocket->u.xTCP.ulRemoteIP,
+						pxSocket->u.xTCP.usRemotePort,
+						pxSocket->u.xTCP.bits.bLowWater ? pxSocket->u.xTCP.uxLittleSpace : uxFrontSpace, pxSocket->u.xTCP.uxEnoughSpace,
+						(int32_t) ( pxTCPWindow->rx.ulHighestSequenceNumber - pxTCPWindow->rx.ulCurrentSequenceNumber ) ) );
+				}
+			}
+		}
+		#endif /* ipconfigHAS_DEBUG_PRINTF != 0 */
 
-		/* Fill in the destination MAC addresses. */
-		memcpy( ( void * ) &( pxEthernetHeader->xDestinationAddress ), ( void * ) &( pxEthernetHeader->xSourceAddress ),
-			sizeof( pxEthernetHeader->xDestinationAddress ) );
+		/* The new window size has been advertised, switch off the flag. */
+		pxSocket->u.xTCP.bits.bWinChange = pdFALSE_UNSIGNED;
 
-		/* The source MAC addresses is fixed to 'ipLOCAL_MAC_ADDRESS'. */
-		memcpy( ( void * ) &( pxEthernetHeader->xSourceAddress) , ( void * ) ipLOCAL_MAC_ADDRESS, ( size_t ) ipMAC_ADDRESS_LENGTH_BYTES );
+		/* Later on, when deciding to delay an ACK, a precise estimate is needed
+		of the free RX space.  At this moment, 'ulHighestRxAllowed' would be the
+		highest sequence number minus 1 that the socket will accept. */
+		pxSocket->u.xTCP.ulHighestRxAllowed = pxTCPWindow->rx.ulCurrentSequenceNumber + ulSpace;
 
-		#if defined( ipconfigETHERNET_MINIMUM_PACKET_BYTES )
-		{
+		#if( ipconfigTCP_KEEP_ALIVE == 1 )
+			if( pxSocket->u.xTCP.bits.bSendKeepAlive != pdFALSE_UNSIGNED )
+			{
+				/* Sending a keep-alive packet, send the current sequence number
+				minus 1, which will	be recognised as a keep-alive packet an
+				responded to by acknowledging the last byte. */
+				pxSocket->u.xTCP.bits.bSendKeepAlive = pdFALSE_UNSIGNED;
+				pxSocket->u.xTCP.bits.bWaitKeepAlive = pdTRUE_UNSIGNED;
+
+				pxTCPPacket->xTCPHeader.ulSequenceNumber = pxSocket->u.xTCP.xTCPWindow.ulOurSequenceNumber - 1UL;
+				pxTCPPacket->xTCPHeader.ulSequenceNumber = FreeRTOS_htonl( pxTCPPacket->xTCPHeader.ulSequenceNumber );
+			}
+			else
+		#endif
+		{
+			pxTCPPacket->xTCPHeader.ulSequenceNumber = FreeRTOS_htonl( pxSocket->u.xTCP.xTCPWindow.ulOurSequenceNumber );
+
+			if( ( pxTCPPacket->xTCPHeader.ucTCPFlags & ( uint8_t ) ipTCP_FLAG_FIN ) != 0u )
+			{
+				/* Suppress FIN in case this packet carries earlier data to be
+				retransmitted. */
+				uint32_t ulDataLen = ( uint32_t ) ( ulLen - ( ipSIZE_OF_TCP_HEADER + ipSIZE_OF_IPv4_HEADER ) );
+				if( ( pxTCPWindow->ulOurSequenceNumber + ulDataLen ) != pxTCPWindow->tx.ulFINSequenceNumber )
+				{
+					pxTCPPacket->xTCPHeader.ucTCPFlags &= ( ( uint8_t ) ~ipTCP_FLAG_FIN );
+					FreeRTOS_debug_printf( ( "Suppress FIN for %lu + %lu < %lu\n",
+						pxTCPWindow->ulOurSequenceNumber - pxTCPWindow->tx.ulFirstSequenceNumber,
+						ulDataLen,
+						pxTCPWindow->tx.ulFINSequenceNumber - pxTCPWindow->tx.ulFirstSequenceNumber ) );
+				}
+			}
+		}
+
+		/* Tell which sequence number is expected next time */
+		pxTCPPacket->xTCPHeader.ulAckNr = FreeRTOS_htonl( pxTCPWindow->rx.ulCurrentSequenceNumber );
+	}
+	else
+	{
+		/* Sending data without a socket, probably replying with a RST flag
+		Just swap the two sequence numbers. */
+		vFlip_32( pxTCPPacket->xTCPHeader.ulSequenceNumber, pxTCPPacket->xTCPHeader.ulAckNr );
+	}
+
+	pxIPHeader->ucTimeToLive           = ( uint8_t ) ipconfigTCP_TIME_TO_LIVE;
+	pxIPHeader->usLength               = FreeRTOS_htons( ulLen );
+	if( ( pxSocket == NULL ) || ( *ipLOCAL_IP_ADDRESS_POINTER == 0ul ) )
+	{
+		/* When pxSocket is NULL, this function is called by prvTCPSendReset()
+		and the IP-addresses must be swapped.
+		Also swap the IP-addresses in case the IP-tack doesn't have an
+		IP-address yet, i.e. when ( *ipLOCAL_IP_ADDRESS_POINTER == 0ul ). */
+		ulSourceAddress = pxIPHeader->ulDestinationIPAddress;
+	}
+	else
+	{
+		ulSourceAddress = *ipLOCAL_IP_ADDRESS_POINTER;
+	}
+	pxIPHeader->ulDestinationIPAddress = pxIPHeader->ulSourceIPAddress;
+	pxIPHeader->ulSourceIPAddress = ulSourceAddress;
+	vFlip_16( pxTCPPacket->xTCPHeader.usSourcePort, pxTCPPacket->xTCPHeader.usDestinationPort );
+
+	/* Just an increasing number. */
+	pxIPHeader->usIdentification = FreeRTOS_htons( usPacketIdentifier );
+	usPacketIdentifier++;
+	pxIPHeader->usFragmentOffset = 0u;
+
+	/* Fill in the destination MAC addresses. */
+	memcpy( ( void * ) &( pxEthernetHeader->xDestinationAddress ), ( void * ) &( pxEthernetHeader->xSourceAddress ),
+		sizeof( pxEthernetHeader->xDestinationAddress ) );
+
+	/* The source MAC addresses is fixed to 'ipLOCAL_MAC_ADDRESS'. */
+	memcpy( ( void * ) &( pxEthernetHeader->xSourceAddress) , ( void * ) ipLOCAL_MAC_ADDRESS, ( size_t ) ipMAC_ADDRESS_LENGTH_BYTES );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Return (or send) a packet the the peer.  The data is stored in pxBuffer,
+ * which may either point to a real network buffer or to a TCP socket field
+ * called 'xTCP.xPacket'.   A temporary xNetworkBuffer will be used to pass
+ * the data to the NIC.
+ */
+static void prvTCPReturnPacket( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer, uint32_t ulLen, BaseType_t xReleaseAfterSend )
+{
+TCPPacket_t * pxTCPPacket;
+IPHeader_t *pxIPHeader;
+EthernetHeader_t *pxEthernetHeader;
+NetworkBufferDescriptor_t xTempBuffer;
+/* For sending, a pseudo network buffer will be used, as explained above. */
+
+	if( pxNetworkBuffer == NULL )
+	{
+		pxNetworkBuffer = &xTempBuffer;
+
+		#if( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+		{
+			xTempBuffer.pxNextBuffer = NULL;
+		}
+		#endif
+		#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+		{
+			xTempBuffer.pxNextFragment = NULL;
+		}
+		#endif
+		xTempBuffer.pucEthernetBuffer = pxSocket->u.xTCP.xPacket.u.ucLastPacket;
+		xTempBuffer.xDataLength = sizeof( pxSocket->u.xTCP.xPacket.u.ucLastPacket );
+		xReleaseAfterSend = pdFALSE;
+	}
+
+	#if( ipconfigZERO_COPY_TX_DRIVER != 0 )
+	{
+		if( xReleaseAfterSend == pdFALSE )
+		{
+			pxNetworkBuffer = pxDuplicateNetworkBufferWithDescriptor( pxNetworkBuffer, ( BaseType_t ) pxNetworkBuffer->xDataLength );
+			if( pxNetworkBuffer == NULL )
+			{
+				FreeRTOS_debug_printf( ( "prvTCPReturnPacket: duplicate failed\n" ) );
+			}
+			xReleaseAfterSend = pdTRUE;
+		}
+	}
+	#endif /* ipconfigZERO_COPY_TX_DRIVER */
+
+	if( pxNetworkBuffer != NULL )
+	{
+		pxTCPPacket = ( TCPPacket_t * ) ( pxNetworkBuffer->pucEthernetBuffer );
+		pxIPHeader = &pxTCPPacket->xIPHeader;
+		pxEthernetHeader = &pxTCPPacket->xEthernetHeader;
+
+		/* Fill the headers, using hton translations. */
+		prvTCPSetHeaders( pxSocket, pxTCPPacket, ulLen );
+
+		#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+		{
+			/* calculate the IP header checksum, in case the driver won't do that. */
+			pxIPHeader->usHeaderChecksum = 0x00u;
+			pxIPHeader->usHeaderChecksum = usGenerateChecksum( 0UL, ( uint8_t * ) &( pxIPHeader->ucVersionHeaderLength ), ipSIZE_OF_IPv4_HEADER );
+			pxIPHeader->usHeaderChecksum = ~FreeRTOS_htons( pxIPHeader->usHeaderChecksum );
+
+			/* calculate the TCP checksum for an outgoing packet. */
+			#if( ipconfigTCP_FUSED_CHECKSUM != 0 )
+			{
+			uint32_t ulDataLen = 0ul;
+			uint32_t ulHeaderLen = ( uint32_t ) ( ipSIZE_OF_IPv4_HEADER + ( ( pxTCPPacket->xTCPHeader.ucTCPOffset & VALID_BITS_IN_TCP_OFFSET_BYTE ) >> 2 ) );
+
+				if( ulLen > ulHeaderLen )
+				{
+					ulDataLen = ulLen - ulHeaderLen;
+				}
+
+				if( ( pxSocket != NULL ) && ( pxSocket->u.xTCP.usTxSummedLength != 0u ) &&
+					( ( uint32_t ) pxSocket->u.xTCP.usTxSummedLength == ulDataLen ) )
+				{
+					/* The payload was summed by prvTCPPrepareSend() while it
+					was copied, only the headers need to be summed. */
+					usGenerateProtocolChecksumPartial( ( uint8_t * ) pxTCPPacket, pdTRUE, ( size_t ) ulDataLen, pxSocket->u.xTCP.usTxSummedData );
+				}
+				else
+				{
+					usGenerateProtocolChecksum( (uint8_t*)pxTCPPacket, pdTRUE );
+				}
+
+				if( pxSocket != NULL )
+				{
+					pxSocket->u.xTCP.usTxSummedLength = 0u;
+				}
+			}
+			#else
+			{
+				usGenerateProtocolChecksum( (uint8_t*)pxTCPPacket, pdTRUE );
+			}
+			#endif /* ipconfigTCP_FUSED_CHECKSUM */
+
+			/* A calculated checksum of 0 must be inverted as 0 means the checksum
+			is disabled. */
+			if( pxTCPPacket->xTCPHeader.usChecksum == 0x00u )
+			{
+				pxTCPPacket->xTCPHeader.usChecksum = 0xffffU;
+			}
+		}
+		#endif
+
+	#if( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
+		pxNetworkBuffer->pxNextBuffer = NULL;
+	#endif
+
+		/* Important: tell NIC driver how many bytes must be sent. */
+		pxNetworkBuffer->xDataLength = ulLen + ipSIZE_OF_ETH_HEADER;
+
+		#if defined( ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+		{
 			if( pxNetworkBuffer->xDataLength < ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES )
 			{
 			BaseType_t xIndex;
@@ -964,7 +1451,26 @@ NetworkBufferDescriptor_t xTempBuffer;
 		#endif
 
 		/* Send! */
-		xNetworkInterfaceOutput( pxNetworkBuffer, xReleaseAfterSend );
+		#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+		{
+		size_t uxFragmentLength = uxNetworkBufferChainLength( pxNetworkBuffer->pxNextFragment );
+
+			/* The payload fragments are not stored in this buffer. */
+			pxNetworkBuffer->xDataLength -= uxFragmentLength;
+			xNetworkInterfaceOutputChain( pxNetworkBuffer, xReleaseAfterSend );
+
+			if( xReleaseAfterSend == pdFALSE )
+			{
+				/* The fragments were only valid during the call. */
+				pxNetworkBuffer->pxNextFragment = NULL;
+				pxNetworkBuffer->xDataLength += uxFragmentLength;
+			}
+		}
+		#else
+		{
+			xIPOutputBatchFrame( pxNetworkBuffer, xReleaseAfterSend );
+		}
+		#endif /* ipconfigUSE_CHAINED_BUFFERS */
 
 		if( xReleaseAfterSend == pdFALSE )
 		{
@@ -1302,13 +1808,30 @@ UBaseType_t uxNewMSS;
 					/* len should be 0 by now. */
 				}
 				#if	ipconfigUSE_TCP_TIMESTAMPS == 1
-					else if( pucPtr[0] == TCP_OPT_TIMESTAMP )
+					else if( ( pucPtr[0] == TCP_OPT_TIMESTAMP ) && ( len == TCP_OPT_TIMESTAMP_LEN ) )
 					{
-						len -= 2;	/* Skip option and length byte. */
-						pucPtr += 2;
-						pxSocket->u.xTCP.xTCPWindow.u.bits.bTimeStamps = pdTRUE_UNSIGNED;
-						pxSocket->u.xTCP.xTCPWindow.rx.ulTimeStamp = ulChar2u32( pucPtr );
-						pxSocket->u.xTCP.xTCPWindow.tx.ulTimeStamp = ulChar2u32( pucPtr + 4 );
+					uint32_t ulTSValue = ulChar2u32( pucPtr + 2 );
+
+						if( ( ( pxTCPHeader->ucTCPFlags & ipTCP_FLAG_SYN ) != 0u ) && ( pxSocket->u.xTCP.ucTCPState < eESTABLISHED ) )
+						{
+							/* The peer's SYN carries time-stamps: they will be
+							used in both directions. */
+							pxTCPWindow->u.bits.bTimeStamps = pdTRUE_UNSIGNED;
+							pxTCPWindow->rx.ulTimeStamp = ulTSValue;
+						}
+						else if( ( int32_t ) ( ulTSValue - pxTCPWindow->rx.ulTimeStamp ) >= 0 )
+						{
+							/* Remember the most recent time-stamp of the peer,
+							it will be echoed in every segment sent. */
+							pxTCPWindow->rx.ulTimeStamp = ulTSValue;
+						}
+
+						if( pxTCPWindow->u.bits.bTimeStamps != pdFALSE_UNSIGNED )
+						{
+							/* The echoed time-stamp, it will give a RTT sample
+							when this segment acknowledges new data. */
+							pxTCPWindow->tx.ulTimeStamp = ulChar2u32( pucPtr + 6 );
+						}
 					}
 				#endif	/* ipconfigUSE_TCP_TIMESTAMPS == 1 */
 			}
@@ -1394,10 +1917,12 @@ uint16_t usMSS = pxSocket->u.xTCP.usInitMSS;
 		#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
 			if( pxSocket->u.xTCP.xTCPWindow.u.bits.bTimeStamps )
 			{
-				uxOptionsLength += prvTCPSetTimeStamp( uxOptionsLength, pxSocket, &pxTCPPacket->xTCPHeader );
+				/* SACK-Permitted takes the place of the 2 NOP's in front of
+				the time-stamps option, 12 bytes for both. */
+				prvTCPSetTimeStamp( ( BaseType_t ) uxOptionsLength, pxSocket, &pxTCPPacket->xTCPHeader );
 				pxTCPHeader->ucOptdata[ uxOptionsLength + 0 ] = TCP_OPT_SACK_P;	/* 4: Sack-Permitted Option. */
 				pxTCPHeader->ucOptdata[ uxOptionsLength + 1 ] = 2u;
-				uxOptionsLength += 2u;
+				uxOptionsLength += winTIMESTAMP_OPTION_LENGTH;
 			}
 			else
 		#endif
@@ -1683,6 +2208,60 @@ BaseType_t xResize;
 }
 /*-----------------------------------------------------------*/
 
+#if( tcpCHAINED_TX != 0 )
+
+	static BaseType_t prvTCPChainPayload( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer,
+		size_t uxOffset, int32_t lDataLen )
+	{
+	StreamBuffer_t *pxStream = pxSocket->u.xTCP.txStream;
+	uint8_t *pucFirst;
+	size_t uxFirst, uxCount;
+	BaseType_t xResult = pdFALSE;
+
+		uxCount = uxStreamBufferPeekFragments( pxStream, uxOffset, ( size_t ) lDataLen, &pucFirst, &uxFirst );
+
+		if( uxCount == ( size_t ) lDataLen )
+		{
+			xPayloadFragments[ 0 ].pucEthernetBuffer = pucFirst;
+			xPayloadFragments[ 0 ].xDataLength = uxFirst;
+			xPayloadFragments[ 0 ].pxNextFragment = NULL;
+
+			if( uxCount > uxFirst )
+			{
+				/* The data wraps around, the rest is found at the start. */
+				xPayloadFragments[ 1 ].pucEthernetBuffer = pxStream->ucArray;
+				xPayloadFragments[ 1 ].xDataLength = uxCount - uxFirst;
+				xPayloadFragments[ 1 ].pxNextFragment = NULL;
+				xPayloadFragments[ 0 ].pxNextFragment = &( xPayloadFragments[ 1 ] );
+			}
+
+			pxNetworkBuffer->pxNextFragment = &( xPayloadFragments[ 0 ] );
+
+			#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+			{
+			uint16_t usSum;
+
+				/* The payload is not in the network buffer, so its sum must be
+				passed to prvTCPReturnPacket(). */
+				usSum = usGenerateChecksum( 0UL, pucFirst, uxFirst );
+				if( uxCount > uxFirst )
+				{
+					usSum = usAddPartialChecksum( usSum, usGenerateChecksum( 0UL, pxStream->ucArray, uxCount - uxFirst ), uxFirst );
+				}
+				pxSocket->u.xTCP.usTxSummedData = usSum;
+				pxSocket->u.xTCP.usTxSummedLength = ( uint16_t ) uxCount;
+			}
+			#endif
+
+			xResult = pdTRUE;
+		}
+
+		return xResult;
+	}
+
+#endif /* tcpCHAINED_TX */
+/*-----------------------------------------------------------*/
+
 /*
  * Prepare an outgoing message, in case anything has to be sent.
  */
@@ -1714,6 +2293,28 @@ int32_t lStreamPos;
 	lStreamPos = 0;
 	pxTCPPacket->xTCPHeader.ucTCPFlags |= ipTCP_FLAG_ACK;
 
+	if( uxOptionsLength == 0u )
+	{
+		/* Leave space for the time-stamps option, if it is being used. */
+		uxOptionsLength = tcpTIMESTAMP_LENGTH( pxSocket );
+	}
+
+	#if( ipconfigTCP_FUSED_CHECKSUM != 0 )
+	{
+		/* No payload has been summed for this packet yet. */
+		pxSocket->u.xTCP.usTxSummedLength = 0u;
+	}
+	#endif
+
+	#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+	{
+		if( ( *ppxNetworkBuffer ) != NULL )
+		{
+			( *ppxNetworkBuffer )->pxNextFragment = NULL;
+		}
+	}
+	#endif
+
 	if( pxSocket->u.xTCP.txStream != NULL )
 	{
 		/* ulTCPWindowTxGet will return the amount of data which may be sent
@@ -1745,7 +2346,29 @@ int32_t lStreamPos;
 
 				/* Here data is copied from the txStream in 'peek' mode.  Only
 				when the packets are acked, the tail marker will be updated. */
-				ulDataGot = ( uint32_t ) uxStreamBufferGet( pxSocket->u.xTCP.txStream, uxOffset, pucSendData, ( size_t ) lDataLen, pdTRUE );
+				#if( tcpCHAINED_TX != 0 )
+				if( ( lDataLen >= tcpCHAINED_TX_MINIMUM_LENGTH ) &&
+					( prvTCPChainPayload( pxSocket, pxNewBuffer, uxOffset, lDataLen ) != pdFALSE ) )
+				{
+					/* The payload will be gathered from the txStream by the
+					driver. */
+					ulDataGot = ( uint32_t ) lDataLen;
+				}
+				else
+				#endif /* tcpCHAINED_TX */
+				#if( ipconfigTCP_FUSED_CHECKSUM != 0 ) && ( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+				{
+					/* Sum the payload while copying it, prvTCPReturnPacket()
+					will only have to sum the headers. */
+					ulDataGot = ( uint32_t ) uxStreamBufferPeekChecksum( pxSocket->u.xTCP.txStream, uxOffset, pucSendData, ( size_t ) lDataLen,
+						&( pxSocket->u.xTCP.usTxSummedData ) );
+					pxSocket->u.xTCP.usTxSummedLength = ( uint16_t ) ulDataGot;
+				}
+				#else
+				{
+					ulDataGot = ( uint32_t ) uxStreamBufferGet( pxSocket->u.xTCP.txStream, uxOffset, pucSendData, ( size_t ) lDataLen, pdTRUE );
+				}
+				#endif
 
 				#if( ipconfigHAS_DEBUG_PRINTF != 0 )
 				{
@@ -1863,13 +2486,10 @@ int32_t lStreamPos;
 
 		#if	ipconfigUSE_TCP_TIMESTAMPS == 1
 		{
-			if( xOptionsLength == 0 )
+			if( pxSocket->u.xTCP.xTCPWindow.u.bits.bTimeStamps )
 			{
-				if( pxSocket->u.xTCP.xTCPWindow.u.bits.bTimeStamps )
-				{
-					TCPPacket_t * pxTCPPacket = ( TCPPacket_t * ) ( pucEthernetBuffer );
-					xOptionsLength = prvTCPSetTimeStamp( 0, pxSocket, &pxTCPPacket->xTCPHeader );
-				}
+				/* Write the time-stamps now that the final buffer is known. */
+				prvTCPSetTimeStamp( ( BaseType_t ) ( uxOptionsLength - winTIMESTAMP_OPTION_LENGTH ), pxSocket, &pxTCPPacket->xTCPHeader );
 			}
 		}
 		#endif
@@ -1989,6 +2609,7 @@ uint8_t ucTCPFlags = pxTCPHeader->ucTCPFlags;
 TCPWindow_t *pxTCPWindow = &pxSocket->u.xTCP.xTCPWindow;
 BaseType_t xSendLength = 0;
 uint32_t ulAckNr = FreeRTOS_ntohl( pxTCPHeader->ulAckNr );
+UBaseType_t uxOptionsLength;
 
 	if( ( ucTCPFlags & ipTCP_FLAG_FIN ) != 0u )
 	{
@@ -2049,12 +2670,23 @@ uint32_t ulAckNr = FreeRTOS_ntohl( pxTCPHeader->ulAckNr );
 
 	pxTCPWindow->ulOurSequenceNumber = pxTCPWindow->tx.ulCurrentSequenceNumber;
 
+	uxOptionsLength = ( UBaseType_t ) pxTCPWindow->ucOptionLength;
+
+	#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+	{
+		if( pxTCPWindow->u.bits.bTimeStamps != pdFALSE_UNSIGNED )
+		{
+			uxOptionsLength += prvTCPSetTimeStamp( ( BaseType_t ) uxOptionsLength, pxSocket, pxTCPHeader );
+		}
+	}
+	#endif
+
 	if( pxTCPHeader->ucTCPFlags != 0u )
 	{
-		xSendLength = ( BaseType_t ) ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER + pxTCPWindow->ucOptionLength );
+		xSendLength = ( BaseType_t ) ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER + uxOptionsLength );
 	}
 
-	pxTCPHeader->ucTCPOffset = ( uint8_t ) ( ( ipSIZE_OF_TCP_HEADER + pxTCPWindow->ucOptionLength ) << 2 );
+	pxTCPHeader->ucTCPOffset = ( uint8_t ) ( ( ipSIZE_OF_TCP_HEADER + uxOptionsLength ) << 2 );
 
 	if( xTCPWindowLoggingLevel != 0 )
 	{
@@ -2077,17 +2709,16 @@ uint32_t ulAckNr = FreeRTOS_ntohl( pxTCPHeader->ulAckNr );
 	uint32_t ulTimes[2];
 	uint8_t *ucOptdata = &( pxTCPHeader->ucOptdata[ lOffset ] );
 
-		ulTimes[0]   = ( xTaskGetTickCount ( ) * 1000u ) / configTICK_RATE_HZ;
-		ulTimes[0]   = FreeRTOS_htonl( ulTimes[0] );
+		/* TSval is the local clock in ms, TSecr echoes the most recent TSval
+		received from the peer (RFC 7323). */
+		ulTimes[0]   = FreeRTOS_htonl( winTIMESTAMP_NOW() );
 		ulTimes[1]   = FreeRTOS_htonl( pxSocket->u.xTCP.xTCPWindow.rx.ulTimeStamp );
-		ucOptdata[0] = ( uint8_t ) TCP_OPT_TIMESTAMP;
-		ucOptdata[1] = ( uint8_t ) TCP_OPT_TIMESTAMP_LEN;
-		memcpy( &(ucOptdata[2] ), ulTimes, 8u );
-		ucOptdata[10] = ( uint8_t ) TCP_OPT_NOOP;
-		ucOptdata[11] = ( uint8_t ) TCP_OPT_NOOP;
-		/* Do not return the same timestamps 2 times. */
-		pxSocket->u.xTCP.xTCPWindow.rx.ulTimeStamp = 0ul;
-		return 12u;
+		ucOptdata[0] = ( uint8_t ) TCP_OPT_NOOP;
+		ucOptdata[1] = ( uint8_t ) TCP_OPT_NOOP;
+		ucOptdata[2] = ( uint8_t ) TCP_OPT_TIMESTAMP;
+		ucOptdata[3] = ( uint8_t ) TCP_OPT_TIMESTAMP_LEN;
+		memcpy( &(ucOptdata[4] ), ulTimes, 8u );
+		return winTIMESTAMP_OPTION_LENGTH;
 	}
 
 #endif
@@ -2202,7 +2833,28 @@ BaseType_t xResult = 0;
 			if the head marker in rxStream may be advanced,	only if lOffset == 0.
 			In case the low-water mark is reached, bLowWater will be set
 			"low-water" here stands for "little space". */
-			lStored = lTCPAddRxdata( pxSocket, ( uint32_t ) lOffset, pucRecvData, ulReceiveLength );
+			#if( ipconfigTCP_FUSED_CHECKSUM != 0 ) && ( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 )
+			{
+				if( ( lOffset == 0 ) && ( ( uint32_t ) pxSocket->u.xTCP.usRxStagedLength == ulReceiveLength ) )
+				{
+					/* prvTCPCheckRxChecksum() has copied the data to the head
+					of rxStream already, only the head must be advanced. */
+					pucRecvData = NULL;
+				}
+				pxSocket->u.xTCP.usRxStagedLength = 0u;
+			}
+			#endif
+			#if( tcpRX_COALESCE != 0 )
+			if( ( pucRecvData != NULL ) && ( pxRxMerged != NULL ) )
+			{
+				/* The payload is spread over several network buffers. */
+				lStored = prvTCPAddMergedRxdata( pxSocket, pxNetworkBuffer, ( uint32_t ) lOffset );
+			}
+			else
+			#endif /* tcpRX_COALESCE */
+			{
+				lStored = lTCPAddRxdata( pxSocket, ( uint32_t ) lOffset, pucRecvData, ulReceiveLength );
+			}
 
 			if( lStored != ( int32_t ) ulReceiveLength )
 			{
@@ -2240,6 +2892,50 @@ BaseType_t xResult = 0;
 }
 /*-----------------------------------------------------------*/
 
+#if( tcpRX_COALESCE != 0 )
+
+	static int32_t prvTCPAddMergedRxdata( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer, uint32_t ulOffset )
+	{
+	NetworkBufferDescriptor_t *pxMerged = pxRxMerged;
+	uint8_t *pucPartData;
+	uint32_t ulPartLength;
+	int32_t lStored = 0, lResult;
+
+		ulPartLength = ( uint32_t ) prvCheckRxData( pxNetworkBuffer, &pucPartData );
+
+		for( ;; )
+		{
+			lResult = lTCPAddRxdata( pxSocket, ( size_t ) ulOffset, pucPartData, ulPartLength );
+
+			if( lResult < 0 )
+			{
+				break;
+			}
+
+			lStored += lResult;
+
+			if( ( lResult != ( int32_t ) ulPartLength ) || ( pxMerged == NULL ) )
+			{
+				break;
+			}
+
+			/* Data stored at the head has advanced the head, data that came in
+			out-of-order is stored in front of it. */
+			if( ulOffset != 0ul )
+			{
+				ulOffset += ulPartLength;
+			}
+
+			ulPartLength = ( uint32_t ) prvCheckRxData( pxMerged, &pucPartData );
+			pxMerged = pxMerged->pxNextBuffer;
+		}
+
+		return lStored;
+	}
+
+#endif /* tcpRX_COALESCE */
+/*-----------------------------------------------------------*/
+
 /* Set the TCP options (if any) for the outgoing packet. */
 static UBaseType_t prvSetOptions( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer )
 {
@@ -2289,7 +2985,8 @@ UBaseType_t uxOptionsLength = pxTCPWindow->ucOptionLength;
 	{
 		if( pxSocket->u.xTCP.xTCPWindow.u.bits.bTimeStamps )
 		{
-			uxOptionsLength += prvTCPSetTimeStamp( xOptionsLength, pxSocket, pxTCPHeader );
+			uxOptionsLength += prvTCPSetTimeStamp( ( BaseType_t ) uxOptionsLength, pxSocket, pxTCPHeader );
+			pxTCPHeader->ucTCPOffset = ( uint8_t )( ( ipSIZE_OF_TCP_HEADER + uxOptionsLength ) << 2 );
 		}
 	}
 	#endif	/* ipconfigUSE_TCP_TIMESTAMPS == 1 */
@@ -2387,6 +3084,18 @@ BaseType_t xSendLength = 0;
 			pxSocket->u.xTCP.ucMyWinScaleFactor = 0;
 			pxSocket->u.xTCP.ucPeerWinScaleFactor = 0;
 		}
+
+		#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+		{
+			if( pxTCPWindow->u.bits.bTimeStamps != pdFALSE_UNSIGNED )
+			{
+				/* Every segment will carry the time-stamps option, make the
+				segments smaller so that the packets still fit in the MTU. */
+				pxTCPWindow->usMSS -= ( uint16_t ) winTIMESTAMP_OPTION_LENGTH;
+			}
+		}
+		#endif
+
 		/* This was the third step of connecting: SYN, SYN+ACK, ACK	so now the
 		connection is established. */
 		vTCPStateChange( pxSocket, eESTABLISHED );
@@ -2396,68 +3105,76 @@ BaseType_t xSendLength = 0;
 }
 /*-----------------------------------------------------------*/
 
-/*
- * prvHandleEstablished(): called from prvTCPHandleState()
- *
- * Called if the status is eESTABLISHED.  Data reception has been handled
- * earlier.  Here the ACK's from peer will be checked, and if a FIN is received,
- * the code will check if it may be accepted, i.e. if all expected data has been
- * completely received.
- */
-static BaseType_t prvHandleEstablished( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t **ppxNetworkBuffer,
-	uint32_t ulReceiveLength, UBaseType_t uxOptionsLength )
+static void prvTCPAckTxData( FreeRTOS_Socket_t *pxSocket, uint32_t ulAckNumber )
 {
-TCPPacket_t *pxTCPPacket = ( TCPPacket_t * ) ( (*ppxNetworkBuffer)->pucEthernetBuffer );
-TCPHeader_t *pxTCPHeader = &pxTCPPacket->xTCPHeader;
-TCPWindow_t *pxTCPWindow = &pxSocket->u.xTCP.xTCPWindow;
-uint8_t ucTCPFlags = pxTCPHeader->ucTCPFlags;
-uint32_t ulSequenceNumber = FreeRTOS_ntohl( pxTCPHeader->ulSequenceNumber ), ulCount;
-BaseType_t xSendLength = 0, xMayClose = pdFALSE, bRxComplete, bTxDone;
-int32_t lDistance, lSendResult;
+uint32_t ulCount;
 
-	/* Remember the window size the peer is advertising. */
-	pxSocket->u.xTCP.ulWindowSize = FreeRTOS_ntohs( pxTCPHeader->usWindow );
-	pxSocket->u.xTCP.ulWindowSize =
-		( pxSocket->u.xTCP.ulWindowSize << pxSocket->u.xTCP.ucPeerWinScaleFactor );
+	ulCount = ulTCPWindowTxAck( &( pxSocket->u.xTCP.xTCPWindow ), ulAckNumber );
 
-	if( ( ucTCPFlags & ( uint8_t ) ipTCP_FLAG_ACK ) != 0u )
+	/* ulTCPWindowTxAck() returns the number of bytes which have been acked,
+	starting at 'tx.ulCurrentSequenceNumber'.  Advance the tail pointer in
+	txStream. */
+	if( ( pxSocket->u.xTCP.txStream != NULL ) && ( ulCount > 0u ) )
 	{
-		ulCount = ulTCPWindowTxAck( pxTCPWindow, FreeRTOS_ntohl( pxTCPPacket->xTCPHeader.ulAckNr ) );
-
-		/* ulTCPWindowTxAck() returns the number of bytes which have been acked,
-		starting at 'tx.ulCurrentSequenceNumber'.  Advance the tail pointer in
-		txStream. */
-		if( ( pxSocket->u.xTCP.txStream != NULL ) && ( ulCount > 0u ) )
+		/* Just advancing the tail index, 'ulCount' bytes have been
+		confirmed, and because there is new space in the txStream, the
+		user/owner should be woken up. */
+		/* _HT_ : only in case the socket's waiting? */
+		if( uxStreamBufferGet( pxSocket->u.xTCP.txStream, 0u, NULL, ( size_t ) ulCount, pdFALSE ) != 0u )
 		{
-			/* Just advancing the tail index, 'ulCount' bytes have been
-			confirmed, and because there is new space in the txStream, the
-			user/owner should be woken up. */
-			/* _HT_ : only in case the socket's waiting? */
-			if( uxStreamBufferGet( pxSocket->u.xTCP.txStream, 0u, NULL, ( size_t ) ulCount, pdFALSE ) != 0u )
-			{
-				pxSocket->xEventBits |= eSOCKET_SEND;
+			pxSocket->xEventBits |= eSOCKET_SEND;
 
-				#if ipconfigSUPPORT_SELECT_FUNCTION == 1
+			#if ipconfigSUPPORT_SELECT_FUNCTION == 1
+			{
+				if( ( pxSocket->xSelectBits & eSELECT_WRITE ) != 0 )
 				{
-					if( ( pxSocket->xSelectBits & eSELECT_WRITE ) != 0 )
-					{
-						pxSocket->xEventBits |= ( eSELECT_WRITE << SOCKET_EVENT_BIT_COUNT );
-					}
+					pxSocket->xEventBits |= ( eSELECT_WRITE << SOCKET_EVENT_BIT_COUNT );
 				}
-				#endif
-				/* In case the socket owner has installed an OnSent handler,
-				call it now. */
-				#if( ipconfigUSE_CALLBACKS == 1 )
+			}
+			#endif
+			/* In case the socket owner has installed an OnSent handler,
+			call it now. */
+			#if( ipconfigUSE_CALLBACKS == 1 )
+			{
+				if( ipconfigIS_VALID_PROG_ADDRESS( pxSocket->u.xTCP.pxHandleSent ) )
 				{
-					if( ipconfigIS_VALID_PROG_ADDRESS( pxSocket->u.xTCP.pxHandleSent ) )
-					{
-						pxSocket->u.xTCP.pxHandleSent( (Socket_t *)pxSocket, ulCount );
-					}
+					pxSocket->u.xTCP.pxHandleSent( (Socket_t *)pxSocket, ulCount );
 				}
-				#endif /* ipconfigUSE_CALLBACKS == 1  */
 			}
+			#endif /* ipconfigUSE_CALLBACKS == 1  */
 		}
 	}
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * prvHandleEstablished(): called from prvTCPHandleState()
+ *
+ * Called if the status is eESTABLISHED.  Data reception has been handled
+ * earlier.  Here the ACK's from peer will be checked, and if a FIN is received,
+ * the code will check if it may be accepted, i.e. if all expected data has been
+ * completely received.
+ */
+static BaseType_t prvHandleEstablished( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t **ppxNetworkBuffer,
+	uint32_t ulReceiveLength, UBaseType_t uxOptionsLength )
+{
+TCPPacket_t *pxTCPPacket = ( TCPPacket_t * ) ( (*ppxNetworkBuffer)->pucEthernetBuffer );
+TCPHeader_t *pxTCPHeader = &pxTCPPacket->xTCPHeader;
+TCPWindow_t *pxTCPWindow = &pxSocket->u.xTCP.xTCPWindow;
+uint8_t ucTCPFlags = pxTCPHeader->ucTCPFlags;
+uint32_t ulSequenceNumber = FreeRTOS_ntohl( pxTCPHeader->ulSequenceNumber );
+BaseType_t xSendLength = 0, xMayClose = pdFALSE, bRxComplete, bTxDone;
+int32_t lDistance, lSendResult;
+
+	/* Remember the window size the peer is advertising. */
+	pxSocket->u.xTCP.ulWindowSize = FreeRTOS_ntohs( pxTCPHeader->usWindow );
+	pxSocket->u.xTCP.ulWindowSize =
+		( pxSocket->u.xTCP.ulWindowSize << pxSocket->u.xTCP.ucPeerWinScaleFactor );
+
+	if( ( ucTCPFlags & ( uint8_t ) ipTCP_FLAG_ACK ) != 0u )
+	{
+		prvTCPAckTxData( pxSocket, FreeRTOS_ntohl( pxTCPPacket->xTCPHeader.ulAckNr ) );
+	}
 
 	/* If this socket has a stream for transmission, add the data to the
 	outgoing segment(s). */
@@ -2539,7 +3256,7 @@ int32_t lDistance, lSendResult;
 		can not	send-out both TCP options and also a full packet. Sending
 		options (SACK) is always more urgent than sending data, which can be
 		sent later. */
-		if( uxOptionsLength == 0u )
+		if( uxOptionsLength == tcpTIMESTAMP_LENGTH( pxSocket ) )
 		{
 			/* prvTCPPrepareSend might allocate a bigger network buffer, if
 			necessary. */
@@ -2575,6 +3292,7 @@ int32_t lRxSpace;
 	#else
 		int32_t lMinLength;
 	#endif
+	BaseType_t xBelowAckCount = pdTRUE;
 #endif
 	pxSocket->u.xTCP.ulRxCurWinSize = pxTCPWindow->xSize.ulRxWindowLength -
 									 ( pxTCPWindow->rx.ulHighestSequenceNumber - pxTCPWindow->rx.ulCurrentSequenceNumber );
@@ -2603,6 +3321,16 @@ int32_t lRxSpace;
 		}
 		#endif /* ipconfigTCP_ACK_EARLIER_PACKET */
 
+		#if( ipconfigTCP_ACK_EVERY_N_SEGMENTS > 0 )
+		{
+			/* Not yet received N segments without an ACK. */
+			if( ( ( UBaseType_t ) pxSocket->u.xTCP.ucDelayedAcks + 1u ) >= ( UBaseType_t ) ipconfigTCP_ACK_EVERY_N_SEGMENTS )
+			{
+				xBelowAckCount = pdFALSE;
+			}
+		}
+		#endif /* ipconfigTCP_ACK_EVERY_N_SEGMENTS */
+
 		/* In case we're receiving data continuously, we might postpone sending
 		an ACK to gain performance. */
 		if( ( ulReceiveLength > 0 ) &&							/* Data was sent to this socket. */
@@ -2610,8 +3338,12 @@ int32_t lRxSpace;
 			( pxSocket->u.xTCP.bits.bFinSent == pdFALSE_UNSIGNED ) &&	/* Not in a closure phase. */
 			( xSendLength == ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER ) ) && /* No Tx data or options to be sent. */
 			( pxSocket->u.xTCP.ucTCPState == eESTABLISHED ) &&	/* Connection established. */
-			( pxTCPHeader->ucTCPFlags == ipTCP_FLAG_ACK ) )		/* There are no other flags than an ACK. */
+			( pxTCPHeader->ucTCPFlags == ipTCP_FLAG_ACK ) &&	/* There are no other flags than an ACK. */
+			( pxSocket->u.xTCP.bits.bQuickAck == pdFALSE_UNSIGNED ) &&	/* The user did not ask for immediate ACK's. */
+			( xBelowAckCount != pdFALSE ) )						/* Not yet received N segments without an ACK. */
 		{
+			pxSocket->u.xTCP.ucDelayedAcks++;
+
 			if( pxSocket->u.xTCP.pxAckMessage != *ppxNetworkBuffer )
 			{
 				/* There was still a delayed in queue, delete it. */
@@ -2651,6 +3383,8 @@ int32_t lRxSpace;
 		}
 		else if( pxSocket->u.xTCP.pxAckMessage != NULL )
 		{
+			pxSocket->u.xTCP.ucDelayedAcks = 0u;
+
 			/* As an ACK is not being delayed, remove any earlier delayed ACK
 			message. */
 			if( pxSocket->u.xTCP.pxAckMessage != *ppxNetworkBuffer )
@@ -2735,6 +3469,19 @@ TCPWindow_t *pxTCPWindow = &( pxSocket->u.xTCP.xTCPWindow );
 	pucRecvData will point to the first byte of the TCP payload. */
 	ulReceiveLength = ( uint32_t ) prvCheckRxData( *ppxNetworkBuffer, &pucRecvData );
 
+	#if( tcpRX_COALESCE != 0 )
+	{
+	NetworkBufferDescriptor_t *pxMerged;
+	uint8_t *pucMergedData;
+
+		/* The segments that were merged with this one continue its payload. */
+		for( pxMerged = pxRxMerged; pxMerged != NULL; pxMerged = pxMerged->pxNextBuffer )
+		{
+			ulReceiveLength += ( uint32_t ) prvCheckRxData( pxMerged, &pucMergedData );
+		}
+	}
+	#endif /* tcpRX_COALESCE */
+
 	if( pxSocket->u.xTCP.ucTCPState >= eESTABLISHED )
 	{
 		if ( pxTCPWindow->rx.ulCurrentSequenceNumber == ulSequenceNumber + 1u )
@@ -2925,6 +3672,182 @@ uint32_t ulMSS = ipconfigTCP_MSS;
 }
 /*-----------------------------------------------------------*/
 
+#if( ipconfigTCP_HEADER_PREDICTION != 0 )
+
+	static BaseType_t prvTCPHeaderPrediction( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t **ppxNetworkBuffer )
+	{
+	TCPPacket_t *pxTCPPacket = ( TCPPacket_t * ) ( ( *ppxNetworkBuffer )->pucEthernetBuffer );
+	TCPHeader_t *pxTCPHeader = &( pxTCPPacket->xTCPHeader );
+	TCPWindow_t *pxTCPWindow = &( pxSocket->u.xTCP.xTCPWindow );
+	uint8_t *pucRecvData = NULL;
+	uint8_t ucExpectedOffset;
+	uint32_t ulSequenceNumber, ulAckNumber = 0ul, ulReceiveLength = 0ul;
+	UBaseType_t uxOptionsLength;
+	BaseType_t xSendLength, xPredicted = pdFALSE;
+	int32_t lSendResult;
+
+		/* The prediction (Van Jacobson): in an established connection, the
+		next segment normally carries the next expected data, or it
+		acknowledges new data.  Anything else, like flags, options other than
+		time-stamps, or data stored out of order, is handled by
+		prvTCPHandleState(). */
+		ulSequenceNumber = FreeRTOS_ntohl( pxTCPHeader->ulSequenceNumber );
+		ucExpectedOffset = ( uint8_t ) ( ( ipSIZE_OF_TCP_HEADER + tcpTIMESTAMP_LENGTH( pxSocket ) ) << 2 );
+
+		if( ( pxSocket->u.xTCP.ucTCPState == eESTABLISHED ) &&
+			( ( pxTCPHeader->ucTCPFlags & tcpPREDICTION_FLAGS_MASK ) == ipTCP_FLAG_ACK ) &&
+			( ( pxTCPHeader->ucTCPOffset & TCP_OFFSET_LENGTH_BITS ) == ucExpectedOffset ) &&
+			( ulSequenceNumber == pxTCPWindow->rx.ulCurrentSequenceNumber ) &&
+			( winRX_RANGES_USED( pxTCPWindow ) == 0u ) &&
+			( pxSocket->u.xTCP.bits.bFinRecv == pdFALSE_UNSIGNED ) &&
+			( pxSocket->u.xTCP.bits.bFinSent == pdFALSE_UNSIGNED ) &&
+			( pxSocket->u.xTCP.bits.bFinAccepted == pdFALSE_UNSIGNED ) &&
+			( pxSocket->u.xTCP.bits.bMssChange == pdFALSE_UNSIGNED ) )
+		{
+			xPredicted = pdTRUE;
+		}
+
+		#if( tcpRX_COALESCE != 0 )
+		{
+			if( pxRxMerged != NULL )
+			{
+				/* Merged segments take the normal path. */
+				xPredicted = pdFALSE;
+			}
+		}
+		#endif
+
+		#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+		{
+			if( ( xPredicted != pdFALSE ) && tcpHAS_TIMESTAMPS( pxSocket ) )
+			{
+				/* The 12 bytes of options must be: NOP, NOP, TS. */
+				if( ( pxTCPHeader->ucOptdata[ 0 ] != TCP_OPT_NOOP ) ||
+					( pxTCPHeader->ucOptdata[ 1 ] != TCP_OPT_NOOP ) ||
+					( pxTCPHeader->ucOptdata[ 2 ] != TCP_OPT_TIMESTAMP ) ||
+					( pxTCPHeader->ucOptdata[ 3 ] != TCP_OPT_TIMESTAMP_LEN ) )
+				{
+					xPredicted = pdFALSE;
+				}
+			}
+		}
+		#endif
+
+		if( xPredicted != pdFALSE )
+		{
+			ulAckNumber = FreeRTOS_ntohl( pxTCPHeader->ulAckNr );
+			ulReceiveLength = ( uint32_t ) prvCheckRxData( *ppxNetworkBuffer, &pucRecvData );
+
+			if( ulReceiveLength == 0u )
+			{
+				/* A pure ACK, it must acknowledge data that has been sent
+				but not yet acknowledged. */
+				if( ( ( int32_t ) ( ulAckNumber - pxTCPWindow->tx.ulCurrentSequenceNumber ) <= 0 ) ||
+					( ( int32_t ) ( ulAckNumber - pxTCPWindow->tx.ulHighestSequenceNumber ) > 0 ) )
+				{
+					xPredicted = pdFALSE;
+				}
+			}
+			else if( ( ulAckNumber != pxTCPWindow->tx.ulCurrentSequenceNumber ) ||
+				( pxSocket->u.xTCP.rxStream == NULL ) ||
+				( ulReceiveLength > ( uint32_t ) uxStreamBufferGetSpace( pxSocket->u.xTCP.rxStream ) ) )
+			{
+				/* Data must acknowledge nothing new, and it must fit in the
+				existing rxStream. */
+				xPredicted = pdFALSE;
+			}
+		}
+
+		if( xPredicted != pdFALSE )
+		{
+			pxSocket->u.xTCP.ulWindowSize = ( ( uint32_t ) FreeRTOS_ntohs( pxTCPHeader->usWindow ) ) << pxSocket->u.xTCP.ucPeerWinScaleFactor;
+
+			#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+			{
+				if( tcpHAS_TIMESTAMPS( pxSocket ) )
+				{
+				uint32_t ulTSValue = ulChar2u32( pxTCPHeader->ucOptdata + 4 );
+
+					/* The same as what prvCheckOptions() does for an
+					established connection. */
+					if( ( int32_t ) ( ulTSValue - pxTCPWindow->rx.ulTimeStamp ) >= 0 )
+					{
+						pxTCPWindow->rx.ulTimeStamp = ulTSValue;
+					}
+
+					pxTCPWindow->tx.ulTimeStamp = ulChar2u32( pxTCPHeader->ucOptdata + 8 );
+				}
+			}
+			#endif
+
+			if( ulReceiveLength == 0u )
+			{
+				/* Free the acknowledged data and send what the window allows
+				now. */
+				ulPredictedAcks++;
+				prvTCPAckTxData( pxSocket, ulAckNumber );
+
+				if( pxSocket->u.xTCP.txStream != NULL )
+				{
+					prvTCPAddTxData( pxSocket );
+				}
+
+				pxTCPWindow->ulOurSequenceNumber = pxTCPWindow->tx.ulCurrentSequenceNumber;
+				prvTCPSendRepeated( pxSocket, ppxNetworkBuffer );
+			}
+			else
+			{
+				/* Pass the data to rxStream, and reply with an ACK which may
+				be delayed or carry data. */
+				ulPredictedData++;
+				pxTCPWindow->rx.ulHighestSequenceNumber = ulSequenceNumber + ulReceiveLength;
+
+				if( prvStoreRxData( pxSocket, pucRecvData, *ppxNetworkBuffer, ulReceiveLength ) == 0 )
+				{
+					uxOptionsLength = prvSetOptions( pxSocket, *ppxNetworkBuffer );
+					pxTCPHeader->ucTCPFlags = ipTCP_FLAG_ACK;
+					pxTCPHeader->ucTCPOffset = ( uint8_t ) ( ( ipSIZE_OF_TCP_HEADER + uxOptionsLength ) << 2 );
+					xSendLength = ( BaseType_t ) ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER + uxOptionsLength );
+
+					if( pxSocket->u.xTCP.txStream != NULL )
+					{
+						prvTCPAddTxData( pxSocket );
+					}
+
+					pxTCPWindow->ulOurSequenceNumber = pxTCPWindow->tx.ulCurrentSequenceNumber;
+					lSendResult = prvTCPPrepareSend( pxSocket, ppxNetworkBuffer, uxOptionsLength );
+
+					if( lSendResult > 0 )
+					{
+						xSendLength = ( BaseType_t ) lSendResult;
+					}
+
+					if( prvSendData( pxSocket, ppxNetworkBuffer, ulReceiveLength, xSendLength ) > 0 )
+					{
+						prvTCPSendRepeated( pxSocket, ppxNetworkBuffer );
+					}
+				}
+			}
+		}
+		else if( pxSocket->u.xTCP.ucTCPState == eESTABLISHED )
+		{
+			ulPredictionMissed++;
+		}
+
+		return xPredicted;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vGetTCPPredictionCounters( uint32_t *pulAcks, uint32_t *pulData, uint32_t *pulMissed )
+	{
+		*pulAcks = ulPredictedAcks;
+		*pulData = ulPredictedData;
+		*pulMissed = ulPredictionMissed;
+	}
+
+#endif /* ipconfigTCP_HEADER_PREDICTION */
+/*-----------------------------------------------------------*/
+
 /*
  *	FreeRTOS_TCP_IP has only 2 public functions, this is the second one:
  *	xProcessReceivedTCPPacket()
@@ -2946,11 +3869,31 @@ uint16_t xLocalPort = FreeRTOS_htons( pxTCPPacket->xTCPHeader.usDestinationPort
 uint32_t ulRemoteIP = FreeRTOS_htonl( pxTCPPacket->xIPHeader.ulSourceIPAddress );
 uint16_t xRemotePort = FreeRTOS_htons( pxTCPPacket->xTCPHeader.usSourcePort );
 BaseType_t xResult = pdPASS;
+#if( ipconfigTCP_SYN_COOKIES != 0 )
+	FreeRTOS_Socket_t *pxChild;
+#endif
+
+	#if( tcpRX_COALESCE != 0 )
+	{
+		/* The segments that follow this one, see prvCoalesceTCPSegments().  The
+		field is cleared because this buffer may be used to send a reply. */
+		pxRxMerged = pxNetworkBuffer->pxNextBuffer;
+		pxNetworkBuffer->pxNextBuffer = NULL;
+	}
+	#endif
 
 	/* Find the destination socket, and if not found: return a socket listing to
 	the destination PORT. */
 	pxSocket = ( FreeRTOS_Socket_t * ) pxTCPSocketLookup( ulLocalIP, xLocalPort, ulRemoteIP, xRemotePort );
 
+	#if( ipconfigTCP_FUSED_CHECKSUM != 0 ) && ( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 )
+	if( prvTCPCheckRxChecksum( pxSocket, pxNetworkBuffer ) == pdFAIL )
+	{
+		/* The TCP checksum is not correct, drop the packet silently. */
+		xResult = pdFAIL;
+	}
+	else
+	#endif
 	if( ( pxSocket == NULL ) || ( prvTCPSocketIsActive( ( UBaseType_t ) pxSocket->u.xTCP.ucTCPState ) == pdFALSE ) )
 	{
 		/* A TCP messages is received but either there is no socket with the
@@ -2983,6 +3926,16 @@ BaseType_t xResult = pdPASS;
 		{
 			/* The matching socket is in a listening state.  Test if the peer
 			has set the SYN flag. */
+			#if( ipconfigTCP_SYN_COOKIES != 0 )
+			if( ( ( ucTCPFlags & ( ipTCP_FLAG_FIN | ipTCP_FLAG_SYN | ipTCP_FLAG_RST | ipTCP_FLAG_ACK ) ) == ipTCP_FLAG_ACK ) &&
+				( ( pxChild = prvHandleSynCookie( pxSocket, pxNetworkBuffer ) ) != NULL ) )
+			{
+				/* The ACK completes a connection that was opened with a SYN
+				cookie.  It will be handled by the new socket. */
+				pxSocket = pxChild;
+			}
+			else
+			#endif /* ipconfigTCP_SYN_COOKIES */
 			if( ( ucTCPFlags & ipTCP_FLAG_CTRL ) != ipTCP_FLAG_SYN )
 			{
 				/* What happens: maybe after a reboot, a client doesn't know the
@@ -3053,37 +4006,52 @@ BaseType_t xResult = pdPASS;
 		socket. */
 		prvTCPTouchSocket( pxSocket );
 
-		/* Parse the TCP option(s), if present. */
-		/* _HT_ : if we're in the SYN phase, and peer does not send a MSS option,
-		then we MUST assume an MSS size of 536 bytes for backward compatibility. */
-
-		/* When there are no TCP options, the TCP offset equals 20 bytes, which is stored as
-		the number 5 (words) in the higher niblle of the TCP-offset byte. */
-		if( ( pxTCPPacket->xTCPHeader.ucTCPOffset & TCP_OFFSET_LENGTH_BITS ) > TCP_OFFSET_STANDARD_LENGTH )
+		#if( ipconfigTCP_HEADER_PREDICTION != 0 )
+		if( prvTCPHeaderPrediction( pxSocket, &pxNetworkBuffer ) == pdFALSE )
+		#endif
 		{
-			prvCheckOptions( pxSocket, pxNetworkBuffer );
-		}
+			/* Parse the TCP option(s), if present. */
+			/* _HT_ : if we're in the SYN phase, and peer does not send a MSS option,
+			then we MUST assume an MSS size of 536 bytes for backward compatibility. */
 
+			#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+			{
+				if( ( ( ucTCPFlags & ipTCP_FLAG_SYN ) != 0u ) && ( pxSocket->u.xTCP.ucTCPState < eESTABLISHED ) )
+				{
+					/* Time-stamps will only be used if this SYN carries them. */
+					pxSocket->u.xTCP.xTCPWindow.u.bits.bTimeStamps = pdFALSE_UNSIGNED;
+				}
+			}
+			#endif
+
+			/* When there are no TCP options, the TCP offset equals 20 bytes, which is stored as
+			the number 5 (words) in the higher niblle of the TCP-offset byte. */
+			if( ( pxTCPPacket->xTCPHeader.ucTCPOffset & TCP_OFFSET_LENGTH_BITS ) > TCP_OFFSET_STANDARD_LENGTH )
+			{
+				prvCheckOptions( pxSocket, pxNetworkBuffer );
+			}
 
-		#if( ipconfigUSE_TCP_WIN == 1 )
-		{
-			pxSocket->u.xTCP.ulWindowSize = FreeRTOS_ntohs( pxTCPPacket->xTCPHeader.usWindow );
-			pxSocket->u.xTCP.ulWindowSize =
-				( pxSocket->u.xTCP.ulWindowSize << pxSocket->u.xTCP.ucPeerWinScaleFactor );
-		}
-		#endif
 
-		/* In prvTCPHandleState() the incoming messages will be handled
-		depending on the current state of the connection. */
-		if( prvTCPHandleState( pxSocket, &pxNetworkBuffer ) > 0 )
-		{
-			/* prvTCPHandleState() has sent a message, see if there are more to
-			be transmitted. */
 			#if( ipconfigUSE_TCP_WIN == 1 )
 			{
-				prvTCPSendRepeated( pxSocket, &pxNetworkBuffer );
+				pxSocket->u.xTCP.ulWindowSize = FreeRTOS_ntohs( pxTCPPacket->xTCPHeader.usWindow );
+				pxSocket->u.xTCP.ulWindowSize =
+					( pxSocket->u.xTCP.ulWindowSize << pxSocket->u.xTCP.ucPeerWinScaleFactor );
+			}
+			#endif
+
+			/* In prvTCPHandleState() the incoming messages will be handled
+			depending on the current state of the connection. */
+			if( prvTCPHandleState( pxSocket, &pxNetworkBuffer ) > 0 )
+			{
+				/* prvTCPHandleState() has sent a message, see if there are more to
+				be transmitted. */
+				#if( ipconfigUSE_TCP_WIN == 1 )
+				{
+					prvTCPSendRepeated( pxSocket, &pxNetworkBuffer );
+				}
+				#endif /* ipconfigUSE_TCP_WIN */
 			}
-			#endif /* ipconfigUSE_TCP_WIN */
 		}
 
 		if( pxNetworkBuffer != NULL )
@@ -3101,11 +4069,136 @@ BaseType_t xResult = pdPASS;
 		xResult = pdPASS;
 	}
 
+	#if( tcpRX_COALESCE != 0 )
+	{
+		pxRxMerged = NULL;
+	}
+	#endif
+
 	/* pdPASS being returned means the buffer has been consumed. */
 	return xResult;
 }
 /*-----------------------------------------------------------*/
 
+#if( ipconfigTCP_FUSED_CHECKSUM != 0 ) && ( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 )
+
+	static BaseType_t prvTCPCheckRxChecksum( FreeRTOS_Socket_t *pxSocket, const NetworkBufferDescriptor_t *pxNetworkBuffer )
+	{
+	const TCPPacket_t *pxTCPPacket = ( const TCPPacket_t * ) ( pxNetworkBuffer->pucEthernetBuffer );
+	StreamBuffer_t *pxStream = NULL;
+	uint32_t ulLength, ulHeaderLength, ulDataLength = 0ul, ulMergedLength = 0ul;
+	uint16_t usChecksum, usDataSum;
+	#if( tcpRX_COALESCE != 0 )
+		NetworkBufferDescriptor_t *pxMerged;
+		uint8_t *pucMergedData;
+		uint32_t ulMergedPart;
+	#endif
+
+		if( ( pxTCPPacket->xIPHeader.ucVersionHeaderLength & 0x0Fu ) != ( uint8_t ) ( ipSIZE_OF_IPv4_HEADER >> 2 ) )
+		{
+			/* Packets with IP options have been checked by prvAllowIPPacket()
+			already, before the options were removed. */
+			return pdPASS;
+		}
+
+		ulLength = ( uint32_t ) FreeRTOS_ntohs( pxTCPPacket->xIPHeader.usLength );
+		ulHeaderLength = ( uint32_t ) ( ipSIZE_OF_IPv4_HEADER + ( ( pxTCPPacket->xTCPHeader.ucTCPOffset & VALID_BITS_IN_TCP_OFFSET_BYTE ) >> 2 ) );
+
+		if( ( ulLength > ulHeaderLength ) && ( ( ulLength + ipSIZE_OF_ETH_HEADER ) <= ( uint32_t ) pxNetworkBuffer->xDataLength ) )
+		{
+			ulDataLength = ulLength - ulHeaderLength;
+		}
+
+		#if( tcpRX_COALESCE != 0 )
+		{
+			for( pxMerged = pxRxMerged; pxMerged != NULL; pxMerged = pxMerged->pxNextBuffer )
+			{
+				ulMergedLength += ( uint32_t ) prvCheckRxData( pxMerged, &pucMergedData );
+			}
+		}
+		#endif
+
+		if( pxSocket != NULL )
+		{
+			pxSocket->u.xTCP.usRxStagedLength = 0u;
+
+			/* Only a plain in-order segment of a connected socket will be
+			copied, and only when no out-of-order data is stored in front of
+			uxHead, which a bad packet might overwrite. */
+			if( ( ulDataLength != 0ul ) &&
+				( pxSocket->u.xTCP.ucTCPState == eESTABLISHED ) &&
+				( ( pxTCPPacket->xTCPHeader.ucTCPFlags & ( ipTCP_FLAG_SYN | ipTCP_FLAG_RST | ipTCP_FLAG_URG ) ) == 0u ) &&
+				( FreeRTOS_ntohl( pxTCPPacket->xTCPHeader.ulSequenceNumber ) == pxSocket->u.xTCP.xTCPWindow.rx.ulCurrentSequenceNumber ) )
+			{
+				pxStream = pxSocket->u.xTCP.rxStream;
+			}
+
+			if( ( pxStream != NULL ) &&
+				( ( pxStream->uxFront != pxStream->uxHead ) || ( uxStreamBufferGetSpace( pxStream ) < ( size_t ) ( ulDataLength + ulMergedLength ) ) ) )
+			{
+				pxStream = NULL;
+			}
+
+			#if( ipconfigUSE_CALLBACKS == 1 )
+			{
+				/* lTCPAddRxdata() passes the data directly to an OnReceive
+				handler when rxStream is empty, there is no need to copy it. */
+				if( ( pxStream != NULL ) && ipconfigIS_VALID_PROG_ADDRESS( pxSocket->u.xTCP.pxHandleReceive ) &&
+					( uxStreamBufferGetSize( pxStream ) == 0u ) )
+				{
+					pxStream = NULL;
+				}
+			}
+			#endif /* ipconfigUSE_CALLBACKS */
+		}
+
+		if( pxStream != NULL )
+		{
+			uxStreamBufferPlaceChecksum( pxStream, 0u, pxNetworkBuffer->pucEthernetBuffer + ipSIZE_OF_ETH_HEADER + ulHeaderLength,
+				( size_t ) ulDataLength, &usDataSum );
+			usChecksum = usGenerateProtocolChecksumPartial( pxNetworkBuffer->pucEthernetBuffer, pdFALSE, ( size_t ) ulDataLength, usDataSum );
+
+			#if( tcpRX_COALESCE != 0 )
+			{
+				/* Each merged segment is placed behind the previous one, and
+				checked against its own headers. */
+				ulLength = ulDataLength;
+				for( pxMerged = pxRxMerged; ( pxMerged != NULL ) && ( usChecksum == ipCORRECT_CRC ); pxMerged = pxMerged->pxNextBuffer )
+				{
+					ulMergedPart = ( uint32_t ) prvCheckRxData( pxMerged, &pucMergedData );
+					uxStreamBufferPlaceChecksum( pxStream, ( size_t ) ulLength, pucMergedData, ( size_t ) ulMergedPart, &usDataSum );
+					usChecksum = usGenerateProtocolChecksumPartial( pxMerged->pucEthernetBuffer, pdFALSE, ( size_t ) ulMergedPart, usDataSum );
+					ulLength += ulMergedPart;
+				}
+			}
+			#endif /* tcpRX_COALESCE */
+
+			if( usChecksum == ipCORRECT_CRC )
+			{
+				/* The data may be passed to the user by prvStoreRxData(). */
+				pxSocket->u.xTCP.usRxStagedLength = ( uint16_t ) ( ulDataLength + ulMergedLength );
+			}
+		}
+		else
+		{
+			usChecksum = usGenerateProtocolChecksum( pxNetworkBuffer->pucEthernetBuffer, pdFALSE );
+
+			#if( tcpRX_COALESCE != 0 )
+			{
+				for( pxMerged = pxRxMerged; ( pxMerged != NULL ) && ( usChecksum == ipCORRECT_CRC ); pxMerged = pxMerged->pxNextBuffer )
+				{
+					usChecksum = usGenerateProtocolChecksum( pxMerged->pucEthernetBuffer, pdFALSE );
+				}
+			}
+			#endif /* tcpRX_COALESCE */
+		}
+
+		return ( usChecksum == ipCORRECT_CRC ) ? pdPASS : pdFAIL;
+	}
+
+#endif /* ( ipconfigTCP_FUSED_CHECKSUM != 0 ) && ( ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM == 0 ) */
+/*-----------------------------------------------------------*/
+
 static FreeRTOS_Socket_t *prvHandleListen( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer )
 {
 TCPPacket_t * pxTCPPacket = ( TCPPacket_t * ) ( pxNetworkBuffer->pucEthernetBuffer );
@@ -3127,6 +4220,14 @@ FreeRTOS_Socket_t *pxReturn;
 		new socket when a connection comes in. */
 		pxReturn = NULL;
 
+		#if( ipconfigTCP_SYN_COOKIES != 0 )
+		if( pxSocket->u.xTCP.usChildCount >= tcpSYN_COOKIE_THRESHOLD( pxSocket ) )
+		{
+			/* Do not keep any state until the peer has answered. */
+			prvTCPSendSynCookie( pxSocket, pxNetworkBuffer );
+		}
+		else
+		#endif /* ipconfigTCP_SYN_COOKIES */
 		if( pxSocket->u.xTCP.usChildCount >= pxSocket->u.xTCP.usBacklog )
 		{
 			FreeRTOS_printf( ( "Check: Socket %u already has %u / %u child%s\n",
@@ -3138,21 +4239,20 @@ FreeRTOS_Socket_t *pxReturn;
 		}
 		else
 		{
-			FreeRTOS_Socket_t *pxNewSocket = (FreeRTOS_Socket_t *)
-				FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+			pxReturn = prvTCPNewChild( pxSocket );
 
-			if( ( pxNewSocket == NULL ) || ( pxNewSocket == FREERTOS_INVALID_SOCKET ) )
-			{
-				FreeRTOS_debug_printf( ( "TCP: Listen: new socket failed\n" ) );
-				prvTCPSendReset( pxNetworkBuffer );
-			}
-			else if( prvTCPSocketCopy( pxNewSocket, pxSocket ) != pdFALSE )
+			if( pxReturn == NULL )
 			{
-				/* The socket will be connected immediately, no time for the
-				owner to setsockopt's, therefore copy properties of the server
-				socket to the new socket.  Only the binding might fail (due to
-				lack of resources). */
-				pxReturn = pxNewSocket;
+				#if( ipconfigTCP_SYN_COOKIES != 0 )
+				{
+					/* No memory for a new socket now, maybe later. */
+					prvTCPSendSynCookie( pxSocket, pxNetworkBuffer );
+				}
+				#else
+				{
+					prvTCPSendReset( pxNetworkBuffer );
+				}
+				#endif
 			}
 		}
 	}
@@ -3182,6 +4282,293 @@ FreeRTOS_Socket_t *pxReturn;
 }
 /*-----------------------------------------------------------*/
 
+static FreeRTOS_Socket_t *prvTCPNewChild( FreeRTOS_Socket_t *pxSocket )
+{
+FreeRTOS_Socket_t *pxNewSocket = NULL;
+FreeRTOS_Socket_t *pxReturn = NULL;
+
+	#if( ipconfigTCP_ACCEPT_POOL_SIZE > 0 )
+	{
+		/* Use a socket that was allocated by FreeRTOS_listen() or
+		FreeRTOS_accept(). */
+		pxNewSocket = pxTCPAcceptPoolTake( pxSocket );
+	}
+	#endif
+
+	if( pxNewSocket == NULL )
+	{
+		pxNewSocket = ( FreeRTOS_Socket_t * ) FreeRTOS_socket( FREERTOS_AF_INET, FREERTOS_SOCK_STREAM, FREERTOS_IPPROTO_TCP );
+	}
+
+	if( ( pxNewSocket == NULL ) || ( pxNewSocket == FREERTOS_INVALID_SOCKET ) )
+	{
+		FreeRTOS_debug_printf( ( "TCP: Listen: new socket failed\n" ) );
+	}
+	else if( prvTCPSocketCopy( pxNewSocket, pxSocket ) != pdFALSE )
+	{
+		/* The socket will be connected immediately, no time for the
+		owner to setsockopt's, therefore copy properties of the server
+		socket to the new socket.  Only the binding might fail (due to
+		lack of resources). */
+		pxReturn = pxNewSocket;
+	}
+
+	return pxReturn;
+}
+/*-----------------------------------------------------------*/
+
+#if( ipconfigTCP_SYN_COOKIES != 0 )
+
+	static portINLINE void prvSipRound( uint64_t *pullV )
+	{
+		pullV[ 0 ] += pullV[ 1 ];
+		pullV[ 1 ] = tcpROTL64( pullV[ 1 ], 13u ) ^ pullV[ 0 ];
+		pullV[ 0 ] = tcpROTL64( pullV[ 0 ], 32u );
+		pullV[ 2 ] += pullV[ 3 ];
+		pullV[ 3 ] = tcpROTL64( pullV[ 3 ], 16u ) ^ pullV[ 2 ];
+		pullV[ 0 ] += pullV[ 3 ];
+		pullV[ 3 ] = tcpROTL64( pullV[ 3 ], 21u ) ^ pullV[ 0 ];
+		pullV[ 2 ] += pullV[ 1 ];
+		pullV[ 1 ] = tcpROTL64( pullV[ 1 ], 17u ) ^ pullV[ 2 ];
+		pullV[ 2 ] = tcpROTL64( pullV[ 2 ], 32u );
+	}
+	/*-----------------------------------------------------------*/
+
+	static uint64_t prvSipHash24( const uint32_t *pulKey, const uint32_t *pulWords, size_t uxCount )
+	{
+	uint64_t ullV[ 4 ];
+	uint64_t ullK0 = ( ( uint64_t ) pulKey[ 1 ] << 32 ) | ( uint64_t ) pulKey[ 0 ];
+	uint64_t ullK1 = ( ( uint64_t ) pulKey[ 3 ] << 32 ) | ( uint64_t ) pulKey[ 2 ];
+	uint64_t ullM;
+	size_t uxIndex;
+	BaseType_t xRound;
+
+		ullV[ 0 ] = ullK0 ^ 0x736f6d6570736575ull;
+		ullV[ 1 ] = ullK1 ^ 0x646f72616e646f6dull;
+		ullV[ 2 ] = ullK0 ^ 0x6c7967656e657261ull;
+		ullV[ 3 ] = ullK1 ^ 0x7465646279746573ull;
+
+		/* The complete 64-bit blocks. */
+		for( uxIndex = 0u; ( uxIndex + 2u ) <= uxCount; uxIndex += 2u )
+		{
+			ullM = ( ( uint64_t ) pulWords[ uxIndex + 1u ] << 32 ) | ( uint64_t ) pulWords[ uxIndex ];
+			ullV[ 3 ] ^= ullM;
+			prvSipRound( ullV );
+			prvSipRound( ullV );
+			ullV[ 0 ] ^= ullM;
+		}
+
+		/* The last block holds the remaining word and the length in bytes. */
+		ullM = ( ( uint64_t ) ( ( uxCount * sizeof( uint32_t ) ) & 0xffu ) ) << 56;
+		if( uxIndex < uxCount )
+		{
+			ullM |= ( uint64_t ) pulWords[ uxIndex ];
+		}
+		ullV[ 3 ] ^= ullM;
+		prvSipRound( ullV );
+		prvSipRound( ullV );
+		ullV[ 0 ] ^= ullM;
+
+		ullV[ 2 ] ^= 0xffull;
+		for( xRound = 0; xRound < 4; xRound++ )
+		{
+			prvSipRound( ullV );
+		}
+
+		return ullV[ 0 ] ^ ullV[ 1 ] ^ ullV[ 2 ] ^ ullV[ 3 ];
+	}
+	/*-----------------------------------------------------------*/
+
+	static uint32_t prvSynCookieHash( const TCPPacket_t *pxTCPPacket, uint32_t ulPeerSequence, uint32_t ulCounter )
+	{
+	uint32_t ulWords[ 5 ];
+	UBaseType_t uxSlot = ( UBaseType_t ) ( ulCounter & 1ul );
+	BaseType_t xIndex;
+
+		if( ( xSynCookieKeyValid[ uxSlot ] == pdFALSE ) || ( ulSynCookieKeyCounter[ uxSlot ] != ulCounter ) )
+		{
+			/* The first cookie of this period: choose a new key.  A cookie of
+			a period whose key has been replaced will not match. */
+			for( xIndex = 0; xIndex < 4; xIndex++ )
+			{
+				ulSynCookieKeys[ uxSlot ][ xIndex ] = ipconfigRAND32();
+			}
+			ulSynCookieKeyCounter[ uxSlot ] = ulCounter;
+			xSynCookieKeyValid[ uxSlot ] = pdTRUE;
+		}
+
+		ulWords[ 0 ] = pxTCPPacket->xIPHeader.ulSourceIPAddress;
+		ulWords[ 1 ] = pxTCPPacket->xIPHeader.ulDestinationIPAddress;
+		ulWords[ 2 ] = ( ( ( uint32_t ) pxTCPPacket->xTCPHeader.usSourcePort ) << 16 ) | ( uint32_t ) pxTCPPacket->xTCPHeader.usDestinationPort;
+		ulWords[ 3 ] = ulPeerSequence;
+		ulWords[ 4 ] = ulCounter;
+
+		return ( uint32_t ) prvSipHash24( ulSynCookieKeys[ uxSlot ], ulWords, ( size_t ) ARRAY_SIZE( ulWords ) );
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvTCPSendSynCookie( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer )
+	{
+	TCPPacket_t *pxTCPPacket = ( TCPPacket_t * ) ( pxNetworkBuffer->pucEthernetBuffer );
+	TCPHeader_t *pxTCPHeader = &( pxTCPPacket->xTCPHeader );
+	uint32_t ulPeerSequence = FreeRTOS_ntohl( pxTCPHeader->ulSequenceNumber );
+	uint32_t ulCounter = ( uint32_t ) ( xTaskGetTickCount() / tcpSYN_COOKIE_PERIOD_TICKS );
+	uint32_t ulPeerMSS = ( uint32_t ) usSynCookieMSS[ 0 ];
+	uint32_t ulMaxMSS, ulMSSIndex, ulCookie;
+	UBaseType_t uxOptionsLength = 0u;
+	const uint8_t *pucPtr = pxTCPHeader->ucOptdata;
+	const uint8_t *pucLast = pucPtr + ( ( ( pxTCPHeader->ucTCPOffset >> 4 ) - 5 ) << 2 );
+
+		/* Find the MSS option of the peer.  Without it, 536 bytes is assumed. */
+		while( ( pucPtr + TCP_OPT_MSS_LEN ) <= pucLast )
+		{
+			if( pucPtr[ 0 ] == TCP_OPT_END )
+			{
+				break;
+			}
+			else if( pucPtr[ 0 ] == TCP_OPT_NOOP )
+			{
+				pucPtr++;
+			}
+			else if( ( pucPtr[ 0 ] == TCP_OPT_MSS ) && ( pucPtr[ 1 ] == TCP_OPT_MSS_LEN ) )
+			{
+				ulPeerMSS = ( uint32_t ) usChar2u16( pucPtr + 2 );
+				break;
+			}
+			else if( pucPtr[ 1 ] < 2u )
+			{
+				/* Malformed options. */
+				break;
+			}
+			else
+			{
+				pucPtr += pucPtr[ 1 ];
+			}
+		}
+
+		/* The largest MSS in the table that both parties can use. */
+		ulMaxMSS = FreeRTOS_min_uint32( ulPeerMSS, ( uint32_t ) ipconfigTCP_MSS );
+
+		for( ulMSSIndex = ( uint32_t ) ARRAY_SIZE( usSynCookieMSS ) - 1ul; ulMSSIndex > 0ul; ulMSSIndex-- )
+		{
+			if( ( uint32_t ) usSynCookieMSS[ ulMSSIndex ] <= ulMaxMSS )
+			{
+				break;
+			}
+		}
+
+		ulCookie = ( ulCounter << tcpSYN_COOKIE_COUNTER_SHIFT ) |
+			( ulMSSIndex << tcpSYN_COOKIE_MSS_SHIFT ) |
+			( prvSynCookieHash( pxTCPPacket, ulPeerSequence, ulCounter ) & tcpSYN_COOKIE_HASH_MASK );
+
+		/* The SYN is turned into a SYN+ACK.  prvTCPReturnPacket() will swap
+		the sequence numbers, the addresses and the ports. */
+		pxTCPHeader->ulAckNr = FreeRTOS_htonl( ulCookie );
+		pxTCPHeader->ulSequenceNumber = FreeRTOS_htonl( ulPeerSequence + 1u );
+		pxTCPHeader->ucTCPFlags = ipTCP_FLAG_SYN | ipTCP_FLAG_ACK;
+		pxTCPHeader->usWindow = FreeRTOS_htons( ( uint16_t ) FreeRTOS_min_uint32( ( uint32_t ) ( ipconfigTCP_MSS * pxSocket->u.xTCP.uxRxWinSize ), 0xfffful ) );
+		pxTCPHeader->usUrgent = 0u;
+
+		/* The MSS option only fits if the SYN had options as well.  Window
+		scaling, SACK and time-stamps are not offered, they can not be
+		remembered. */
+		if( ( pxTCPHeader->ucTCPOffset & TCP_OFFSET_LENGTH_BITS ) > TCP_OFFSET_STANDARD_LENGTH )
+		{
+		uint16_t usMSS = ( uint16_t ) FreeRTOS_min_uint32( ( uint32_t ) usSynCookieMSS[ ulMSSIndex ], ( uint32_t ) ipconfigTCP_MSS );
+
+			pxTCPHeader->ucOptdata[ 0 ] = ( uint8_t ) TCP_OPT_MSS;
+			pxTCPHeader->ucOptdata[ 1 ] = ( uint8_t ) TCP_OPT_MSS_LEN;
+			pxTCPHeader->ucOptdata[ 2 ] = ( uint8_t ) ( usMSS >> 8 );
+			pxTCPHeader->ucOptdata[ 3 ] = ( uint8_t ) ( usMSS & 0xffu );
+			uxOptionsLength = TCP_OPT_MSS_LEN;
+		}
+
+		pxTCPHeader->ucTCPOffset = ( uint8_t ) ( ( ipSIZE_OF_TCP_HEADER + uxOptionsLength ) << 2 );
+
+		prvTCPReturnPacket( NULL, pxNetworkBuffer, ( uint32_t ) ( ipSIZE_OF_IPv4_HEADER + ipSIZE_OF_TCP_HEADER + uxOptionsLength ), pdFALSE );
+
+		iptraceTCP_SYN_COOKIE_SENT( pxSocket );
+	}
+	/*-----------------------------------------------------------*/
+
+	static FreeRTOS_Socket_t *prvHandleSynCookie( FreeRTOS_Socket_t *pxSocket, NetworkBufferDescriptor_t *pxNetworkBuffer )
+	{
+	TCPPacket_t *pxTCPPacket = ( TCPPacket_t * ) ( pxNetworkBuffer->pucEthernetBuffer );
+	uint32_t ulCookie = FreeRTOS_ntohl( pxTCPPacket->xTCPHeader.ulAckNr ) - 1u;
+	uint32_t ulPeerSequence = FreeRTOS_ntohl( pxTCPPacket->xTCPHeader.ulSequenceNumber ) - 1u;
+	uint32_t ulNow = ( uint32_t ) ( xTaskGetTickCount() / tcpSYN_COOKIE_PERIOD_TICKS );
+	uint32_t ulAge, ulCounter, ulMSS;
+	BaseType_t xValid = pdFALSE;
+	FreeRTOS_Socket_t *pxReturn = NULL;
+	TCPWindow_t *pxTCPWindow;
+
+		/* The counter in the cookie must be recent, and the hash must match. */
+		for( ulAge = 0ul; ( ulAge <= tcpSYN_COOKIE_MAX_AGE ) && ( xValid == pdFALSE ); ulAge++ )
+		{
+			ulCounter = ulNow - ulAge;
+
+			if( ( ( ( ulCookie >> tcpSYN_COOKIE_COUNTER_SHIFT ) ^ ulCounter ) & tcpSYN_COOKIE_COUNTER_MASK ) == 0ul )
+			{
+				if( ( ( prvSynCookieHash( pxTCPPacket, ulPeerSequence, ulCounter ) ^ ulCookie ) & tcpSYN_COOKIE_HASH_MASK ) == 0ul )
+				{
+					xValid = pdTRUE;
+				}
+			}
+		}
+
+		if( xValid == pdFALSE )
+		{
+			iptraceTCP_SYN_COOKIE_REJECTED( pxSocket );
+		}
+		else if( pxSocket->u.xTCP.usChildCount >= pxSocket->u.xTCP.usBacklog )
+		{
+			FreeRTOS_debug_printf( ( "SYN cookie: socket %u has no room for %lxip:%u\n",
+				pxSocket->usLocalPort,
+				FreeRTOS_ntohl( pxTCPPacket->xIPHeader.ulSourceIPAddress ),
+				FreeRTOS_ntohs( pxTCPPacket->xTCPHeader.usSourcePort ) ) );
+			iptraceTCP_SYN_COOKIE_REJECTED( pxSocket );
+		}
+		else
+		{
+			pxReturn = prvTCPNewChild( pxSocket );
+		}
+
+		if( pxReturn != NULL )
+		{
+			iptraceTCP_SYN_COOKIE_ACCEPTED( pxSocket );
+
+			pxTCPWindow = &( pxReturn->u.xTCP.xTCPWindow );
+			pxReturn->u.xTCP.usRemotePort = FreeRTOS_htons( pxTCPPacket->xTCPHeader.usSourcePort );
+			pxReturn->u.xTCP.ulRemoteIP = FreeRTOS_htonl( pxTCPPacket->xIPHeader.ulSourceIPAddress );
+			pxTCPWindow->ulOurSequenceNumber = ulCookie;
+			pxTCPWindow->rx.ulCurrentSequenceNumber = ulPeerSequence;
+
+			/* Use the MSS that was stored in the cookie, if it is smaller. */
+			prvSocketSetMSS( pxReturn );
+			ulMSS = ( uint32_t ) usSynCookieMSS[ ( ulCookie >> tcpSYN_COOKIE_MSS_SHIFT ) & tcpSYN_COOKIE_MSS_MASK ];
+			if( ulMSS < ( uint32_t ) pxReturn->u.xTCP.usInitMSS )
+			{
+				pxReturn->u.xTCP.usInitMSS = pxReturn->u.xTCP.usCurMSS = ( uint16_t ) ulMSS;
+			}
+
+			prvTCPCreateWindow( pxReturn );
+
+			/* Continue as if this socket had sent the SYN+ACK, the ACK will
+			now move it to eESTABLISHED. */
+			vTCPStateChange( pxReturn, eSYN_RECEIVED );
+			pxTCPWindow->rx.ulCurrentSequenceNumber = pxTCPWindow->rx.ulHighestSequenceNumber = ulPeerSequence + 1u;
+			pxTCPWindow->tx.ulCurrentSequenceNumber = pxTCPWindow->ulNextTxSequenceNumber = pxTCPWindow->tx.ulFirstSequenceNumber + 1u;
+
+			/* Make a copy of the header up to the TCP header. */
+			memcpy( pxReturn->u.xTCP.xPacket.u.ucLastPacket, pxNetworkBuffer->pucEthernetBuffer, sizeof( pxReturn->u.xTCP.xPacket.u.ucLastPacket ) );
+		}
+
+		return pxReturn;
+	}
+
+#endif /* ipconfigTCP_SYN_COOKIES */
+/*-----------------------------------------------------------*/
+
 /*
  * Duplicates a socket after a listening socket receives a connection.
  */
@@ -3198,6 +4585,14 @@ struct freertos_sockaddr xAddress;
 	pxNewSocket->u.xTCP.uxEnoughSpace = pxSocket->u.xTCP.uxEnoughSpace;
 	pxNewSocket->u.xTCP.uxRxWinSize  = pxSocket->u.xTCP.uxRxWinSize;
 	pxNewSocket->u.xTCP.uxTxWinSize  = pxSocket->u.xTCP.uxTxWinSize;
+	pxNewSocket->u.xTCP.bits.bQuickAck = pxSocket->u.xTCP.bits.bQuickAck;
+	pxNewSocket->u.xTCP.xTCPWindow.u.bits.bNagle = pxSocket->u.xTCP.xTCPWindow.u.bits.bNagle;
+
+	#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+	{
+		pxNewSocket->u.xTCP.xTCPWindow.ucCongestionAlgorithm = pxSocket->u.xTCP.xTCPWindow.ucCongestionAlgorithm;
+	}
+	#endif /* ipconfigTCP_CONGESTION_CONTROL */
 
 	#if( ipconfigSOCKET_HAS_USER_SEMAPHORE == 1 )
 	{
@@ -91,20 +91,27 @@
 
 #if( ipconfigUSE_TCP_WIN == 1 )
 
-	#define xTCPWindowRxNew( pxWindow, ulSequenceNumber, lCount ) xTCPWindowNew( pxWindow, ulSequenceNumber, lCount, pdTRUE )
+	#define xTCPWindowTxNew( pxWindow, ulSequenceNumber, lCount ) xTCPWindowNew( pxWindow, ulSequenceNumber, lCount )
 
-	#define xTCPWindowTxNew( pxWindow, ulSequenceNumber, lCount ) xTCPWindowNew( pxWindow, ulSequenceNumber, lCount, pdFALSE )
+	/* The transmission segment at position 'uxIndex' in the ring, counted from
+	the oldest one. */
+	#define winTX_SEGMENT_AT( pxWindow, uxIndex ) \
+		( ( pxWindow )->pxTxSegments[ ( ( pxWindow )->uxTxHead + ( uxIndex ) ) % ( UBaseType_t ) ipconfigTCP_TX_RING_LENGTH ] )
 
-	/* The code to send a single Selective ACK (SACK):
-	 * NOP (0x01), NOP (0x01), SACK (0x05), LEN (0x0a),
-	 * followed by a lower and a higher sequence number,
-	 * where LEN is 2 + 2*4 = 10 bytes. */
+	/* The code to send a Selective ACK (SACK):
+	 * NOP (0x01), NOP (0x01), SACK (0x05), LEN,
+	 * followed by pairs of a lower and a higher sequence number,
+	 * where LEN is 2 + n*8 bytes. */
 	#if( ipconfigBYTE_ORDER == pdFREERTOS_BIG_ENDIAN )
-		#define OPTION_CODE_SINGLE_SACK		( 0x0101050aUL )
+		#define OPTION_CODE_SACK( uxBlocks )	( 0x01010500UL | ( 2UL + ( 8UL * ( uxBlocks ) ) ) )
 	#else
-		#define OPTION_CODE_SINGLE_SACK		( 0x0a050101UL )
+		#define OPTION_CODE_SACK( uxBlocks )	( 0x00050101UL | ( ( 2UL + ( 8UL * ( uxBlocks ) ) ) << 24 ) )
 	#endif
 
+	/* With the time-stamp option, at most 3 SACK blocks fit in the 40 bytes of
+	TCP options. */
+	#define winSACK_MAX_BLOCKS_WITH_TIMESTAMPS		( 3u )
+
 	/* Normal retransmission:
 	 * A packet will be retransmitted after a Retransmit Time-Out (RTO).
 	 * Fast retransmission:
@@ -119,6 +126,21 @@
 	 */
 	#define MAX_TRANSMIT_COUNT_USING_LARGE_WINDOW		( 4u )
 
+	#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+		/* The initial congestion window, as in RFC 3390: 4380 bytes, or 2
+		to 4 times the MSS. */
+		#define winINITIAL_CONGESTION_WINDOW		( 4380UL )
+
+		/* CUBIC: the time (t - K) is limited to 16 seconds, in units of 1/32
+		sec, so that its third power fits in 32 bits. */
+		#define winCUBIC_MAX_TIME_UNITS				( 512UL )
+
+		/* CUBIC uses C = 0.4 and beta = 0.7.  The growth of the window is
+		C * t^3 segments.  With t in units of 1/32 sec, that is t^3 / 81920
+		segments. */
+		#define winCUBIC_SCALE						( 81920UL )
+	#endif /* ipconfigTCP_CONGESTION_CONTROL */
+
 #endif /* configUSE_TCP_WIN */
 /*-----------------------------------------------------------*/
 
@@ -127,21 +149,76 @@ extern void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewL
 /*
  * All TCP sockets share a pool of segment descriptors (TCPSegment_t)
  * Available descriptors are stored in the 'xSegmentList'
- * When a socket owns a descriptor, it will either be stored in
- * 'xTxSegments' or 'xRxSegments'
+ * When a socket owns a descriptor, it will be stored in the ring 'pxTxSegments[]'
  * As soon as a package has been confirmed, the descriptor will be returned
  * to the segment pool
+ * The pool grows with 'uxCount' descriptors at a time, until it holds
+ * ipconfigTCP_WIN_SEG_COUNT descriptors.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 )
+	static BaseType_t prvCreateSectors( UBaseType_t uxCount );
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+
+/*
+ * The number of descriptors that are free or that may still be allocated.
  */
 #if( ipconfigUSE_TCP_WIN == 1 )
-	static BaseType_t prvCreateSectors( void );
+	static UBaseType_t prvSegmentsAvailable( void );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
 /*
- * Find a segment with a given sequence number in the list of received
- * segments: 'pxWindow->xRxSegments'.
+ * The number of descriptors owned by a window.  Only transmission uses
+ * descriptors.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_SEG_MIN_PER_SOCKET > 0 )
+	static UBaseType_t prvTCPWindowSegmentCount( TCPWindow_t *pxWindow );
+#endif
+
+/*
+ * Data received out of order is described by a sorted array of ranges:
+ * 'pxWindow->xRxRanges[]'.  Return the index of the first range of which the
+ * first (or, when 'xUseLast' is true, the last) sequence number is at or
+ * beyond 'ulSequenceNumber'.  It does a binary search.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_RX_RANGE_COUNT > 0 )
+	static UBaseType_t prvTCPWindowRxRangeSearch( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, BaseType_t xUseLast );
+#endif /* ipconfigUSE_TCP_WIN && ipconfigTCP_RX_RANGE_COUNT */
+
+/*
+ * Add the range 'ulFirst' up to 'ulLast' to 'xRxRanges[]', merging it with the
+ * ranges that it overlaps or touches.  Returns the index of the resulting
+ * range, or -1 when there is no room for a new range.  '*pxDuplicate' is set
+ * when all of the data had been received already.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_RX_RANGE_COUNT > 0 )
+	static BaseType_t prvTCPWindowRxRangeAdd( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast, BaseType_t *pxDuplicate );
+#endif /* ipconfigUSE_TCP_WIN && ipconfigTCP_RX_RANGE_COUNT */
+
+/*
+ * Remove the ranges that start at or before 'ulSequenceNumber', which is the
+ * new 'rx.ulCurrentSequenceNumber'.  Returns the sequence number that follows
+ * the data that can now be passed to the user.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_RX_RANGE_COUNT > 0 )
+	static uint32_t prvTCPWindowRxRangePop( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber );
+#endif /* ipconfigUSE_TCP_WIN && ipconfigTCP_RX_RANGE_COUNT */
+
+/*
+ * Prepare a SACK option that describes the ranges in 'xRxRanges[]'.  The range
+ * 'xFirst' comes first, as it holds the most recently received data.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_RX_RANGE_COUNT > 0 )
+	static void prvTCPWindowRxSetSack( TCPWindow_t *pxWindow, BaseType_t xFirst );
+#endif /* ipconfigUSE_TCP_WIN && ipconfigTCP_RX_RANGE_COUNT */
+
+/*
+ * The transmission segments of a window are stored in the ring
+ * 'pxWindow->pxTxSegments[]', sorted on sequence number.  Return the position
+ * of the first segment that starts at or beyond 'ulSequenceNumber'.  It does a
+ * binary search.
  */
 #if( ipconfigUSE_TCP_WIN == 1 )
-	static TCPSegment_t *xTCPWindowRxFind( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber );
+	static UBaseType_t prvTCPWindowTxSearch( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
 /*
@@ -150,7 +227,7 @@ extern void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewL
  * which is a list of 'TCPSegment_t'
  */
 #if( ipconfigUSE_TCP_WIN == 1 )
-	static TCPSegment_t *xTCPWindowNew( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, int32_t lCount, BaseType_t xIsForRx );
+	static TCPSegment_t *xTCPWindowNew( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, int32_t lCount );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
 /* When the peer has a close request (FIN flag), the driver will check if
@@ -182,19 +259,7 @@ extern void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewL
  *	The ownership will be passed back to the segment pool
  */
 #if( ipconfigUSE_TCP_WIN == 1 )
-	static void vTCPWindowFree( TCPSegment_t *pxSegment );
-#endif /* ipconfigUSE_TCP_WIN == 1 */
-
-/*
- * A segment has been received with sequence number 'ulSequenceNumber', where
- * 'ulCurrentSequenceNumber == ulSequenceNumber', which means that exactly this
- * segment was expected.  xTCPWindowRxConfirm() will check if there is already
- * another segment with a sequence number between (ulSequenceNumber) and
- * (ulSequenceNumber+xLength).  Normally none will be found, because the next Rx
- * segment should have a sequence number equal to '(ulSequenceNumber+xLength)'.
- */
-#if( ipconfigUSE_TCP_WIN == 1 )
-	static TCPSegment_t *xTCPWindowRxConfirm( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, uint32_t ulLength );
+	static void vTCPWindowFree( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
 /*
@@ -213,6 +278,15 @@ extern void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewL
 	static BaseType_t prvTCPWindowTxHasSpace( TCPWindow_t *pxWindow, uint32_t ulWindowSize );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
+/*
+ * Nagle's algorithm, used when FREERTOS_SO_TCP_NODELAY is cleared: returns
+ * pdTRUE when a segment is smaller than MSS while earlier data has not been
+ * acknowledged yet.  The segment must wait, so that it can grow.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 )
+	static BaseType_t prvTCPWindowTxNagle( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment );
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+
 /*
  * An acknowledge was received.  See if some outstanding data may be removed
  * from the transmission queue(s).
@@ -229,18 +303,91 @@ extern void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewL
 	static uint32_t prvTCPWindowFastRetransmit( TCPWindow_t *pxWindow, uint32_t ulFirst );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
-/*-----------------------------------------------------------*/
+/*
+ * A round-trip time of 'lRTT' ms was measured, update the estimates.
+ */
+#if( ipconfigUSE_TCP_WIN == 1 )
+	static void prvTCPWindowRTTSample( TCPWindow_t *pxWindow, int32_t lRTT );
+#endif /* ipconfigUSE_TCP_WIN == 1 */
 
-/* TCP segement pool. */
+/*
+ * Returns the number of ms to wait for an ACK for the segment, before it will
+ * be resent.  The time doubles with each retransmission.
+ */
 #if( ipconfigUSE_TCP_WIN == 1 )
-	static TCPSegment_t *xTCPSegments = NULL;
+	static uint32_t prvTCPWindowSegmentTimeout( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment );
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 
+/*
+ * Returns the transmission segment with the lowest sequence number, i.e. the
+ * one at the left side of the sliding window.
+ */
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+	static TCPSegment_t *prvTCPWindowOldestTxSegment( TCPWindow_t *pxWindow );
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+
+/*
+ * Integer cube root, needed by CUBIC.
+ */
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+	static uint32_t prvCubeRoot( uint32_t ulValue );
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+
+/*
+ * Congestion control: a segment got lost, either detected by a time-out or by
+ * the SACK's of the peer.  Reduce the congestion window.
+ */
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+	static void prvTCPWindowCongestionLoss( TCPWindow_t *pxWindow, BaseType_t xTimeout );
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+
+/*
+ * Congestion control: 'ulAcked' new bytes have been acknowledged, the peer
+ * has ACK'd up to 'ulAckNumber'.  Let the congestion window grow.
+ */
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+	static void prvTCPWindowCongestionAck( TCPWindow_t *pxWindow, uint32_t ulAcked, uint32_t ulAckNumber );
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+
+/*
+ * CUBIC: let the congestion window grow in congestion avoidance.
+ */
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+	static void prvTCPWindowCubicUpdate( TCPWindow_t *pxWindow, uint32_t ulAcked );
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+
+/*
+ * A segment in the waiting queue has timed out.  Check if the congestion
+ * window allows to retransmit it.  If not, the oldest segment may be resent
+ * in stead, if it has timed out as well.  Returns NULL when nothing may be
+ * retransmitted now.
+ */
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+	static TCPSegment_t *prvTCPWindowCongestionResend( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment );
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+
+/*-----------------------------------------------------------*/
+
 /* List of free TCP segments. */
 #if( ipconfigUSE_TCP_WIN == 1 )
 	static List_t xSegmentList;
 #endif
 
+/* The administration of the segment pool: the number of descriptors allocated
+so far, the lowest number that was available, and the number of times that a
+window could not get a descriptor. */
+#if( ipconfigUSE_TCP_WIN == 1 )
+	static UBaseType_t uxSegmentsAllocated = 0u;
+	static UBaseType_t uxSegmentsLowest = ( UBaseType_t ) ipconfigTCP_WIN_SEG_COUNT;
+	static UBaseType_t uxSegmentsStarved = 0u;
+#endif
+
+/* The number of descriptors that must stay available for windows that own
+less than their quota: the sum of ( usSegmentQuota - owned ) of those windows. */
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_SEG_MIN_PER_SOCKET > 0 )
+	static UBaseType_t uxSegmentsReserved = 0u;
+#endif
+
 /* Logging verbosity level. */
 BaseType_t xTCPWindowLoggingLevel = 0;
 
@@ -332,38 +479,55 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 
 #if( ipconfigUSE_TCP_WIN == 1 )
 
-	static BaseType_t prvCreateSectors( void )
+	static BaseType_t prvCreateSectors( UBaseType_t uxCount )
 	{
-	BaseType_t xIndex, xReturn;
-
-		/* Allocate space for 'xTCPSegments' and store them in 'xSegmentList'. */
+	TCPSegment_t *pxSegments;
+	UBaseType_t xIndex;
+	BaseType_t xReturn;
 
-		vListInitialise( &xSegmentList );
-		xTCPSegments = ( TCPSegment_t * ) pvPortMallocLarge( ipconfigTCP_WIN_SEG_COUNT * sizeof( xTCPSegments[ 0 ] ) );
+		/* Allocate space for 'uxCount' more segments and store them in
+		'xSegmentList'.  The blocks are never freed. */
+		if( uxCount > ( ( UBaseType_t ) ipconfigTCP_WIN_SEG_COUNT - uxSegmentsAllocated ) )
+		{
+			uxCount = ( UBaseType_t ) ipconfigTCP_WIN_SEG_COUNT - uxSegmentsAllocated;
+		}
 
-		if( xTCPSegments == NULL )
+		if( uxCount == 0u )
 		{
-			FreeRTOS_debug_printf( ( "prvCreateSectors: malloc %lu failed\n",
-				ipconfigTCP_WIN_SEG_COUNT * sizeof( xTCPSegments[ 0 ] ) ) );
+			pxSegments = NULL;
+		}
+		else
+		{
+			pxSegments = ( TCPSegment_t * ) pvPortMallocLarge( uxCount * sizeof( pxSegments[ 0 ] ) );
+
+			if( pxSegments == NULL )
+			{
+				FreeRTOS_debug_printf( ( "prvCreateSectors: malloc %lu failed\n",
+					uxCount * sizeof( pxSegments[ 0 ] ) ) );
+			}
+		}
 
+		if( pxSegments == NULL )
+		{
 			xReturn = pdFAIL;
 		}
 		else
 		{
 			/* Clear the allocated space. */
-			memset( xTCPSegments, '\0', ipconfigTCP_WIN_SEG_COUNT * sizeof( xTCPSegments[ 0 ] ) );
+			memset( pxSegments, '\0', uxCount * sizeof( pxSegments[ 0 ] ) );
 
-			for( xIndex = 0; xIndex < ipconfigTCP_WIN_SEG_COUNT; xIndex++ )
+			for( xIndex = 0; xIndex < uxCount; xIndex++ )
 			{
 				/* Could call vListInitialiseItem here but all data has been
 				nulled already.  Set the owner to a segment descriptor. */
-				listSET_LIST_ITEM_OWNER( &( xTCPSegments[ xIndex ].xListItem ), ( void* ) &( xTCPSegments[ xIndex ] ) );
-				listSET_LIST_ITEM_OWNER( &( xTCPSegments[ xIndex ].xQueueItem ), ( void* ) &( xTCPSegments[ xIndex ] ) );
+				listSET_LIST_ITEM_OWNER( &( pxSegments[ xIndex ].xListItem ), ( void* ) &( pxSegments[ xIndex ] ) );
+				listSET_LIST_ITEM_OWNER( &( pxSegments[ xIndex ].xQueueItem ), ( void* ) &( pxSegments[ xIndex ] ) );
 
 				/* And add it to the pool of available segments */
-				vListInsertFifo( &xSegmentList, &( xTCPSegments[xIndex].xListItem ) );
+				vListInsertFifo( &xSegmentList, &( pxSegments[xIndex].xListItem ) );
 			}
 
+			uxSegmentsAllocated += uxCount;
 			xReturn = pdPASS;
 		}
 
@@ -375,50 +539,67 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 
 #if( ipconfigUSE_TCP_WIN == 1 )
 
-	static TCPSegment_t *xTCPWindowRxFind( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber )
+	static UBaseType_t prvSegmentsAvailable( void )
 	{
-	const ListItem_t *pxIterator;
-	const MiniListItem_t* pxEnd;
-	TCPSegment_t *pxSegment, *pxReturn = NULL;
-
-		/* Find a segment with a given sequence number in the list of received
-		segments. */
-
-		pxEnd = ( const MiniListItem_t* )listGET_END_MARKER( &pxWindow->xRxSegments );
+		return listCURRENT_LIST_LENGTH( &xSegmentList ) + ( ( UBaseType_t ) ipconfigTCP_WIN_SEG_COUNT - uxSegmentsAllocated );
+	}
 
-		for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxEnd );
-			 pxIterator != ( const ListItem_t * ) pxEnd;
-			 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
-		{
-			pxSegment = ( TCPSegment_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+/*-----------------------------------------------------------*/
 
-			if( pxSegment->ulSequenceNumber == ulSequenceNumber )
-			{
-				pxReturn = pxSegment;
-				break;
-			}
-		}
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_SEG_MIN_PER_SOCKET > 0 )
 
-		return pxReturn;
+	static UBaseType_t prvTCPWindowSegmentCount( TCPWindow_t *pxWindow )
+	{
+		return pxWindow->uxTxCount;
 	}
 
-#endif /* ipconfigUSE_TCP_WIN == 1 */
+#endif /* ipconfigTCP_WIN_SEG_MIN_PER_SOCKET */
 /*-----------------------------------------------------------*/
 
 #if( ipconfigUSE_TCP_WIN == 1 )
 
-	static TCPSegment_t *xTCPWindowNew( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, int32_t lCount, BaseType_t xIsForRx )
+	static TCPSegment_t *xTCPWindowNew( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, int32_t lCount )
 	{
 	TCPSegment_t *pxSegment;
 	ListItem_t * pxItem;
+	BaseType_t xAllowed = pdTRUE;
+	UBaseType_t uxAvailable;
+	#if( ipconfigTCP_WIN_SEG_MIN_PER_SOCKET > 0 )
+		BaseType_t xWithinQuota = ( prvTCPWindowSegmentCount( pxWindow ) < ( UBaseType_t ) pxWindow->usSegmentQuota );
+
+		/* A window that owns its quota or more, may not take the descriptors
+		that are reserved for the other windows. */
+		if( ( xWithinQuota == pdFALSE ) && ( prvSegmentsAvailable() <= uxSegmentsReserved ) )
+		{
+			xAllowed = pdFALSE;
+		}
+	#endif /* ipconfigTCP_WIN_SEG_MIN_PER_SOCKET */
 
 		/* Allocate a new segment.  The socket will borrow all segments from a
-		common pool: 'xSegmentList', which is a list of 'TCPSegment_t' */
-		if( listLIST_IS_EMPTY( &xSegmentList ) != pdFALSE )
+		common pool: 'xSegmentList', which is a list of 'TCPSegment_t'.  When it
+		is empty, try to let the pool grow, but not for a window whose ring is
+		full already. */
+		if( ( xAllowed != pdFALSE ) &&
+			( pxWindow->uxTxCount < ( UBaseType_t ) ipconfigTCP_TX_RING_LENGTH ) &&
+			( listLIST_IS_EMPTY( &xSegmentList ) != pdFALSE ) )
+		{
+			prvCreateSectors( ( UBaseType_t ) ipconfigTCP_WIN_SEG_GROW );
+		}
+
+		if( pxWindow->uxTxCount >= ( UBaseType_t ) ipconfigTCP_TX_RING_LENGTH )
+		{
+			/* The window owns as many segments as it can store.  The data will
+			be added as soon as the oldest segments have been ACK'd. */
+			pxSegment = NULL;
+		}
+		else if( ( xAllowed == pdFALSE ) || ( listLIST_IS_EMPTY( &xSegmentList ) != pdFALSE ) )
 		{
 			/* If the TCP-stack runs out of segments, you might consider
 			increasing 'ipconfigTCP_WIN_SEG_COUNT'. */
-			FreeRTOS_debug_printf( ( "xTCPWindow%cxNew: Error: all segments occupied\n", xIsForRx ? 'R' : 'T' ) );
+			FreeRTOS_debug_printf( ( "xTCPWindowTxNew: Error: all segments occupied\n" ) );
+			uxSegmentsStarved++;
+			iptraceTCP_WIN_SEGMENT_STARVED( pxWindow );
 			pxSegment = NULL;
 		}
 		else
@@ -434,28 +615,36 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 			/* Remove the item from xSegmentList. */
 			uxListRemove( pxItem );
 
-			/* Add it to either the connections' Rx or Tx queue. */
-			vListInsertFifo( xIsForRx ? &pxWindow->xRxSegments : &pxWindow->xTxSegments, pxItem );
+			/* Add it to the tail of the connections' ring.  Segments are
+			created in the order of their sequence numbers, so the ring remains
+			sorted. */
+			winTX_SEGMENT_AT( pxWindow, pxWindow->uxTxCount ) = pxSegment;
+			pxWindow->uxTxCount++;
 
 			/* And set the segment's timer to zero */
 			vTCPTimerSet( &pxSegment->xTransmitTimer );
 
 			pxSegment->u.ulFlags = 0;
-			pxSegment->u.bits.bIsForRx = ( xIsForRx != 0 );
 			pxSegment->lMaxLength = lCount;
 			pxSegment->lDataLength = lCount;
 			pxSegment->ulSequenceNumber = ulSequenceNumber;
-			#if( ipconfigHAS_DEBUG_PRINTF != 0 )
-			{
-			static UBaseType_t xLowestLength = ipconfigTCP_WIN_SEG_COUNT;
-			UBaseType_t xLength = listCURRENT_LIST_LENGTH( &xSegmentList );
 
-				if( xLowestLength > xLength )
+			#if( ipconfigTCP_WIN_SEG_MIN_PER_SOCKET > 0 )
+			{
+				if( xWithinQuota != pdFALSE )
 				{
-					xLowestLength = xLength;
+					/* One of the reserved descriptors has been taken. */
+					uxSegmentsReserved--;
 				}
 			}
-			#endif /* ipconfigHAS_DEBUG_PRINTF */
+			#endif /* ipconfigTCP_WIN_SEG_MIN_PER_SOCKET */
+
+			uxAvailable = prvSegmentsAvailable();
+
+			if( uxSegmentsLowest > uxAvailable )
+			{
+				uxSegmentsLowest = uxAvailable;
+			}
 		}
 
 		return pxSegment;
@@ -475,7 +664,7 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 		closure of the connection if both conditions are true:
 		  - the Rx-queue is empty
 		  - the highest Rx sequence number has been ACK'ed */
-		if( listLIST_IS_EMPTY( ( &pxWindow->xRxSegments ) ) == pdFALSE )
+		if( winRX_RANGES_USED( pxWindow ) != 0u )
 		{
 			/* Rx data has been stored while earlier packets were missing. */
 			xReturn = pdFALSE;
@@ -552,8 +741,10 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 
 #if( ipconfigUSE_TCP_WIN == 1 )
 
-	static void vTCPWindowFree( TCPSegment_t *pxSegment )
+	static void vTCPWindowFree( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment )
 	{
+	UBaseType_t uxIndex;
+
 		/*  Free entry pxSegment because it's not used any more.  The ownership
 		will be passed back to the segment pool.
 
@@ -567,10 +758,47 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 		pxSegment->lDataLength = 0l;
 		pxSegment->u.ulFlags = 0u;
 
-		/* Take it out of xRxSegments/xTxSegments */
-		if( listLIST_ITEM_CONTAINER( &( pxSegment->xListItem ) ) != NULL )
+		/* Find it in the ring.  Segments are normally freed in the order of
+		their sequence numbers, so it is mostly the oldest one. */
+		for( uxIndex = 0u; uxIndex < pxWindow->uxTxCount; uxIndex++ )
+		{
+			if( winTX_SEGMENT_AT( pxWindow, uxIndex ) == pxSegment )
+			{
+				break;
+			}
+		}
+
+		if( uxIndex < pxWindow->uxTxCount )
 		{
-			uxListRemove( &( pxSegment->xListItem ) );
+			if( uxIndex == 0u )
+			{
+				/* The oldest segment: move the head of the ring. */
+				winTX_SEGMENT_AT( pxWindow, 0u ) = NULL;
+				pxWindow->uxTxHead = ( pxWindow->uxTxHead + 1u ) % ( UBaseType_t ) ipconfigTCP_TX_RING_LENGTH;
+			}
+			else
+			{
+				/* Close the gap, the ring must remain sorted on sequence
+				number. */
+				for( ; uxIndex < ( pxWindow->uxTxCount - 1u ); uxIndex++ )
+				{
+					winTX_SEGMENT_AT( pxWindow, uxIndex ) = winTX_SEGMENT_AT( pxWindow, uxIndex + 1u );
+				}
+
+				winTX_SEGMENT_AT( pxWindow, uxIndex ) = NULL;
+			}
+
+			pxWindow->uxTxCount--;
+
+			#if( ipconfigTCP_WIN_SEG_MIN_PER_SOCKET > 0 )
+			{
+				if( prvTCPWindowSegmentCount( pxWindow ) < ( UBaseType_t ) pxWindow->usSegmentQuota )
+				{
+					/* The descriptor becomes part of the reservation. */
+					uxSegmentsReserved++;
+				}
+			}
+			#endif /* ipconfigTCP_WIN_SEG_MIN_PER_SOCKET */
 		}
 
 		/* Return it to xSegmentList */
@@ -584,34 +812,50 @@ void vListInsertGeneric( List_t * const pxList, ListItem_t * const pxNewListItem
 
 	void vTCPWindowDestroy( TCPWindow_t *pxWindow )
 	{
-	List_t * pxSegments;
-	BaseType_t xRound;
-	TCPSegment_t *pxSegment;
-
 		/*  Destroy a window.  A TCP window doesn't serve any more.  Return all
-		owned segments to the pool.  In order to save code, it will make 2 rounds,
-		one to remove the segments from xRxSegments, and a second round to clear
-		xTxSegments*/
-		for( xRound = 0; xRound < 2; xRound++ )
+		owned segments to the pool.  Only pxTxSegments[] owns segments, received
+		data is described by xRxRanges[]. */
+		while( pxWindow->uxTxCount > 0u )
 		{
-			if( xRound != 0 )
-			{
-				pxSegments = &( pxWindow->xRxSegments );
-			}
-			else
-			{
-				pxSegments = &( pxWindow->xTxSegments );
-			}
+			vTCPWindowFree( pxWindow, winTX_SEGMENT_AT( pxWindow, 0u ) );
+		}
 
-			if( listLIST_IS_INITIALISED( pxSegments ) != pdFALSE )
-			{
-				while( listCURRENT_LIST_LENGTH( pxSegments ) > 0U )
-				{
-					pxSegment = ( TCPSegment_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxSegments );
-					vTCPWindowFree( pxSegment );
-				}
-			}
+		#if( ipconfigTCP_RX_RANGE_COUNT > 0 )
+		{
+			pxWindow->uxRxRangeCount = 0u;
+		}
+		#endif
+
+		#if( ipconfigTCP_WIN_SEG_MIN_PER_SOCKET > 0 )
+		{
+			/* The window owns no descriptors any more, give back its
+			reservation. */
+			uxSegmentsReserved -= ( UBaseType_t ) pxWindow->usSegmentQuota;
+			pxWindow->usSegmentQuota = 0u;
+		}
+		#endif /* ipconfigTCP_WIN_SEG_MIN_PER_SOCKET */
+	}
+
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_TCP_WIN == 1 )
+
+	void vTCPWindowGetSegmentStats( TCPSegmentStats_t *pxStats )
+	{
+		pxStats->uxAllocated = uxSegmentsAllocated;
+		pxStats->uxFree = ( uxSegmentsAllocated != 0u ) ? listCURRENT_LIST_LENGTH( &xSegmentList ) : 0u;
+		pxStats->uxLowestFree = uxSegmentsLowest;
+		pxStats->uxStarved = uxSegmentsStarved;
+		#if( ipconfigTCP_WIN_SEG_MIN_PER_SOCKET > 0 )
+		{
+			pxStats->uxReserved = uxSegmentsReserved;
+		}
+		#else
+		{
+			pxStats->uxReserved = 0u;
 		}
+		#endif
 	}
 
 #endif /* ipconfigUSE_TCP_WIN == 1 */
@@ -624,13 +868,33 @@ void vTCPWindowCreate( TCPWindow_t *pxWindow, uint32_t ulRxWindowLength,
 
 	#if( ipconfigUSE_TCP_WIN == 1 )
 	{
-		if( xTCPSegments == NULL )
+		if( listLIST_IS_INITIALISED( &xSegmentList ) == pdFALSE )
+		{
+			vListInitialise( &xSegmentList );
+			prvCreateSectors( ( UBaseType_t ) ipconfigTCP_WIN_SEG_INITIAL );
+		}
+
+		pxWindow->uxTxHead = 0u;
+		pxWindow->uxTxCount = 0u;
+		#if( ipconfigTCP_RX_RANGE_COUNT > 0 )
 		{
-			prvCreateSectors();
+			pxWindow->uxRxRangeCount = 0u;
 		}
+		#endif
 
-		vListInitialise( &pxWindow->xTxSegments );
-		vListInitialise( &pxWindow->xRxSegments );
+		#if( ipconfigTCP_WIN_SEG_MIN_PER_SOCKET > 0 )
+		{
+			/* Reserve descriptors for this window, but only if the pool can
+			still guarantee them on top of the descriptors in use and the
+			reservations of other windows. */
+			if( ( pxWindow->usSegmentQuota == 0u ) &&
+				( prvSegmentsAvailable() >= ( uxSegmentsReserved + ( UBaseType_t ) ipconfigTCP_WIN_SEG_MIN_PER_SOCKET ) ) )
+			{
+				pxWindow->usSegmentQuota = ( uint16_t ) ipconfigTCP_WIN_SEG_MIN_PER_SOCKET;
+				uxSegmentsReserved += ( UBaseType_t ) ipconfigTCP_WIN_SEG_MIN_PER_SOCKET;
+			}
+		}
+		#endif /* ipconfigTCP_WIN_SEG_MIN_PER_SOCKET */
 
 		vListInitialise( &pxWindow->xPriorityQueue );			/* Priority queue: segments which must be sent immediately */
 		vListInitialise( &pxWindow->xTxQueue   );			/* Transmit queue: segments queued for transmission */
@@ -654,9 +918,22 @@ void vTCPWindowCreate( TCPWindow_t *pxWindow, uint32_t ulRxWindowLength,
 void vTCPWindowInit( TCPWindow_t *pxWindow, uint32_t ulAckNumber, uint32_t ulSequenceNumber, uint32_t ulMSS )
 {
 const int32_t l500ms = 500;
+#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+	/* Whether time-stamps are used has been negotiated in the SYN phase. */
+	uint32_t ulTimeStamps = pxWindow->u.bits.bTimeStamps;
+#endif
+/* FREERTOS_SO_TCP_NODELAY may have been cleared before connecting. */
+uint32_t ulNagle = pxWindow->u.bits.bNagle;
 
 	pxWindow->u.ulFlags = 0ul;
 	pxWindow->u.bits.bHasInit = pdTRUE_UNSIGNED;
+	pxWindow->u.bits.bNagle = ulNagle;
+
+	#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+	{
+		pxWindow->u.bits.bTimeStamps = ulTimeStamps;
+	}
+	#endif
 
 	if( ulMSS != 0ul )
 	{
@@ -681,6 +958,14 @@ const int32_t l500ms = 500;
 	/*Start with a timeout of 2 * 500 ms (1 sec). */
 	pxWindow->lSRTT = l500ms;
 
+	#if( ipconfigTCP_RTO_RFC6298 != 0 )
+	{
+		/* RFC 6298 (2.1): until a RTT has been measured, RTO is 1 second. */
+		pxWindow->lRTTVar = 0;
+		pxWindow->lRTO = 2 * l500ms;
+	}
+	#endif
+
 	/* Just for logging, to print relative sequence numbers. */
 	pxWindow->rx.ulFirstSequenceNumber = ulAckNumber;
 
@@ -699,6 +984,25 @@ const int32_t l500ms = 500;
 	maintained by lTCPWindowTxAdd(). */
 	pxWindow->ulNextTxSequenceNumber = ulSequenceNumber;
 
+	#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+	{
+	uint32_t ulSegmentSize = ( uint32_t ) pxWindow->usMSS;
+
+		/* Start in slow-start, with an initial window of 2 to 4 segments.  The
+		slow-start threshold is unknown yet, it will be set by the first loss.
+		The algorithm itself, ucCongestionAlgorithm, is set by the owner of
+		the window and is not changed here. */
+		pxWindow->ulCongestionWindow = FreeRTOS_min_uint32( 4UL * ulSegmentSize,
+			FreeRTOS_max_uint32( 2UL * ulSegmentSize, winINITIAL_CONGESTION_WINDOW ) );
+		pxWindow->ulSlowStartThreshold = 0xffffffffUL;
+		pxWindow->ulBytesAcked = 0UL;
+		pxWindow->ulRecoverSequenceNumber = ulSequenceNumber;
+		pxWindow->ulCubicWindowMax = 0UL;
+		pxWindow->ulCubicRenoWindow = 0UL;
+		pxWindow->ulCubicK = 0UL;
+	}
+	#endif /* ipconfigTCP_CONGESTION_CONTROL */
+
 	/* The right-hand side of the transmit window. */
 	pxWindow->tx.ulHighestSequenceNumber = ulSequenceNumber;
 	pxWindow->ulOurSequenceNumber = ulSequenceNumber;
@@ -720,148 +1024,275 @@ const int32_t l500ms = 500;
  *
  *=============================================================================*/
 
-#if( ipconfigUSE_TCP_WIN == 1 )
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_RX_RANGE_COUNT > 0 )
 
-	static TCPSegment_t *xTCPWindowRxConfirm( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, uint32_t ulLength )
+	static UBaseType_t prvTCPWindowRxRangeSearch( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, BaseType_t xUseLast )
 	{
-	TCPSegment_t *pxBest = NULL;
-	const ListItem_t *pxIterator;
-	uint32_t ulNextSequenceNumber = ulSequenceNumber + ulLength;
-	const MiniListItem_t* pxEnd = ( const MiniListItem_t* ) listGET_END_MARKER( &pxWindow->xRxSegments );
-	TCPSegment_t *pxSegment;
+	UBaseType_t uxLow = 0u;
+	UBaseType_t uxHigh = pxWindow->uxRxRangeCount;
+	UBaseType_t uxMiddle;
+	uint32_t ulBase = pxWindow->rx.ulCurrentSequenceNumber;
+	uint32_t ulOffset = ulSequenceNumber - ulBase;
+	uint32_t ulKey;
+
+		/* All ranges lie ahead of rx.ulCurrentSequenceNumber, so sequence
+		numbers can be compared as unsigned distances from it. */
+		while( uxLow < uxHigh )
+		{
+			uxMiddle = ( uxLow + uxHigh ) / 2u;
 
-		/* A segment has been received with sequence number 'ulSequenceNumber',
-		where 'ulCurrentSequenceNumber == ulSequenceNumber', which means that
-		exactly this segment was expected.  xTCPWindowRxConfirm() will check if
-		there is already another segment with a sequence number between (ulSequenceNumber)
-		and (ulSequenceNumber+ulLength).  Normally none will be found, because
-		the next RX segment should have a sequence number equal to
-		'(ulSequenceNumber+ulLength)'. */
-
-		/* Iterate through all RX segments that are stored: */
-		for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxEnd );
-			 pxIterator != ( const ListItem_t * ) pxEnd;
-			 pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator ) )
-		{
-			pxSegment = ( TCPSegment_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
-			/* And see if there is a segment for which:
-			'ulSequenceNumber' <= 'pxSegment->ulSequenceNumber' < 'ulNextSequenceNumber'
-			If there are more matching segments, the one with the lowest sequence number
-			shall be taken */
-			if( ( xSequenceGreaterThanOrEqual( pxSegment->ulSequenceNumber, ulSequenceNumber ) != 0 ) &&
-				( xSequenceLessThan( pxSegment->ulSequenceNumber, ulNextSequenceNumber ) != 0 ) )
-			{
-				if( ( pxBest == NULL ) || ( xSequenceLessThan( pxSegment->ulSequenceNumber, pxBest->ulSequenceNumber ) != 0 ) )
-				{
-					pxBest = pxSegment;
-				}
+			if( xUseLast != pdFALSE )
+			{
+				ulKey = pxWindow->xRxRanges[ uxMiddle ].ulLastSequenceNumber;
+			}
+			else
+			{
+				ulKey = pxWindow->xRxRanges[ uxMiddle ].ulFirstSequenceNumber;
 			}
-		}
 
-		if( ( pxBest != NULL ) &&
-			( ( pxBest->ulSequenceNumber != ulSequenceNumber ) || ( pxBest->lDataLength != ( int32_t ) ulLength ) ) )
-		{
-			FreeRTOS_flush_logging();
-			FreeRTOS_debug_printf( ( "xTCPWindowRxConfirm[%u]: search %lu (+%ld=%lu) found %lu (+%ld=%lu)\n",
-				pxWindow->usPeerPortNumber,
-				ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
-				ulLength,
-				ulSequenceNumber + ulLength - pxWindow->rx.ulFirstSequenceNumber,
-				pxBest->ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
-				pxBest->lDataLength,
-				pxBest->ulSequenceNumber + ( ( uint32_t ) pxBest->lDataLength ) - pxWindow->rx.ulFirstSequenceNumber ) );
+			if( ( ulKey - ulBase ) < ulOffset )
+			{
+				uxLow = uxMiddle + 1u;
+			}
+			else
+			{
+				uxHigh = uxMiddle;
+			}
 		}
 
-		return pxBest;
+		return uxLow;
 	}
 
-#endif /* ipconfgiUSE_TCP_WIN == 1 */
+#endif /* ipconfigUSE_TCP_WIN && ipconfigTCP_RX_RANGE_COUNT */
 /*-----------------------------------------------------------*/
 
-#if( ipconfigUSE_TCP_WIN == 1 )
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_RX_RANGE_COUNT > 0 )
 
-	int32_t lTCPWindowRxCheck( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, uint32_t ulLength, uint32_t ulSpace )
+	static BaseType_t prvTCPWindowRxRangeAdd( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast, BaseType_t *pxDuplicate )
 	{
-	uint32_t ulCurrentSequenceNumber, ulLast, ulSavedSequenceNumber;
-	int32_t lReturn, lDistance;
-	TCPSegment_t *pxFound;
-
-		/* If lTCPWindowRxCheck( ) returns == 0, the packet will be passed
-		directly to user (segment is expected).  If it returns a positive
-		number, an earlier packet is missing, but this packet may be stored.
-		If negative, the packet has already been stored, or it is out-of-order,
-		or there is not enough space.
-
-		As a side-effect, pxWindow->ulUserDataLength will get set to non-zero,
-		if more Rx data may be passed to the user after this packet. */
-
-		ulCurrentSequenceNumber = pxWindow->rx.ulCurrentSequenceNumber;
+	TCPRxRange_t *pxRanges = pxWindow->xRxRanges;
+	uint32_t ulBase = pxWindow->rx.ulCurrentSequenceNumber;
+	UBaseType_t uxCount = pxWindow->uxRxRangeCount;
+	UBaseType_t uxLow, uxHigh;
+	BaseType_t xReturn;
 
-		/* For Selective Ack (SACK), used when out-of-sequence data come in. */
-		pxWindow->ucOptionLength = 0u;
+		*pxDuplicate = pdFALSE;
 
-		/* Non-zero if TCP-windows contains data which must be popped. */
-		pxWindow->ulUserDataLength = 0ul;
+		/* The ranges from 'uxLow' up to 'uxHigh' overlap or touch the new
+		data: 'uxLow' is the first range that ends at or beyond 'ulFirst',
+		'uxHigh' is the first range that starts beyond 'ulLast'. */
+		uxLow = prvTCPWindowRxRangeSearch( pxWindow, ulFirst, pdTRUE );
+		uxHigh = prvTCPWindowRxRangeSearch( pxWindow, ulLast + 1u, pdFALSE );
 
-		if( ulCurrentSequenceNumber == ulSequenceNumber )
+		if( uxLow == uxHigh )
 		{
-			/* This is the packet with the lowest sequence number we're waiting
-			for.  It can be passed directly to the rx stream. */
-			if( ulLength > ulSpace )
+			/* A new range must be inserted at 'uxLow'. */
+			if( uxCount >= ( UBaseType_t ) ipconfigTCP_RX_RANGE_COUNT )
 			{
-				FreeRTOS_debug_printf( ( "lTCPWindowRxCheck: Refuse %lu bytes, due to lack of space (%lu)\n", ulLength, ulSpace ) );
-				lReturn = -1;
+				xReturn = -1;
 			}
 			else
 			{
-				ulCurrentSequenceNumber += ulLength;
+				memmove( &( pxRanges[ uxLow + 1u ] ), &( pxRanges[ uxLow ] ), ( uxCount - uxLow ) * sizeof( pxRanges[ 0 ] ) );
+				pxRanges[ uxLow ].ulFirstSequenceNumber = ulFirst;
+				pxRanges[ uxLow ].ulLastSequenceNumber = ulLast;
+				pxWindow->uxRxRangeCount = uxCount + 1u;
+				xReturn = ( BaseType_t ) uxLow;
+			}
+		}
+		else
+		{
+			if( ( uxHigh == ( uxLow + 1u ) ) &&
+				( ( pxRanges[ uxLow ].ulFirstSequenceNumber - ulBase ) <= ( ulFirst - ulBase ) ) &&
+				( ( pxRanges[ uxLow ].ulLastSequenceNumber - ulBase ) >= ( ulLast - ulBase ) ) )
+			{
+				/* This data has been received before. */
+				*pxDuplicate = pdTRUE;
+			}
 
-				if( listCURRENT_LIST_LENGTH( &( pxWindow->xRxSegments ) ) != 0 )
-				{
-					ulSavedSequenceNumber = ulCurrentSequenceNumber;
+			/* Merge the ranges into the one at 'uxLow'. */
+			if( ( pxRanges[ uxLow ].ulFirstSequenceNumber - ulBase ) < ( ulFirst - ulBase ) )
+			{
+				ulFirst = pxRanges[ uxLow ].ulFirstSequenceNumber;
+			}
 
-					/* See if (part of) this segment has been stored already,
-					but this rarely happens. */
-					pxFound = xTCPWindowRxConfirm( pxWindow, ulSequenceNumber, ulLength );
-					if( pxFound != NULL )
-					{
-						ulCurrentSequenceNumber = pxFound->ulSequenceNumber + ( ( uint32_t ) pxFound->lDataLength );
+			if( ( pxRanges[ uxHigh - 1u ].ulLastSequenceNumber - ulBase ) > ( ulLast - ulBase ) )
+			{
+				ulLast = pxRanges[ uxHigh - 1u ].ulLastSequenceNumber;
+			}
 
-						/* Remove it because it will be passed to user directly. */
-						vTCPWindowFree( pxFound );
-					}
+			pxRanges[ uxLow ].ulFirstSequenceNumber = ulFirst;
+			pxRanges[ uxLow ].ulLastSequenceNumber = ulLast;
 
-					/*  Check for following segments that are already in the
-					queue and increment ulCurrentSequenceNumber. */
-					while( ( pxFound = xTCPWindowRxFind( pxWindow, ulCurrentSequenceNumber ) ) != NULL )
-					{
-						ulCurrentSequenceNumber += ( uint32_t ) pxFound->lDataLength;
+			if( uxHigh > ( uxLow + 1u ) )
+			{
+				memmove( &( pxRanges[ uxLow + 1u ] ), &( pxRanges[ uxHigh ] ), ( uxCount - uxHigh ) * sizeof( pxRanges[ 0 ] ) );
+				pxWindow->uxRxRangeCount = uxCount - ( uxHigh - uxLow - 1u );
+			}
 
-						/* As all packet below this one have been passed to the
-						user it can be discarded. */
-						vTCPWindowFree( pxFound );
-					}
+			xReturn = ( BaseType_t ) uxLow;
+		}
 
-					if( ulSavedSequenceNumber != ulCurrentSequenceNumber )
-					{
-						/*  After the current data-package, there is more data
-						to be popped. */
-						pxWindow->ulUserDataLength = ulCurrentSequenceNumber - ulSavedSequenceNumber;
+		return xReturn;
+	}
 
-						if( xTCPWindowLoggingLevel >= 1 )
-						{
-							FreeRTOS_debug_printf( ( "lTCPWindowRxCheck[%d,%d]: retran %lu (Found %lu bytes at %lu cnt %ld)\n",
-								pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
-								ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
-								pxWindow->ulUserDataLength,
-								ulSavedSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
-								listCURRENT_LIST_LENGTH( &pxWindow->xRxSegments ) ) );
-						}
-					}
-				}
+#endif /* ipconfigUSE_TCP_WIN && ipconfigTCP_RX_RANGE_COUNT */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_RX_RANGE_COUNT > 0 )
+
+	static uint32_t prvTCPWindowRxRangePop( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber )
+	{
+	TCPRxRange_t *pxRanges = pxWindow->xRxRanges;
+	UBaseType_t uxCount = pxWindow->uxRxRangeCount;
+	UBaseType_t uxIndex = 0u;
+
+		/* The ranges are sorted, so only the first ones can be reached by the
+		data that was just received.  Normally this is just one range, or
+		none. */
+		while( ( uxIndex < uxCount ) &&
+			   ( ( int32_t ) ( pxRanges[ uxIndex ].ulFirstSequenceNumber - ulSequenceNumber ) <= 0 ) )
+		{
+			if( ( int32_t ) ( pxRanges[ uxIndex ].ulLastSequenceNumber - ulSequenceNumber ) > 0 )
+			{
+				ulSequenceNumber = pxRanges[ uxIndex ].ulLastSequenceNumber;
+			}
+
+			uxIndex++;
+		}
+
+		if( uxIndex != 0u )
+		{
+			memmove( &( pxRanges[ 0 ] ), &( pxRanges[ uxIndex ] ), ( uxCount - uxIndex ) * sizeof( pxRanges[ 0 ] ) );
+			pxWindow->uxRxRangeCount = uxCount - uxIndex;
+		}
+
+		return ulSequenceNumber;
+	}
+
+#endif /* ipconfigUSE_TCP_WIN && ipconfigTCP_RX_RANGE_COUNT */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_RX_RANGE_COUNT > 0 )
+
+	static void prvTCPWindowRxSetSack( TCPWindow_t *pxWindow, BaseType_t xFirst )
+	{
+	UBaseType_t uxMaxBlocks = ( UBaseType_t ) ipconfigTCP_SACK_BLOCKS;
+	UBaseType_t uxBlocks = 1u;
+	UBaseType_t uxIndex;
+
+		#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+		{
+			if( ( pxWindow->u.bits.bTimeStamps != pdFALSE_UNSIGNED ) && ( uxMaxBlocks > winSACK_MAX_BLOCKS_WITH_TIMESTAMPS ) )
+			{
+				uxMaxBlocks = winSACK_MAX_BLOCKS_WITH_TIMESTAMPS;
+			}
+		}
+		#endif
+
+		/* RFC 2018: the first block contains the most recently received data,
+		the other ranges follow in order of sequence number. */
+		pxWindow->ulOptionsData[ 1 ] = FreeRTOS_htonl( pxWindow->xRxRanges[ xFirst ].ulFirstSequenceNumber );
+		pxWindow->ulOptionsData[ 2 ] = FreeRTOS_htonl( pxWindow->xRxRanges[ xFirst ].ulLastSequenceNumber );
+
+		for( uxIndex = 0u; ( uxIndex < pxWindow->uxRxRangeCount ) && ( uxBlocks < uxMaxBlocks ); uxIndex++ )
+		{
+			if( uxIndex != ( UBaseType_t ) xFirst )
+			{
+				pxWindow->ulOptionsData[ 1u + ( 2u * uxBlocks ) ] = FreeRTOS_htonl( pxWindow->xRxRanges[ uxIndex ].ulFirstSequenceNumber );
+				pxWindow->ulOptionsData[ 2u + ( 2u * uxBlocks ) ] = FreeRTOS_htonl( pxWindow->xRxRanges[ uxIndex ].ulLastSequenceNumber );
+				uxBlocks++;
+			}
+		}
+
+		/* Code OPTION_CODE_SACK is already in network byte order. */
+		pxWindow->ulOptionsData[ 0 ] = OPTION_CODE_SACK( uxBlocks );
+		pxWindow->ucOptionLength = ( uint8_t ) winSACK_OPTION_LENGTH( uxBlocks );
+	}
+
+#endif /* ipconfigUSE_TCP_WIN && ipconfigTCP_RX_RANGE_COUNT */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_TCP_WIN == 1 )
+
+	int32_t lTCPWindowRxCheck( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber, uint32_t ulLength, uint32_t ulSpace )
+	{
+	uint32_t ulCurrentSequenceNumber, ulLast;
+	int32_t lReturn, lDistance;
+	#if( ipconfigTCP_RX_RANGE_COUNT > 0 )
+		uint32_t ulSavedSequenceNumber;
+		BaseType_t xIndex, xDuplicate;
+	#endif
+
+		/* If lTCPWindowRxCheck( ) returns == 0, the packet will be passed
+		directly to user (segment is expected).  If it returns a positive
+		number, an earlier packet is missing, but this packet may be stored.
+		If negative, the packet has already been stored, or it is out-of-order,
+		or there is not enough space.
+
+		As a side-effect, pxWindow->ulUserDataLength will get set to non-zero,
+		if more Rx data may be passed to the user after this packet. */
+
+		ulCurrentSequenceNumber = pxWindow->rx.ulCurrentSequenceNumber;
+
+		/* For Selective Ack (SACK), used when out-of-sequence data come in. */
+		pxWindow->ucOptionLength = 0u;
+
+		/* Non-zero if TCP-windows contains data which must be popped. */
+		pxWindow->ulUserDataLength = 0ul;
+
+		if( ulCurrentSequenceNumber == ulSequenceNumber )
+		{
+			/* This is the packet with the lowest sequence number we're waiting
+			for.  It can be passed directly to the rx stream. */
+			if( ulLength > ulSpace )
+			{
+				FreeRTOS_debug_printf( ( "lTCPWindowRxCheck: Refuse %lu bytes, due to lack of space (%lu)\n", ulLength, ulSpace ) );
+				lReturn = -1;
+			}
+			else
+			{
+				ulCurrentSequenceNumber += ulLength;
+
+				#if( ipconfigTCP_RX_RANGE_COUNT > 0 )
+				if( pxWindow->uxRxRangeCount != 0u )
+				{
+					ulSavedSequenceNumber = ulCurrentSequenceNumber;
+
+					/*  Check for data that was received earlier and that
+					follows, or overlaps, this packet. */
+					ulCurrentSequenceNumber = prvTCPWindowRxRangePop( pxWindow, ulCurrentSequenceNumber );
+
+					if( ulSavedSequenceNumber != ulCurrentSequenceNumber )
+					{
+						/*  After the current data-package, there is more data
+						to be popped. */
+						pxWindow->ulUserDataLength = ulCurrentSequenceNumber - ulSavedSequenceNumber;
+
+						if( xTCPWindowLoggingLevel >= 1 )
+						{
+							FreeRTOS_debug_printf( ( "lTCPWindowRxCheck[%d,%d]: retran %lu (Found %lu bytes at %lu cnt %lu)\n",
+								pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
+								ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
+								pxWindow->ulUserDataLength,
+								ulSavedSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
+								pxWindow->uxRxRangeCount ) );
+						}
+					}
+				}
+				#endif /* ipconfigTCP_RX_RANGE_COUNT */
 
 				pxWindow->rx.ulCurrentSequenceNumber = ulCurrentSequenceNumber;
 
+				#if( ipconfigTCP_RX_RANGE_COUNT > 0 )
+				if( pxWindow->uxRxRangeCount != 0u )
+				{
+					/* There is still a gap, keep on reporting the ranges
+					beyond it. */
+					prvTCPWindowRxSetSack( pxWindow, 0 );
+				}
+				#endif /* ipconfigTCP_RX_RANGE_COUNT */
+
 				/* Packet was expected, may be passed directly to the socket
 				buffer or application.  Store the packet at offset 0. */
 				lReturn = 0;
@@ -897,64 +1328,53 @@ const int32_t l500ms = 500;
 				FreeRTOS_debug_printf( ( "lTCPWindowRxCheck: Refuse %lu+%lu bytes, due to lack of space (%lu)\n", lDistance, ulLength, ulSpace ) );
 				lReturn = -1;
 			}
+			else if( ( int32_t ) ( ulSequenceNumber - ulCurrentSequenceNumber ) < 0 )
+			{
+				/* The packet starts before rx.ulCurrentSequenceNumber, part of it
+				has been passed to the user already.  The peer will send the rest
+				again. */
+				lReturn = -1;
+			}
+			#if( ipconfigTCP_RX_RANGE_COUNT == 0 )
 			else
 			{
-				/* See if there is more data in a contiguous block to make the
-				SACK describe a longer range of data. */
-
-				/* TODO: SACK's may also be delayed for a short period
-				 * This is useful because subsequent packets will be SACK'd with
-				 * single one message
-				 */
-				while( ( pxFound = xTCPWindowRxFind( pxWindow, ulLast ) ) != NULL )
-				{
-					ulLast += ( uint32_t ) pxFound->lDataLength;
-				}
-
-				if( xTCPWindowLoggingLevel >= 1 )
-				{
-					FreeRTOS_debug_printf( ( "lTCPWindowRxCheck[%d,%d]: seqnr %lu exp %lu (dist %ld) SACK to %lu\n",
-						pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
-						ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
-						ulCurrentSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
-						( BaseType_t ) ( ulSequenceNumber - ulCurrentSequenceNumber ),	/* want this signed */
-						ulLast - pxWindow->rx.ulFirstSequenceNumber ) );
-				}
-
-				/* Now prepare the SACK message.
-				Code OPTION_CODE_SINGLE_SACK already in network byte order. */
-				pxWindow->ulOptionsData[0] = OPTION_CODE_SINGLE_SACK;
-
-				/* First sequence number that we received. */
-				pxWindow->ulOptionsData[1] = FreeRTOS_htonl( ulSequenceNumber );
-
-				/* Last + 1 */
-				pxWindow->ulOptionsData[2] = FreeRTOS_htonl( ulLast );
-
-				/* Which make 12 (3*4) option bytes. */
-				pxWindow->ucOptionLength = 3 * sizeof( pxWindow->ulOptionsData[ 0 ] );
-
-				pxFound = xTCPWindowRxFind( pxWindow, ulSequenceNumber );
+				/* Data received out of order is not stored, the peer will
+				send it again. */
+				lReturn = -1;
+			}
+			#else
+			else
+			{
+				/* Add the data to the ranges, merging it with the data around
+				it, so that the SACK describes the longest possible range. */
+				xIndex = prvTCPWindowRxRangeAdd( pxWindow, ulSequenceNumber, ulLast, &xDuplicate );
 
-				if( pxFound != NULL )
+				if( xIndex < 0 )
 				{
-					/* This out-of-sequence packet has been received for a
-					second time.  It is already stored but do send a SACK
-					again. */
+					/* Can not send a SACK, because the data cannot be stored:
+					there are already ipconfigTCP_RX_RANGE_COUNT ranges. */
+					FreeRTOS_debug_printf( ( "lTCPWindowRxCheck: Refuse %lu bytes, all %d ranges are in use\n", ulLength, ipconfigTCP_RX_RANGE_COUNT ) );
 					lReturn = -1;
 				}
 				else
 				{
-					pxFound = xTCPWindowRxNew( pxWindow, ulSequenceNumber, ( int32_t ) ulLength );
+					prvTCPWindowRxSetSack( pxWindow, xIndex );
 
-					if( pxFound == NULL )
+					if( xTCPWindowLoggingLevel >= 1 )
 					{
-						/* Can not send a SACK, because the segment cannot be
-						stored. */
-						pxWindow->ucOptionLength = 0u;
+						FreeRTOS_debug_printf( ( "lTCPWindowRxCheck[%d,%d]: seqnr %lu exp %lu (dist %ld) SACK to %lu\n",
+							pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
+							ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
+							ulCurrentSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
+							( BaseType_t ) ( ulSequenceNumber - ulCurrentSequenceNumber ),	/* want this signed */
+							pxWindow->xRxRanges[ xIndex ].ulLastSequenceNumber - pxWindow->rx.ulFirstSequenceNumber ) );
+					}
 
-						/* Needs to be stored but there is no segment
-						available. */
+					if( xDuplicate != pdFALSE )
+					{
+						/* This out-of-sequence packet has been received for a
+						second time.  It is already stored but do send a SACK
+						again. */
 						lReturn = -1;
 					}
 					else
@@ -963,7 +1383,7 @@ const int32_t l500ms = 500;
 						{
 							FreeRTOS_debug_printf( ( "lTCPWindowRxCheck[%u,%u]: seqnr %lu (cnt %lu)\n",
 								pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber, ulSequenceNumber - pxWindow->rx.ulFirstSequenceNumber,
-								listCURRENT_LIST_LENGTH( &pxWindow->xRxSegments ) ) );
+								pxWindow->uxRxRangeCount ) );
 							FreeRTOS_flush_logging( );
 						}
 
@@ -973,6 +1393,7 @@ const int32_t l500ms = 500;
 					}
 				}
 			}
+			#endif /* ipconfigTCP_RX_RANGE_COUNT */
 		}
 
 		return lReturn;
@@ -1141,7 +1562,7 @@ const int32_t l500ms = 500;
 
 	BaseType_t xTCPWindowTxDone( TCPWindow_t *pxWindow )
 	{
-		return listLIST_IS_EMPTY( ( &pxWindow->xTxSegments) );
+		return ( pxWindow->uxTxCount == 0u ) ? pdTRUE : pdFALSE;
 	}
 
 #endif /* ipconfigUSE_TCP_WIN == 1 */
@@ -1198,6 +1619,18 @@ const int32_t l500ms = 500;
 			{
 				xHasSpace = pdFALSE;
 			}
+
+			#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+			{
+				/* The congestion window limits the number of bytes in flight.
+				It is never smaller than MSS, so a single segment may always
+				be sent. */
+				if( pxWindow->ulCongestionWindow < ulTxOutstanding + ( ( uint32_t ) pxSegment->lDataLength ) )
+				{
+					xHasSpace = pdFALSE;
+				}
+			}
+			#endif /* ipconfigTCP_CONGESTION_CONTROL */
 		}
 
 		return xHasSpace;
@@ -1206,6 +1639,25 @@ const int32_t l500ms = 500;
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_TCP_WIN == 1 )
+
+	static BaseType_t prvTCPWindowTxNagle( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment )
+	{
+	BaseType_t xReturn = pdFALSE;
+
+		if( ( pxWindow->u.bits.bNagle != pdFALSE_UNSIGNED ) &&
+			( pxSegment->lDataLength < pxSegment->lMaxLength ) &&
+			( pxWindow->tx.ulHighestSequenceNumber != pxWindow->tx.ulCurrentSequenceNumber ) )
+		{
+			xReturn = pdTRUE;
+		}
+
+		return xReturn;
+	}
+
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP_WIN == 1 )
 
 	BaseType_t xTCPWindowTxHasData( TCPWindow_t *pxWindow, uint32_t ulWindowSize, TickType_t *pulDelay )
@@ -1234,9 +1686,9 @@ const int32_t l500ms = 500;
 				ulAge = ulTimerGetAge( &pxSegment->xTransmitTimer );
 
 				/* After a packet has been sent for the first time, it will wait
-				'1 * lSRTT' ms for an ACK. A second time it will wait '2 * lSRTT' ms,
+				'2 * lSRTT' ms for an ACK. A second time it will wait '4 * lSRTT' ms,
 				each time doubling the time-out */
-				ulMaxAge = ( 1u << pxSegment->u.bits.ucTransmitCount ) * ( ( uint32_t ) pxWindow->lSRTT );
+				ulMaxAge = prvTCPWindowSegmentTimeout( pxWindow, pxSegment );
 
 				if( ulMaxAge > ulAge )
 				{
@@ -1308,13 +1760,26 @@ const int32_t l500ms = 500;
 			if( pxSegment != NULL )
 			{
 				/* Do check the timing. */
-				ulMaxTime = ( 1u << pxSegment->u.bits.ucTransmitCount ) * ( ( uint32_t ) pxWindow->lSRTT );
+				ulMaxTime = prvTCPWindowSegmentTimeout( pxWindow, pxSegment );
 
 				if( ulTimerGetAge( &pxSegment->xTransmitTimer ) > ulMaxTime )
 				{
-					/* A normal (non-fast) retransmission.  Move it from the
-					head of the waiting queue. */
-					pxSegment = xTCPWindowGetHead( &( pxWindow->xWaitQueue ) );
+					#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+					{
+						pxSegment = prvTCPWindowCongestionResend( pxWindow, pxSegment );
+					}
+					#endif /* ipconfigTCP_CONGESTION_CONTROL */
+				}
+				else
+				{
+					pxSegment = NULL;
+				}
+
+				if( pxSegment != NULL )
+				{
+					/* A normal (non-fast) retransmission.  Remove it from the
+					waiting queue, normally from its head. */
+					uxListRemove( &( pxSegment->xQueueItem ) );
 					pxSegment->u.bits.ucDupAckCount = pdFALSE_UNSIGNED;
 
 					/* Some detailed logging. */
@@ -1329,10 +1794,6 @@ const int32_t l500ms = 500;
 						FreeRTOS_flush_logging( );
 					}
 				}
-				else
-				{
-					pxSegment = NULL;
-				}
 			}
 
 			if( pxSegment == NULL )
@@ -1352,6 +1813,12 @@ const int32_t l500ms = 500;
 					has a full size of MSS. */
 					ulReturn = 0;
 				}
+				else if( prvTCPWindowTxNagle( pxWindow, pxSegment ) != pdFALSE )
+				{
+					/* A small segment waits for the outstanding data to be
+					acknowledged. */
+					ulReturn = 0;
+				}
 				else if( prvTCPWindowTxHasSpace( pxWindow, ulWindowSize ) == pdFALSE )
 				{
 					/* Peer has no more space at this moment. */
@@ -1419,18 +1886,22 @@ const int32_t l500ms = 500;
 			retransmissions. */
 			( pxSegment->u.bits.ucTransmitCount )++;
 
-			/* If there have been several retransmissions (4), decrease the
-			size of the transmission window to at most 2 times MSS. */
-			if( pxSegment->u.bits.ucTransmitCount == MAX_TRANSMIT_COUNT_USING_LARGE_WINDOW )
+			#if( ipconfigTCP_CONGESTION_CONTROL == 0 )
 			{
-				if( pxWindow->xSize.ulTxWindowLength > ( 2U * pxWindow->usMSS ) )
+				/* If there have been several retransmissions (4), decrease the
+				size of the transmission window to at most 2 times MSS. */
+				if( pxSegment->u.bits.ucTransmitCount == MAX_TRANSMIT_COUNT_USING_LARGE_WINDOW )
 				{
-					FreeRTOS_debug_printf( ( "ulTCPWindowTxGet[%u - %d]: Change Tx window: %lu -> %u\n",
-						pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
-						pxWindow->xSize.ulTxWindowLength, 2 * pxWindow->usMSS ) );
-					pxWindow->xSize.ulTxWindowLength = ( 2UL * pxWindow->usMSS );
+					if( pxWindow->xSize.ulTxWindowLength > ( 2U * pxWindow->usMSS ) )
+					{
+						FreeRTOS_debug_printf( ( "ulTCPWindowTxGet[%u - %d]: Change Tx window: %lu -> %u\n",
+							pxWindow->usPeerPortNumber, pxWindow->usOurPortNumber,
+							pxWindow->xSize.ulTxWindowLength, 2 * pxWindow->usMSS ) );
+						pxWindow->xSize.ulTxWindowLength = ( 2UL * pxWindow->usMSS );
+					}
 				}
 			}
+			#endif /* ipconfigTCP_CONGESTION_CONTROL == 0 */
 
 			/* Clear the transmit timer. */
 			vTCPTimerSet( &( pxSegment->xTransmitTimer ) );
@@ -1450,22 +1921,179 @@ const int32_t l500ms = 500;
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_LARGE_SEND != 0 )
+
+	uint32_t ulTCPWindowTxGetBurst( TCPWindow_t *pxWindow, uint32_t ulWindowSize, int32_t *plPosition, uint32_t ulMaxLength )
+	{
+	TCPSegment_t *pxSegment;
+	uint32_t ulMaxTime;
+	uint32_t ulReturn = 0UL;
+	BaseType_t xRetransmit = pdFALSE;
+
+		/* Fetches a series of new segments which are contiguous in the
+		txStream, in order to send them in one go.  Resending segments is left
+		to ulTCPWindowTxGet(). */
+		if( listLIST_IS_EMPTY( &pxWindow->xPriorityQueue ) == pdFALSE )
+		{
+			xRetransmit = pdTRUE;
+		}
+		else
+		{
+			pxSegment = xTCPWindowPeekHead( &( pxWindow->xWaitQueue ) );
+
+			if( pxSegment != NULL )
+			{
+				ulMaxTime = prvTCPWindowSegmentTimeout( pxWindow, pxSegment );
+
+				if( ulTimerGetAge( &pxSegment->xTransmitTimer ) > ulMaxTime )
+				{
+					xRetransmit = pdTRUE;
+				}
+			}
+		}
+
+		while( xRetransmit == pdFALSE )
+		{
+			pxSegment = xTCPWindowPeekHead( &( pxWindow->xTxQueue ) );
+
+			if( pxSegment == NULL )
+			{
+				break;
+			}
+
+			if( ( pxWindow->u.bits.bSendFullSize != pdFALSE_UNSIGNED ) && ( pxSegment->lDataLength < pxSegment->lMaxLength ) )
+			{
+				break;
+			}
+
+			if( prvTCPWindowTxNagle( pxWindow, pxSegment ) != pdFALSE )
+			{
+				break;
+			}
+
+			/* All segments, except the last one, must have a length of exactly
+			MSS bytes, so that the caller can cut the data in the same way. */
+			if( ( pxSegment->lDataLength > ( int32_t ) pxWindow->usMSS ) ||
+				( ( ulReturn + ( uint32_t ) pxSegment->lDataLength ) > ulMaxLength ) )
+			{
+				break;
+			}
+
+			if( ( ulReturn != 0UL ) && ( pxSegment->ulSequenceNumber != pxWindow->tx.ulHighestSequenceNumber ) )
+			{
+				break;
+			}
+
+			if( prvTCPWindowTxHasSpace( pxWindow, ulWindowSize ) == pdFALSE )
+			{
+				break;
+			}
+
+			/* Move it out of the Tx queue. */
+			pxSegment = xTCPWindowGetHead( &( pxWindow->xTxQueue ) );
+
+			if( pxWindow->pxHeadSegment == pxSegment )
+			{
+				pxWindow->pxHeadSegment = NULL;
+			}
+
+			if( ulReturn == 0UL )
+			{
+				/* Inform the caller where to find the data and which sequence
+				number it starts with. */
+				*plPosition = pxSegment->lStreamPos;
+				pxWindow->ulOurSequenceNumber = pxSegment->ulSequenceNumber;
+			}
+
+			pxWindow->tx.ulHighestSequenceNumber = pxSegment->ulSequenceNumber + ( ( uint32_t ) pxSegment->lDataLength );
+
+			/* Add it to the tail of the waiting queue, mark it as outstanding
+			and start the transmit timer, just like ulTCPWindowTxGet() does. */
+			configASSERT( listLIST_ITEM_CONTAINER( &(pxSegment->xQueueItem ) ) == NULL );
+			vListInsertFifo( &pxWindow->xWaitQueue, &pxSegment->xQueueItem );
+			pxSegment->u.bits.bOutstanding = pdTRUE_UNSIGNED;
+			( pxSegment->u.bits.ucTransmitCount )++;
+			vTCPTimerSet( &( pxSegment->xTransmitTimer ) );
+
+			ulReturn += ( uint32_t ) pxSegment->lDataLength;
+
+			if( pxSegment->lDataLength < ( int32_t ) pxWindow->usMSS )
+			{
+				/* A short segment can only be the last one. */
+				break;
+			}
+		}
+
+		if( ( ulReturn != 0UL ) && ( xTCPWindowLoggingLevel >= 2 ) && ( ipconfigTCP_MAY_LOG_PORT( pxWindow->usOurPortNumber ) != pdFALSE ) )
+		{
+			FreeRTOS_debug_printf( ( "ulTCPWindowTxGetBurst[%u,%u]: %lu bytes for sequence number %lu (ws %lu)\n",
+				pxWindow->usPeerPortNumber,
+				pxWindow->usOurPortNumber,
+				ulReturn,
+				pxWindow->ulOurSequenceNumber - pxWindow->tx.ulFirstSequenceNumber,
+				ulWindowSize ) );
+		}
+
+		return ulReturn;
+	}
+
+#endif /* ( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_LARGE_SEND != 0 ) */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_TCP_WIN == 1 )
+
+	static UBaseType_t prvTCPWindowTxSearch( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber )
+	{
+	UBaseType_t uxLow = 0u;
+	UBaseType_t uxHigh = pxWindow->uxTxCount;
+	UBaseType_t uxMiddle;
+	uint32_t ulBase, ulOffset;
+
+		if( uxHigh != 0u )
+		{
+			/* All segments lie at or ahead of the oldest one, so sequence
+			numbers can be compared as unsigned distances from it.  A sequence
+			number before the oldest segment gets a very large distance. */
+			ulBase = winTX_SEGMENT_AT( pxWindow, 0u )->ulSequenceNumber;
+			ulOffset = ulSequenceNumber - ulBase;
+
+			while( uxLow < uxHigh )
+			{
+				uxMiddle = ( uxLow + uxHigh ) / 2u;
+
+				if( ( winTX_SEGMENT_AT( pxWindow, uxMiddle )->ulSequenceNumber - ulBase ) < ulOffset )
+				{
+					uxLow = uxMiddle + 1u;
+				}
+				else
+				{
+					uxHigh = uxMiddle;
+				}
+			}
+		}
+
+		return uxLow;
+	}
+
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP_WIN == 1 )
 
 	static uint32_t prvTCPWindowTxCheckAck( TCPWindow_t *pxWindow, uint32_t ulFirst, uint32_t ulLast )
 	{
 	uint32_t ulBytesConfirmed = 0u;
 	uint32_t ulSequenceNumber = ulFirst, ulDataLength;
-	const ListItem_t *pxIterator;
-	const MiniListItem_t *pxEnd = ( const MiniListItem_t* )listGET_END_MARKER( &pxWindow->xTxSegments );
+	UBaseType_t uxIndex;
 	BaseType_t xDoUnlink;
 	TCPSegment_t *pxSegment;
 		/* An acknowledgement or a selective ACK (SACK) was received.  See if some outstanding data
 		may be removed from the transmission queue(s).
 		All TX segments for which
 		( ( ulSequenceNumber >= ulFirst ) && ( ulSequenceNumber < ulLast ) in a
-		contiguous block.  Note that the segments are stored in xTxSegments in a
-		strict sequential order. */
+		contiguous block.  Note that the segments are stored in pxTxSegments[] in a
+		strict sequential order, so the first one can be found with a binary
+		search. */
 
 		/* SRTT[i] = (1-a) * SRTT[i-1] + a * RTT
 
@@ -1482,22 +2110,12 @@ const int32_t l500ms = 500;
 		 becoming smaller. */
 
 		for(
-				pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxEnd );
-				( pxIterator != ( const ListItem_t * ) pxEnd ) && ( xSequenceLessThan( ulSequenceNumber, ulLast ) != 0 );
+				uxIndex = prvTCPWindowTxSearch( pxWindow, ulFirst );
+				( uxIndex < pxWindow->uxTxCount ) && ( xSequenceLessThan( ulSequenceNumber, ulLast ) != 0 );
 			)
 		{
 			xDoUnlink = pdFALSE;
-			pxSegment = ( TCPSegment_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
-
-			/* Move to the next item because the current item might get
-			removed. */
-			pxIterator = ( const ListItem_t * ) listGET_NEXT( pxIterator );
-
-			/* Continue if this segment does not fall within the ACK'd range. */
-			if( xSequenceGreaterThan( ulSequenceNumber, pxSegment->ulSequenceNumber ) != pdFALSE )
-			{
-				continue;
-			}
+			pxSegment = winTX_SEGMENT_AT( pxWindow, uxIndex );
 
 			/* Is it ready? */
 			if( ulSequenceNumber != pxSegment->ulSequenceNumber )
@@ -1535,25 +2153,22 @@ const int32_t l500ms = 500;
 
 				/* Calculate the RTT only if the segment was sent-out for the
 				first time and if this is the last ACK'd segment in a range. */
-				if( ( pxSegment->u.bits.ucTransmitCount == 1 ) && ( ( pxSegment->ulSequenceNumber + ulDataLength ) == ulLast ) )
+				if( ( pxSegment->ulSequenceNumber + ulDataLength ) == ulLast )
 				{
-					int32_t mS = ( int32_t ) ulTimerGetAge( &( pxSegment->xTransmitTimer ) );
-
-					if( pxWindow->lSRTT >= mS )
+					#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+					if( ( pxWindow->u.bits.bTimeStamps != pdFALSE_UNSIGNED ) && ( pxWindow->tx.ulTimeStamp != 0UL ) )
 					{
-						/* RTT becomes smaller: adapt slowly. */
-						pxWindow->lSRTT = ( ( winSRTT_DECREMENT_NEW * mS ) + ( winSRTT_DECREMENT_CURRENT * pxWindow->lSRTT ) ) / ( winSRTT_DECREMENT_NEW + winSRTT_DECREMENT_CURRENT );
+						/* The peer echoed one of our time-stamps.  That gives a
+						valid sample, also after a retransmission (RFC 7323).
+						Use it only once. */
+						prvTCPWindowRTTSample( pxWindow, ( int32_t ) ( winTIMESTAMP_NOW() - pxWindow->tx.ulTimeStamp ) );
+						pxWindow->tx.ulTimeStamp = 0UL;
 					}
 					else
+					#endif /* ipconfigUSE_TCP_TIMESTAMPS */
+					if( pxSegment->u.bits.ucTransmitCount == 1 )
 					{
-						/* RTT becomes larger: adapt quicker */
-						pxWindow->lSRTT = ( ( winSRTT_INCREMENT_NEW * mS ) + ( winSRTT_INCREMENT_CURRENT * pxWindow->lSRTT ) ) / ( winSRTT_INCREMENT_NEW + winSRTT_INCREMENT_CURRENT );
-					}
-
-					/* Cap to the minimum of 50ms. */
-					if( pxWindow->lSRTT < winSRTT_CAP_mS )
-					{
-						pxWindow->lSRTT = winSRTT_CAP_mS;
+						prvTCPWindowRTTSample( pxWindow, ( int32_t ) ulTimerGetAge( &( pxSegment->xTransmitTimer ) ) );
 					}
 				}
 
@@ -1563,7 +2178,7 @@ const int32_t l500ms = 500;
 
 			/* pxSegment->u.bits.bAcked is now true.  Is it located at the left
 			side of the transmission queue?  If so, it may be freed. */
-			if( ulSequenceNumber == pxWindow->tx.ulCurrentSequenceNumber )
+			if( ( uxIndex == 0u ) && ( ulSequenceNumber == pxWindow->tx.ulCurrentSequenceNumber ) )
 			{
 				if( ( xTCPWindowLoggingLevel >= 2 ) && ( ipconfigTCP_MAY_LOG_PORT( pxWindow->usOurPortNumber ) != pdFALSE ) )
 				{
@@ -1580,12 +2195,17 @@ const int32_t l500ms = 500;
 				of txStream may be advanced. */
 				ulBytesConfirmed += ulDataLength;
 
-				/* All segments below tx.ulCurrentSequenceNumber may be freed. */
-				vTCPWindowFree( pxSegment );
+				/* All segments below tx.ulCurrentSequenceNumber may be freed.
+				The next segment becomes the oldest one, at index 0. */
+				vTCPWindowFree( pxWindow, pxSegment );
 
 				/* No need to unlink it any more. */
 				xDoUnlink = pdFALSE;
 			}
+			else
+			{
+				uxIndex++;
+			}
 
 			if( ( xDoUnlink != pdFALSE ) && ( listLIST_ITEM_CONTAINER( &( pxSegment->xQueueItem ) ) != NULL ) )
 			{
@@ -1601,35 +2221,133 @@ const int32_t l500ms = 500;
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_TCP_WIN == 1 )
+
+	static void prvTCPWindowRTTSample( TCPWindow_t *pxWindow, int32_t lRTT )
+	{
+		#if( ipconfigTCP_RTO_RFC6298 != 0 )
+		{
+		int32_t lDelta;
+
+			/* RFC 6298: keep the smoothed RTT and the RTT variation, and
+			let RTO = SRTT + 4 * RTTVAR. */
+			if( pxWindow->u.bits.bHasRTT == pdFALSE_UNSIGNED )
+			{
+				/* (2.2) The first measurement. */
+				pxWindow->u.bits.bHasRTT = pdTRUE_UNSIGNED;
+				pxWindow->lSRTT = lRTT;
+				pxWindow->lRTTVar = lRTT / 2;
+			}
+			else
+			{
+				/* (2.3) RTTVAR = 3/4 RTTVAR + 1/4 | SRTT - R |
+				SRTT = 7/8 SRTT + 1/8 R */
+				lDelta = pxWindow->lSRTT - lRTT;
+
+				if( lDelta < 0 )
+				{
+					lDelta = -lDelta;
+				}
+
+				pxWindow->lRTTVar = ( ( 3 * pxWindow->lRTTVar ) + lDelta ) / 4;
+				pxWindow->lSRTT = ( ( 7 * pxWindow->lSRTT ) + lRTT ) / 8;
+			}
+
+			/* The clock granularity is one tick. */
+			pxWindow->lRTO = pxWindow->lSRTT + FreeRTOS_max_int32( ( int32_t ) portTICK_PERIOD_MS, 4 * pxWindow->lRTTVar );
+
+			/* (2.4) and (2.5): a lower and an upper limit. */
+			if( pxWindow->lRTO < ( int32_t ) ipconfigTCP_RTO_MIN_MS )
+			{
+				pxWindow->lRTO = ( int32_t ) ipconfigTCP_RTO_MIN_MS;
+			}
+			else if( pxWindow->lRTO > ( int32_t ) ipconfigTCP_RTO_MAX_MS )
+			{
+				pxWindow->lRTO = ( int32_t ) ipconfigTCP_RTO_MAX_MS;
+			}
+		}
+		#else
+		{
+			if( pxWindow->lSRTT >= lRTT )
+			{
+				/* RTT becomes smaller: adapt slowly. */
+				pxWindow->lSRTT = ( ( winSRTT_DECREMENT_NEW * lRTT ) + ( winSRTT_DECREMENT_CURRENT * pxWindow->lSRTT ) ) / ( winSRTT_DECREMENT_NEW + winSRTT_DECREMENT_CURRENT );
+			}
+			else
+			{
+				/* RTT becomes larger: adapt quicker */
+				pxWindow->lSRTT = ( ( winSRTT_INCREMENT_NEW * lRTT ) + ( winSRTT_INCREMENT_CURRENT * pxWindow->lSRTT ) ) / ( winSRTT_INCREMENT_NEW + winSRTT_INCREMENT_CURRENT );
+			}
+
+			/* Cap to the minimum of 50ms. */
+			if( pxWindow->lSRTT < winSRTT_CAP_mS )
+			{
+				pxWindow->lSRTT = winSRTT_CAP_mS;
+			}
+		}
+		#endif /* ipconfigTCP_RTO_RFC6298 */
+	}
+
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_TCP_WIN == 1 )
+
+	static uint32_t prvTCPWindowSegmentTimeout( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment )
+	{
+	uint32_t ulTimeout;
+
+		#if( ipconfigTCP_RTO_RFC6298 != 0 )
+		{
+		UBaseType_t uxCount;
+
+			/* (5.5) Back off the timer: RTO doubles with every retransmission,
+			up to the maximum. */
+			ulTimeout = ( uint32_t ) pxWindow->lRTO;
+
+			for( uxCount = 1u; ( uxCount < ( UBaseType_t ) pxSegment->u.bits.ucTransmitCount ) && ( ulTimeout < ( uint32_t ) ipconfigTCP_RTO_MAX_MS ); uxCount++ )
+			{
+				ulTimeout *= 2UL;
+			}
+
+			ulTimeout = FreeRTOS_min_uint32( ulTimeout, ( uint32_t ) ipconfigTCP_RTO_MAX_MS );
+		}
+		#else
+		{
+			/* RTO = 2 * SRTT, doubled with every retransmission. */
+			ulTimeout = ( 1u << pxSegment->u.bits.ucTransmitCount ) * ( ( uint32_t ) pxWindow->lSRTT );
+		}
+		#endif /* ipconfigTCP_RTO_RFC6298 */
+
+		return ulTimeout;
+	}
+
+#endif /* ipconfigUSE_TCP_WIN == 1 */
+/*-----------------------------------------------------------*/
+
 #if( ipconfigUSE_TCP_WIN == 1 )
 
 	static uint32_t prvTCPWindowFastRetransmit( TCPWindow_t *pxWindow, uint32_t ulFirst )
 	{
-	const ListItem_t *pxIterator;
-	const MiniListItem_t* pxEnd;
+	UBaseType_t uxIndex, uxLimit;
 	TCPSegment_t *pxSegment;
 	uint32_t ulCount = 0UL;
 
 		/* A higher Tx block has been acknowledged.  Now iterate through the
-		 xWaitQueue to find a possible condition for a FAST retransmission. */
-
-		pxEnd = ( const MiniListItem_t* ) listGET_END_MARKER( &( pxWindow->xWaitQueue ) );
+		outstanding segments below it, to find a possible condition for a FAST
+		retransmission.  Segments at or beyond 'ulFirst' are not visited. */
+		uxLimit = prvTCPWindowTxSearch( pxWindow, ulFirst );
 
-		for( pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxEnd );
-			 pxIterator != ( const ListItem_t * ) pxEnd; )
+		for( uxIndex = 0u; uxIndex < uxLimit; uxIndex++ )
 		{
-			/* Get the owner, which is a TCP segment. */
-			pxSegment = ( TCPSegment_t * ) listGET_LIST_ITEM_OWNER( pxIterator );
-
-			/* Hop to the next item before the current gets unlinked. */
-			pxIterator  = ( const ListItem_t * ) listGET_NEXT( pxIterator );
+			pxSegment = winTX_SEGMENT_AT( pxWindow, uxIndex );
 
 			/* Fast retransmission:
 			When 3 packets with a higher sequence number have been acknowledged
 			by the peer, it is very unlikely a current packet will ever arrive.
 			It will be retransmitted far before the RTO. */
 			if( ( pxSegment->u.bits.bAcked == pdFALSE_UNSIGNED ) &&
-				( xSequenceLessThan( pxSegment->ulSequenceNumber, ulFirst ) != pdFALSE ) &&
+				( listLIST_ITEM_CONTAINER( &( pxSegment->xQueueItem ) ) == &( pxWindow->xWaitQueue ) ) &&
 				( ++( pxSegment->u.bits.ucDupAckCount ) == DUPLICATE_ACKS_BEFORE_FAST_RETRANSMIT ) )
 			{
 				pxSegment->u.bits.ucTransmitCount = pdFALSE_UNSIGNED;
@@ -1676,6 +2394,15 @@ const int32_t l500ms = 500;
 		else
 		{
 			ulReturn = prvTCPWindowTxCheckAck( pxWindow, ulFirstSequence, ulSequenceNumber );
+
+			#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+			{
+				if( ulReturn != 0UL )
+				{
+					prvTCPWindowCongestionAck( pxWindow, ulReturn, ulSequenceNumber );
+				}
+			}
+			#endif /* ipconfigTCP_CONGESTION_CONTROL */
 		}
 
 		return ulReturn;
@@ -1693,7 +2420,23 @@ const int32_t l500ms = 500;
 
 		/* Receive a SACK option. */
 		ulAckCount = prvTCPWindowTxCheckAck( pxWindow, ulFirst, ulLast );
-		prvTCPWindowFastRetransmit( pxWindow, ulFirst );
+
+		#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+		{
+			/* A fast retransmission means that a segment was lost.  The
+			window is only reduced once per window of data: no more while in
+			fast recovery. */
+			if( ( prvTCPWindowFastRetransmit( pxWindow, ulFirst ) != 0UL ) &&
+				( pxWindow->u.bits.bFastRecovery == pdFALSE_UNSIGNED ) )
+			{
+				prvTCPWindowCongestionLoss( pxWindow, pdFALSE );
+			}
+		}
+		#else
+		{
+			prvTCPWindowFastRetransmit( pxWindow, ulFirst );
+		}
+		#endif /* ipconfigTCP_CONGESTION_CONTROL */
 
 		if( ( xTCPWindowLoggingLevel >= 1 ) && ( xSequenceGreaterThan( ulFirst, ulCurrentSequenceNumber ) != pdFALSE ) )
 		{
@@ -1712,6 +2455,343 @@ const int32_t l500ms = 500;
 #endif /* ipconfigUSE_TCP_WIN == 1 */
 /*-----------------------------------------------------------*/
 
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+
+	static TCPSegment_t *prvTCPWindowOldestTxSegment( TCPWindow_t *pxWindow )
+	{
+	TCPSegment_t *pxSegment;
+
+		/* pxTxSegments[] is sorted on sequence number and segments are freed
+		as soon as they're ACK'd at the left side of the window.  The first one
+		contains tx.ulCurrentSequenceNumber. */
+		if( pxWindow->uxTxCount == 0u )
+		{
+			pxSegment = NULL;
+		}
+		else
+		{
+			pxSegment = winTX_SEGMENT_AT( pxWindow, 0u );
+		}
+
+		return pxSegment;
+	}
+
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+
+	static uint32_t prvCubeRoot( uint32_t ulValue )
+	{
+	uint32_t ulLow = 0UL, ulHigh = 1625UL, ulMid;
+
+		/* Returns the largest integer whose third power does not exceed
+		'ulValue'.  1625^3 is just below 2^32. */
+		while( ulLow < ulHigh )
+		{
+			ulMid = ( ulLow + ulHigh + 1UL ) / 2UL;
+
+			if( ( ulMid * ulMid * ulMid ) <= ulValue )
+			{
+				ulLow = ulMid;
+			}
+			else
+			{
+				ulHigh = ulMid - 1UL;
+			}
+		}
+
+		return ulLow;
+	}
+
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+
+	static TCPSegment_t *prvTCPWindowCongestionResend( TCPWindow_t *pxWindow, TCPSegment_t *pxSegment )
+	{
+	TCPSegment_t *pxOldest;
+	uint32_t ulEnd;
+
+		/* After a time-out, all outstanding segments will time-out one after
+		the other.  Only resend those that fall within the congestion window,
+		counted from the left side of the sliding window.  The others will be
+		resent as soon as the ACK's make the window move. */
+		ulEnd = pxSegment->ulSequenceNumber + ( uint32_t ) pxSegment->lDataLength;
+
+		if( ( ulEnd - pxWindow->tx.ulCurrentSequenceNumber ) > pxWindow->ulCongestionWindow )
+		{
+			/* The oldest segment may not be at the head of the waiting queue
+			when it was resent recently.  Make sure that it isn't blocked by
+			the others. */
+			pxSegment = NULL;
+			pxOldest = prvTCPWindowOldestTxSegment( pxWindow );
+
+			if( ( pxOldest != NULL ) &&
+				( pxOldest->u.bits.bAcked == pdFALSE_UNSIGNED ) &&
+				( listLIST_ITEM_CONTAINER( &( pxOldest->xQueueItem ) ) == &( pxWindow->xWaitQueue ) ) &&
+				( ulTimerGetAge( &( pxOldest->xTransmitTimer ) ) > prvTCPWindowSegmentTimeout( pxWindow, pxOldest ) ) )
+			{
+				pxSegment = pxOldest;
+			}
+		}
+
+		/* The first time-out of the oldest segment is a sign of congestion.
+		When it times out again, ssthresh is kept as it is (RFC 5681). */
+		if( ( pxSegment != NULL ) &&
+			( pxSegment->ulSequenceNumber == pxWindow->tx.ulCurrentSequenceNumber ) &&
+			( pxSegment->u.bits.ucTransmitCount == 1u ) )
+		{
+			prvTCPWindowCongestionLoss( pxWindow, pdTRUE );
+		}
+
+		return pxSegment;
+	}
+
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+
+	static void prvTCPWindowCongestionLoss( TCPWindow_t *pxWindow, BaseType_t xTimeout )
+	{
+	uint32_t ulSegmentSize = ( uint32_t ) pxWindow->usMSS;
+	uint32_t ulFlightSize = pxWindow->tx.ulHighestSequenceNumber - pxWindow->tx.ulCurrentSequenceNumber;
+	uint32_t ulWindow = pxWindow->ulCongestionWindow;
+
+		if( pxWindow->ucCongestionAlgorithm == ( uint8_t ) FREERTOS_TCP_CC_CUBIC )
+		{
+			/* Remember the size before the reduction.  When the window didn't
+			reach the previous maximum, release some bandwidth for other flows
+			(fast convergence). */
+			if( ulWindow < pxWindow->ulCubicWindowMax )
+			{
+				pxWindow->ulCubicWindowMax = ( ulWindow / 20UL ) * 17UL;
+			}
+			else
+			{
+				pxWindow->ulCubicWindowMax = ulWindow;
+			}
+
+			/* Multiplicative decrease with beta = 0.7. */
+			pxWindow->ulSlowStartThreshold = ( ulWindow / 10UL ) * 7UL;
+			pxWindow->u.bits.bCubicEpoch = pdFALSE_UNSIGNED;
+		}
+		else
+		{
+			/* NewReno: half of the data in flight (RFC 5681). */
+			pxWindow->ulSlowStartThreshold = ulFlightSize / 2UL;
+		}
+
+		if( pxWindow->ulSlowStartThreshold < 2UL * ulSegmentSize )
+		{
+			pxWindow->ulSlowStartThreshold = 2UL * ulSegmentSize;
+		}
+
+		if( xTimeout != pdFALSE )
+		{
+			/* Restart in slow-start with a single segment. */
+			pxWindow->ulCongestionWindow = ulSegmentSize;
+			pxWindow->u.bits.bFastRecovery = pdFALSE_UNSIGNED;
+		}
+		else
+		{
+			/* Fast recovery lasts until all data that is in flight now has
+			been acknowledged. */
+			pxWindow->ulCongestionWindow = pxWindow->ulSlowStartThreshold;
+			pxWindow->ulRecoverSequenceNumber = pxWindow->tx.ulHighestSequenceNumber;
+			pxWindow->u.bits.bFastRecovery = pdTRUE_UNSIGNED;
+		}
+
+		pxWindow->ulBytesAcked = 0UL;
+
+		if( ( xTCPWindowLoggingLevel != 0 ) && ( ipconfigTCP_MAY_LOG_PORT( pxWindow->usOurPortNumber ) != pdFALSE ) )
+		{
+			FreeRTOS_debug_printf( ( "prvTCPWindowCongestionLoss[%u,%u]: %s cwnd %lu -> %lu ssthresh %lu\n",
+				pxWindow->usPeerPortNumber,
+				pxWindow->usOurPortNumber,
+				( xTimeout != pdFALSE ) ? "time-out" : "fast",
+				ulWindow,
+				pxWindow->ulCongestionWindow,
+				pxWindow->ulSlowStartThreshold ) );
+		}
+	}
+
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+
+	static void prvTCPWindowCongestionAck( TCPWindow_t *pxWindow, uint32_t ulAcked, uint32_t ulAckNumber )
+	{
+	uint32_t ulSegmentSize = ( uint32_t ) pxWindow->usMSS;
+	TCPSegment_t *pxSegment;
+
+		if( pxWindow->u.bits.bFastRecovery != pdFALSE_UNSIGNED )
+		{
+			if( xSequenceGreaterThanOrEqual( ulAckNumber, pxWindow->ulRecoverSequenceNumber ) != pdFALSE )
+			{
+				/* A full ACK: leave fast recovery. */
+				pxWindow->u.bits.bFastRecovery = pdFALSE_UNSIGNED;
+				pxWindow->ulCongestionWindow = pxWindow->ulSlowStartThreshold;
+			}
+			else
+			{
+				/* A partial ACK: the next segment was lost as well (RFC 6582).
+				Resend it right now, without waiting for more SACK's. */
+				pxSegment = prvTCPWindowOldestTxSegment( pxWindow );
+
+				if( ( pxSegment != NULL ) &&
+					( pxSegment->u.bits.bAcked == pdFALSE_UNSIGNED ) &&
+					( listLIST_ITEM_CONTAINER( &( pxSegment->xQueueItem ) ) == &( pxWindow->xWaitQueue ) ) )
+				{
+					uxListRemove( &( pxSegment->xQueueItem ) );
+					pxSegment->u.bits.ucTransmitCount = pdFALSE_UNSIGNED;
+					vListInsertFifo( &( pxWindow->xPriorityQueue ), &( pxSegment->xQueueItem ) );
+				}
+
+				/* Deflate the window by the amount of new data ACK'd, and add
+				back one segment. */
+				pxWindow->ulCongestionWindow -= FreeRTOS_min_uint32( ulAcked, pxWindow->ulCongestionWindow - ulSegmentSize );
+				pxWindow->ulCongestionWindow += ulSegmentSize;
+			}
+		}
+		else if( pxWindow->ulCongestionWindow < pxWindow->ulSlowStartThreshold )
+		{
+			/* Slow-start: grow with at most one segment per ACK (RFC 3465). */
+			pxWindow->ulCongestionWindow += FreeRTOS_min_uint32( ulAcked, ulSegmentSize );
+		}
+		else if( pxWindow->ucCongestionAlgorithm == ( uint8_t ) FREERTOS_TCP_CC_CUBIC )
+		{
+			prvTCPWindowCubicUpdate( pxWindow, ulAcked );
+		}
+		else
+		{
+			/* Congestion avoidance: grow with one segment per window of
+			ACK'd data. */
+			pxWindow->ulBytesAcked += ulAcked;
+
+			if( pxWindow->ulBytesAcked >= pxWindow->ulCongestionWindow )
+			{
+				pxWindow->ulBytesAcked -= pxWindow->ulCongestionWindow;
+				pxWindow->ulCongestionWindow += ulSegmentSize;
+			}
+		}
+
+		/* There is no use in a congestion window that is larger than the
+		transmission window. */
+		if( pxWindow->ulCongestionWindow > pxWindow->xSize.ulTxWindowLength )
+		{
+			pxWindow->ulCongestionWindow = FreeRTOS_max_uint32( pxWindow->xSize.ulTxWindowLength, ulSegmentSize );
+		}
+	}
+
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+/*-----------------------------------------------------------*/
+
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+
+	static void prvTCPWindowCubicUpdate( TCPWindow_t *pxWindow, uint32_t ulAcked )
+	{
+	uint32_t ulSegmentSize = ( uint32_t ) pxWindow->usMSS;
+	uint32_t ulWindow = pxWindow->ulCongestionWindow;
+	uint32_t ulSegments, ulTime, ulOffset, ulTarget, ulThreshold;
+
+		if( pxWindow->u.bits.bCubicEpoch == pdFALSE_UNSIGNED )
+		{
+			/* A new epoch starts: the window will grow along a cubic curve,
+			which reaches ulCubicWindowMax after K units of time. */
+			pxWindow->u.bits.bCubicEpoch = pdTRUE_UNSIGNED;
+			vTCPTimerSet( &( pxWindow->xCubicEpoch ) );
+			pxWindow->ulBytesAcked = 0UL;
+			pxWindow->ulCubicRenoWindow = ulWindow;
+
+			if( ulWindow < pxWindow->ulCubicWindowMax )
+			{
+				/* K = cubic_root( ( Wmax - cwnd ) / C ) */
+				ulSegments = FreeRTOS_min_uint32( ( pxWindow->ulCubicWindowMax - ulWindow ) / ulSegmentSize, 0xffffffffUL / winCUBIC_SCALE );
+				pxWindow->ulCubicK = prvCubeRoot( ulSegments * winCUBIC_SCALE );
+			}
+			else
+			{
+				pxWindow->ulCubicK = 0UL;
+				pxWindow->ulCubicWindowMax = ulWindow;
+			}
+		}
+
+		/* The time since the start of the epoch, looking one RTT ahead, in
+		units of 1/32 sec. */
+		ulTime = ulTimerGetAge( &( pxWindow->xCubicEpoch ) ) + ( uint32_t ) pxWindow->lSRTT;
+		ulTime = ( FreeRTOS_min_uint32( ulTime, 600000UL ) * 4UL ) / 125UL;
+
+		/* W( t ) = C * ( t - K )^3 + Wmax */
+		if( ulTime >= pxWindow->ulCubicK )
+		{
+			ulOffset = FreeRTOS_min_uint32( ulTime - pxWindow->ulCubicK, winCUBIC_MAX_TIME_UNITS );
+		}
+		else
+		{
+			ulOffset = FreeRTOS_min_uint32( pxWindow->ulCubicK - ulTime, winCUBIC_MAX_TIME_UNITS );
+		}
+
+		/* The offset in bytes, calculated in units of 1/16 segment. */
+		ulOffset = ( ( ( ulOffset * ulOffset * ulOffset ) / ( winCUBIC_SCALE / 16UL ) ) * ulSegmentSize ) / 16UL;
+
+		if( ulTime >= pxWindow->ulCubicK )
+		{
+			ulTarget = pxWindow->ulCubicWindowMax + ulOffset;
+		}
+		else if( pxWindow->ulCubicWindowMax > ulOffset + ulSegmentSize )
+		{
+			ulTarget = pxWindow->ulCubicWindowMax - ulOffset;
+		}
+		else
+		{
+			ulTarget = ulSegmentSize;
+		}
+
+		/* Do not grow faster than 1.5 times per RTT. */
+		ulTarget = FreeRTOS_min_uint32( ulTarget, ulWindow + ( ulWindow / 2UL ) );
+
+		/* The TCP-friendly region: never be slower than NewReno would be.
+		With beta = 0.7, NewReno would grow with 3*(1-beta)/(1+beta) = 9/17
+		segments per RTT. */
+		pxWindow->ulCubicRenoWindow += ( ( ( ulAcked * 9UL ) / 17UL ) * ulSegmentSize ) / ulWindow;
+
+		if( ulTarget < pxWindow->ulCubicRenoWindow )
+		{
+			ulTarget = pxWindow->ulCubicRenoWindow;
+		}
+
+		/* Grow with one segment for every 'ulThreshold' bytes ACK'd, so that
+		cwnd reaches the target within one RTT. */
+		if( ulTarget > ulWindow )
+		{
+			ulThreshold = ( ulWindow / ( ulTarget - ulWindow ) ) * ulSegmentSize;
+		}
+		else
+		{
+			ulThreshold = 100UL * ulWindow;
+		}
+
+		if( ulThreshold < ulSegmentSize )
+		{
+			ulThreshold = ulSegmentSize;
+		}
+
+		pxWindow->ulBytesAcked += ulAcked;
+
+		if( pxWindow->ulBytesAcked >= ulThreshold )
+		{
+			pxWindow->ulBytesAcked -= ulThreshold;
+			pxWindow->ulCongestionWindow += ulSegmentSize;
+		}
+	}
+
+#endif /* ipconfigTCP_CONGESTION_CONTROL */
+/*-----------------------------------------------------------*/
+
 /*
 #####   #                      #####   ####  ######
 # # #   #                      # # #  #    #  #    #
@@ -82,6 +82,19 @@
 /* The expected IP version and header length coded into the IP header itself. */
 #define ipIP_VERSION_AND_HEADER_LENGTH_BYTE ( ( uint8_t ) 0x45 )
 
+/*
+ * Fill in the UDP, IP and Ethernet headers of a packet created by
+ * FreeRTOS_sendto(), once the MAC address of the target is known.
+ */
+static void prvUDPFillHeaders( NetworkBufferDescriptor_t * const pxNetworkBuffer );
+
+/*
+ * Extend frames that are shorter than ipconfigETHERNET_MINIMUM_PACKET_BYTES.
+ */
+static void prvUDPPadFrame( NetworkBufferDescriptor_t * const pxNetworkBuffer );
+
+/*-----------------------------------------------------------*/
+
 /* Part of the Ethernet and IP headers are always constant when sending an IPv4
 UDP packet.  This array defines the constant parts, allowing this part of the
 packet to be filled in using a simple memcpy() instead of individual writes. */
@@ -107,7 +120,6 @@ UDPPacketHeader_t xDefaultPartUDPPacketHeader =
 void vProcessGeneratedUDPPacket( NetworkBufferDescriptor_t * const pxNetworkBuffer )
 {
 UDPPacket_t *pxUDPPacket;
-IPHeader_t *pxIPHeader;
 eARPLookupResult_t eReturned;
 uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
 
@@ -121,96 +133,9 @@ uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
 	{
 		if( eReturned == eARPCacheHit )
 		{
-			#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
-				uint8_t ucSocketOptions;
-			#endif
 			iptraceSENDING_UDP_PACKET( pxNetworkBuffer->ulIPAddress );
 
-			/* Create short cuts to the data within the packet. */
-			pxIPHeader = &( pxUDPPacket->xIPHeader );
-
-		#if ( ipconfigSUPPORT_OUTGOING_PINGS == 1 )
-			/* Is it possible that the packet is not actually a UDP packet
-			after all, but an ICMP packet. */
-			if( pxNetworkBuffer->usPort != ipPACKET_CONTAINS_ICMP_DATA )
-		#endif /* ipconfigSUPPORT_OUTGOING_PINGS */
-			{
-			UDPHeader_t *pxUDPHeader;
-
-				pxUDPHeader = &( pxUDPPacket->xUDPHeader );
-
-				pxUDPHeader->usDestinationPort = pxNetworkBuffer->usPort;
-				pxUDPHeader->usSourcePort = pxNetworkBuffer->usBoundPort;
-				pxUDPHeader->usLength = ( uint16_t ) ( pxNetworkBuffer->xDataLength + sizeof( UDPHeader_t ) );
-				pxUDPHeader->usLength = FreeRTOS_htons( pxUDPHeader->usLength );
-				pxUDPHeader->usChecksum = 0u;
-			}
-
-			/* memcpy() the constant parts of the header information into
-			the	correct location within the packet.  This fills in:
-				xEthernetHeader.xSourceAddress
-				xEthernetHeader.usFrameType
-				xIPHeader.ucVersionHeaderLength
-				xIPHeader.ucDifferentiatedServicesCode
-				xIPHeader.usLength
-				xIPHeader.usIdentification
-				xIPHeader.usFragmentOffset
-				xIPHeader.ucTimeToLive
-				xIPHeader.ucProtocol
-			and
-				xIPHeader.usHeaderChecksum
-			*/
-			/* Save options now, as they will be overwritten by memcpy */
-			#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
-				ucSocketOptions = pxNetworkBuffer->pucEthernetBuffer[ ipSOCKET_OPTIONS_OFFSET ];
-			#endif
-			memcpy( ( void *) &( pxUDPPacket->xEthernetHeader.xSourceAddress ), ( void * ) xDefaultPartUDPPacketHeader.ucBytes, sizeof( xDefaultPartUDPPacketHeader ) );
-
-		#if ipconfigSUPPORT_OUTGOING_PINGS == 1
-			if( pxNetworkBuffer->usPort == ipPACKET_CONTAINS_ICMP_DATA )
-			{
-				pxIPHeader->ucProtocol = ipPROTOCOL_ICMP;
-				pxIPHeader->usLength = ( uint16_t ) ( pxNetworkBuffer->xDataLength + sizeof( IPHeader_t ) );
-			}
-			else
-		#endif /* ipconfigSUPPORT_OUTGOING_PINGS */
-			{
-				pxIPHeader->usLength = ( uint16_t ) ( pxNetworkBuffer->xDataLength + sizeof( IPHeader_t ) + sizeof( UDPHeader_t ) );
-			}
-
-			/* The total transmit size adds on the Ethernet header. */
-			pxNetworkBuffer->xDataLength = pxIPHeader->usLength + sizeof( EthernetHeader_t );
-			pxIPHeader->usLength = FreeRTOS_htons( pxIPHeader->usLength );
-			/* HT:endian: changed back to network endian */
-			pxIPHeader->ulDestinationIPAddress = pxNetworkBuffer->ulIPAddress;
-
-			#if( ipconfigUSE_LLMNR == 1 )
-			{
-				/* LLMNR messages are typically used on a LAN and they're
-				 * not supposed to cross routers */
-				if( pxNetworkBuffer->ulIPAddress == ipLLMNR_IP_ADDR )
-				{
-					pxIPHeader->ucTimeToLive = 0x01;
-				}
-			}
-			#endif
-
-			#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
-			{
-				pxIPHeader->usHeaderChecksum = 0u;
-				pxIPHeader->usHeaderChecksum = usGenerateChecksum( 0UL, ( uint8_t * ) &( pxIPHeader->ucVersionHeaderLength ), ipSIZE_OF_IPv4_HEADER );
-				pxIPHeader->usHeaderChecksum = ~FreeRTOS_htons( pxIPHeader->usHeaderChecksum );
-
-				if( ( ucSocketOptions & ( uint8_t ) FREERTOS_SO_UDPCKSUM_OUT ) != 0u )
-				{
-					usGenerateProtocolChecksum( (uint8_t*)pxUDPPacket, pdTRUE );
-				}
-				else
-				{
-					pxUDPPacket->xUDPHeader.usChecksum = 0u;
-				}
-			}
-			#endif
+			prvUDPFillHeaders( pxNetworkBuffer );
 		}
 		else if( eReturned == eARPCacheMiss )
 		{
@@ -237,30 +162,182 @@ uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
 		/* The network driver is responsible for freeing the network buffer
 		after the packet has been sent. */
 
-		#if defined( ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+		prvUDPPadFrame( pxNetworkBuffer );
+
+		xIPOutputBatchFrame( pxNetworkBuffer, pdTRUE );
+	}
+	else
+	{
+		/* The packet can't be sent (DHCP not completed?).  Just drop the
+		packet. */
+		vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+	}
+}
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUDP_DIRECT_SEND != 0 )
+
+	BaseType_t xUDPDirectSend( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+	{
+	UDPPacket_t *pxUDPPacket;
+	eARPLookupResult_t eReturned;
+	uint32_t ulIPAddress = pxNetworkBuffer->ulIPAddress;
+	BaseType_t xReturn = pdFALSE;
+
+		/* Map the UDP packet onto the start of the frame. */
+		pxUDPPacket = ( UDPPacket_t * ) pxNetworkBuffer->pucEthernetBuffer;
+
+		/* Do not wait for the lock: when the IP-task is busy, it might as well
+		send the packet itself. */
+		if( ( FreeRTOS_IsNetworkUp() != pdFALSE ) && ( xIPDriverLockTake() != pdFALSE ) )
 		{
-			if( pxNetworkBuffer->xDataLength < ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+			/* The IP-task is waiting for an event, so the ARP cache can be
+			read safely.  A miss is left to the IP-task, which will send an ARP
+			request.  The lookup does not change the buffer in that case. */
+			eReturned = eARPGetCacheEntry( &( ulIPAddress ), &( pxUDPPacket->xEthernetHeader.xDestinationAddress ) );
+
+			if( eReturned == eARPCacheHit )
 			{
-			BaseType_t xIndex;
+				iptraceSENDING_UDP_PACKET( pxNetworkBuffer->ulIPAddress );
 
-				FreeRTOS_printf( ( "vProcessGeneratedUDPPacket: length %lu\n", pxNetworkBuffer->xDataLength ) );
-				for( xIndex = ( BaseType_t ) pxNetworkBuffer->xDataLength; xIndex < ( BaseType_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES; xIndex++ )
-				{
-					pxNetworkBuffer->pucEthernetBuffer[ xIndex ] = 0u;
-				}
-				pxNetworkBuffer->xDataLength = ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES;
+				prvUDPFillHeaders( pxNetworkBuffer );
+				prvUDPPadFrame( pxNetworkBuffer );
+
+				/* The network driver is responsible for freeing the network
+				buffer after the packet has been sent.  No batch is open
+				while the IP-task is waiting, so the frame is sent at once. */
+				xIPOutputBatchFrame( pxNetworkBuffer, pdTRUE );
+				xReturn = pdTRUE;
 			}
+
+			vIPDriverLockGive();
 		}
-		#endif
 
-		xNetworkInterfaceOutput( pxNetworkBuffer, pdTRUE );
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* ipconfigUDP_DIRECT_SEND */
+
+static void prvUDPFillHeaders( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+UDPPacket_t *pxUDPPacket;
+IPHeader_t *pxIPHeader;
+#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+	uint8_t ucSocketOptions;
+#endif
+
+	/* Map the UDP packet onto the start of the frame. */
+	pxUDPPacket = ( UDPPacket_t * ) pxNetworkBuffer->pucEthernetBuffer;
+
+	/* Create short cuts to the data within the packet. */
+	pxIPHeader = &( pxUDPPacket->xIPHeader );
+
+#if ( ipconfigSUPPORT_OUTGOING_PINGS == 1 )
+	/* Is it possible that the packet is not actually a UDP packet
+	after all, but an ICMP packet. */
+	if( pxNetworkBuffer->usPort != ipPACKET_CONTAINS_ICMP_DATA )
+#endif /* ipconfigSUPPORT_OUTGOING_PINGS */
+	{
+	UDPHeader_t *pxUDPHeader;
+
+		pxUDPHeader = &( pxUDPPacket->xUDPHeader );
+
+		pxUDPHeader->usDestinationPort = pxNetworkBuffer->usPort;
+		pxUDPHeader->usSourcePort = pxNetworkBuffer->usBoundPort;
+		pxUDPHeader->usLength = ( uint16_t ) ( pxNetworkBuffer->xDataLength + sizeof( UDPHeader_t ) );
+		pxUDPHeader->usLength = FreeRTOS_htons( pxUDPHeader->usLength );
+		pxUDPHeader->usChecksum = 0u;
+	}
+
+	/* memcpy() the constant parts of the header information into
+	the	correct location within the packet.  This fills in:
+		xEthernetHeader.xSourceAddress
+		xEthernetHeader.usFrameType
+		xIPHeader.ucVersionHeaderLength
+		xIPHeader.ucDifferentiatedServicesCode
+		xIPHeader.usLength
+		xIPHeader.usIdentification
+		xIPHeader.usFragmentOffset
+		xIPHeader.ucTimeToLive
+		xIPHeader.ucProtocol
+	and
+		xIPHeader.usHeaderChecksum
+	*/
+	/* Save options now, as they will be overwritten by memcpy */
+	#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+		ucSocketOptions = pxNetworkBuffer->pucEthernetBuffer[ ipSOCKET_OPTIONS_OFFSET ];
+	#endif
+	memcpy( ( void *) &( pxUDPPacket->xEthernetHeader.xSourceAddress ), ( void * ) xDefaultPartUDPPacketHeader.ucBytes, sizeof( xDefaultPartUDPPacketHeader ) );
+
+#if ipconfigSUPPORT_OUTGOING_PINGS == 1
+	if( pxNetworkBuffer->usPort == ipPACKET_CONTAINS_ICMP_DATA )
+	{
+		pxIPHeader->ucProtocol = ipPROTOCOL_ICMP;
+		pxIPHeader->usLength = ( uint16_t ) ( pxNetworkBuffer->xDataLength + sizeof( IPHeader_t ) );
 	}
 	else
+#endif /* ipconfigSUPPORT_OUTGOING_PINGS */
 	{
-		/* The packet can't be sent (DHCP not completed?).  Just drop the
-		packet. */
-		vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+		pxIPHeader->usLength = ( uint16_t ) ( pxNetworkBuffer->xDataLength + sizeof( IPHeader_t ) + sizeof( UDPHeader_t ) );
+	}
+
+	/* The total transmit size adds on the Ethernet header. */
+	pxNetworkBuffer->xDataLength = pxIPHeader->usLength + sizeof( EthernetHeader_t );
+	pxIPHeader->usLength = FreeRTOS_htons( pxIPHeader->usLength );
+	/* HT:endian: changed back to network endian */
+	pxIPHeader->ulDestinationIPAddress = pxNetworkBuffer->ulIPAddress;
+
+	#if( ipconfigUSE_LLMNR == 1 )
+	{
+		/* LLMNR messages are typically used on a LAN and they're
+		 * not supposed to cross routers */
+		if( pxNetworkBuffer->ulIPAddress == ipLLMNR_IP_ADDR )
+		{
+			pxIPHeader->ucTimeToLive = 0x01;
+		}
+	}
+	#endif
+
+	#if( ipconfigDRIVER_INCLUDED_TX_IP_CHECKSUM == 0 )
+	{
+		pxIPHeader->usHeaderChecksum = 0u;
+		pxIPHeader->usHeaderChecksum = usGenerateChecksum( 0UL, ( uint8_t * ) &( pxIPHeader->ucVersionHeaderLength ), ipSIZE_OF_IPv4_HEADER );
+		pxIPHeader->usHeaderChecksum = ~FreeRTOS_htons( pxIPHeader->usHeaderChecksum );
+
+		if( ( ucSocketOptions & ( uint8_t ) FREERTOS_SO_UDPCKSUM_OUT ) != 0u )
+		{
+			usGenerateProtocolChecksum( (uint8_t*)pxUDPPacket, pdTRUE );
+		}
+		else
+		{
+			pxUDPPacket->xUDPHeader.usChecksum = 0u;
+		}
 	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+static void prvUDPPadFrame( NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+	/* Some drivers or MAC's do not pad short frames themselves. */
+	#if defined( ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+	{
+		if( pxNetworkBuffer->xDataLength < ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES )
+		{
+		BaseType_t xIndex;
+
+			FreeRTOS_printf( ( "prvUDPPadFrame: length %lu\n", pxNetworkBuffer->xDataLength ) );
+			for( xIndex = ( BaseType_t ) pxNetworkBuffer->xDataLength; xIndex < ( BaseType_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES; xIndex++ )
+			{
+				pxNetworkBuffer->pucEthernetBuffer[ xIndex ] = 0u;
+			}
+			pxNetworkBuffer->xDataLength = ( size_t ) ipconfigETHERNET_MINIMUM_PACKET_BYTES;
+		}
+	}
+	#endif
+
+	( void ) pxNetworkBuffer;
 }
 /*-----------------------------------------------------------*/
 
@@ -281,6 +358,18 @@ UDPPacket_t *pxUDPPacket = (UDPPacket_t *) pxNetworkBuffer->pucEthernetBuffer;
 		handling them, no use to fill the ARP cache with those IP addresses. */
 		vARPRefreshCacheEntry( &( pxUDPPacket->xEthernetHeader.xSourceAddress ), pxUDPPacket->xIPHeader.ulSourceIPAddress );
 
+		#if( ( ipconfigUSE_DNS != 0 ) && ( ipconfigDNS_USE_CALLBACKS != 0 ) )
+		{
+			/* Replies to the shared DNS socket are handled right here, they
+			are not queued to the socket. */
+			if( xIsDNSSocket( ( Socket_t ) pxSocket ) != pdFALSE )
+			{
+				ulDNSHandlePacket( pxNetworkBuffer );
+				xReturn = pdFAIL; /* FAIL means that we did not consume or release the buffer */
+			}
+		}
+		#endif /* ipconfigDNS_USE_CALLBACKS */
+
 		#if( ipconfigUSE_CALLBACKS == 1 )
 		{
 			/* Did the owner of this socket register a reception handler ? */
@@ -350,6 +439,12 @@ UDPPacket_t *pxUDPPacket = (UDPPacket_t *) pxNetworkBuffer->pucEthernetBuffer;
 			}
 			#endif
 
+			#if( ipconfigSUPPORT_POLL_SET != 0 )
+			{
+				vSocketPollEvent( pxSocket, eSELECT_READ );
+			}
+			#endif
+
 			#if( ipconfigSOCKET_HAS_USER_SEMAPHORE == 1 )
 			{
 				if( pxSocket->pxUserSemaphore != NULL )
@@ -170,9 +170,80 @@ from the FreeRTOSIPConfig.h configuration header file. */
 	#endif
 
 	#ifndef ipconfigTCP_WIN_SEG_COUNT
+		/* The maximum number of segment descriptors shared by all TCP
+		sockets. */
 		#define	ipconfigTCP_WIN_SEG_COUNT		( 256 )
 	#endif
 
+	#ifndef ipconfigTCP_WIN_SEG_INITIAL
+		/* The number of segment descriptors allocated when the first TCP
+		window is created.  By default all of them are allocated at once. */
+		#define ipconfigTCP_WIN_SEG_INITIAL		ipconfigTCP_WIN_SEG_COUNT
+	#endif
+
+	#ifndef ipconfigTCP_WIN_SEG_GROW
+		/* When no descriptor is free, the pool grows by this number of
+		descriptors, until ipconfigTCP_WIN_SEG_COUNT is reached. */
+		#define ipconfigTCP_WIN_SEG_GROW		( 16 )
+	#endif
+
+	#ifndef ipconfigTCP_WIN_SEG_MIN_PER_SOCKET
+		/* The number of segment descriptors that are reserved for every TCP
+		window, so that one busy connection can not take all of them.  When 0,
+		descriptors are handed out on a first-come first-served basis. */
+		#define ipconfigTCP_WIN_SEG_MIN_PER_SOCKET	( 0 )
+	#endif
+
+	#ifndef ipconfigTCP_RX_RANGE_COUNT
+		/* The maximum number of separate ranges of data that a TCP socket
+		can hold after a missing packet.  Adjacent ranges are merged.  When 0,
+		the ranges are not compiled in: data that arrives out of order is
+		dropped, and the peer has to send it again. */
+		#define ipconfigTCP_RX_RANGE_COUNT		( 8 )
+	#endif
+
+	#ifndef ipconfigTCP_SACK_BLOCKS
+		/* The maximum number of blocks in a SACK option, 1 to 4.  When
+		time-stamps are in use, at most 3 blocks fit in the 40 bytes of TCP
+		options, and at most 3 are sent. */
+		#define ipconfigTCP_SACK_BLOCKS			( 1 )
+	#endif
+
+	#ifndef ipconfigTCP_TX_RING_LENGTH
+		/* The maximum number of transmission segments that a TCP socket can
+		own at the same time.  They are kept in a ring, sorted on sequence
+		number, so that ACK's and SACK's can be found with a binary search.
+		The ring also limits the amount of data in flight: with the default of
+		at most 64 segments and an MSS of 1460 bytes, a socket will not have
+		more than about 93 KB outstanding, whatever its TX window size.  Raise
+		it for larger windows, each entry costs one pointer per socket. */
+		#if( ipconfigTCP_WIN_SEG_COUNT < 64 )
+			#define ipconfigTCP_TX_RING_LENGTH	ipconfigTCP_WIN_SEG_COUNT
+		#else
+			#define ipconfigTCP_TX_RING_LENGTH	( 64 )
+		#endif
+	#endif
+
+	#if( ipconfigTCP_TX_RING_LENGTH < 2 )
+		#error ipconfigTCP_TX_RING_LENGTH must be at least 2
+	#endif
+
+	#if( ipconfigTCP_RX_RANGE_COUNT < 0 )
+		#error ipconfigTCP_RX_RANGE_COUNT can not be negative
+	#endif
+
+	#if( ipconfigTCP_SACK_BLOCKS < 1 ) || ( ipconfigTCP_SACK_BLOCKS > 4 )
+		#error ipconfigTCP_SACK_BLOCKS must be between 1 and 4
+	#endif
+
+	#if( ipconfigTCP_WIN_SEG_INITIAL > ipconfigTCP_WIN_SEG_COUNT )
+		#error ipconfigTCP_WIN_SEG_INITIAL can not be larger than ipconfigTCP_WIN_SEG_COUNT
+	#endif
+
+	#if( ipconfigTCP_WIN_SEG_GROW < 1 )
+		#error ipconfigTCP_WIN_SEG_GROW must be at least 1
+	#endif
+
 	#ifndef ipconfigIGNORE_UNKNOWN_PACKETS
 		/* When non-zero, TCP will not send RST packets in reply to
 		TCP packets which are unknown, or out-of-order. */
@@ -331,6 +402,15 @@ from the FreeRTOSIPConfig.h configuration header file. */
 	#define ipconfigEVENT_QUEUE_LENGTH		( ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS + 5 )
 #endif
 
+#ifndef ipconfigUSE_IP_EVENT_RING
+	/* When non-zero, events are passed to the IP-task through a ring buffer of
+	ipconfigEVENT_QUEUE_LENGTH entries in stead of a kernel queue.  The IP-task
+	takes the events from the ring without calling the kernel, and only waits
+	for a task notification when the ring is empty.  Timer events that are
+	still pending will not be stored a second time. */
+	#define ipconfigUSE_IP_EVENT_RING		( 0 )
+#endif
+
 #ifndef ipconfigALLOW_SOCKET_SEND_WITHOUT_BIND
 	#define ipconfigALLOW_SOCKET_SEND_WITHOUT_BIND 1
 #endif
@@ -423,7 +503,37 @@ from the FreeRTOSIPConfig.h configuration header file. */
 	#endif
 
 	#ifndef ipconfigDNS_CACHE_ENTRIES
-		#define ipconfigDNS_CACHE_ENTRIES			0
+		#define ipconfigDNS_CACHE_ENTRIES			1
+	#endif
+
+	#if( ipconfigDNS_CACHE_ENTRIES < 1 )
+		#error ipconfigDNS_CACHE_ENTRIES must be at least 1 when ipconfigUSE_DNS_CACHE is defined
+	#endif
+
+	#ifndef ipconfigDNS_CACHE_NEGATIVE_TTL
+		/* The number of seconds that a failed look-up (the server answered
+		that the name does not exist, or it did not answer at all) is kept in
+		the cache, so the same name is not queried again immediately. */
+		#define ipconfigDNS_CACHE_NEGATIVE_TTL		( 10 )
+	#endif
+
+	#ifndef ipconfigDNS_CACHE_MAX_TTL
+		/* The TTL of a DNS answer is limited to this number of seconds. */
+		#define ipconfigDNS_CACHE_MAX_TTL			( 86400 )
+	#endif
+
+	#ifndef ipconfigDNS_CACHE_PREFETCH_TIME
+		/* When an entry that is used often is looked up less than this number
+		of seconds before it expires, a new request is sent to the DNS server
+		without waiting for the answer.  The answer will refresh the entry.
+		Define as 0 to disable the prefetching. */
+		#define ipconfigDNS_CACHE_PREFETCH_TIME	( 10 )
+	#endif
+
+	#ifndef ipconfigDNS_CACHE_PREFETCH_PORT
+		/* The local UDP port used for prefetch requests.  No socket should be
+		bound to this port. */
+		#define ipconfigDNS_CACHE_PREFETCH_PORT	( 0xcf35u )
 	#endif
 #endif /* ipconfigUSE_DNS_CACHE != 0 */
 
@@ -509,6 +619,21 @@ from the FreeRTOSIPConfig.h configuration header file. */
 	#define ipconfigZERO_COPY_TX_DRIVER		( 0 )
 #endif
 
+#ifndef ipconfigUSE_CHAINED_BUFFERS
+	/* When non-zero, a network buffer descriptor may be followed by a chain
+	of fragments ('pxNextFragment'), each describing a part of an outgoing
+	frame that is stored elsewhere, e.g. TCP payload in a socket's stream
+	buffer.  The frame is built without copying the payload. */
+	#define ipconfigUSE_CHAINED_BUFFERS		( 0 )
+#endif
+
+#ifndef ipconfigGATHER_TX_DRIVER
+	/* When non-zero, xNetworkInterfaceOutput() is able to send a chain of
+	fragments (see ipconfigUSE_CHAINED_BUFFERS).  Otherwise the fragments are
+	copied into a single network buffer before the driver is called. */
+	#define ipconfigGATHER_TX_DRIVER		( 0 )
+#endif
+
 #ifndef ipconfigZERO_COPY_RX_DRIVER
 	/* This define doesn't mean much to the driver, except that it makes
 	sure that pxPacketBuffer_to_NetworkBuffer() will be included. */
@@ -523,6 +648,232 @@ from the FreeRTOSIPConfig.h configuration header file. */
 	#define ipconfigDRIVER_INCLUDED_RX_IP_CHECKSUM 0
 #endif
 
+#ifndef ipconfigTCP_FUSED_CHECKSUM
+	/* When non-zero, the checksum of TCP payload is calculated while the data
+	is copied between the packet and the socket's stream buffer, so that the
+	payload is only read once.  Only used when the checksums are not calculated
+	by the driver (see above).
+	Note that the checksum of a received packet is then only known after the
+	socket has been looked up and part of its state has been read.  A packet
+	with a bad checksum is still dropped before it changes any state, but the
+	option is off by default so that packets are checked before any socket is
+	touched. */
+	#define ipconfigTCP_FUSED_CHECKSUM 0
+#endif
+
+#ifndef ipconfigTCP_LARGE_SEND
+	/* When non-zero, a TCP socket that has several new segments ready to be
+	sent will fetch them from the sliding window in one go, and send them
+	back-to-back using a header that is prepared only once.  Only used along
+	with ipconfigUSE_TCP_WIN. */
+	#define ipconfigTCP_LARGE_SEND			( 0 )
+#endif
+
+#ifndef ipconfigTCP_LARGE_SEND_OFFLOAD
+	/* When non-zero, the driver implements xNetworkInterfaceOutputLarge(),
+	which accepts a TCP packet with up to 'SEND_REPEATED_COUNT' segments of
+	payload and lets the hardware cut it into segments of MSS bytes (TSO).
+	Requires ipconfigTCP_LARGE_SEND and network buffers of a variable size. */
+	#define ipconfigTCP_LARGE_SEND_OFFLOAD	( 0 )
+#endif
+
+#ifndef ipconfigUSE_NETWORK_OUTPUT_BATCH
+	/* When non-zero, the driver implements xNetworkInterfaceOutputBatch(),
+	which accepts a number of frames at once.  The IP-task collects the frames
+	that it produces in one go, e.g. a series of TCP segments or the replies to
+	a chain of received packets, and passes them with a single call.  Only
+	frames of which the ownership is passed to the driver are collected, which
+	normally requires ipconfigZERO_COPY_TX_DRIVER. */
+	#define ipconfigUSE_NETWORK_OUTPUT_BATCH	( 0 )
+#endif
+
+#ifndef ipconfigNETWORK_OUTPUT_BATCH_SIZE
+	/* The maximum number of frames passed to xNetworkInterfaceOutputBatch(). */
+	#define ipconfigNETWORK_OUTPUT_BATCH_SIZE	( 8 )
+#endif
+
+#ifndef ipconfigUSE_UDP_BATCH
+	/* When non-zero, FreeRTOS_recvmmsg() and FreeRTOS_sendmmsg() are
+	available: they receive or send a number of UDP messages in a single call.
+	The messages sent are passed to the IP-task with a single event. */
+	#define ipconfigUSE_UDP_BATCH			( 0 )
+#endif
+
+#ifndef ipconfigUDP_DIRECT_SEND
+	/* When non-zero, FreeRTOS_sendto() fills in the headers and calls the
+	driver from the task that sends, when the IP-task is idle and the ARP cache
+	knows the MAC address.  Otherwise the packet is passed to the IP-task as
+	usual.  The driver must allow xNetworkInterfaceOutput() to be called from
+	any task.  The calls are serialised: a task only calls the driver while
+	the IP-task is waiting, and one task at a time. */
+	#define ipconfigUDP_DIRECT_SEND			( 0 )
+#endif
+
+#ifndef ipconfigTCP_RX_COALESCE
+	/* When non-zero, and the driver passes bursts of received packets as a
+	chain (ipconfigUSE_LINKED_RX_MESSAGES), consecutive data segments of the
+	same TCP connection are handled as a single segment.  That gives one window
+	update, one ACK decision and one wake-up of the user per burst. */
+	#define ipconfigTCP_RX_COALESCE			( 0 )
+#endif
+
+#ifndef ipconfigTCP_RX_COALESCE_MAX_SEGMENTS
+	/* The maximum number of received segments that will be handled as one. */
+	#define ipconfigTCP_RX_COALESCE_MAX_SEGMENTS	( 8 )
+#endif
+
+#ifndef ipconfigNETWORK_INTERFACES
+	/* The number of Ethernet ports of a driver that has more than one.  This
+	is an opt-in hook, not multi-interface support: there is still one
+	MAC-address, one IP-address and one ARP cache, and there is no routing.
+	Port 0 is xNetworkInterfaceOutput(), the driver registers the output
+	function of every other port with vIPRegisterPortOutput().  The stack
+	sends a frame on the port where its destination was last seen.  Broadcast
+	frames are sent on all ports.  No driver in this tree uses it.
+	Because of the shared addresses, every port must be connected to a
+	separate Ethernet segment, they may not be bridged.  When a port receives
+	a frame that the stack has sent through another port, it is disabled and
+	its neighbours are reached through port 0. */
+	#define ipconfigNETWORK_INTERFACES		( 1 )
+#endif
+
+#if( ipconfigNETWORK_INTERFACES > 1 ) && ( ( ipconfigUSE_NETWORK_OUTPUT_BATCH != 0 ) || ( ipconfigTCP_LARGE_SEND_OFFLOAD != 0 ) )
+	#error Batched and large output are not yet available with multiple network interfaces
+#endif
+
+#ifndef ipconfigTCP_CONGESTION_CONTROL
+	/* The congestion control algorithm of new TCP sockets: 0 for none, 1 for
+	NewReno (FREERTOS_TCP_CC_NEWRENO) or 2 for CUBIC (FREERTOS_TCP_CC_CUBIC).
+	When non-zero, a socket sends no more than its congestion window, which
+	grows as data gets acknowledged and shrinks when a segment is lost.  The
+	algorithm can be changed per socket with FREERTOS_SO_TCP_CONGESTION.  When
+	0, only the peer's window limits the transmission. */
+	#define ipconfigTCP_CONGESTION_CONTROL	( 0 )
+#endif
+
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 ) && ( ipconfigUSE_TCP_WIN == 0 )
+	#error ipconfigTCP_CONGESTION_CONTROL can only be used along with ipconfigUSE_TCP_WIN
+#endif
+
+#ifndef ipconfigUSE_TCP_TIMESTAMPS
+	/* When 1, the TCP time-stamps option (RFC 7323) is offered in every SYN,
+	and used when the peer agrees.  Every segment will carry 12 bytes of
+	options, the echoed time-stamps give a RTT sample for each ACK. */
+	#define ipconfigUSE_TCP_TIMESTAMPS		( 0 )
+#endif
+
+#if( ipconfigUSE_TCP_TIMESTAMPS != 0 ) && ( ipconfigUSE_TCP_WIN == 0 )
+	#error ipconfigUSE_TCP_TIMESTAMPS can only be used along with ipconfigUSE_TCP_WIN
+#endif
+
+#ifndef ipconfigTCP_RTO_RFC6298
+	/* When 1, the retransmission time-out is calculated as in RFC 6298: the
+	smoothed RTT plus four times the RTT variation, bounded by
+	ipconfigTCP_RTO_MIN_MS and ipconfigTCP_RTO_MAX_MS.  When 0, the time-out
+	is twice the smoothed RTT. */
+	#define ipconfigTCP_RTO_RFC6298			( 0 )
+#endif
+
+#ifndef ipconfigTCP_RTO_MIN_MS
+	#define ipconfigTCP_RTO_MIN_MS			( 200 )
+#endif
+
+#ifndef ipconfigTCP_RTO_MAX_MS
+	#define ipconfigTCP_RTO_MAX_MS			( 60000 )
+#endif
+
+#ifndef ipconfigTCP_SYN_COOKIES
+	/* When 1, a listening socket that has used half of its backlog answers a
+	SYN with a SYN cookie: the sequence number of the SYN+ACK encodes the
+	connection, and no socket is created until the ACK of the peer proves that
+	it exists.  Such connections do not use window scaling, SACK or
+	time-stamps.  When 0, a SYN is answered with a RST once the backlog is
+	full. */
+	#define ipconfigTCP_SYN_COOKIES			( 0 )
+#endif
+
+#ifndef ipconfigTCP_ACCEPT_POOL_SIZE
+	/* The maximum number of child sockets that FreeRTOS_listen() allocates in
+	advance, so that an incoming connection does not need to allocate memory.
+	FreeRTOS_accept() allocates a new one for every socket that it returns.
+	When 0, a child socket is allocated when a SYN arrives. */
+	#define ipconfigTCP_ACCEPT_POOL_SIZE	( 0 )
+#endif
+
+#ifndef ipconfigSOCKET_SLAB_DEPTH
+	/* The maximum number of released objects that are kept for re-use in each
+	of the socket slabs: UDP sockets, TCP sockets, and TCP stream buffers of the
+	default RX and TX sizes.  Objects of other sizes are always returned to the
+	heap.  When 0, every socket and stream is allocated from and freed to the
+	heap directly. */
+	#define ipconfigSOCKET_SLAB_DEPTH		( 0 )
+#endif
+
+#ifndef ipconfigTCP_HEADER_PREDICTION
+	/* When 1, a segment received by an established connection is first tested
+	against the most common cases: it carries the next expected data while
+	acknowledging nothing new, or it is a pure ACK of new data.  No options
+	other than time-stamps, no other flags than ACK and PSH, and no data
+	stored out of order.  Such segments skip the generic state handling.  See
+	vGetTCPPredictionCounters() for the hit rate. */
+	#define ipconfigTCP_HEADER_PREDICTION	( 0 )
+#endif
+
+#if( ipconfigTCP_HEADER_PREDICTION != 0 ) && ( ipconfigUSE_TCP_WIN == 0 )
+	#error ipconfigTCP_HEADER_PREDICTION can only be used along with ipconfigUSE_TCP_WIN
+#endif
+
+#ifndef ipconfigTCP_DELAYED_ACK_MS
+	/* The time that the ACK of a full-size segment may be delayed, waiting
+	for the next segment.  The ACK of a smaller segment is delayed by 2 ms.
+	A socket can switch off delayed ACK's with FREERTOS_SO_TCP_QUICKACK. */
+	#define ipconfigTCP_DELAYED_ACK_MS		( 20 )
+#endif
+
+#ifndef ipconfigTCP_ACK_EVERY_N_SEGMENTS
+	/* When non-zero, an ACK will be sent at least for every N data segments
+	received, in stead of waiting for the delayed-ACK time-out.  RFC 1122
+	recommends 2.  Zero means that the number is not limited. */
+	#define ipconfigTCP_ACK_EVERY_N_SEGMENTS	( 0 )
+#endif
+
+#if( ipconfigTCP_ACK_EVERY_N_SEGMENTS > 255 )
+	#error ipconfigTCP_ACK_EVERY_N_SEGMENTS must be less than 256
+#endif
+
+#ifndef ipconfigUSE_SENDFILE
+	/* When 1, FreeRTOS_sendfile() is available: it reads a file from
+	FreeRTOS+FAT directly into the TX stream of a TCP socket.  The HTTP and FTP
+	servers will use it to send files.  This option makes the library depend
+	on FreeRTOS+FAT. */
+	#define ipconfigUSE_SENDFILE			( 0 )
+#endif
+
+#if( ipconfigUSE_SENDFILE != 0 ) && ( ipconfigUSE_TCP == 0 )
+	#error ipconfigUSE_SENDFILE can only be used along with ipconfigUSE_TCP
+#endif
+
+#ifndef ipconfigUSE_RECV_TO_FILE
+	/* When 1, FreeRTOS_recv_to_file() is available: it writes the data
+	received by a TCP socket directly from its RX stream to a FreeRTOS+FAT
+	file.  The FTP (STOR) server will use it to store files, and so will the
+	HTTP server when ipconfigHTTP_ALLOW_PUT is set.  This option makes the
+	library depend on FreeRTOS+FAT. */
+	#define ipconfigUSE_RECV_TO_FILE		( 0 )
+#endif
+
+#ifndef ipconfigHTTP_ALLOW_PUT
+	/* When 1, and when ipconfigUSE_RECV_TO_FILE is 1, the HTTP server stores
+	the body of a PUT request as a file.  The server has no authentication:
+	anyone that can reach it can then overwrite files below its root
+	directory. */
+	#define ipconfigHTTP_ALLOW_PUT			( 0 )
+#endif
+
+#if( ipconfigUSE_RECV_TO_FILE != 0 ) && ( ipconfigUSE_TCP == 0 )
+	#error ipconfigUSE_RECV_TO_FILE can only be used along with ipconfigUSE_TCP
+#endif
+
 #ifndef ipconfigDHCP_REGISTER_HOSTNAME
 	#define ipconfigDHCP_REGISTER_HOSTNAME 0
 #endif
@@ -535,6 +886,19 @@ from the FreeRTOSIPConfig.h configuration header file. */
 	#define ipconfigSUPPORT_SELECT_FUNCTION 0
 #endif
 
+#ifndef ipconfigSUPPORT_POLL_SET
+	/* When 1, FreeRTOS_CreatePollSet() and friends are available.  Sockets
+	registered in a poll set are queued by the IP-task as soon as an event
+	occurs, and FreeRTOS_PollWait() only looks at the queued sockets, in stead
+	of having the IP-task scan all bound sockets like FreeRTOS_select() does.
+	The TCP servers in 'protocols' will use it in stead of a socket set. */
+	#define ipconfigSUPPORT_POLL_SET		( 0 )
+#endif
+
+#if( ipconfigSUPPORT_POLL_SET != 0 ) && ( ipconfigSUPPORT_SELECT_FUNCTION != 1 )
+	#error ipconfigSUPPORT_POLL_SET can only be used along with ipconfigSUPPORT_SELECT_FUNCTION
+#endif
+
 #ifndef ipconfigTCP_KEEP_ALIVE
 	#define ipconfigTCP_KEEP_ALIVE 0
 #endif
@@ -543,6 +907,15 @@ from the FreeRTOSIPConfig.h configuration header file. */
 	#define ipconfigDNS_USE_CALLBACKS 0
 #endif
 
+#if( ipconfigDNS_USE_CALLBACKS != 0 )
+	#ifndef ipconfigDNS_EXTRA_SERVERS
+		/* The number of DNS servers, set with FreeRTOS_SetDNSServer(), which
+		are asked in parallel with the DNS server of the network configuration.
+		The first answer wins. */
+		#define ipconfigDNS_EXTRA_SERVERS		( 2 )
+	#endif
+#endif /* ipconfigDNS_USE_CALLBACKS != 0 */
+
 #ifndef ipconfigSUPPORT_SIGNALS
 	#define ipconfigSUPPORT_SIGNALS				0
 #endif
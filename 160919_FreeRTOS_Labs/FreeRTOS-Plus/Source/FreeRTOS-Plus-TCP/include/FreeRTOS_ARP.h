@@ -77,6 +77,9 @@ typedef struct xARP_CACHE_TABLE_ROW
 	MACAddress_t xMACAddress;  /* The MAC address of an ARP cache entry. */
 	uint8_t ucAge;				/* A value that is periodically decremented but can also be refreshed by active communication.  The ARP cache entry is removed if the value reaches zero. */
     uint8_t ucValid;			/* pdTRUE: xMACAddress is valid, pdFALSE: waiting for ARP reply */
+	#if( ipconfigNETWORK_INTERFACES > 1 )
+		uint8_t ucInterface;	/* The port on which xMACAddress was last seen. */
+	#endif
 } ARPCacheRow_t;
 
 typedef enum
@@ -133,6 +136,14 @@ eARPLookupResult_t eARPGetCacheEntry( uint32_t *pulIPAddress, MACAddress_t * con
 	/* Lookup an IP-address if only the MAC-address is known */
 	eARPLookupResult_t eARPGetCacheEntryByMac( MACAddress_t * const pxMACAddress, uint32_t *pulIPAddress );
 
+#endif
+
+#if( ipconfigNETWORK_INTERFACES > 1 )
+
+	/* Returns the port on which a MAC-address was last seen, or -1 if it is not
+	in the ARP cache. */
+	BaseType_t xARPGetCacheInterface( const MACAddress_t * const pxMACAddress );
+
 #endif
 /*
  * Reduce the age count in each entry within the ARP cache.  An entry is no
@@ -131,10 +131,30 @@ uint32_t ulDNSHandlePacket( NetworkBufferDescriptor_t *pxNetworkBuffer );
 	/*
 	 * Asynchronous version of gethostbyname()
 	 * xTimeout is in units of ms.
+	 * All outstanding requests share a single socket and are matched on their
+	 * transaction ID, so any number of requests can be in progress at the same
+	 * time.  A task that calls FreeRTOS_gethostbyname() is woken up with a task
+	 * notification, so it should not be waiting for notifications of its own.
 	 */
 	uint32_t FreeRTOS_gethostbyname_a( const char *pcHostName, FOnDNSEvent pCallback, void *pvSearchID, TickType_t xTimeout );
 	void FreeRTOS_gethostbyname_cancel( void *pvSearchID );
 
+	/*
+	 * Returns true if xSocket is the socket shared by the DNS requests.  The
+	 * IP-task passes the replies to that socket to ulDNSHandlePacket().
+	 */
+	BaseType_t xIsDNSSocket( Socket_t xSocket );
+
+	#if( ipconfigDNS_EXTRA_SERVERS > 0 )
+		/*
+		 * Set (or clear with 0) an additional DNS server.  Requests are sent to
+		 * the DNS server of the network configuration and to all additional
+		 * servers at the same time, the first answer is used.
+		 * xIndex ranges from 0 to ipconfigDNS_EXTRA_SERVERS - 1.
+		 */
+		BaseType_t FreeRTOS_SetDNSServer( BaseType_t xIndex, uint32_t ulIPAddress );
+	#endif
+
 #endif
 
 /*
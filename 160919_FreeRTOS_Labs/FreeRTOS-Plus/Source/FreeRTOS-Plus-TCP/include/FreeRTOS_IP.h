@@ -126,8 +126,14 @@ typedef struct xNETWORK_BUFFER
 	size_t xDataLength; 			/* Starts by holding the total Ethernet frame length, then the UDP/TCP payload length. */
 	uint16_t usPort;				/* Source or destination port, depending on usage scenario. */
 	uint16_t usBoundPort;			/* The port to which a transmitting socket is bound. */
-	#if( ipconfigUSE_LINKED_RX_MESSAGES != 0 )
-		struct xNETWORK_BUFFER *pxNextBuffer; /* Possible optimisation for expert users - requires network driver support. */
+	#if( ipconfigUSE_LINKED_RX_MESSAGES != 0 ) || ( ipconfigUSE_UDP_BATCH != 0 )
+		struct xNETWORK_BUFFER *pxNextBuffer; /* Possible optimisation for expert users - requires network driver support.  Also links the messages of FreeRTOS_sendmmsg(). */
+	#endif
+	#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+		struct xNETWORK_BUFFER *pxNextFragment; /* The next part of an outgoing frame.  Fragments do not own the memory they point to. */
+	#endif
+	#if( ipconfigNETWORK_INTERFACES > 1 )
+		BaseType_t xInterface;			/* The port on which the frame was received, set by the driver. */
 	#endif
 } NetworkBufferDescriptor_t;
 
@@ -270,6 +276,27 @@ BaseType_t FreeRTOS_IsNetworkUp( void );
 	UBaseType_t uxGetMinimumIPQueueSpace( void );
 #endif
 
+#if( ipconfigUSE_TCP == 1 ) && ( ipconfigUSE_LINKED_RX_MESSAGES != 0 ) && ( ipconfigTCP_RX_COALESCE != 0 )
+	/* Get the number of TCP data segments that were received in bursts, and
+	how many of them were merged with an earlier segment.  The average number
+	of segments handled as one is ulSegments / ( ulSegments - ulMerged ). */
+	void vGetTCPCoalesceCounters( uint32_t *pulSegments, uint32_t *pulMerged );
+#endif
+
+#if( ipconfigUSE_TCP == 1 ) && ( ipconfigTCP_HEADER_PREDICTION != 0 )
+	/* Get the number of segments of established connections that were handled
+	by the header prediction: pure ACK's and in-order data.  'pulMissed' counts
+	the segments that took the normal path.  The hit rate is
+	( ulAcks + ulData ) / ( ulAcks + ulData + ulMissed ). */
+	void vGetTCPPredictionCounters( uint32_t *pulAcks, uint32_t *pulData, uint32_t *pulMissed );
+#endif
+
+#if( ipconfigUSE_IP_EVENT_RING != 0 )
+	/* Get the number of events that were not stored because the same event
+	was still pending, and the number of times the event ring was found full. */
+	void vGetIPEventRingCounters( uint32_t *pulCoalesced, uint32_t *pulOverflows );
+#endif
+
 /*
  * Defined in FreeRTOS_Sockets.c
  * //_RB_ Don't think this comment is correct.  If this is for internal use only it should appear after all the public API functions and not start with FreeRTOS_.
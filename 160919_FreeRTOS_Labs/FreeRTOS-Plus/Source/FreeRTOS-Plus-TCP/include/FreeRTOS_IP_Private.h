@@ -286,6 +286,7 @@ typedef enum
 	eSocketCloseEvent,		/* 9: Send a message to the IP-task to close a socket. */
 	eSocketSelectEvent,		/*10: Send a message to the IP-task for select(). */
 	eSocketSignalEvent,		/*11: A socket must be signalled. */
+	eStackTxBatchEvent,		/*12: The software stack has queued a chain of UDP packets to transmit. */
 } eIPEvent_t;
 
 typedef struct IP_TASK_COMMANDS
@@ -462,11 +463,38 @@ eFrameProcessingResult_t eARPProcessPacket( ARPPacket_t * const pxARPFrame );
  */
 eFrameProcessingResult_t eConsiderFrameForProcessing( const uint8_t * const pucEthernetBuffer );
 
+/* Returned to indicate a valid checksum when the checksum does not need to be
+calculated. */
+#define ipCORRECT_CRC				0xffffu
+
 /*
  * Return the checksum generated over xDataLengthBytes from pucNextData.
  */
 uint16_t usGenerateChecksum( uint32_t ulSum, const uint8_t * pucNextData, size_t uxDataLengthBytes );
 
+/*
+ * Copy uxDataLengthBytes from pucSource to pucTarget and return the checksum
+ * of the copied bytes, reading the data only once.  The result is the same as
+ * that of usGenerateChecksum( ulSum, pucSource, uxDataLengthBytes ).
+ */
+uint16_t usGenerateChecksumCopy( uint32_t ulSum, uint8_t * pucTarget, const uint8_t * pucSource, size_t uxDataLengthBytes );
+
+/*
+ * Add the checksum of a part of the data that starts uxPartialOffset bytes
+ * from the beginning, to the checksum of the data in front of it.  Both are
+ * values as returned by usGenerateChecksum( 0UL, ... ).
+ */
+uint16_t usAddPartialChecksum( uint16_t usChecksum, uint16_t usPartial, size_t uxPartialOffset );
+
+/*
+ * Update a checksum after a 16-bit or a 32-bit field in the checksummed data
+ * has been changed from the old to the new value (RFC 1624), which is much
+ * cheaper than calling usGenerateChecksum() again.  The checksum and the
+ * values should be passed as they are stored in the packet.
+ */
+uint16_t usUpdateChecksum16( uint16_t usChecksum, uint16_t usOldValue, uint16_t usNewValue );
+uint16_t usUpdateChecksum32( uint16_t usChecksum, uint32_t ulOldValue, uint32_t ulNewValue );
+
 /* Socket related private functions. */
 BaseType_t xProcessReceivedUDPPacket( NetworkBufferDescriptor_t *pxNetworkBuffer, uint16_t usPort );
 void vNetworkSocketsInit( void );
@@ -548,7 +576,8 @@ BaseType_t xIPIsNetworkTaskReady( void );
 				bFinLast : 1,		/* The last ACK (after FIN and FIN+ACK) has been sent or will be sent by the peer */
 				bRxStopped : 1,		/* Application asked to temporarily stop reception */
 				bMallocError : 1,	/* There was an error allocating a stream */
-				bWinScaling : 1;	/* A TCP-Window Scaling option was offered and accepted in the SYN phase. */
+				bWinScaling : 1,	/* A TCP-Window Scaling option was offered and accepted in the SYN phase. */
+				bQuickAck : 1;		/* FREERTOS_SO_TCP_QUICKACK: do not delay ACK's */
 		} bits;
 		uint32_t ulHighestRxAllowed;
 								/* The highest sequence number that we can receive at any moment */
@@ -562,6 +591,10 @@ BaseType_t xIPIsNetworkTaskReady( void );
 								 * TCP win segments */
 		uint8_t ucTCPState;		/* TCP state: see eTCP_STATE */
 		struct XSOCKET *pxPeerSocket;	/* for server socket: child, for child socket: parent */
+		#if( ipconfigTCP_ACCEPT_POOL_SIZE > 0 )
+			struct XSOCKET *pxAcceptPool;	/* for server socket: unused child sockets, linked through their 'pxPeerSocket' */
+			uint16_t usAcceptPoolCount;		/* Number of sockets in 'pxAcceptPool' */
+		#endif /* ipconfigTCP_ACCEPT_POOL_SIZE */
 		#if( ipconfigTCP_KEEP_ALIVE == 1 )
 			uint8_t ucKeepRepCount;
 			TickType_t xLastAliveTime;
@@ -577,6 +610,7 @@ BaseType_t xIPIsNetworkTaskReady( void );
 		StreamBuffer_t *txStream;
 		#if( ipconfigUSE_TCP_WIN == 1 )
 			NetworkBufferDescriptor_t *pxAckMessage;
+			uint8_t ucDelayedAcks;	/* The number of segments received since the last ACK was sent */
 		#endif /* ipconfigUSE_TCP_WIN */
 		/* Buffer space to store the last TCP header received. */
 		LastTCPPacket_t xPacket;
@@ -593,6 +627,11 @@ BaseType_t xIPIsNetworkTaskReady( void );
 			FOnTCPSent_t pxHandleSent;
 			FOnConnected_t pxHandleConnected;	/* Actually type: typedef void (* FOnConnected_t) (Socket_t xSocket, BaseType_t ulConnected ); */
 		#endif /* ipconfigUSE_CALLBACKS */
+		#if( ipconfigTCP_FUSED_CHECKSUM != 0 )
+			uint16_t usTxSummedLength;	/* Number of payload bytes summed by prvTCPPrepareSend() */
+			uint16_t usTxSummedData;	/* The sum of those bytes, to be used by prvTCPReturnPacket() */
+			uint16_t usRxStagedLength;	/* Number of payload bytes already copied and checked at rxStream's uxHead */
+		#endif
 		uint32_t ulWindowSize;		/* Current Window size advertised by peer */
 		uint32_t ulRxCurWinSize;	/* Constantly changing: this is the current size available for data reception */
 		size_t uxRxWinSize;	/* Fixed value: size of the TCP reception window */
@@ -652,6 +691,15 @@ typedef struct XSOCKET
 		They are maintained by the IP-task */
 		EventBits_t xSocketBits;
 	#endif /* ipconfigSUPPORT_SELECT_FUNCTION */
+	#if( ipconfigSUPPORT_POLL_SET != 0 )
+		struct xSOCKET_POLL *pxPollSet;
+		/* The events that the owner of the poll set is interested in. */
+		EventBits_t xPollBits;
+		/* Returned along with the events, see FreeRTOS_PollWait(). */
+		void *pvPollData;
+		/* Used to queue the socket in the ready list of its poll set. */
+		ListItem_t xPollListItem;
+	#endif /* ipconfigSUPPORT_POLL_SET */
 	/* TCP/UDP specific fields: */
 	/* Before accessing any member of this structure, it should be confirmed */
 	/* that the protocol corresponds with the type of structure */
@@ -687,6 +735,25 @@ FreeRTOS_Socket_t *pxUDPSocketLookup( UBaseType_t uxLocalPort );
  */
 void vProcessGeneratedUDPPacket( NetworkBufferDescriptor_t * const pxNetworkBuffer );
 
+#if( ipconfigUDP_DIRECT_SEND != 0 )
+	/*
+	 * Send a UDP packet from the calling task, without the help of the
+	 * IP-task.  Returns pdFALSE when that is not possible: the IP-task or
+	 * another sender is using the driver, or the MAC address of the target is
+	 * not known yet.  The buffer is then still owned by the caller.
+	 */
+	BaseType_t xUDPDirectSend( NetworkBufferDescriptor_t * const pxNetworkBuffer );
+
+	/*
+	 * The driver lock, a mutex.  xIPDriverLockTake() does not block: it only
+	 * succeeds while the IP-task is waiting for a new event, and no other task
+	 * holds the lock.  A task that holds the lock may read the ARP cache and call
+	 * xIPOutputBatchFrame().
+	 */
+	BaseType_t xIPDriverLockTake( void );
+	void vIPDriverLockGive( void );
+#endif
+
 /*
  * Calculate the upper-layer checksum
  * Works both for UDP, ICMP and TCP packages
@@ -696,6 +763,64 @@ void vProcessGeneratedUDPPacket( NetworkBufferDescriptor_t * const pxNetworkBuff
  */
 uint16_t usGenerateProtocolChecksum( const uint8_t * const pucEthernetBuffer, BaseType_t xOutgoingPacket );
 
+/*
+ * The same as usGenerateProtocolChecksum(), except that the last
+ * uxSummedLength bytes of the protocol data are not read: usSummedData holds
+ * their sum, as returned by usGenerateChecksum().  Used when the payload was
+ * summed while it was being copied.  uxSummedLength must leave an even number
+ * of bytes to be summed.
+ */
+uint16_t usGenerateProtocolChecksumPartial( const uint8_t * const pucEthernetBuffer, BaseType_t xOutgoingPacket,
+	size_t uxSummedLength, uint16_t usSummedData );
+
+#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+	/*
+	 * Pass a frame that may consist of a chain of fragments to the driver.  The
+	 * chain is linearised first when the driver can not gather the fragments,
+	 * or when it wants to keep the buffer for DMA, as the fragments are only
+	 * guaranteed to be valid until this function returns.
+	 */
+	BaseType_t xNetworkInterfaceOutputChain( NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t xReleaseAfterSend );
+#endif
+
+#if( ipconfigNETWORK_INTERFACES > 1 )
+	/*
+	 * Returns the port on which the frame being handled by the IP-task was
+	 * received.
+	 */
+	BaseType_t xIPGetRxInterface( void );
+
+	/*
+	 * Send a frame on the port where its destination was last seen, or on all
+	 * ports when it is a broadcast.  Port 0 is xNetworkInterfaceOutput().
+	 */
+	BaseType_t xIPPortOutput( NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t xReleaseAfterSend );
+#endif
+
+#if( ipconfigUSE_NETWORK_OUTPUT_BATCH != 0 )
+	/*
+	 * Between vIPOutputBatchBegin() and vIPOutputBatchEnd(), frames passed to
+	 * xIPOutputBatchFrame() with xReleaseAfterSend set are collected, and given
+	 * to the driver with xNetworkInterfaceOutputBatch().  Other frames are sent
+	 * immediately, after the frames that were collected before them.  The calls
+	 * may be nested, the frames are sent by the outermost vIPOutputBatchEnd().
+	 * Only to be called from the IP-task, or by a task that holds the driver
+	 * lock.
+	 */
+	void vIPOutputBatchBegin( void );
+	BaseType_t xIPOutputBatchFrame( NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t xReleaseAfterSend );
+	void vIPOutputBatchEnd( void );
+#else
+	/* Without driver support, every frame is sent on its own. */
+	#define vIPOutputBatchBegin()
+	#if( ipconfigNETWORK_INTERFACES > 1 )
+		#define xIPOutputBatchFrame( pxNetworkBuffer, xReleaseAfterSend )	xIPPortOutput( ( pxNetworkBuffer ), ( xReleaseAfterSend ) )
+	#else
+		#define xIPOutputBatchFrame( pxNetworkBuffer, xReleaseAfterSend )	xNetworkInterfaceOutput( ( pxNetworkBuffer ), ( xReleaseAfterSend ) )
+	#endif
+	#define vIPOutputBatchEnd()
+#endif
+
 /*
  * An Ethernet frame has been updated (maybe it was an ARP request or a PING
  * request?) and is to be sent back to its source.
@@ -754,6 +879,14 @@ BaseType_t xTCPCheckNewClient( FreeRTOS_Socket_t *pxSocket );
  */
 void *vSocketClose( FreeRTOS_Socket_t *pxSocket );
 
+#if( ipconfigTCP_ACCEPT_POOL_SIZE > 0 )
+	/* Defined in FreeRTOS_Sockets.c
+	 * Take a pre-allocated child socket from a listening socket, or return NULL
+	 * when its pool is empty.
+	 */
+	FreeRTOS_Socket_t *pxTCPAcceptPoolTake( FreeRTOS_Socket_t *pxSocket );
+#endif
+
 /*
  * Send the event eEvent to the IP task event queue, using a block time of
  * zero.  Return pdPASS if the message was sent successfully, otherwise return
@@ -768,6 +901,11 @@ BaseType_t xSendEventToIPTask( eIPEvent_t eEvent );
  */
 BaseType_t xSendEventStructToIPTask( const IPStackEvent_t *pxEvent, TickType_t xTimeout );
 
+/*
+ * The same as above, to be called from an interrupt.
+ */
+BaseType_t xSendEventStructToIPTaskFromISR( const IPStackEvent_t *pxEvent, BaseType_t *pxHigherPriorityTaskWoken );
+
 /*
  * Returns a pointer to the original NetworkBuffer from a pointer to a UDP
  * payload buffer.
@@ -810,6 +948,21 @@ extern void vSocketSelect( SocketSelect_t *pxSocketSelect );
 
 #endif /* ipconfigSUPPORT_SELECT_FUNCTION */
 
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+
+typedef struct xSOCKET_POLL
+{
+	EventGroupHandle_t xPollGroup;
+	List_t xReadyList;	/* Sockets which had an event since they were last found idle. */
+	UBaseType_t uxSocketCount;	/* The number of sockets registered in this poll set. */
+} SocketPoll_t;
+
+/* Called by the IP-task when 'xEvents' ( eSELECT_READ/WRITE/EXCEPT ) may have
+become true for a socket. */
+extern void vSocketPollEvent( FreeRTOS_Socket_t *pxSocket, EventBits_t xEvents );
+
+#endif /* ipconfigSUPPORT_POLL_SET */
+
 void vIPSetDHCPTimerEnableState( BaseType_t xEnableState );
 void vIPReloadDHCPTimer( uint32_t ulLeaseTime );
 #if( ipconfigDNS_USE_CALLBACKS != 0 )
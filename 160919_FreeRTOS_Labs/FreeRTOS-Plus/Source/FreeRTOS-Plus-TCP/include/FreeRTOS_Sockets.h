@@ -158,6 +158,18 @@ FreeRTOS_setsockopt(). */
 	#define FREERTOS_SO_UDP_MAX_RX_PACKETS	( 16 )		/* This option helps to limit the maximum number of packets a UDP socket will buffer */
 #endif
 
+#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+	#define FREERTOS_SO_TCP_CONGESTION	( 17 )		/* Choose the congestion control algorithm of a TCP socket, parameter is a pointer to a BaseType_t */
+
+	/* Values for FREERTOS_SO_TCP_CONGESTION. */
+	#define FREERTOS_TCP_CC_NEWRENO		( 1 )
+	#define FREERTOS_TCP_CC_CUBIC		( 2 )
+#endif
+
+#define FREERTOS_SO_TCP_NODELAY			( 18 )		/* Non-zero (the default): send small segments immediately.  Zero: use Nagle's algorithm */
+#define FREERTOS_SO_TCP_CORK			( 19 )		/* Non-zero: only send full-size segments, zero: send the remaining data.  Same as FREERTOS_SO_SET_FULL_SIZE */
+#define FREERTOS_SO_TCP_QUICKACK		( 20 )		/* Non-zero: acknowledge received data immediately, in stead of delaying the ACK */
+
 #define FREERTOS_NOT_LAST_IN_FRAGMENTED_PACKET 	( 0x80 )  /* For internal use only, but also part of an 8-bit bitwise value. */
 #define FREERTOS_FRAGMENTED_PACKET				( 0x40 )  /* For internal use only, but also part of an 8-bit bitwise value. */
 
@@ -249,6 +261,28 @@ int32_t FreeRTOS_recvfrom( Socket_t xSocket, void *pvBuffer, size_t xBufferLengt
 int32_t FreeRTOS_sendto( Socket_t xSocket, const void *pvBuffer, size_t xTotalDataLength, BaseType_t xFlags, const struct freertos_sockaddr *pxDestinationAddress, socklen_t xDestinationAddressLength );
 BaseType_t FreeRTOS_bind( Socket_t xSocket, struct freertos_sockaddr *pxAddress, socklen_t xAddressLength );
 
+#if( ipconfigUSE_UDP_BATCH != 0 )
+	/* A message for FreeRTOS_recvmmsg() and FreeRTOS_sendmmsg().  With
+	FREERTOS_ZERO_COPY, 'pvBuffer' is the payload of a network buffer, which
+	FreeRTOS_recvmmsg() sets, and FreeRTOS_sendmmsg() takes from
+	FreeRTOS_GetUDPPayloadBuffer(). */
+	typedef struct xUDP_MESSAGE
+	{
+		void *pvBuffer;
+		size_t uxLength;	/* The size of 'pvBuffer' or the length of the message.  Set to the length received. */
+		struct freertos_sockaddr xAddress;	/* The source or the destination. */
+	} UDPMessage_t;
+
+	/*
+	 * Both functions return the number of messages received or sent, or a
+	 * negative errno value.  FreeRTOS_recvmmsg() only blocks until the first
+	 * message has arrived.  When FreeRTOS_sendmmsg() sends less than 'uxCount'
+	 * zero-copy messages, the caller still owns the other buffers.
+	 */
+	int32_t FreeRTOS_recvmmsg( Socket_t xSocket, UDPMessage_t *pxMessages, size_t uxCount, BaseType_t xFlags );
+	int32_t FreeRTOS_sendmmsg( Socket_t xSocket, UDPMessage_t *pxMessages, size_t uxCount, BaseType_t xFlags );
+#endif /* ipconfigUSE_UDP_BATCH */
+
 /* function to get the local address and IP port */
 size_t FreeRTOS_GetLocalAddress( Socket_t xSocket, struct freertos_sockaddr *pxAddress );
 
@@ -314,6 +348,34 @@ FreeRTOS_rx_size(). */
  */
 uint8_t *FreeRTOS_get_tx_head( Socket_t xSocket, BaseType_t *pxLength );
 
+#if( ipconfigUSE_SENDFILE != 0 ) || ( ipconfigUSE_RECV_TO_FILE != 0 )
+	/* A FreeRTOS+FAT file, see ff_file.h. */
+	struct _FF_FILE;
+#endif
+
+#if( ipconfigUSE_SENDFILE != 0 )
+	/*
+	 * Send 'uxLength' bytes of a FreeRTOS+FAT file, starting at 'uxOffset'.
+	 * The file is read directly into the TX stream of the socket.  The function
+	 * does not block: it returns the number of bytes queued, which is less than
+	 * 'uxLength' when the TX stream is full, or a negative errno value.  When
+	 * the file can not be read in full, nothing is queued and
+	 * -pdFREERTOS_ERRNO_EIO is returned.
+	 */
+	BaseType_t FreeRTOS_sendfile( Socket_t xSocket, struct _FF_FILE *pxFile, size_t uxOffset, size_t uxLength );
+#endif
+
+#if( ipconfigUSE_RECV_TO_FILE != 0 )
+	/*
+	 * Write at most 'uxLength' received bytes to a FreeRTOS+FAT file, at its
+	 * current position, directly from the RX stream of the socket.  The
+	 * function does not block: it returns the number of bytes written, or a
+	 * negative errno value once the connection is closed and all data has been
+	 * written.
+	 */
+	BaseType_t FreeRTOS_recv_to_file( Socket_t xSocket, struct _FF_FILE *pxFile, size_t uxLength );
+#endif
+
 #endif /* ipconfigUSE_TCP */
 
 /*
@@ -364,6 +426,7 @@ typedef union xTCP_UDP_HANDLER
 } F_TCP_UDP_Handler_t;
 
 BaseType_t FreeRTOS_setsockopt( Socket_t xSocket, int32_t lLevel, int32_t lOptionName, const void *pvOptionValue, size_t xOptionLength );
+BaseType_t FreeRTOS_getsockopt( Socket_t xSocket, int32_t lLevel, int32_t lOptionName, void *pvOptionValue, size_t *pxOptionLength );
 BaseType_t FreeRTOS_closesocket( Socket_t xSocket );
 uint32_t FreeRTOS_gethostbyname( const char *pcHostName );
 uint32_t FreeRTOS_inet_addr( const char * pcIPAddress );
@@ -376,6 +439,33 @@ const struct xSTREAM_BUFFER *FreeRTOS_get_rx_buf( Socket_t xSocket );
 
 void FreeRTOS_netstat( void );
 
+#if( ipconfigSOCKET_SLAB_DEPTH > 0 )
+
+	/* Indexes of the socket slabs, for FreeRTOS_GetSocketSlabStats(). */
+	#define FREERTOS_SLAB_UDP_SOCKET	( 0 )
+	#define FREERTOS_SLAB_TCP_SOCKET	( 1 )
+	#define FREERTOS_SLAB_RX_STREAM		( 2 )
+	#define FREERTOS_SLAB_TX_STREAM		( 3 )
+	#define FREERTOS_SLAB_COUNT			( 4 )
+
+	typedef struct xSOCKET_SLAB_STATS
+	{
+		size_t uxObjectSize;	/* The size of the objects in this slab. */
+		UBaseType_t uxCached;	/* The number of objects now waiting for re-use. */
+		UBaseType_t uxHits;		/* Allocations served from the slab. */
+		UBaseType_t uxMisses;	/* Allocations that had to call the heap. */
+		UBaseType_t uxReleased;	/* Objects put back into the slab. */
+		UBaseType_t uxOverflow;	/* Objects freed to the heap because the slab was full. */
+	} SocketSlabStats_t;
+
+	/* Copy the statistics of one slab, returns pdFAIL for an invalid index. */
+	BaseType_t FreeRTOS_GetSocketSlabStats( BaseType_t xIndex, SocketSlabStats_t *pxStats );
+
+	/* Return all cached objects to the heap. */
+	void FreeRTOS_SocketSlabFlush( void );
+
+#endif /* ipconfigSOCKET_SLAB_DEPTH */
+
 #if ipconfigSUPPORT_SELECT_FUNCTION == 1
 
 	/* For FD_SET and FD_CLR, a combination of the following bits can be used: */
@@ -400,6 +490,39 @@ void FreeRTOS_netstat( void );
 
 #endif /* ipconfigSUPPORT_SELECT_FUNCTION */
 
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+
+	/* A poll set is the scalable alternative to a socket set: the IP-task
+	queues a registered socket as soon as something happens to it, and
+	FreeRTOS_PollWait() only checks the queued sockets.  The events are the
+	same eSELECT_READ, eSELECT_WRITE and eSELECT_EXCEPT bits, and they are
+	level-triggered: a socket is returned as long as the condition holds. */
+
+	typedef void *PollSet_t;
+
+	typedef enum ePOLL_CTL {
+		ePOLL_CTL_ADD = 1,	/* Register a socket, which may belong to one poll set only. */
+		ePOLL_CTL_MOD,		/* Change the events and the user data of a registered socket. */
+		ePOLL_CTL_DEL,		/* Remove a socket from the poll set. */
+	} ePollCtl_t;
+
+	typedef struct xPOLL_EVENT
+	{
+		Socket_t xSocket;
+		EventBits_t xEvents;	/* The events which are true now. */
+		void *pvData;			/* As passed to FreeRTOS_PollCtl(). */
+	} PollEvent_t;
+
+	PollSet_t FreeRTOS_CreatePollSet( void );
+	/* All sockets must be removed before a poll set is deleted. */
+	void FreeRTOS_DeletePollSet( PollSet_t xPollSet );
+	BaseType_t FreeRTOS_PollCtl( PollSet_t xPollSet, Socket_t xSocket, BaseType_t xOperation, EventBits_t xEvents, void *pvData );
+	/* Returns the number of events stored in 'pxEvents', 0 after a time-out,
+	or -pdFREERTOS_ERRNO_EINTR when a registered socket was signalled. */
+	BaseType_t FreeRTOS_PollWait( PollSet_t xPollSet, PollEvent_t *pxEvents, BaseType_t xMaxEvents, TickType_t xBlockTimeTicks );
+
+#endif /* ipconfigSUPPORT_POLL_SET */
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
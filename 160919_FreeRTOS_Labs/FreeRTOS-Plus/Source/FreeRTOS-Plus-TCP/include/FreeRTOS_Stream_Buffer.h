@@ -281,6 +281,26 @@ size_t uxStreamBufferAdd( StreamBuffer_t *pxBuffer, size_t uxOffset, const uint8
  */
 size_t uxStreamBufferGet( StreamBuffer_t *pxBuffer, size_t uxOffset, uint8_t *pucData, size_t uxMaxCount, BaseType_t xPeek );
 
+/*
+ * Copy bytes into the free space of a stream buffer without moving any of the
+ * markers, and return their checksum in *pusChecksum.  The bytes can be made
+ * available later by calling uxStreamBufferAdd() with pucData == NULL.
+ */
+size_t uxStreamBufferPlaceChecksum( StreamBuffer_t *pxBuffer, size_t uxOffset, const uint8_t *pucData, size_t uxCount, uint16_t *pusChecksum );
+
+/*
+ * Read bytes from a stream buffer in 'peek' mode, and return their checksum
+ * in *pusChecksum.
+ */
+size_t uxStreamBufferPeekChecksum( StreamBuffer_t *pxBuffer, size_t uxOffset, uint8_t *pucData, size_t uxMaxCount, uint16_t *pusChecksum );
+
+/*
+ * Find bytes in a stream buffer without copying them.  The first *puxFirst
+ * bytes are at *ppucFirst, the remaining bytes (if any) at the start of
+ * ucArray.
+ */
+size_t uxStreamBufferPeekFragments( StreamBuffer_t *pxBuffer, size_t uxOffset, size_t uxMaxCount, uint8_t **ppucFirst, size_t *puxFirst );
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
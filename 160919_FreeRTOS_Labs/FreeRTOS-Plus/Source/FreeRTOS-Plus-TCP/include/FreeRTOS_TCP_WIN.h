@@ -96,7 +96,7 @@ typedef struct xTCP_SEGMENT
 	} u;
 #if( ipconfigUSE_TCP_WIN != 0 )
 	struct xLIST_ITEM xQueueItem;	/* TX only: segments can be linked in one of three queues: xPriorityQueue, xTxQueue, and xWaitQueue */
-	struct xLIST_ITEM xListItem;	/* With this item the segment can be connected to a list, depending on who is owning it */
+	struct xLIST_ITEM xListItem;	/* With this item a free segment is connected to the pool 'xSegmentList' */
 #endif
 } TCPSegment_t;
 
@@ -110,12 +110,32 @@ typedef struct xTCP_WINSIZE
  * If TCP time-stamps are being used, they will occupy 12 bytes in
  * each packet, and thus the message space will become smaller
  */
+#define winTIMESTAMP_OPTION_LENGTH		( 12u )
+
+/* The clock of the TCP time-stamps option (RFC 7323): it counts in ms. */
+#define winTIMESTAMP_NOW()				( ( uint32_t ) ( xTaskGetTickCount() * portTICK_PERIOD_MS ) )
+
+/* The SACK option: NOP, NOP, kind and length, followed by 8 bytes for every
+block. */
+#define winSACK_OPTION_LENGTH( uxBlocks )	( 4u + ( 8u * ( uxBlocks ) ) )
+
+/* A TCP header has room for at most 40 bytes of options. */
+#define winMAX_OPTIONS_LENGTH			( 40u )
+
 /* Keep this as a multiple of 4 */
 #if( ipconfigUSE_TCP_WIN == 1 )
-	#if( ipconfigUSE_TCP_TIMESTAMPS == 1 )
-		#define ipSIZE_TCP_OPTIONS	( 16u + 12u )
+	#if( ipconfigTCP_SACK_BLOCKS > 1 )
+		#define winSIZE_SACK_OPTIONS	winSACK_OPTION_LENGTH( ipconfigTCP_SACK_BLOCKS )
 	#else
-		#define ipSIZE_TCP_OPTIONS	16u
+		#define winSIZE_SACK_OPTIONS	16u
+	#endif
+	#if( ipconfigUSE_TCP_TIMESTAMPS == 1 ) && ( ipconfigTCP_SACK_BLOCKS > 3 )
+		/* When time-stamps are in use, at most 3 SACK blocks are sent. */
+		#define ipSIZE_TCP_OPTIONS	winMAX_OPTIONS_LENGTH
+	#elif( ipconfigUSE_TCP_TIMESTAMPS == 1 )
+		#define ipSIZE_TCP_OPTIONS	( winSIZE_SACK_OPTIONS + 12u )
+	#else
+		#define ipSIZE_TCP_OPTIONS	winSIZE_SACK_OPTIONS
 	#endif
 #else
 	#if	ipconfigUSE_TCP_TIMESTAMPS == 1
@@ -125,6 +145,21 @@ typedef struct xTCP_WINSIZE
 	#endif
 #endif
 
+#if( ipSIZE_TCP_OPTIONS > winMAX_OPTIONS_LENGTH )
+	#error ipSIZE_TCP_OPTIONS is larger than the 40 bytes of options that a TCP header can hold
+#endif
+
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_RX_RANGE_COUNT > 0 )
+	/* A range of data that has been received out of order, from
+	ulFirstSequenceNumber up to but not including ulLastSequenceNumber.  The
+	data itself is stored in the rxStream of the socket. */
+	typedef struct xTCP_RX_RANGE
+	{
+		uint32_t ulFirstSequenceNumber;
+		uint32_t ulLastSequenceNumber;
+	} TCPRxRange_t;
+#endif
+
 /*
  *	Every TCP connection owns a TCP window for the administration of all packets
  *	It owns two sets of segment descriptors, incoming and outgoing
@@ -138,6 +173,14 @@ typedef struct xTCP_WINDOW
 			uint32_t
 				bHasInit : 1,		/* The window structure has been initialised */
 				bSendFullSize : 1,	/* May only send packets with a size equal to MSS (for optimisation) */
+				bNagle : 1,			/* Hold a small segment while earlier data has not been acknowledged */
+				#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+					bFastRecovery : 1,	/* A fast retransmission took place, waiting for ulRecoverSequenceNumber to be ACK'd */
+					bCubicEpoch : 1,	/* CUBIC: the current congestion avoidance epoch has been started */
+				#endif
+				#if( ipconfigTCP_RTO_RFC6298 != 0 )
+					bHasRTT : 1,		/* The first RTT sample has been taken */
+				#endif
 				bTimeStamps : 1;	/* Socket is supposed to use TCP time-stamps. This depends on the */
 		} bits;						/* party which opens the connection */
 		uint32_t ulFlags;
@@ -160,6 +203,10 @@ typedef struct xTCP_WINDOW
 	uint32_t ulUserDataLength;			/* Number of bytes in Rx buffer which may be passed to the user, after having received a 'missing packet' */
 	uint32_t ulNextTxSequenceNumber;	/* The sequence number given to the next byte to be added for transmission */
 	int32_t lSRTT;						/* Smoothed Round Trip Time, it may increment quickly and it decrements slower */
+#if( ipconfigTCP_RTO_RFC6298 != 0 )
+	int32_t lRTTVar;					/* RFC 6298: the RTT variation, in ms */
+	int32_t lRTO;						/* RFC 6298: the retransmission time-out of a first transmission, in ms */
+#endif
 	uint8_t ucOptionLength;				/* Number of valid bytes in ulOptionsData[] */
 #if( ipconfigUSE_TCP_WIN == 1 )
 	List_t xPriorityQueue;				/* Priority queue: segments which must be sent immediately */
@@ -167,8 +214,24 @@ typedef struct xTCP_WINDOW
 	List_t xWaitQueue;					/* Waiting queue:  outstanding segments */
 	TCPSegment_t *pxHeadSegment;		/* points to a segment which has not been transmitted and it's size is still growing (user data being added) */
 	uint32_t ulOptionsData[ipSIZE_TCP_OPTIONS/sizeof(uint32_t)];	/* Contains the options we send out */
-	List_t xTxSegments;					/* A linked list of all transmission segments, sorted on sequence number */
-	List_t xRxSegments;					/* A linked list of reception segments, order depends on sequence of arrival */
+	TCPSegment_t *pxTxSegments[ ipconfigTCP_TX_RING_LENGTH ];	/* A ring of all transmission segments, sorted on sequence number */
+	UBaseType_t uxTxHead;				/* The index of the oldest segment in pxTxSegments[] */
+	UBaseType_t uxTxCount;				/* The number of segments in pxTxSegments[] */
+	#if( ipconfigTCP_RX_RANGE_COUNT > 0 )
+		TCPRxRange_t xRxRanges[ ipconfigTCP_RX_RANGE_COUNT ];	/* Data received out of order, sorted on sequence number, no ranges overlap or touch */
+		UBaseType_t uxRxRangeCount;			/* The number of valid entries in xRxRanges[] */
+	#endif
+	#if( ipconfigTCP_CONGESTION_CONTROL != 0 )
+		uint32_t ulCongestionWindow;		/* cwnd: the number of bytes that may be outstanding */
+		uint32_t ulSlowStartThreshold;		/* ssthresh: below this value, cwnd grows with every ACK */
+		uint32_t ulBytesAcked;				/* Bytes ACK'd since cwnd was last increased in congestion avoidance */
+		uint32_t ulRecoverSequenceNumber;	/* NewReno: the highest sequence number sent when fast recovery started */
+		uint32_t ulCubicWindowMax;			/* CUBIC: the size of cwnd just before the last reduction */
+		uint32_t ulCubicRenoWindow;			/* CUBIC: the size that cwnd would have with NewReno */
+		uint32_t ulCubicK;					/* CUBIC: the time needed to grow back to ulCubicWindowMax, in units of 1/32 sec */
+		TCPTimer_t xCubicEpoch;				/* CUBIC: the moment that the current epoch started */
+		uint8_t ucCongestionAlgorithm;		/* FREERTOS_TCP_CC_NEWRENO or FREERTOS_TCP_CC_CUBIC */
+	#endif
 #else
 	/* For tiny TCP, there is only 1 outstanding TX segment */
 	TCPSegment_t xTxSegment;			/* Priority queue */
@@ -177,8 +240,31 @@ typedef struct xTCP_WINDOW
 	uint16_t usPeerPortNumber;			/* debugging/logging: the peer's TCP port number */
 	uint16_t usMSS;						/* Current accepted MSS */
 	uint16_t usMSSInit;					/* MSS as configured by the socket owner */
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_WIN_SEG_MIN_PER_SOCKET > 0 )
+	uint16_t usSegmentQuota;			/* The number of segment descriptors reserved for this window */
+#endif
 } TCPWindow_t;
 
+/* The number of ranges of data that are stored while earlier data is
+missing. */
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_RX_RANGE_COUNT > 0 )
+	#define winRX_RANGES_USED( pxWindow )	( ( pxWindow )->uxRxRangeCount )
+#else
+	#define winRX_RANGES_USED( pxWindow )	( 0u )
+#endif
+
+#if( ipconfigUSE_TCP_WIN == 1 )
+	/* The state of the pool of segment descriptors. */
+	typedef struct xTCP_SEGMENT_STATS
+	{
+		UBaseType_t uxAllocated;	/* Descriptors allocated so far, at most ipconfigTCP_WIN_SEG_COUNT */
+		UBaseType_t uxFree;			/* Allocated descriptors not owned by any window */
+		UBaseType_t uxLowestFree;	/* The lowest value of uxFree + the descriptors that may still be allocated */
+		UBaseType_t uxReserved;		/* Descriptors reserved for windows that own less than their quota */
+		UBaseType_t uxStarved;		/* The number of times that a window did not get a descriptor */
+	} TCPSegmentStats_t;
+#endif
+
 
 /*=============================================================================
  *
@@ -197,6 +283,11 @@ void vTCPWindowDestroy( TCPWindow_t *pxWindow );
 /* Initialize a window */
 void vTCPWindowInit( TCPWindow_t *pxWindow, uint32_t ulAckNumber, uint32_t ulSequenceNumber, uint32_t ulMSS );
 
+#if( ipconfigUSE_TCP_WIN == 1 )
+	/* Get the statistics of the pool of segment descriptors. */
+	void vTCPWindowGetSegmentStats( TCPSegmentStats_t *pxStats );
+#endif
+
 /*=============================================================================
  *
  * Rx functions
@@ -239,6 +330,14 @@ BaseType_t xTCPWindowTxDone( TCPWindow_t *pxWindow );
  * apPos will point to a location with the circular data buffer: txStream */
 uint32_t ulTCPWindowTxGet( TCPWindow_t *pxWindow, uint32_t ulWindowSize, int32_t *plPosition );
 
+#if( ipconfigUSE_TCP_WIN == 1 ) && ( ipconfigTCP_LARGE_SEND != 0 )
+	/* Fetches a series of new, contiguous segments of at most ulMaxLength
+	 * bytes in total.  All but the last segment have a length of MSS.
+	 * Returns zero when there is nothing new to send, or when a segment must
+	 * be retransmitted first. */
+	uint32_t ulTCPWindowTxGetBurst( TCPWindow_t *pxWindow, uint32_t ulWindowSize, int32_t *plPosition, uint32_t ulMaxLength );
+#endif
+
 /* Receive a normal ACK */
 uint32_t ulTCPWindowTxAck( TCPWindow_t *pxWindow, uint32_t ulSequenceNumber );
 
@@ -178,6 +178,10 @@ http://www.FreeRTOS.org/FreeRTOS-Plus/FreeRTOS_Plus_TCP/TCP_IP_Trace.html */
 	#define iptraceNETWORK_INTERFACE_TRANSMIT()
 #endif
 
+#ifndef iptraceNETWORK_INTERFACE_OUTPUT_BATCH
+	#define iptraceNETWORK_INTERFACE_OUTPUT_BATCH( xCount )
+#endif
+
 #ifndef iptraceNETWORK_INTERFACE_RECEIVE
 	#define iptraceNETWORK_INTERFACE_RECEIVE()
 #endif
@@ -186,6 +190,10 @@ http://www.FreeRTOS.org/FreeRTOS-Plus/FreeRTOS_Plus_TCP/TCP_IP_Trace.html */
 	#define iptraceSENDING_DNS_REQUEST()
 #endif
 
+#ifndef iptraceDNS_REQUEST_COMPLETE
+	#define iptraceDNS_REQUEST_COMPLETE( pcName, ulIPAddress, xLatencyTicks )
+#endif
+
 #ifndef	iptraceWAITING_FOR_TX_DMA_DESCRIPTOR
 	#define iptraceWAITING_FOR_TX_DMA_DESCRIPTOR()
 #endif
@@ -222,4 +230,28 @@ http://www.FreeRTOS.org/FreeRTOS-Plus/FreeRTOS_Plus_TCP/TCP_IP_Trace.html */
 	#define iptraceSENDTO_DATA_TOO_LONG()
 #endif
 
+#ifndef iptraceTCP_RX_SEGMENTS_MERGED
+	#define iptraceTCP_RX_SEGMENTS_MERGED( uxCount, uxLength )
+#endif
+
+#ifndef iptraceTCP_SYN_COOKIE_SENT
+	#define iptraceTCP_SYN_COOKIE_SENT( pxListenSocket )
+#endif
+
+#ifndef iptraceTCP_SYN_COOKIE_ACCEPTED
+	#define iptraceTCP_SYN_COOKIE_ACCEPTED( pxListenSocket )
+#endif
+
+#ifndef iptraceTCP_SYN_COOKIE_REJECTED
+	#define iptraceTCP_SYN_COOKIE_REJECTED( pxListenSocket )
+#endif
+
+#ifndef iptraceTCP_ACCEPT_POOL_EMPTY
+	#define iptraceTCP_ACCEPT_POOL_EMPTY( pxListenSocket )
+#endif
+
+#ifndef iptraceTCP_WIN_SEGMENT_STARVED
+	#define iptraceTCP_WIN_SEGMENT_STARVED( pxWindow )
+#endif
+
 #endif /* UDP_TRACE_MACRO_DEFAULTS_H */
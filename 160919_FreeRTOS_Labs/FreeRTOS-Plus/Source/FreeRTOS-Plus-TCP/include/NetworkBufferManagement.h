@@ -81,6 +81,15 @@ UBaseType_t uxGetMinimumFreeNetworkBuffers( void );
 NetworkBufferDescriptor_t *pxDuplicateNetworkBufferWithDescriptor( NetworkBufferDescriptor_t * const pxNetworkBuffer,
 	BaseType_t xNewLength);
 
+#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+	/* Get the total number of bytes in a chain of fragments. */
+	size_t uxNetworkBufferChainLength( const NetworkBufferDescriptor_t *pxNetworkBuffer );
+
+	/* Copy a chain of fragments into a new, contiguous network buffer.  The
+	chain itself is left untouched. */
+	NetworkBufferDescriptor_t *pxLinearizeNetworkBuffer( const NetworkBufferDescriptor_t *pxNetworkBuffer );
+#endif
+
 /* Increase the size of a Network Buffer.
 In case BufferAllocation_2.c is used, the new space must be allocated. */
 NetworkBufferDescriptor_t *pxResizeNetworkBufferWithDescriptor( NetworkBufferDescriptor_t * pxNetworkBuffer,
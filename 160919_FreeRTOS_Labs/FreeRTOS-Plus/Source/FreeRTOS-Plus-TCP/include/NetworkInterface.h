@@ -68,6 +68,32 @@ BaseType_t xNetworkInterfaceOutput( NetworkBufferDescriptor_t * const pxNetworkB
 void vNetworkInterfaceAllocateRAMToBuffers( NetworkBufferDescriptor_t pxNetworkBuffers[ ipconfigNUM_NETWORK_BUFFER_DESCRIPTORS ] );
 BaseType_t xGetPhyLinkStatus( void );
 
+#if( ipconfigTCP_LARGE_SEND_OFFLOAD != 0 )
+	/* Send a TCP packet whose payload is larger than the MSS.  The hardware
+	must cut it into segments of at most 'usMSS' bytes, and calculate the IP-
+	and TCP checksums of each segment. */
+	BaseType_t xNetworkInterfaceOutputLarge( NetworkBufferDescriptor_t * const pxNetworkBuffer, uint16_t usMSS, BaseType_t xReleaseAfterSend );
+#endif
+
+#if( ipconfigNETWORK_INTERFACES > 1 )
+	/* An optional hook for a driver that owns more than one Ethernet port.
+	xNetworkInterfaceOutput() remains port 0.  xNetworkInterfaceInitialise()
+	registers an output function for each extra port, numbered from 1.  The
+	driver sets the field 'xInterface' of every frame that it receives.  This
+	is not multi-interface support: all ports share the one MAC-address,
+	IP-address and ARP cache of the stack, so each must be on a separate
+	segment. */
+	typedef BaseType_t ( * NetworkInterfaceOutputFunction_t )( NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t xReleaseAfterSend );
+	void vIPRegisterPortOutput( BaseType_t xInterface, NetworkInterfaceOutputFunction_t pxOutput );
+#endif
+
+#if( ipconfigUSE_NETWORK_OUTPUT_BATCH != 0 )
+	/* Send 'xCount' frames in the order in which they appear in the array.  The
+	driver becomes the owner of all buffers, as if xNetworkInterfaceOutput()
+	was called with xReleaseAfterSend = pdTRUE for each of them. */
+	BaseType_t xNetworkInterfaceOutputBatch( NetworkBufferDescriptor_t * const pxNetworkBuffers[], BaseType_t xCount );
+#endif
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -313,6 +313,13 @@ UBaseType_t uxCount;
 				}
 				#endif /* ipconfigUSE_LINKED_RX_MESSAGES */
 
+				#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+				{
+					/* make sure no fragments are attached */
+					pxReturn->pxNextFragment = NULL;
+				}
+				#endif /* ipconfigUSE_CHAINED_BUFFERS */
+
 				if( xTCPWindowLoggingLevel > 3 )
 				{
 					FreeRTOS_debug_printf( ( "BUF_GET[%ld]: %p (%p)\n",
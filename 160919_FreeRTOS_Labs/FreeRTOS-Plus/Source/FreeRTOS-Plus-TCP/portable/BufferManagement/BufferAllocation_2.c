@@ -143,8 +143,12 @@ BaseType_t xReturn, x;
 		in FreeRTOS+Trace.  */
 		#if( ipconfigINCLUDE_EXAMPLE_FREERTOS_PLUS_TRACE_CALLS == 1 )
 		{
-			extern QueueHandle_t xNetworkEventQueue;
-			vTraceSetQueueName( xNetworkEventQueue, "IPStackEvent" );
+			#if( ipconfigUSE_IP_EVENT_RING == 0 )
+			{
+				extern QueueHandle_t xNetworkEventQueue;
+				vTraceSetQueueName( xNetworkEventQueue, "IPStackEvent" );
+			}
+			#endif
 			vTraceSetQueueName( xNetworkBufferSemaphore, "NetworkBufferCount" );
 		}
 		#endif /*  ipconfigINCLUDE_EXAMPLE_FREERTOS_PLUS_TRACE_CALLS == 1 */
@@ -305,6 +309,13 @@ size_t uxCount;
 					pxReturn->pxNextBuffer = NULL;
 				}
 				#endif /* ipconfigUSE_LINKED_RX_MESSAGES */
+
+				#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+				{
+					/* make sure no fragments are attached */
+					pxReturn->pxNextFragment = NULL;
+				}
+				#endif /* ipconfigUSE_CHAINED_BUFFERS */
 			}
 		}
 		else
@@ -136,6 +136,11 @@ static void prvCreateThreadSafeBuffers( void );
  */
 static const char *prvRemoveSpaces( char *pcBuffer, int aBuflen, const char *pcMessage );
 
+/*
+ * Place a frame in the buffer that is read by the Win32 send thread.
+ */
+static void prvStoreFrame( const NetworkBufferDescriptor_t * const pxNetworkBuffer );
+
 /*-----------------------------------------------------------*/
 
 /* Required by the WinPCap library. */
@@ -222,41 +227,99 @@ static void prvCreateThreadSafeBuffers( void )
 
 BaseType_t xNetworkInterfaceOutput( NetworkBufferDescriptor_t * const pxNetworkBuffer, BaseType_t bReleaseAfterSend )
 {
-size_t xSpace;
-
 	iptraceNETWORK_INTERFACE_TRANSMIT();
 	configASSERT( xIsCallingFromIPTask() == pdTRUE );
 
+	prvStoreFrame( pxNetworkBuffer );
+
+	/* Kick the Tx task in either case in case it doesn't know the buffer is
+	full. */
+	SetEvent( pvSendEvent );
+
+	/* The buffer has been sent so can be released. */
+	if( bReleaseAfterSend != pdFALSE )
+	{
+		vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+	}
+
+	return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+#if( ipconfigUSE_NETWORK_OUTPUT_BATCH != 0 )
+
+	BaseType_t xNetworkInterfaceOutputBatch( NetworkBufferDescriptor_t * const pxNetworkBuffers[], BaseType_t xCount )
+	{
+	BaseType_t xIndex;
+
+		configASSERT( xIsCallingFromIPTask() == pdTRUE );
+
+		for( xIndex = 0; xIndex < xCount; xIndex++ )
+		{
+			iptraceNETWORK_INTERFACE_TRANSMIT();
+			prvStoreFrame( pxNetworkBuffers[ xIndex ] );
+		}
+
+		/* The Tx task is only woken up once for all frames. */
+		SetEvent( pvSendEvent );
+
+		for( xIndex = 0; xIndex < xCount; xIndex++ )
+		{
+			vReleaseNetworkBufferAndDescriptor( pxNetworkBuffers[ xIndex ] );
+		}
+
+		return pdPASS;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* ipconfigUSE_NETWORK_OUTPUT_BATCH */
+
+static void prvStoreFrame( const NetworkBufferDescriptor_t * const pxNetworkBuffer )
+{
+size_t xSpace, xLength;
+
+	/* The frame may consist of a chain of fragments, which are gathered into
+	xSendBuffer below.  Define ipconfigGATHER_TX_DRIVER as 1 to make use of
+	it. */
+	#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+	{
+		xLength = uxNetworkBufferChainLength( pxNetworkBuffer );
+	}
+	#else
+	{
+		xLength = pxNetworkBuffer->xDataLength;
+	}
+	#endif
+
 	/* Both the length of the data being sent and the actual data being sent
 	are placed in the thread safe buffer used to pass data between the FreeRTOS
 	tasks and the Win32 thread that sends data via the WinPCAP library.  Drop
 	the packet if there is insufficient space in the buffer to hold both. */
 	xSpace = uxStreamBufferGetSpace( xSendBuffer );
 
-	if( ( pxNetworkBuffer->xDataLength <= ( ipconfigNETWORK_MTU + ipSIZE_OF_ETH_HEADER ) ) &&
-		( xSpace >= ( pxNetworkBuffer->xDataLength + sizeof( pxNetworkBuffer->xDataLength ) ) ) )
+	if( ( xLength <= ( ipconfigNETWORK_MTU + ipSIZE_OF_ETH_HEADER ) ) &&
+		( xSpace >= ( xLength + sizeof( xLength ) ) ) )
 	{
 		/* First write in the length of the data, then write in the data
 		itself. */
-		uxStreamBufferAdd( xSendBuffer, 0, ( const uint8_t * ) &( pxNetworkBuffer->xDataLength ), sizeof( pxNetworkBuffer->xDataLength ) );
+		uxStreamBufferAdd( xSendBuffer, 0, ( const uint8_t * ) &( xLength ), sizeof( xLength ) );
 		uxStreamBufferAdd( xSendBuffer, 0, ( const uint8_t * ) pxNetworkBuffer->pucEthernetBuffer, pxNetworkBuffer->xDataLength );
-	}
-	else
-	{
-		FreeRTOS_debug_printf( ( "xNetworkInterfaceOutput: send buffers full to store %lu\n", pxNetworkBuffer->xDataLength ) );
-	}
 
-	/* Kick the Tx task in either case in case it doesn't know the buffer is
-	full. */
-	SetEvent( pvSendEvent );
+		#if( ipconfigUSE_CHAINED_BUFFERS != 0 )
+		{
+		NetworkBufferDescriptor_t *pxFragment;
 
-	/* The buffer has been sent so can be released. */
-	if( bReleaseAfterSend != pdFALSE )
+			for( pxFragment = pxNetworkBuffer->pxNextFragment; pxFragment != NULL; pxFragment = pxFragment->pxNextFragment )
+			{
+				uxStreamBufferAdd( xSendBuffer, 0, ( const uint8_t * ) pxFragment->pucEthernetBuffer, pxFragment->xDataLength );
+			}
+		}
+		#endif
+	}
+	else
 	{
-		vReleaseNetworkBufferAndDescriptor( pxNetworkBuffer );
+		FreeRTOS_debug_printf( ( "xNetworkInterfaceOutput: send buffers full to store %lu\n", xLength ) );
 	}
-
-	return pdPASS;
 }
 /*-----------------------------------------------------------*/
 
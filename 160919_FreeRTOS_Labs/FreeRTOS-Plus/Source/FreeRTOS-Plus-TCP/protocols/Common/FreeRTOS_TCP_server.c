@@ -80,6 +80,13 @@
 
 
 static void prvReceiveNewClient( TCPServer_t *pxServer, BaseType_t xIndex, Socket_t xNexSocket );
+/* Accept new clients on all server sockets. */
+static void prvAcceptClients( TCPServer_t *pxServer );
+/* Call the work function of every client and delete the clients that are
+finished. */
+static void prvCallAllClients( TCPServer_t *pxServer );
+/* Unlink a client from the server, close its handles and free it. */
+static void prvDeleteClient( TCPServer_t *pxServer, TCPClient_t *pxClient );
 static char *strnew( const char *pcString );
 /* Remove slashes at the end of a path. */
 static void prvRemoveSlash( char *pcDir );
@@ -87,11 +94,23 @@ static void prvRemoveSlash( char *pcDir );
 TCPServer_t *FreeRTOS_CreateTCPServer( const struct xSERVER_CONFIG *pxConfigs, BaseType_t xCount )
 {
 TCPServer_t *pxServer;
-SocketSet_t xSocketSet;
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+	PollSet_t xSocketSet;
+#else
+	SocketSet_t xSocketSet;
+#endif
 
 	/* Create a new server.
 	xPort / xPortAlt : Make the service available on 1 or 2 public port numbers. */
-	xSocketSet = FreeRTOS_CreateSocketSet();
+	#if( ipconfigSUPPORT_POLL_SET != 0 )
+	{
+		xSocketSet = FreeRTOS_CreatePollSet();
+	}
+	#else
+	{
+		xSocketSet = FreeRTOS_CreateSocketSet();
+	}
+	#endif
 
 	if( xSocketSet != NULL )
 	{
@@ -108,7 +127,16 @@ SocketSet_t xSocketSet;
 
 			memset( pxServer, '\0', xSize );
 			pxServer->xServerCount = xCount;
-			pxServer->xSocketSet = xSocketSet;
+			#if( ipconfigSUPPORT_POLL_SET != 0 )
+			{
+				pxServer->xPollSet = xSocketSet;
+				pxServer->xLastSweep = xTaskGetTickCount();
+			}
+			#else
+			{
+				pxServer->xSocketSet = xSocketSet;
+			}
+			#endif
 
 			for( xIndex = 0; xIndex < xCount; xIndex++ )
 			{
@@ -152,7 +180,7 @@ SocketSet_t xSocketSet;
 						}
 						#endif
 
-						FreeRTOS_FD_SET( xSocket, xSocketSet, eSELECT_READ|eSELECT_EXCEPT );
+						vTCPServerSetEvents( pxServer, xSocket, NULL, eSELECT_READ|eSELECT_EXCEPT );
 						pxServer->xServers[ xIndex ].xSocket = xSocket;
 						pxServer->xServers[ xIndex ].eType = pxConfigs[ xIndex ].eType;
 						pxServer->xServers[ xIndex ].pcRootDir = strnew( pxConfigs[ xIndex ].pcRootDir );
@@ -164,7 +192,15 @@ SocketSet_t xSocketSet;
 		else
 		{
 			/* Could not allocate the server, delete the socket set */
-			FreeRTOS_DeleteSocketSet( xSocketSet );
+			#if( ipconfigSUPPORT_POLL_SET != 0 )
+			{
+				FreeRTOS_DeletePollSet( xSocketSet );
+			}
+			#else
+			{
+				FreeRTOS_DeleteSocketSet( xSocketSet );
+			}
+			#endif
 		}
 	}
 	else
@@ -231,7 +267,7 @@ const char *pcType = "Unknown";
 		pxClient->fDeleteFunction = fDeleteFunc;
 		pxServer->pxClients = pxClient;
 
-		FreeRTOS_FD_SET( xNexSocket, pxServer->xSocketSet, eSELECT_READ|eSELECT_EXCEPT );
+		vTCPServerSetEvents( pxServer, xNexSocket, pxClient, eSELECT_READ|eSELECT_EXCEPT );
 	}
 	else
 	{
@@ -248,58 +284,175 @@ const char *pcType = "Unknown";
 
 void FreeRTOS_TCPServerWork( TCPServer_t *pxServer, TickType_t xBlockingTime )
 {
-TCPClient_t **ppxClient;
-BaseType_t xIndex;
 BaseType_t xRc;
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+	BaseType_t xEvent, xOther;
+	TCPClient_t *pxThis;
+	TickType_t xNow;
+#endif
 
-	/* Let the server do one working cycle */
-	xRc = FreeRTOS_select( pxServer->xSocketSet, xBlockingTime );
-
-	if( xRc != 0 )
+	#if( ipconfigSUPPORT_POLL_SET != 0 )
 	{
-		for( xIndex = 0; xIndex < pxServer->xServerCount; xIndex++ )
-		{
-		struct freertos_sockaddr xAddress;
-		Socket_t xNexSocket;
-		socklen_t xSocketLength;
+		/* Let the server do one working cycle.  Only the clients which have
+		an event will be called. */
+		xRc = FreeRTOS_PollWait( pxServer->xPollSet, pxServer->xEvents, ARRAY_SIZE( pxServer->xEvents ), xBlockingTime );
 
-			if( pxServer->xServers[ xIndex ].xSocket == FREERTOS_NO_SOCKET )
+		for( xEvent = 0; xEvent < xRc; xEvent++ )
+		{
+			if( pxServer->xEvents[ xEvent ].xSocket == NULL )
 			{
+				/* The client has been deleted while handling an earlier event. */
 				continue;
 			}
 
-			xSocketLength = sizeof( xAddress );
-			xNexSocket = FreeRTOS_accept( pxServer->xServers[ xIndex ].xSocket, &xAddress, &xSocketLength);
+			pxThis = ( TCPClient_t * ) pxServer->xEvents[ xEvent ].pvData;
 
-			if( ( xNexSocket != FREERTOS_NO_SOCKET ) && ( xNexSocket != FREERTOS_INVALID_SOCKET ) )
+			if( pxThis == NULL )
 			{
-				prvReceiveNewClient( pxServer, xIndex, xNexSocket );
+				/* One of the server sockets. */
+				prvAcceptClients( pxServer );
 			}
+			else if( pxThis->fWorkFunction( pxThis ) < 0 )
+			{
+				/* A client may own two sockets, e.g. an FTP data socket.
+				Forget the other events of this client. */
+				for( xOther = xEvent + 1; xOther < xRc; xOther++ )
+				{
+					if( pxServer->xEvents[ xOther ].pvData == ( void * ) pxThis )
+					{
+						pxServer->xEvents[ xOther ].xSocket = NULL;
+					}
+				}
+				prvDeleteClient( pxServer, pxThis );
+			}
+		}
+
+		/* The work functions expect to be called at regular intervals as
+		well, e.g. to continue a directory listing.  Call all clients after a
+		time-out, or when 'xBlockingTime' has passed since the last time. */
+		xNow = xTaskGetTickCount();
+
+		if( ( xRc == 0 ) || ( ( xNow - pxServer->xLastSweep ) >= xBlockingTime ) )
+		{
+			pxServer->xLastSweep = xNow;
+			prvCallAllClients( pxServer );
+		}
+	}
+	#else
+	{
+		/* Let the server do one working cycle */
+		xRc = FreeRTOS_select( pxServer->xSocketSet, xBlockingTime );
+
+		if( xRc != 0 )
+		{
+			prvAcceptClients( pxServer );
+		}
+
+		prvCallAllClients( pxServer );
+	}
+	#endif /* ipconfigSUPPORT_POLL_SET */
+}
+/*-----------------------------------------------------------*/
+
+static void prvAcceptClients( TCPServer_t *pxServer )
+{
+BaseType_t xIndex;
+
+	for( xIndex = 0; xIndex < pxServer->xServerCount; xIndex++ )
+	{
+	struct freertos_sockaddr xAddress;
+	Socket_t xNexSocket;
+	socklen_t xSocketLength;
+
+		if( pxServer->xServers[ xIndex ].xSocket == FREERTOS_NO_SOCKET )
+		{
+			continue;
+		}
+
+		xSocketLength = sizeof( xAddress );
+		xNexSocket = FreeRTOS_accept( pxServer->xServers[ xIndex ].xSocket, &xAddress, &xSocketLength);
+
+		if( ( xNexSocket != FREERTOS_NO_SOCKET ) && ( xNexSocket != FREERTOS_INVALID_SOCKET ) )
+		{
+			prvReceiveNewClient( pxServer, xIndex, xNexSocket );
 		}
 	}
+}
+/*-----------------------------------------------------------*/
 
-	ppxClient = &pxServer->pxClients;
+static void prvCallAllClients( TCPServer_t *pxServer )
+{
+TCPClient_t *pxThis, *pxNext;
+BaseType_t xRc;
 
-	while( ( * ppxClient ) != NULL )
+	pxThis = pxServer->pxClients;
+
+	while( pxThis != NULL )
 	{
-	TCPClient_t *pxThis = *ppxClient;
+		/* Remember the next client, 'pxThis' may be deleted. */
+		pxNext = pxThis->pxNextClient;
 
 		/* Almost C++ */
 		xRc = pxThis->fWorkFunction( pxThis );
 
-		if (xRc < 0 )
+		if( xRc < 0 )
 		{
-			*ppxClient = pxThis->pxNextClient;
-			/* Close handles, resources */
-			pxThis->fDeleteFunction( pxThis );
-			/* Free the space */
-			vPortFreeLarge( pxThis );
+			prvDeleteClient( pxServer, pxThis );
 		}
-		else
+
+		pxThis = pxNext;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvDeleteClient( TCPServer_t *pxServer, TCPClient_t *pxClient )
+{
+TCPClient_t **ppxClient;
+
+	for( ppxClient = &pxServer->pxClients; ( * ppxClient ) != NULL; ppxClient = &( ( * ppxClient )->pxNextClient ) )
+	{
+		if( ( * ppxClient ) == pxClient )
+		{
+			*ppxClient = pxClient->pxNextClient;
+			break;
+		}
+	}
+
+	/* Close handles, resources */
+	pxClient->fDeleteFunction( pxClient );
+	/* Free the space */
+	vPortFreeLarge( pxClient );
+}
+/*-----------------------------------------------------------*/
+
+void vTCPServerSetEvents( TCPServer_t *pxServer, Socket_t xSocket, TCPClient_t *pxClient, EventBits_t xEvents )
+{
+	#if( ipconfigSUPPORT_POLL_SET != 0 )
+	{
+		if( xEvents == 0u )
+		{
+			FreeRTOS_PollCtl( pxServer->xPollSet, xSocket, ePOLL_CTL_DEL, 0u, NULL );
+		}
+		else if( FreeRTOS_PollCtl( pxServer->xPollSet, xSocket, ePOLL_CTL_MOD, xEvents, ( void * ) pxClient ) != 0 )
+		{
+			/* The socket was not registered yet. */
+			FreeRTOS_PollCtl( pxServer->xPollSet, xSocket, ePOLL_CTL_ADD, xEvents, ( void * ) pxClient );
+		}
+	}
+	#else
+	{
+		/* The client is not needed: select() does not tell which client owns
+		the socket. */
+		( void ) pxClient;
+
+		FreeRTOS_FD_CLR( xSocket, pxServer->xSocketSet, eSELECT_ALL & ~xEvents );
+
+		if( xEvents != 0u )
 		{
-			ppxClient = &( pxThis->pxNextClient );
+			FreeRTOS_FD_SET( xSocket, pxServer->xSocketSet, xEvents );
 		}
 	}
+	#endif /* ipconfigSUPPORT_POLL_SET */
 }
 /*-----------------------------------------------------------*/
 
@@ -111,10 +111,16 @@
 	#error Name change : please rename the define to the new name 'ipconfigFTP_ZERO_COPY_ALIGNED_WRITES'
 #endif
 
+#if defined( ipconfigFTP_TX_ZERO_COPY ) && ( ipconfigFTP_TX_ZERO_COPY != 0 )
+	#error ipconfigFTP_TX_ZERO_COPY has been replaced by 'ipconfigUSE_SENDFILE', which uses FreeRTOS_sendfile()
+#endif
+
 /*
  * ipconfigFTP_ZERO_COPY_ALIGNED_WRITES : experimental optimisation option.
  * If non-zero, receiving data will be done with the zero-copy method and also
  * writes to disk will be done with sector-alignment as much as possible.
+ * Not used when ipconfigUSE_RECV_TO_FILE is non-zero, FreeRTOS_recv_to_file()
+ * does the same.
  */
 #ifndef ipconfigFTP_ZERO_COPY_ALIGNED_WRITES
 	#define ipconfigFTP_ZERO_COPY_ALIGNED_WRITES			0
@@ -418,7 +424,7 @@ FTPClient_t *pxClient = ( FTPClient_t * ) pxTCPClient;
 	/* Close the FTP command socket */
 	if( pxClient->xSocket != FREERTOS_NO_SOCKET )
 	{
-		FreeRTOS_FD_CLR( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_ALL );
+		vTCPServerSetEvents( pxClient->pxParent, pxClient->xSocket, ( TCPClient_t * ) pxClient, 0u );
 		FreeRTOS_closesocket( pxClient->xSocket );
 		pxClient->xSocket = FREERTOS_NO_SOCKET;
 	}
@@ -913,7 +919,7 @@ BaseType_t xResult;
 
 		if( xDoListen != pdFALSE )
 		{
-			FreeRTOS_FD_SET( xSocket, pxClient->pxParent->xSocketSet, eSELECT_EXCEPT | eSELECT_READ );
+			vTCPServerSetEvents( pxClient->pxParent, xSocket, ( TCPClient_t * ) pxClient, eSELECT_EXCEPT | eSELECT_READ );
 			/* Calling FreeRTOS_listen( ) */
 			xResult = prvTransferStart( pxClient );
 			if( xResult >= 0 )
@@ -923,7 +929,7 @@ BaseType_t xResult;
 		}
 		else
 		{
-			FreeRTOS_FD_SET( xSocket, pxClient->pxParent->xSocketSet, eSELECT_EXCEPT | eSELECT_READ | eSELECT_WRITE );
+			vTCPServerSetEvents( pxClient->pxParent, xSocket, ( TCPClient_t * ) pxClient, eSELECT_EXCEPT | eSELECT_READ | eSELECT_WRITE );
 			xResult = pdTRUE;
 		}
 	}
@@ -1010,8 +1016,7 @@ BaseType_t xRxSize;
 						( unsigned ) FreeRTOS_ntohs( xRemoteAddress.sin_port ) ) );
 				}
 				#endif /* ipconfigHAS_PRINTF */
-				FreeRTOS_FD_CLR( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
-				FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_READ|eSELECT_EXCEPT );
+				vTCPServerSetEvents( pxClient->pxParent, pxClient->xTransferSocket, ( TCPClient_t * ) pxClient, eSELECT_READ|eSELECT_EXCEPT );
 			}
 		}
 	}
@@ -1108,7 +1113,7 @@ static void prvTransferCloseSocket( FTPClient_t *pxClient )
 
 	if( pxClient->xTransferSocket != FREERTOS_NO_SOCKET )
 	{
-		FreeRTOS_FD_CLR( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_ALL );
+		vTCPServerSetEvents( pxClient->pxParent, pxClient->xTransferSocket, ( TCPClient_t * ) pxClient, 0u );
 		FreeRTOS_closesocket( pxClient->xTransferSocket );
 		pxClient->xTransferSocket = FREERTOS_NO_SOCKET;
 		if( pxClient->ulRecvBytes == 0ul )
@@ -1424,7 +1429,33 @@ int iErrorNo;
 }
 /*-----------------------------------------------------------*/
 
-#if( ipconfigFTP_ZERO_COPY_ALIGNED_WRITES == 0 )
+#if( ipconfigUSE_RECV_TO_FILE != 0 )
+
+	static BaseType_t prvStoreFileWork( FTPClient_t *pxClient )
+	{
+	BaseType_t xRc;
+
+		/* FreeRTOS_recv_to_file() writes the data directly from the RX stream
+		to the file, keeping the writes sector-aligned.  The size of the file
+		is not known in advance, all data is stored until the peer closes the
+		connection. */
+		xRc = FreeRTOS_recv_to_file( pxClient->xTransferSocket, pxClient->pxWriteHandle, ~( ( size_t ) 0u ) );
+
+		if( xRc > 0 )
+		{
+			pxClient->ulRecvBytes += xRc;
+		}
+		else if( xRc == -pdFREERTOS_ERRNO_EIO )
+		{
+			xRc = -1;
+			/* bHadError: a transfer got aborted because of an error. */
+			pxClient->bits1.bHadError = pdTRUE_UNSIGNED;
+		}
+
+		return xRc;
+	}
+
+#elif( ipconfigFTP_ZERO_COPY_ALIGNED_WRITES == 0 )
 
 	static BaseType_t prvStoreFileWork( FTPClient_t *pxClient )
 	{
@@ -1542,7 +1573,7 @@ int iErrorNo;
 		return xRc;
 	}
 
-#endif /* ipconfigFTP_ZERO_COPY_ALIGNED_WRITES */
+#endif /* ipconfigUSE_RECV_TO_FILE */
 /*-----------------------------------------------------------*/
 
 /*
@@ -1658,17 +1689,15 @@ size_t uxFileSize;
 static BaseType_t prvRetrieveFileWork( FTPClient_t *pxClient )
 {
 size_t uxSpace;
-size_t uxCount, uxItemsRead;
+size_t uxCount;
 BaseType_t xRc = 0;
 BaseType_t xSetEvent = pdFALSE;
+#if( ipconfigUSE_SENDFILE == 0 )
+	size_t uxItemsRead;
+#endif
 
 	do
 	{
-	#if( ipconfigFTP_TX_ZERO_COPY != 0 )
-		char *pcBuffer;
-		BaseType_t xBufferLength;
-	#endif /* ipconfigFTP_TX_ZERO_COPY */
-
 		/* Take the lesser of the two: tx_space (number of bytes that can be
 		queued for transmission) and uxBytesLeft (the number of bytes left to
 		read from the file) */
@@ -1676,8 +1705,20 @@ BaseType_t xSetEvent = pdFALSE;
 
 		if( uxSpace == 0 )
 		{
-			FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE | eSELECT_EXCEPT );
-			xRc = FreeRTOS_select( pxClient->pxParent->xSocketSet, 200 );
+			vTCPServerSetEvents( pxClient->pxParent, pxClient->xTransferSocket, ( TCPClient_t * ) pxClient, eSELECT_READ | eSELECT_EXCEPT | eSELECT_WRITE );
+			#if( ipconfigSUPPORT_POLL_SET != 0 )
+			{
+			PollEvent_t xEvent;
+
+				/* Only used to wait: the events are level-triggered, and
+				will be returned again to FreeRTOS_TCPServerWork(). */
+				xRc = FreeRTOS_PollWait( pxClient->pxParent->xPollSet, &xEvent, 1, 200 );
+			}
+			#else
+			{
+				xRc = FreeRTOS_select( pxClient->pxParent->xSocketSet, 200 );
+			}
+			#endif
 			uxSpace = FreeRTOS_tx_space( pxClient->xTransferSocket );
 		}
 
@@ -1688,7 +1729,7 @@ BaseType_t xSetEvent = pdFALSE;
 			break;
 		}
 
-		#if( ipconfigFTP_TX_ZERO_COPY == 0 )
+		#if( ipconfigUSE_SENDFILE == 0 )
 		{
 			if( uxCount > sizeof( pcFILE_BUFFER ) )
 			{
@@ -1698,8 +1739,9 @@ BaseType_t xSetEvent = pdFALSE;
 			if( uxItemsRead != uxCount )
 			{
 				FreeRTOS_printf( ( "prvRetrieveFileWork: Got %u Expected %u\n", ( unsigned )uxItemsRead, ( unsigned ) uxCount ) );
-				xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
-				pxClient->uxBytesLeft = 0u;
+				/* Abort the transfer, the client will get a 451 reply. */
+				pxClient->bits1.bHadError = pdTRUE_UNSIGNED;
+				xRc = -1;
 				break;
 			}
 			pxClient->uxBytesLeft -= uxCount;
@@ -1708,71 +1750,43 @@ BaseType_t xSetEvent = pdFALSE;
 			{
 			BaseType_t xTrueValue = 1;
 
+				/* The last block was read in full, let the FIN follow it. */
 				FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
 			}
 
 			xRc = FreeRTOS_send( pxClient->xTransferSocket, pcFILE_BUFFER, uxCount, 0 );
 		}
-		#else /* ipconfigFTP_TX_ZERO_COPY != 0 */
+		#else /* ipconfigUSE_SENDFILE != 0 */
 		{
-			/* Use zero-copy transmission:
-			FreeRTOS_get_tx_head() returns a direct pointer to the TX stream and
-			set xBufferLength to know how much space there is left. */
-			pcBuffer = ( char * )FreeRTOS_get_tx_head( pxClient->xTransferSocket, &xBufferLength );
-			if( ( pcBuffer != NULL ) && ( xBufferLength >= 512 ) )
+			/* FreeRTOS_sendfile() reads the file directly into the TX stream.
+			When the remaining data fits, the FIN will be sent along with it.
+			FreeRTOS_sendfile() only queues the data, and so the FIN, when it
+			was read in full. */
+			if( pxClient->uxBytesLeft <= uxSpace )
 			{
-				/* Will read disk data directly to the TX stream of the socket. */
-				uxCount = FreeRTOS_min_uint32( uxCount, ( uint32_t )xBufferLength );
-				if( uxCount > ( size_t ) 0x40000u )
-				{
-					uxCount = ( size_t ) 0x40000u;
-				}
-			}
-			else
-			{
-				/* Use the normal file i/o buffer. */
-				pcBuffer = pcFILE_BUFFER;
-				if( uxCount > sizeof( pcFILE_BUFFER ) )
-				{
-					uxCount = sizeof( pcFILE_BUFFER );
-				}
-			}
-
-			if ( pxClient->uxBytesLeft >= 1024u )
-			{
-				uxCount &= ~( ( size_t ) 512u - 1u );
-			}
+			BaseType_t xTrueValue = 1;
 
-			if( uxCount <= 0u )
-			{
-				/* Nothing to send after rounding down to a multiple of a sector size. */
-				break;
+				FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
 			}
 
-			uxItemsRead = ff_fread( pcBuffer, 1, uxCount, pxClient->pxReadHandle );
+			xRc = FreeRTOS_sendfile( pxClient->xTransferSocket, pxClient->pxReadHandle,
+				( size_t ) ff_ftell( pxClient->pxReadHandle ), pxClient->uxBytesLeft );
 
-			if( uxCount != uxItemsRead )
+			if( xRc == -pdFREERTOS_ERRNO_EIO )
 			{
-				FreeRTOS_printf( ( "prvRetrieveFileWork: Got %u Expected %u\n", ( unsigned )uxItemsRead, ( unsigned )uxCount ) );
-				xRc = FreeRTOS_shutdown( pxClient->xTransferSocket, FREERTOS_SHUT_RDWR );
-				pxClient->uxBytesLeft = 0u;
+				FreeRTOS_printf( ( "prvRetrieveFileWork: read error, %u bytes left\n", ( unsigned ) pxClient->uxBytesLeft ) );
+				/* Abort the transfer, the client will get a 451 reply. */
+				pxClient->bits1.bHadError = pdTRUE_UNSIGNED;
+				xRc = -1;
 				break;
 			}
-			pxClient->uxBytesLeft -= uxCount;
 
-			if( pxClient->uxBytesLeft == 0u )
-			{
-			BaseType_t xTrueValue = 1;
-
-				FreeRTOS_setsockopt( pxClient->xTransferSocket, 0, FREERTOS_SO_CLOSE_AFTER_SEND, ( void * ) &xTrueValue, sizeof( xTrueValue ) );
-			}
-			if( pcBuffer != pcFILE_BUFFER )
+			if( xRc > 0 )
 			{
-				pcBuffer = NULL;
+				pxClient->uxBytesLeft -= ( size_t ) xRc;
 			}
-			xRc = FreeRTOS_send( pxClient->xTransferSocket, pcBuffer, uxCount, 0 );
 		}
-		#endif /* ipconfigFTP_TX_ZERO_COPY */
+		#endif /* ipconfigUSE_SENDFILE */
 
 		if( xRc < 0 )
 		{
@@ -1806,12 +1820,12 @@ BaseType_t xSetEvent = pdFALSE;
 	}
 	else
 	{
-		FreeRTOS_FD_SET( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+		vTCPServerSetEvents( pxClient->pxParent, pxClient->xTransferSocket, ( TCPClient_t * ) pxClient, eSELECT_READ | eSELECT_EXCEPT | eSELECT_WRITE );
 		xSetEvent = pdTRUE;
 	}
 	if( xSetEvent == pdFALSE )
 	{
-		FreeRTOS_FD_CLR( pxClient->xTransferSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+		vTCPServerSetEvents( pxClient->pxParent, pxClient->xTransferSocket, ( TCPClient_t * ) pxClient, eSELECT_READ | eSELECT_EXCEPT );
 	}
 	return xRc;
 }
@@ -106,6 +106,17 @@ static BaseType_t prvOpenURL( HTTPClient_t *pxClient );
 static BaseType_t prvSendFile( HTTPClient_t *pxClient );
 static BaseType_t prvSendReply( HTTPClient_t *pxClient, BaseType_t xCode );
 static BaseType_t prvPostProcessTest(HTTPClient_t * pxClient);
+static void prvSetFileName( HTTPClient_t *pxClient );
+
+#if( ipconfigUSE_RECV_TO_FILE != 0 ) && ( ipconfigHTTP_ALLOW_PUT != 0 )
+	/* Read a request from the socket.  The body of a PUT request is left in
+	the RX stream, it will be stored by prvStoreFile(). */
+	static BaseType_t prvReceiveRequest( HTTPClient_t *pxClient );
+	static BaseType_t prvOpenPUT( HTTPClient_t *pxClient );
+	static BaseType_t prvStoreFile( HTTPClient_t *pxClient );
+	/* Find a header field, the name is compared case-insensitive. */
+	static const char *prvFindField( const char *pcHeader, const char *pcName );
+#endif
 
 static const char pcEmptyString[1] = { '\0' };
 
@@ -142,7 +153,7 @@ HTTPClient_t *pxClient = ( HTTPClient_t * ) pxTCPClient;
 	/* This HTTP client stops, close / release all resources. */
 	if( pxClient->xSocket != FREERTOS_NO_SOCKET )
 	{
-		FreeRTOS_FD_CLR( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_ALL );
+		vTCPServerSetEvents( pxClient->pxParent, pxClient->xSocket, ( TCPClient_t * ) pxClient, 0u );
 		FreeRTOS_closesocket( pxClient->xSocket );
 		pxClient->xSocket = FREERTOS_NO_SOCKET;
 	}
@@ -158,6 +169,7 @@ static void prvFileClose( HTTPClient_t *pxClient )
 		ff_fclose( pxClient->pxFileHandle );
 		pxClient->pxFileHandle = NULL;
 	}
+	pxClient->bits.bUploading = pdFALSE_UNSIGNED;
 }
 /*-----------------------------------------------------------*/
 
@@ -194,8 +206,10 @@ BaseType_t xRc;
 
 static BaseType_t prvSendFile( HTTPClient_t *pxClient )
 {
-size_t uxSpace;
-size_t uxCount;
+#if( ipconfigUSE_SENDFILE == 0 )
+	size_t uxSpace;
+	size_t uxCount;
+#endif
 BaseType_t xRc = 0;
 
 	if( pxClient->bits.bReplySent == pdFALSE_UNSIGNED )
@@ -210,6 +224,21 @@ BaseType_t xRc = 0;
 		xRc = prvSendReply( pxClient, WEB_REPLY_OK );
 	}
 
+	#if( ipconfigUSE_SENDFILE != 0 )
+	{
+		/* Read the file directly into the TX stream. */
+		if( ( xRc >= 0 ) && ( pxClient->uxBytesLeft > 0u ) )
+		{
+			xRc = FreeRTOS_sendfile( pxClient->xSocket, pxClient->pxFileHandle,
+				( size_t ) ff_ftell( pxClient->pxFileHandle ), pxClient->uxBytesLeft );
+
+			if( xRc > 0 )
+			{
+				pxClient->uxBytesLeft -= ( size_t ) xRc;
+			}
+		}
+	}
+	#else
 	if( xRc >= 0 ) do
 	{
 		uxSpace = FreeRTOS_tx_space( pxClient->xSocket );
@@ -239,27 +268,49 @@ BaseType_t xRc = 0;
 			}
 		}
 	} while( uxCount > 0u );
+	#endif /* ipconfigUSE_SENDFILE */
 
 	if( pxClient->uxBytesLeft == 0u )
 	{
 		/* Writing is ready, no need for further 'eSELECT_WRITE' events. */
-		FreeRTOS_FD_CLR( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+		vTCPServerSetEvents( pxClient->pxParent, pxClient->xSocket, ( TCPClient_t * ) pxClient, eSELECT_READ | eSELECT_EXCEPT );
 		prvFileClose( pxClient );
 	}
 	else
 	{
 		/* Wake up the TCP task as soon as this socket may be written to. */
-		FreeRTOS_FD_SET( pxClient->xSocket, pxClient->pxParent->xSocketSet, eSELECT_WRITE );
+		vTCPServerSetEvents( pxClient->pxParent, pxClient->xSocket, ( TCPClient_t * ) pxClient, eSELECT_READ | eSELECT_EXCEPT | eSELECT_WRITE );
 	}
 
 	return xRc;
 }
 /*-----------------------------------------------------------*/
 
+static void prvSetFileName( HTTPClient_t *pxClient )
+{
+char pcSlash[ 2 ];
+
+	if( pxClient->pcUrlData[ 0 ] != '/' )
+	{
+		/* Insert a slash before the file name. */
+		pcSlash[ 0 ] = '/';
+		pcSlash[ 1 ] = '\0';
+	}
+	else
+	{
+		/* The browser provided a starting '/' already. */
+		pcSlash[ 0 ] = '\0';
+	}
+	snprintf( pxClient->pcCurrentFilename, sizeof( pxClient->pcCurrentFilename ), "%s%s%s",
+		pxClient->pcRootDir,
+		pcSlash,
+		pxClient->pcUrlData);
+}
+/*-----------------------------------------------------------*/
+
 static BaseType_t prvOpenURL( HTTPClient_t *pxClient )
 {
 BaseType_t xRc;
-char pcSlash[ 2 ];
 
 	pxClient->bits.ulFlags = 0;
 
@@ -288,21 +339,7 @@ char pcSlash[ 2 ];
 	}
 	#endif /* ipconfigHTTP_HAS_HANDLE_REQUEST_HOOK */
 
-	if( pxClient->pcUrlData[ 0 ] != '/' )
-	{
-		/* Insert a slash before the file name. */
-		pcSlash[ 0 ] = '/';
-		pcSlash[ 1 ] = '\0';
-	}
-	else
-	{
-		/* The browser provided a starting '/' already. */
-		pcSlash[ 0 ] = '\0';
-	}
-	snprintf( pxClient->pcCurrentFilename, sizeof( pxClient->pcCurrentFilename ), "%s%s%s",
-		pxClient->pcRootDir,
-		pcSlash,
-		pxClient->pcUrlData);
+	prvSetFileName( pxClient );
 
 	pxClient->pxFileHandle = ff_fopen( pxClient->pcCurrentFilename, "rb" );
 
@@ -324,6 +361,143 @@ char pcSlash[ 2 ];
 }
 /*-----------------------------------------------------------*/
 
+#if( ipconfigUSE_RECV_TO_FILE != 0 ) && ( ipconfigHTTP_ALLOW_PUT != 0 )
+
+	static BaseType_t prvReceiveRequest( HTTPClient_t *pxClient )
+	{
+	BaseType_t xRc, xIndex;
+
+		/* Leave space for a terminating zero. */
+		xRc = FreeRTOS_recv( pxClient->xSocket, ( void * )pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ) - 1, FREERTOS_MSG_PEEK );
+
+		if( xRc > 0 )
+		{
+			if( ( xRc > xWebCommands[ ECMD_PUT ].xCommandLength ) &&
+				( memcmp( pcCOMMAND_BUFFER, xWebCommands[ ECMD_PUT ].pcCommandName, xWebCommands[ ECMD_PUT ].xCommandLength ) == 0 ) )
+			{
+				/* Only take the header, up to and including the empty line. */
+				for( xIndex = 3; xIndex < xRc; xIndex++ )
+				{
+					if( memcmp( pcCOMMAND_BUFFER + xIndex - 3, "\r\n\r\n", 4 ) == 0 )
+					{
+						xRc = xIndex + 1;
+						break;
+					}
+				}
+			}
+
+			/* Now remove the request from the RX stream. */
+			FreeRTOS_recv( pxClient->xSocket, NULL, xRc, 0 );
+			pcCOMMAND_BUFFER[ xRc ] = '\0';
+		}
+
+		return xRc;
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvOpenPUT( HTTPClient_t *pxClient )
+	{
+	BaseType_t xRc;
+	const char *pcLength;
+
+		pxClient->bits.ulFlags = 0;
+
+		prvFileClose( pxClient );
+		prvSetFileName( pxClient );
+
+		/* The header fields are searched as a string. */
+		pcCOMMAND_BUFFER[ sizeof( pcCOMMAND_BUFFER ) - 1 ] = '\0';
+		pcLength = prvFindField( pxClient->pcRestData, "Content-Length:" );
+
+		if( strstr( pxClient->pcCurrentFilename, ".." ) != NULL )
+		{
+			/* Do not allow to write outside the root directory. */
+			FreeRTOS_printf( ( "prvOpenPUT: refuse '%s'\n", pxClient->pcCurrentFilename ) );
+			xRc = prvSendReply( pxClient, WEB_BAD_REQUEST );
+		}
+		else if( pcLength == NULL )
+		{
+			/* Without a length, the end of the body can not be found. */
+			xRc = prvSendReply( pxClient, WEB_BAD_REQUEST );
+		}
+		else
+		{
+			pxClient->uxBytesLeft = ( size_t ) strtoul( pcLength + sizeof( "Content-Length:" ) - 1, NULL, 10 );
+			pxClient->pxFileHandle = ff_fopen( pxClient->pcCurrentFilename, "wb" );
+
+			FreeRTOS_printf( ( "Create file '%s' (%u bytes): %s\n", pxClient->pcCurrentFilename,
+				( unsigned ) pxClient->uxBytesLeft,
+				pxClient->pxFileHandle != NULL ? "Ok" : strerror( stdioGET_ERRNO() ) ) );
+
+			if( pxClient->pxFileHandle == NULL )
+			{
+				xRc = prvSendReply( pxClient, WEB_INTERNAL_SERVER_ERROR );
+			}
+			else
+			{
+				pxClient->bits.bUploading = pdTRUE_UNSIGNED;
+				xRc = prvStoreFile( pxClient );
+			}
+		}
+
+		return xRc;
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvStoreFile( HTTPClient_t *pxClient )
+	{
+	BaseType_t xRc = 0;
+
+		if( pxClient->uxBytesLeft > 0u )
+		{
+			/* Write the body directly from the RX stream to the file. */
+			xRc = FreeRTOS_recv_to_file( pxClient->xSocket, pxClient->pxFileHandle, pxClient->uxBytesLeft );
+
+			if( xRc > 0 )
+			{
+				pxClient->uxBytesLeft -= ( size_t ) xRc;
+			}
+		}
+
+		if( xRc < 0 )
+		{
+			/* The disk is full or the connection got closed, the client will
+			be deleted. */
+			FreeRTOS_printf( ( "prvStoreFile: rc = %ld, %u bytes left\n", xRc, ( unsigned ) pxClient->uxBytesLeft ) );
+			prvFileClose( pxClient );
+		}
+		else if( pxClient->uxBytesLeft == 0u )
+		{
+			prvFileClose( pxClient );
+			snprintf( pxClient->pxParent->pcExtraContents, sizeof( pxClient->pxParent->pcExtraContents ),
+				"Content-Length: 0\r\n" );
+			xRc = prvSendReply( pxClient, WEB_CREATED );
+		}
+
+		return xRc;
+	}
+	/*-----------------------------------------------------------*/
+
+	static const char *prvFindField( const char *pcHeader, const char *pcName )
+	{
+	size_t uxLength = strlen( pcName );
+	const char *pcResult = NULL;
+
+		for( ; *pcHeader != '\0'; pcHeader++ )
+		{
+			if( strncasecmp( pcHeader, pcName, uxLength ) == 0 )
+			{
+				pcResult = pcHeader;
+				break;
+			}
+		}
+
+		return pcResult;
+	}
+
+#endif /* ipconfigUSE_RECV_TO_FILE && ipconfigHTTP_ALLOW_PUT */
+/*-----------------------------------------------------------*/
+
 static BaseType_t prvProcessCmd( HTTPClient_t *pxClient, BaseType_t xIndex )
 {
 BaseType_t xResult = 0;
@@ -343,7 +517,15 @@ BaseType_t xResult = 0;
 	case ECMD_PUT:
         FreeRTOS_debug_printf(("Got To HTTP Put\n"));
         FreeRTOS_printf(("%s\n", pxClient->pcCurrentFilename));
-        xResult = prvOpenURL(pxClient);
+		#if( ipconfigUSE_RECV_TO_FILE != 0 ) && ( ipconfigHTTP_ALLOW_PUT != 0 )
+		{
+			xResult = prvOpenPUT( pxClient );
+		}
+		#else
+		{
+			xResult = prvOpenURL( pxClient );
+		}
+		#endif
         break;
 	case ECMD_DELETE:
 	case ECMD_TRACE:
@@ -367,12 +549,32 @@ BaseType_t xHTTPClientWork( TCPClient_t *pxTCPClient )
 BaseType_t xRc;
 HTTPClient_t *pxClient = ( HTTPClient_t * ) pxTCPClient;
 
+	#if( ipconfigUSE_RECV_TO_FILE != 0 ) && ( ipconfigHTTP_ALLOW_PUT != 0 )
+	{
+		if( pxClient->bits.bUploading != pdFALSE_UNSIGNED )
+		{
+			/* The body of a PUT request is being received, these are not
+			commands.  Although against the coding standard of FreeRTOS, a
+			return is done here to simplify this conditional code. */
+			return prvStoreFile( pxClient );
+		}
+	}
+	#endif /* ipconfigUSE_RECV_TO_FILE && ipconfigHTTP_ALLOW_PUT */
+
 	if( pxClient->pxFileHandle != NULL )
 	{
 		prvSendFile( pxClient );
 	}
 
-	xRc = FreeRTOS_recv( pxClient->xSocket, ( void * )pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), 0 );
+	#if( ipconfigUSE_RECV_TO_FILE != 0 ) && ( ipconfigHTTP_ALLOW_PUT != 0 )
+	{
+		xRc = prvReceiveRequest( pxClient );
+	}
+	#else
+	{
+		xRc = FreeRTOS_recv( pxClient->xSocket, ( void * )pcCOMMAND_BUFFER, sizeof( pcCOMMAND_BUFFER ), 0 );
+	}
+	#endif /* ipconfigUSE_RECV_TO_FILE && ipconfigHTTP_ALLOW_PUT */
 
 	if( xRc > 0 )
 	{
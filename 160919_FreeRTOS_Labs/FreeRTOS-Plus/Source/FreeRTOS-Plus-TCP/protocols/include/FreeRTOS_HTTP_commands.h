@@ -59,6 +59,7 @@
 
 enum {
 	WEB_REPLY_OK = 200,
+	WEB_CREATED = 201,
 	WEB_NO_CONTENT = 204,
 	WEB_BAD_REQUEST = 400,
 	WEB_UNAUTHORIZED = 401,
@@ -88,6 +88,14 @@
 	#define ipconfigTCP_FILE_BUFFER_SIZE	( 2048 )
 #endif
 
+#if( ipconfigSUPPORT_POLL_SET != 0 )
+	/* The number of events that FreeRTOS_TCPServerWork() handles per call to
+	FreeRTOS_PollWait(). */
+	#ifndef ipconfigTCP_SERVER_POLL_EVENTS
+		#define ipconfigTCP_SERVER_POLL_EVENTS	( 16 )
+	#endif
+#endif
+
 struct xTCP_CLIENT;
 
 typedef BaseType_t ( * FTCPWorkFunction ) ( struct xTCP_CLIENT * /* pxClient */ );
@@ -124,7 +132,8 @@ struct xHTTP_CLIENT
 	union {
 		struct {
 			uint32_t
-				bReplySent : 1;
+				bReplySent : 1,
+				bUploading : 1;	/* pdTRUE while the body of a PUT request is being stored. */
 		};
 		uint32_t ulFlags;
 	} bits;
@@ -186,12 +195,25 @@ BaseType_t xFTPClientWork( TCPClient_t *pxClient );
 void vHTTPClientDelete( TCPClient_t *pxClient );
 void vFTPClientDelete( TCPClient_t *pxClient );
 
+/* Set the exact events ( eSELECT_READ/WRITE/EXCEPT ) that the server will
+wait for on a socket of 'pxClient', or of a listening socket when 'pxClient' is
+NULL.  When 'xEvents' is zero, the socket is removed from the socket set or
+poll set. */
+void vTCPServerSetEvents( struct xTCP_SERVER *pxServer, Socket_t xSocket, TCPClient_t *pxClient, EventBits_t xEvents );
+
 BaseType_t xMakeAbsolute( struct xFTP_CLIENT *pxClient, char *pcBuffer, BaseType_t xBufferLength, const char *pcFileName );
 BaseType_t xMakeRelative( FTPClient_t *pxClient, char *pcBuffer, BaseType_t xBufferLength, const char *pcFileName );
 
 struct xTCP_SERVER
 {
-	SocketSet_t xSocketSet;
+	#if( ipconfigSUPPORT_POLL_SET != 0 )
+		PollSet_t xPollSet;
+		/* The time at which all clients were called for the last time. */
+		TickType_t xLastSweep;
+		PollEvent_t xEvents[ ipconfigTCP_SERVER_POLL_EVENTS ];
+	#else
+		SocketSet_t xSocketSet;
+	#endif
 	/* A buffer to receive and send TCP commands, either HTTP of FTP. */
 	char pcCommandBuffer[ ipconfigTCP_COMMAND_BUFFER_SIZE ];
 	/* A buffer to access the file system: read or write data. */